@@ -25,6 +25,7 @@
 #include "actions-types.h"
 
 #include "core/gimp.h"
+#include "core/gimpperformancelog.h"
 
 #include "widgets/gimpdashboard.h"
 #include "widgets/gimphelp-ids.h"
@@ -39,8 +40,8 @@
 
 typedef struct
 {
-  GFile                  *folder;
-  GimpDashboardLogParams  params;
+  GFile                    *folder;
+  GimpPerformanceLogParams  params;
 } DashboardLogDialogInfo;
 
 
@@ -184,7 +185,10 @@ dashboard_log_record_cmd_callback (GimpAction *action,
           gtk_box_pack_start (GTK_BOX (hbox2), label, FALSE, FALSE, 0);
           gtk_widget_show (label);
 
-          spinbutton = gimp_spin_button_new_with_range (1, 1000, 1);
+          spinbutton = gimp_spin_button_new_with_range (
+            GIMP_PERFORMANCE_LOG_SAMPLE_FREQUENCY_MIN,
+            GIMP_PERFORMANCE_LOG_SAMPLE_FREQUENCY_MAX,
+            1);
           gtk_box_pack_start (GTK_BOX (hbox2), spinbutton, FALSE, FALSE, 0);
           gtk_widget_show (spinbutton);
 
@@ -57,6 +57,7 @@
 #include "core/gimp-batch.h"
 #include "core/gimp-user-install.h"
 #include "core/gimpimage.h"
+#include "core/gimpperformancelog.h"
 
 #include "file/file-open.h"
 
@@ -73,6 +74,7 @@
 #include "gimp-debug.h"
 
 #include "gimp-intl.h"
+#include "gimp-trace.h"
 #include "gimp-update.h"
 
 
@@ -86,6 +88,8 @@ static void       app_restore_after_callback (Gimp               *gimp,
 static gboolean   app_exit_after_callback    (Gimp               *gimp,
                                               gboolean            kill_it,
                                               GMainLoop         **loop);
+static void       app_performance_log_stop   (Gimp               *gimp);
+static void       app_trace_stop             (void);
 
 #if 0
 /*  left here as documentation how to do compat enums  */
@@ -171,6 +175,7 @@ app_run (const gchar         *full_prog_name,
          const gchar         *session_name,
          const gchar         *batch_interpreter,
          const gchar        **batch_commands,
+         gboolean             batch_farm_worker,
          gboolean             as_new,
          gboolean             no_interface,
          gboolean             no_data,
@@ -185,7 +190,9 @@ app_run (const gchar         *full_prog_name,
          gboolean             show_debug_menu,
          GimpStackTraceMode   stack_trace_mode,
          GimpPDBCompatMode    pdb_compat_mode,
-         const gchar         *backtrace_file)
+         const gchar         *backtrace_file,
+         GFile               *performance_log,
+         GFile               *trace_log)
 {
   GimpInitStatusFunc  update_status_func = NULL;
   Gimp               *gimp;
@@ -198,6 +205,20 @@ app_run (const gchar         *full_prog_name,
   gchar              *language   = NULL;
   GError             *font_error = NULL;
 
+  /*  before any plug-in is started, which would inherit stdout  */
+  if (batch_farm_worker)
+    {
+      GError *error = NULL;
+
+      if (! gimp_batch_serve_init (&error))
+        {
+          g_printerr ("%s\n", error->message);
+          g_clear_error (&error);
+
+          app_exit (EXIT_FAILURE);
+        }
+    }
+
   if (filenames && filenames[0] && ! filenames[1] &&
       g_file_test (filenames[0], G_FILE_TEST_IS_DIR))
     {
@@ -238,6 +259,17 @@ app_run (const gchar         *full_prog_name,
   if (language)
     g_free (language);
 
+  if (trace_log)
+    {
+      GError *error = NULL;
+
+      if (! gimp_trace_start (trace_log, &error))
+        {
+          g_printerr (_("Failed to record trace: %s\n"), error->message);
+          g_clear_error (&error);
+        }
+    }
+
   /*  Create an instance of the "Gimp" object which is the root of the
    *  core object system
    */
@@ -310,6 +342,21 @@ app_run (const gchar         *full_prog_name,
   /*  initialize lowlevel stuff  */
   gimp_gegl_init (gimp);
 
+  /*  start recording right after GEGL is configured, so that the log
+   *  covers the rest of the startup
+   */
+  if (performance_log)
+    {
+      GError *error = NULL;
+
+      if (! gimp_performance_log_record_start (performance_log, &error))
+        {
+          g_printerr (_("Failed to record performance log: %s\n"),
+                      error->message);
+          g_clear_error (&error);
+        }
+    }
+
   /*  Connect our restore_after callback before gui_init() connects
    *  theirs, so ours runs first and can grab the initial monitor
    *  before the GUI's restore_after callback resets it.
@@ -439,8 +486,17 @@ app_run (const gchar         *full_prog_name,
       g_error_free (font_error);
     }
 
-  if (run_loop)
-    gimp_batch_run (gimp, batch_interpreter, batch_commands);
+  if (run_loop && batch_farm_worker)
+    {
+      gimp_batch_serve (gimp, batch_interpreter);
+
+      /*  the farm closed our stdin, we're done  */
+      gimp_exit (gimp, TRUE);
+    }
+  else if (run_loop)
+    {
+      gimp_batch_run (gimp, batch_interpreter, batch_commands);
+    }
 
   if (run_loop)
     g_main_loop_run (loop);
@@ -450,6 +506,9 @@ app_run (const gchar         *full_prog_name,
 
   g_main_loop_unref (loop);
 
+  app_performance_log_stop (gimp);
+  app_trace_stop ();
+
   gimp_gegl_exit (gimp);
 
   errors_exit ();
@@ -494,6 +553,9 @@ app_exit_after_callback (Gimp       *gimp,
   if (gimp->be_verbose)
     g_print ("EXIT: %s\n", G_STRFUNC);
 
+  app_performance_log_stop (gimp);
+  app_trace_stop ();
+
   /*
    *  In stable releases, we simply call exit() here. This speeds up
    *  the process of quitting GIMP and also works around the problem
@@ -522,3 +584,28 @@ app_exit_after_callback (Gimp       *gimp,
 
   return FALSE;
 }
+
+static void
+app_performance_log_stop (Gimp *gimp)
+{
+  GError *error = NULL;
+
+  if (! gimp_performance_log_record_stop (gimp, &error))
+    {
+      g_printerr (_("Failed to record performance log: %s\n"),
+                  error->message);
+      g_clear_error (&error);
+    }
+}
+
+static void
+app_trace_stop (void)
+{
+  GError *error = NULL;
+
+  if (! gimp_trace_stop (&error))
+    {
+      g_printerr (_("Failed to record trace: %s\n"), error->message);
+      g_clear_error (&error);
+    }
+}
@@ -37,6 +37,7 @@ void  app_run       (const gchar         *full_prog_name,
                      const gchar         *session_name,
                      const gchar         *batch_interpreter,
                      const gchar        **batch_commands,
+                     gboolean             batch_farm_worker,
                      gboolean             as_new,
                      gboolean             no_interface,
                      gboolean             no_data,
@@ -51,7 +52,9 @@ void  app_run       (const gchar         *full_prog_name,
                      gboolean             show_debug_menu,
                      GimpStackTraceMode   stack_trace_mode,
                      GimpPDBCompatMode    pdb_compat_mode,
-                     const gchar         *backtrace_file);
+                     const gchar         *backtrace_file,
+                     GFile               *performance_log,
+                     GFile               *trace_log);
 
 
 #endif /* __APP_H__ */
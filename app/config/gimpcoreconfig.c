@@ -109,6 +109,8 @@ enum
   PROP_UNDO_PREVIEW_SIZE,
   PROP_FILTER_HISTORY_SIZE,
   PROP_PLUGINRC_PATH,
+  PROP_PLUG_IN_PERSISTENT_TIMEOUT,
+  PROP_PLUG_IN_PERSISTENT_MEMORY,
   PROP_LAYER_PREVIEWS,
   PROP_GROUP_LAYER_PREVIEWS,
   PROP_LAYER_PREVIEW_SIZE,
@@ -637,6 +639,20 @@ gimp_core_config_class_init (GimpCoreConfigClass *klass)
                          GIMP_PARAM_STATIC_STRINGS |
                          GIMP_CONFIG_PARAM_RESTART);
 
+  GIMP_CONFIG_PROP_INT (object_class, PROP_PLUG_IN_PERSISTENT_TIMEOUT,
+                        "plug-in-persistent-timeout",
+                        "Persistent plug-in timeout",
+                        PLUG_IN_PERSISTENT_TIMEOUT_BLURB,
+                        0, 3600, 0,
+                        GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_MEMSIZE (object_class, PROP_PLUG_IN_PERSISTENT_MEMORY,
+                            "plug-in-persistent-memory",
+                            "Persistent plug-in memory",
+                            PLUG_IN_PERSISTENT_MEMORY_BLURB,
+                            0, GIMP_MAX_MEMSIZE, 1 << 28, /* 256MB */
+                            GIMP_PARAM_STATIC_STRINGS);
+
   GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_LAYER_PREVIEWS,
                             "layer-previews",
                             "Layer previews",
@@ -1083,6 +1099,12 @@ gimp_core_config_set_property (GObject      *object,
       g_free (core_config->plug_in_rc_path);
       core_config->plug_in_rc_path = g_value_dup_string (value);
       break;
+    case PROP_PLUG_IN_PERSISTENT_TIMEOUT:
+      core_config->plug_in_persistent_timeout = g_value_get_int (value);
+      break;
+    case PROP_PLUG_IN_PERSISTENT_MEMORY:
+      core_config->plug_in_persistent_memory = g_value_get_uint64 (value);
+      break;
     case PROP_LAYER_PREVIEWS:
       core_config->layer_previews = g_value_get_boolean (value);
       break;
@@ -1317,6 +1339,12 @@ gimp_core_config_get_property (GObject    *object,
     case PROP_PLUGINRC_PATH:
       g_value_set_string (value, core_config->plug_in_rc_path);
       break;
+    case PROP_PLUG_IN_PERSISTENT_TIMEOUT:
+      g_value_set_int (value, core_config->plug_in_persistent_timeout);
+      break;
+    case PROP_PLUG_IN_PERSISTENT_MEMORY:
+      g_value_set_uint64 (value, core_config->plug_in_persistent_memory);
+      break;
     case PROP_LAYER_PREVIEWS:
       g_value_set_boolean (value, core_config->layer_previews);
       break;
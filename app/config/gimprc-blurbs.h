@@ -335,6 +335,16 @@ _("Sets how many threads GIMP should use for operations that support it.")
 #define PLUG_IN_PATH_BLURB \
 "Sets the plug-in search path."
 
+#define PLUG_IN_PERSISTENT_MEMORY_BLURB \
+"Idle persistent plug-ins which use more memory than this are not kept " \
+"running."
+
+#define PLUG_IN_PERSISTENT_TIMEOUT_BLURB \
+"How many seconds to keep an idle persistent plug-in running, so that " \
+"the next call of one of its procedures doesn't have to start it again. " \
+"Only plug-ins which declare that they can be reused are kept.  0 means " \
+"that plug-ins are never kept running."
+
 #define PLUGINRC_PATH_BLURB \
 "Sets the pluginrc search path."
 
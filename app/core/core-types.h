@@ -231,8 +231,11 @@ typedef struct _GimpBacktrace                   GimpBacktrace;
 typedef struct _GimpBoundSeg                    GimpBoundSeg;
 typedef struct _GimpChunkIterator               GimpChunkIterator;
 typedef struct _GimpCoords                      GimpCoords;
+typedef struct _GimpDrawableTransformBatch      GimpDrawableTransformBatch;
 typedef struct _GimpGradientSegment             GimpGradientSegment;
 typedef struct _GimpPaletteEntry                GimpPaletteEntry;
+typedef struct _GimpPerformanceLog              GimpPerformanceLog;
+typedef struct _GimpPerformanceLogParams        GimpPerformanceLogParams;
 typedef struct _GimpScanConvert                 GimpScanConvert;
 typedef struct _GimpTempBuf                     GimpTempBuf;
 typedef         guint32                         GimpTattoo;
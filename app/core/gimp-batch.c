@@ -17,9 +17,23 @@
 
 #include "config.h"
 
+#include <errno.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef G_OS_UNIX
+#include <fcntl.h>
+#endif
+
+#ifdef G_OS_WIN32
+#include <io.h>
+#endif
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
 
@@ -29,6 +43,7 @@
 
 #include "gimp.h"
 #include "gimp-batch.h"
+#include "gimpimage.h"
 #include "gimpparamspecs.h"
 
 #include "pdb/gimppdb.h"
@@ -40,13 +55,26 @@
 #define BATCH_DEFAULT_EVAL_PROC   "plug-in-script-fu-eval"
 
 
-static void  gimp_batch_exit_after_callback (Gimp          *gimp) G_GNUC_NORETURN;
+static void                gimp_batch_exit_after_callback       (Gimp          *gimp) G_GNUC_NORETURN;
+static void                gimp_batch_serve_exit_after_callback (Gimp          *gimp) G_GNUC_NORETURN;
+
+static void                gimp_batch_serve_message             (const gchar   *message);
+static void                gimp_batch_serve_delete_images       (Gimp          *gimp,
+                                                                 GList         *keep);
 
-static void  gimp_batch_run_cmd             (Gimp          *gimp,
-                                             const gchar   *proc_name,
-                                             GimpProcedure *procedure,
-                                             GimpRunMode    run_mode,
-                                             const gchar   *cmd);
+static const gchar       * gimp_batch_get_interpreter           (Gimp          *gimp,
+                                                                 const gchar   *batch_interpreter);
+static gchar             * gimp_batch_read_line                 (FILE          *stream);
+
+static GimpPDBStatusType   gimp_batch_run_cmd                   (Gimp          *gimp,
+                                                                 const gchar   *proc_name,
+                                                                 GimpProcedure *procedure,
+                                                                 GimpRunMode    run_mode,
+                                                                 const gchar   *cmd);
+
+
+/*  the batch farm worker's messages to the farm  */
+static FILE *batch_control = NULL;
 
 
 void
@@ -63,19 +91,7 @@ gimp_batch_run (Gimp         *gimp,
                                     G_CALLBACK (gimp_batch_exit_after_callback),
                                     NULL);
 
-  if (! batch_interpreter)
-    {
-      batch_interpreter = g_getenv ("GIMP_BATCH_INTERPRETER");
-
-      if (! batch_interpreter)
-        {
-          batch_interpreter = BATCH_DEFAULT_EVAL_PROC;
-
-          if (gimp->be_verbose)
-            g_printerr (_("No batch interpreter specified, using the default "
-                          "'%s'.\n"), batch_interpreter);
-        }
-    }
+  batch_interpreter = gimp_batch_get_interpreter (gimp, batch_interpreter);
 
   /*  script-fu text console, hardcoded for backward compatibility  */
 
@@ -116,6 +132,124 @@ gimp_batch_run (Gimp         *gimp,
   g_signal_handler_disconnect (gimp, exit_id);
 }
 
+/*
+ * Sets up a batch farm worker's messages to the farm, which go to what
+ * is stdout now.  Everything else printed to stdout afterwards, by GIMP
+ * and by the plug-ins it starts, goes to stderr instead, so it can't
+ * get mixed up with the messages.  This has to be called before any
+ * plug-in is started.
+ */
+gboolean
+gimp_batch_serve_init (GError **error)
+{
+  gint fd;
+
+  g_return_val_if_fail (batch_control == NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  fflush (stdout);
+
+  fd = dup (fileno (stdout));
+
+  if (fd < 0 || dup2 (fileno (stderr), fileno (stdout)) < 0)
+    {
+      gint errsv = errno;
+
+      if (fd >= 0)
+        close (fd);
+
+      g_set_error_literal (error, G_FILE_ERROR,
+                           g_file_error_from_errno (errsv),
+                           g_strerror (errsv));
+      return FALSE;
+    }
+
+#ifdef G_OS_UNIX
+  fcntl (fd, F_SETFD, FD_CLOEXEC);
+#endif
+
+  batch_control = fdopen (fd, "w");
+
+  if (! batch_control)
+    {
+      gint errsv = errno;
+
+      close (fd);
+
+      g_set_error_literal (error, G_FILE_ERROR,
+                           g_file_error_from_errno (errsv),
+                           g_strerror (errsv));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*
+ * Runs batch commands read from stdin, one per line, for as long as
+ * stdin stays open.  This is the worker side of the batch farm (see
+ * app/gimp-batch-farm.c): before reading a command it announces itself
+ * as ready, and after running it reports the command's status, both on
+ * the channel set up by gimp_batch_serve_init().  The images a command
+ * leaves behind are deleted once it is done.
+ */
+void
+gimp_batch_serve (Gimp        *gimp,
+                  const gchar *batch_interpreter)
+{
+  GimpProcedure *eval_proc;
+  gchar         *cmd;
+
+  g_return_if_fail (batch_control != NULL);
+
+  batch_interpreter = gimp_batch_get_interpreter (gimp, batch_interpreter);
+
+  eval_proc = gimp_pdb_lookup_procedure (gimp->pdb, batch_interpreter);
+
+  if (! eval_proc)
+    {
+      g_message (_("The batch interpreter '%s' is not available. "
+                   "Batch mode disabled."), batch_interpreter);
+      return;
+    }
+
+  g_signal_connect_after (gimp, "exit",
+                          G_CALLBACK (gimp_batch_serve_exit_after_callback),
+                          NULL);
+
+  while (TRUE)
+    {
+      GimpPDBStatusType  status;
+      GEnumValue        *value;
+      GList             *images;
+      gchar             *message;
+
+      gimp_batch_serve_message ("ready");
+
+      cmd = gimp_batch_read_line (stdin);
+
+      if (! cmd)
+        break;
+
+      images = g_list_copy (gimp_get_image_iter (gimp));
+
+      status = gimp_batch_run_cmd (gimp, batch_interpreter, eval_proc,
+                                   GIMP_RUN_NONINTERACTIVE, cmd);
+
+      gimp_batch_serve_delete_images (gimp, images);
+      g_list_free (images);
+
+      value = g_enum_get_value (g_type_class_peek (GIMP_TYPE_PDB_STATUS_TYPE),
+                                status);
+
+      message = g_strdup_printf ("done %s",
+                                 value ? value->value_nick : "unknown");
+      gimp_batch_serve_message (message);
+      g_free (message);
+
+      g_free (cmd);
+    }
+}
 
 /*
  * The purpose of this handler is to exit GIMP cleanly when the batch
@@ -134,6 +268,108 @@ gimp_batch_exit_after_callback (Gimp *gimp)
   exit (EXIT_SUCCESS);
 }
 
+/*
+ * Same as above for a batch farm worker, which additionally tells the
+ * farm that it is going away on purpose, so the command isn't counted
+ * as a crash.
+ */
+static void
+gimp_batch_serve_exit_after_callback (Gimp *gimp)
+{
+  gimp_batch_serve_message ("quit");
+
+  gimp_batch_exit_after_callback (gimp);
+}
+
+static void
+gimp_batch_serve_message (const gchar *message)
+{
+  /*  let the command's own output through first  */
+  fflush (stdout);
+  fflush (stderr);
+
+  fprintf (batch_control, "%s %s\n", GIMP_BATCH_FARM_TAG, message);
+  fflush (batch_control);
+}
+
+/*  deletes the images which are not in keep, as the image-delete
+ *  procedure would
+ */
+static void
+gimp_batch_serve_delete_images (Gimp  *gimp,
+                                GList *keep)
+{
+  GList *images = g_list_copy (gimp_get_image_iter (gimp));
+  GList *list;
+
+  for (list = images; list; list = g_list_next (list))
+    {
+      GimpImage *image = list->data;
+
+      if (! g_list_find (keep, image) &&
+          gimp_image_get_display_count (image) == 0)
+        {
+          g_object_unref (image);
+        }
+    }
+
+  g_list_free (images);
+}
+
+static const gchar *
+gimp_batch_get_interpreter (Gimp        *gimp,
+                            const gchar *batch_interpreter)
+{
+  if (! batch_interpreter)
+    {
+      batch_interpreter = g_getenv ("GIMP_BATCH_INTERPRETER");
+
+      if (! batch_interpreter)
+        {
+          batch_interpreter = BATCH_DEFAULT_EVAL_PROC;
+
+          if (gimp->be_verbose)
+            g_printerr (_("No batch interpreter specified, using the default "
+                          "'%s'.\n"), batch_interpreter);
+        }
+    }
+
+  return batch_interpreter;
+}
+
+/*
+ * Reads one line of any length from stream, without the line break.
+ * Returns NULL at the end of the stream.
+ */
+static gchar *
+gimp_batch_read_line (FILE *stream)
+{
+  GString *line = g_string_new (NULL);
+  gchar    buf[1024];
+
+  while (fgets (buf, sizeof (buf), stream))
+    {
+      g_string_append (line, buf);
+
+      if (line->len > 0 && line->str[line->len - 1] == '\n')
+        {
+          g_string_truncate (line, line->len - 1);
+
+          if (line->len > 0 && line->str[line->len - 1] == '\r')
+            g_string_truncate (line, line->len - 1);
+
+          return g_string_free (line, FALSE);
+        }
+    }
+
+  if (line->len > 0)
+    return g_string_free (line, FALSE);
+
+  g_string_free (line, TRUE);
+
+  return NULL;
+}
+
 static inline gboolean
 GIMP_IS_PARAM_SPEC_RUN_MODE (GParamSpec *pspec)
 {
@@ -141,17 +377,18 @@ GIMP_IS_PARAM_SPEC_RUN_MODE (GParamSpec *pspec)
           pspec->value_type == GIMP_TYPE_RUN_MODE);
 }
 
-static void
+static GimpPDBStatusType
 gimp_batch_run_cmd (Gimp          *gimp,
                     const gchar   *proc_name,
                     GimpProcedure *procedure,
                     GimpRunMode    run_mode,
                     const gchar   *cmd)
 {
-  GimpValueArray *args;
-  GimpValueArray *return_vals;
-  GError         *error = NULL;
-  gint            i     = 0;
+  GimpValueArray    *args;
+  GimpValueArray    *return_vals;
+  GimpPDBStatusType  status;
+  GError            *error = NULL;
+  gint               i     = 0;
 
   args = gimp_procedure_get_arguments (procedure);
 
@@ -173,7 +410,9 @@ gimp_batch_run_cmd (Gimp          *gimp,
                                              NULL, &error,
                                              proc_name, args);
 
-  switch (g_value_get_enum (gimp_value_array_index (return_vals, 0)))
+  status = g_value_get_enum (gimp_value_array_index (return_vals, 0));
+
+  switch (status)
     {
     case GIMP_PDB_EXECUTION_ERROR:
       if (error)
@@ -202,6 +441,9 @@ gimp_batch_run_cmd (Gimp          *gimp,
     case GIMP_PDB_SUCCESS:
       g_printerr ("batch command executed successfully\n");
       break;
+
+    default:
+      break;
     }
 
   gimp_value_array_unref (return_vals);
@@ -210,5 +452,5 @@ gimp_batch_run_cmd (Gimp          *gimp,
   if (error)
     g_error_free (error);
 
-  return;
+  return status;
 }
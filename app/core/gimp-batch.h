@@ -19,9 +19,16 @@
 #define __GIMP_BATCH_H__
 
 
-void   gimp_batch_run (Gimp         *gimp,
-                       const gchar  *batch_interpreter,
-                       const gchar **batch_commands);
+/*  prefix of the lines a batch farm worker uses to talk to the farm  */
+#define GIMP_BATCH_FARM_TAG "@@gimp-batch-farm"
+
+
+void       gimp_batch_run        (Gimp         *gimp,
+                                  const gchar  *batch_interpreter,
+                                  const gchar **batch_commands);
+gboolean   gimp_batch_serve_init (GError      **error);
+void       gimp_batch_serve      (Gimp         *gimp,
+                                  const gchar  *batch_interpreter);
 
 
 #endif /* __GIMP_BATCH_H__ */
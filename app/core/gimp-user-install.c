@@ -885,6 +885,7 @@ user_install_migrate_files (GimpUserInstall *install)
           if (strcmp (basename, "documents") == 0      ||
               g_str_has_prefix (basename, "gimpswap.") ||
               strcmp (basename, "pluginrc") == 0       ||
+              strcmp (basename, "pluginrc.bin") == 0   ||
               strcmp (basename, "themerc") == 0        ||
               strcmp (basename, "toolrc") == 0         ||
               strcmp (basename, "gtkrc") == 0)
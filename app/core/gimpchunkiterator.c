@@ -58,13 +58,18 @@ struct _GimpChunkIterator
 {
   cairo_region_t *region;
   cairo_region_t *priority_region;
+  cairo_region_t *preview_region;
 
   GeglRectangle   tile_rect;
   GeglRectangle   priority_rect;
 
   gdouble         interval;
 
+  gint            preview_level;
+  gboolean        preview_pending;
+
   cairo_region_t *current_region;
+  gint            current_level;
   GeglRectangle   current_rect;
 
   gint            current_x;
@@ -164,6 +169,17 @@ gimp_chunk_iterator_merge (GimpChunkIterator *iter)
   /* merge the current rect back to the current region */
   gimp_chunk_iterator_merge_current_rect (iter);
 
+  /* drop the rest of the preview pass.  its area is still part of the
+   * global region, so it will be processed at full resolution regardless.
+   */
+  if (iter->preview_region)
+    {
+      g_clear_pointer (&iter->preview_region, cairo_region_destroy);
+
+      iter->current_region = iter->region;
+      iter->current_level  = 0;
+    }
+
   /* merge the priority region back to the global region */
   if (iter->priority_region)
     {
@@ -188,28 +204,72 @@ gimp_chunk_iterator_prepare (GimpChunkIterator *iter)
         {
           GeglRectangle rect;
 
-          if (! iter->priority_region &&
-              ! gegl_rectangle_is_empty (&iter->priority_rect))
+          if (iter->preview_region &&
+              cairo_region_is_empty (iter->preview_region))
             {
-              iter->priority_region = cairo_region_copy (iter->region);
+              g_clear_pointer (&iter->preview_region, cairo_region_destroy);
 
-              cairo_region_intersect_rectangle (
-                iter->priority_region,
-                (const cairo_rectangle_int_t *) &iter->priority_rect);
+              iter->current_level = 0;
+            }
 
-              cairo_region_subtract_rectangle (
-                iter->region,
-                (const cairo_rectangle_int_t *) &iter->priority_rect);
+          if (iter->preview_pending)
+            {
+              iter->preview_pending = FALSE;
+
+              /* the preview pass covers the part of the region inside the
+               * priority rect, and leaves the region itself intact, so
+               * that the same area is refined by the following passes.
+               */
+              if (! gegl_rectangle_is_empty (&iter->priority_rect))
+                {
+                  iter->preview_region = cairo_region_copy (iter->region);
+
+                  if (iter->priority_region)
+                    {
+                      cairo_region_union (iter->preview_region,
+                                          iter->priority_region);
+                    }
+
+                  cairo_region_intersect_rectangle (
+                    iter->preview_region,
+                    (const cairo_rectangle_int_t *) &iter->priority_rect);
+
+                  if (cairo_region_is_empty (iter->preview_region))
+                    g_clear_pointer (&iter->preview_region,
+                                     cairo_region_destroy);
+                }
             }
 
-          if (! iter->priority_region ||
-              cairo_region_is_empty (iter->priority_region))
+          if (iter->preview_region)
             {
-              iter->current_region = iter->region;
+              iter->current_region = iter->preview_region;
+              iter->current_level  = iter->preview_level;
             }
           else
             {
-              iter->current_region = iter->priority_region;
+              if (! iter->priority_region &&
+                  ! gegl_rectangle_is_empty (&iter->priority_rect))
+                {
+                  iter->priority_region = cairo_region_copy (iter->region);
+
+                  cairo_region_intersect_rectangle (
+                    iter->priority_region,
+                    (const cairo_rectangle_int_t *) &iter->priority_rect);
+
+                  cairo_region_subtract_rectangle (
+                    iter->region,
+                    (const cairo_rectangle_int_t *) &iter->priority_rect);
+                }
+
+              if (! iter->priority_region ||
+                  cairo_region_is_empty (iter->priority_region))
+                {
+                  iter->current_region = iter->region;
+                }
+              else
+                {
+                  iter->current_region = iter->priority_region;
+                }
             }
 
           if (cairo_region_is_empty (iter->current_region))
@@ -300,7 +360,11 @@ gimp_chunk_iterator_calc_rect (GimpChunkIterator *iter,
   if (readjust_height)
     gimp_chunk_iterator_reset_target_area (iter);
 
-  target_area = gimp_chunk_iterator_get_target_area (iter);
+  /* the target area is measured in full-resolution pixels; a preview pass
+   * processes 4 times fewer pixels per level of detail.
+   */
+  target_area = gimp_chunk_iterator_get_target_area (iter) *
+                (1 << (2 * iter->current_level));
 
   aspect_ratio = (gdouble) iter->tile_rect.height /
                  (gdouble) iter->tile_rect.width;
@@ -398,6 +462,25 @@ gimp_chunk_iterator_set_priority_rect (GimpChunkIterator   *iter,
       iter->priority_rect = *rect;
 
       gimp_chunk_iterator_merge (iter);
+
+      /* preview the newly-prioritized area */
+      iter->preview_pending = iter->preview_level > 0;
+    }
+}
+
+void
+gimp_chunk_iterator_set_preview_level (GimpChunkIterator *iter,
+                                       gint               level)
+{
+  g_return_if_fail (iter != NULL);
+  g_return_if_fail (level >= 0);
+
+  if (level != iter->preview_level)
+    {
+      gimp_chunk_iterator_merge (iter);
+
+      iter->preview_level   = level;
+      iter->preview_pending = level > 0;
     }
 }
 
@@ -484,7 +567,7 @@ gimp_chunk_iterator_get_rect (GimpChunkIterator *iter,
     {
       gimp_chunk_iterator_calc_rect (iter, rect, FALSE);
 
-      if (rect->width * rect->height >=
+      if ((rect->width * rect->height >> (2 * iter->current_level)) >=
           MAX_AREA_RATIO * gimp_chunk_iterator_get_target_area (iter))
         {
           GeglRectangle old_rect = *rect;
@@ -523,11 +606,19 @@ gimp_chunk_iterator_get_rect (GimpChunkIterator *iter,
   iter->current_x += rect->width;
 
   iter->last_time = time;
-  iter->last_area = rect->width * rect->height;
+  iter->last_area = rect->width * rect->height >> (2 * iter->current_level);
 
   return TRUE;
 }
 
+gint
+gimp_chunk_iterator_get_level (GimpChunkIterator *iter)
+{
+  g_return_val_if_fail (iter != NULL, 0);
+
+  return iter->current_level;
+}
+
 cairo_region_t *
 gimp_chunk_iterator_stop (GimpChunkIterator *iter,
                           gboolean           free_region)
@@ -548,6 +639,7 @@ gimp_chunk_iterator_stop (GimpChunkIterator *iter,
     }
 
   g_clear_pointer (&iter->priority_region, cairo_region_destroy);
+  g_clear_pointer (&iter->preview_region,  cairo_region_destroy);
 
   g_slice_free (GimpChunkIterator, iter);
 
@@ -33,9 +33,13 @@ void                gimp_chunk_iterator_set_priority_rect (GimpChunkIterator   *
 void                gimp_chunk_iterator_set_interval      (GimpChunkIterator   *iter,
                                                            gdouble              interval);
 
+void                gimp_chunk_iterator_set_preview_level (GimpChunkIterator   *iter,
+                                                           gint                 level);
+
 gboolean            gimp_chunk_iterator_next              (GimpChunkIterator   *iter);
 gboolean            gimp_chunk_iterator_get_rect          (GimpChunkIterator   *iter,
                                                            GeglRectangle       *rect);
+gint                gimp_chunk_iterator_get_level         (GimpChunkIterator   *iter);
 
 cairo_region_t    * gimp_chunk_iterator_stop              (GimpChunkIterator   *iter,
                                                            gboolean             free_region);
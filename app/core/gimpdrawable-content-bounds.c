@@ -0,0 +1,177 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "gegl/gimp-gegl-loops.h"
+
+#include "gimpchannel.h"
+#include "gimpdrawable.h"
+#include "gimpdrawable-content-bounds.h"
+#include "gimpdrawable-private.h"
+#include "gimppickable.h"
+
+
+/*  The content bounds of a drawable are the bounds of its non-transparent
+ *  pixels (of its nonzero pixels, for channels).  They are computed by
+ *  scanning the drawable once, and are then maintained incrementally from
+ *  the drawable's update rectangles, which can only grow them.  The
+ *  incrementally maintained bounds are therefore a conservative superset
+ *  of the exact bounds; asking for the exact bounds rescans only the area
+ *  inside the current bounds.
+ */
+
+
+/*  local function prototypes  */
+
+static const Babl * gimp_drawable_content_bounds_get_format (GimpDrawable *drawable);
+static void         gimp_drawable_content_bounds_scan       (GimpDrawable *drawable);
+
+
+/*  public functions  */
+
+gboolean
+gimp_drawable_get_content_bounds (GimpDrawable  *drawable,
+                                  gboolean       exact,
+                                  GeglRectangle *bounds)
+{
+  GimpDrawablePrivate *private;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+  g_return_val_if_fail (bounds != NULL, FALSE);
+
+  private = drawable->private;
+
+  if (! private->content_bounds_valid ||
+      (exact && ! private->content_bounds_exact))
+    {
+      gimp_drawable_content_bounds_scan (drawable);
+    }
+
+  *bounds = private->content_bounds;
+
+  return ! gegl_rectangle_is_empty (bounds);
+}
+
+void
+gimp_drawable_content_bounds_update (GimpDrawable *drawable,
+                                     gint          x,
+                                     gint          y,
+                                     gint          width,
+                                     gint          height)
+{
+  GimpDrawablePrivate *private;
+  GeglRectangle        rect;
+
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+
+  private = drawable->private;
+
+  if (! private->content_bounds_valid)
+    return;
+
+  if (! gegl_rectangle_intersect (&rect,
+                                  GEGL_RECTANGLE (x, y, width, height),
+                                  GEGL_RECTANGLE (0, 0,
+                                                  gimp_item_get_width  (GIMP_ITEM (drawable)),
+                                                  gimp_item_get_height (GIMP_ITEM (drawable)))))
+    {
+      return;
+    }
+
+  if (gegl_rectangle_contains (&private->content_bounds, &rect))
+    {
+      /*  the update may have erased content inside the bounds  */
+      private->content_bounds_exact = FALSE;
+
+      return;
+    }
+
+  if (gegl_rectangle_is_empty (&private->content_bounds))
+    private->content_bounds = rect;
+  else
+    gegl_rectangle_bounding_box (&private->content_bounds,
+                                 &private->content_bounds, &rect);
+
+  private->content_bounds_exact = FALSE;
+}
+
+void
+gimp_drawable_content_bounds_invalidate (GimpDrawable *drawable)
+{
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+
+  drawable->private->content_bounds_valid = FALSE;
+  drawable->private->content_bounds_exact = FALSE;
+}
+
+
+/*  private functions  */
+
+static const Babl *
+gimp_drawable_content_bounds_get_format (GimpDrawable *drawable)
+{
+  if (GIMP_IS_CHANNEL (drawable))
+    return babl_format ("Y float");
+  else if (gimp_drawable_has_alpha (drawable))
+    return babl_format ("A float");
+
+  return NULL;
+}
+
+static void
+gimp_drawable_content_bounds_scan (GimpDrawable *drawable)
+{
+  GimpDrawablePrivate *private = drawable->private;
+  const Babl          *format;
+  GeglRectangle        rect;
+
+  rect.x      = 0;
+  rect.y      = 0;
+  rect.width  = gimp_item_get_width  (GIMP_ITEM (drawable));
+  rect.height = gimp_item_get_height (GIMP_ITEM (drawable));
+
+  format = gimp_drawable_content_bounds_get_format (drawable);
+
+  if (! format)
+    {
+      /*  drawables without alpha are opaque everywhere  */
+      private->content_bounds = rect;
+    }
+  else
+    {
+      /*  when refining valid bounds, content can only have been removed
+       *  inside them
+       */
+      if (private->content_bounds_valid)
+        rect = private->content_bounds;
+
+      gimp_pickable_flush (GIMP_PICKABLE (drawable));
+
+      gimp_gegl_buffer_get_content_bounds (gimp_drawable_get_buffer (drawable),
+                                           &rect, format,
+                                           &private->content_bounds);
+    }
+
+  private->content_bounds_valid = TRUE;
+  private->content_bounds_exact = TRUE;
+}
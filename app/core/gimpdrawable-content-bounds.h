@@ -0,0 +1,36 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_DRAWABLE_CONTENT_BOUNDS_H__
+#define __GIMP_DRAWABLE_CONTENT_BOUNDS_H__
+
+
+gboolean   gimp_drawable_get_content_bounds        (GimpDrawable  *drawable,
+                                                    gboolean       exact,
+                                                    GeglRectangle *bounds);
+
+/*  private  */
+
+void       gimp_drawable_content_bounds_update     (GimpDrawable  *drawable,
+                                                    gint           x,
+                                                    gint           y,
+                                                    gint           width,
+                                                    gint           height);
+void       gimp_drawable_content_bounds_invalidate (GimpDrawable  *drawable);
+
+
+#endif  /*  __GIMP_DRAWABLE_CONTENT_BOUNDS_H__  */
@@ -41,6 +41,12 @@ struct _GimpDrawablePrivate
   GeglBuffer       *paint_buffer;
   cairo_region_t   *paint_copy_region;
   cairo_region_t   *paint_update_region;
+  cairo_region_t   *paint_flush_copy_region;
+  cairo_region_t   *paint_flush_update_region;
+
+  GeglRectangle     content_bounds;
+  gboolean          content_bounds_valid;
+  gboolean          content_bounds_exact;
 };
 
 #endif /* __GIMP_DRAWABLE_PRIVATE_H__ */
@@ -34,23 +34,302 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimp-transform-resize.h"
+#include "gimpasync.h"
 #include "gimpchannel.h"
 #include "gimpcontext.h"
 #include "gimpdrawable-transform.h"
 #include "gimpimage.h"
 #include "gimpimage-undo.h"
 #include "gimpimage-undo-push.h"
+#include "gimpitemstack.h"
 #include "gimplayer.h"
 #include "gimplayer-floating-selection.h"
 #include "gimplayer-new.h"
+#include "gimplayermask.h"
 #include "gimppickable.h"
 #include "gimpprogress.h"
 #include "gimpselection.h"
+#include "gimpwaitable.h"
 
 #include "gimp-intl.h"
 
 
+#define TRANSFORM_JOB_KEY "gimp-drawable-transform-job"
+
+
+typedef struct
+{
+  /*  source geometry  */
+  gint                 u1, v1, u2, v2;
+  GimpTransformResize  clip_result;
+
+  /*  target geometry, shared by all drawables using this plan  */
+  gint                 x1, y1, x2, y2;
+  GimpMatrix3          gegl_matrix;
+} TransformPlan;
+
+typedef struct
+{
+  GimpDrawableTransformBatch *batch;
+  GimpDrawable               *drawable;
+  GimpItem                   *owner;
+  GeglBuffer                 *orig_buffer;
+  GeglBuffer                 *src_buffer;
+  const TransformPlan        *plan;
+  gint64                      memsize;
+
+  GimpAsync                  *async;
+  GeglBuffer                 *result;
+  gboolean                    processed;
+} TransformJob;
+
+struct _GimpDrawableTransformBatch
+{
+  GimpMatrix3            matrix;
+  GimpInterpolationType  interpolation_type;
+  gint64                 memory_budget;
+
+  GPtrArray             *plans;
+  GPtrArray             *jobs;
+};
+
+
+/*  local function prototypes  */
+
+static void         gimp_drawable_transform_affine_bounds  (const GimpMatrix3   *m,
+                                                            GimpTransformResize  clip_result,
+                                                            gint                 u1,
+                                                            gint                 v1,
+                                                            gint                 u2,
+                                                            gint                 v2,
+                                                            gint                *x1,
+                                                            gint                *y1,
+                                                            gint                *x2,
+                                                            gint                *y2,
+                                                            GimpMatrix3         *gegl_matrix);
+
+static const TransformPlan *
+                    gimp_drawable_transform_batch_get_plan (GimpDrawableTransformBatch *batch,
+                                                            gint                        u1,
+                                                            gint                        v1,
+                                                            gint                        u2,
+                                                            gint                        v2,
+                                                            GimpTransformResize         clip_result);
+static void         gimp_drawable_transform_batch_add_drawable
+                                                           (GimpDrawableTransformBatch *batch,
+                                                            GimpItem                   *owner,
+                                                            GimpDrawable               *drawable,
+                                                            GimpTransformResize         clip_result);
+static void         gimp_drawable_transform_batch_run_job  (GimpAsync                  *async,
+                                                            TransformJob               *job);
+static void         gimp_drawable_transform_batch_clear_job
+                                                           (TransformJob               *job);
+static GeglBuffer * gimp_drawable_transform_batch_steal    (GimpDrawable               *drawable,
+                                                            GeglBuffer                 *orig_buffer,
+                                                            gint                        orig_offset_x,
+                                                            gint                        orig_offset_y,
+                                                            const GimpMatrix3          *matrix,
+                                                            GimpInterpolationType       interpolation_type,
+                                                            GimpTransformResize         clip_result,
+                                                            gint                       *new_offset_x,
+                                                            gint                       *new_offset_y);
+
+
+/*  private functions  */
+
+static void
+gimp_drawable_transform_affine_bounds (const GimpMatrix3   *m,
+                                       GimpTransformResize  clip_result,
+                                       gint                 u1,
+                                       gint                 v1,
+                                       gint                 u2,
+                                       gint                 v2,
+                                       gint                *x1,
+                                       gint                *y1,
+                                       gint                *x2,
+                                       gint                *y2,
+                                       GimpMatrix3         *gegl_matrix)
+{
+  /*  Find the bounding coordinates of target */
+  gimp_transform_resize_boundary (m, clip_result,
+                                  u1, v1, u2, v2,
+                                  x1, y1, x2, y2);
+
+  gimp_matrix3_identity (gegl_matrix);
+  gimp_matrix3_translate (gegl_matrix, u1, v1);
+  gimp_matrix3_mult (m, gegl_matrix);
+  gimp_matrix3_translate (gegl_matrix, -*x1, -*y1);
+}
+
+static const TransformPlan *
+gimp_drawable_transform_batch_get_plan (GimpDrawableTransformBatch *batch,
+                                        gint                        u1,
+                                        gint                        v1,
+                                        gint                        u2,
+                                        gint                        v2,
+                                        GimpTransformResize         clip_result)
+{
+  TransformPlan *plan;
+  gint           i;
+
+  /*  drawables sharing the same geometry (typically same-sized layers, or a
+   *  layer and its mask) share a single resampling plan
+   */
+  for (i = 0; i < batch->plans->len; i++)
+    {
+      plan = g_ptr_array_index (batch->plans, i);
+
+      if (plan->u1 == u1 && plan->v1 == v1 &&
+          plan->u2 == u2 && plan->v2 == v2 &&
+          plan->clip_result == clip_result)
+        {
+          return plan;
+        }
+    }
+
+  plan = g_slice_new (TransformPlan);
+
+  plan->u1          = u1;
+  plan->v1          = v1;
+  plan->u2          = u2;
+  plan->v2          = v2;
+  plan->clip_result = clip_result;
+
+  gimp_drawable_transform_affine_bounds (&batch->matrix, clip_result,
+                                         u1, v1, u2, v2,
+                                         &plan->x1, &plan->y1,
+                                         &plan->x2, &plan->y2,
+                                         &plan->gegl_matrix);
+
+  g_ptr_array_add (batch->plans, plan);
+
+  return plan;
+}
+
+static void
+gimp_drawable_transform_batch_add_drawable (GimpDrawableTransformBatch *batch,
+                                            GimpItem                   *owner,
+                                            GimpDrawable               *drawable,
+                                            GimpTransformResize         clip_result)
+{
+  TransformJob *job;
+  GeglBuffer   *buffer;
+  gint          u1, v1;
+
+  if (g_object_get_data (G_OBJECT (drawable), TRANSFORM_JOB_KEY))
+    return;
+
+  buffer = gimp_drawable_get_buffer (drawable);
+
+  gimp_item_get_offset (GIMP_ITEM (drawable), &u1, &v1);
+
+  job = g_slice_new0 (TransformJob);
+
+  job->batch       = batch;
+  job->drawable    = drawable;
+  job->owner       = owner;
+  job->orig_buffer = g_object_ref (buffer);
+  job->plan        = gimp_drawable_transform_batch_get_plan (
+                       batch,
+                       u1,
+                       v1,
+                       u1 + gegl_buffer_get_width  (buffer),
+                       v1 + gegl_buffer_get_height (buffer),
+                       clip_result);
+  job->memsize     = (gint64) (job->plan->x2 - job->plan->x1) *
+                     (gint64) (job->plan->y2 - job->plan->y1) *
+                     babl_format_get_bytes_per_pixel (
+                       gegl_buffer_get_format (buffer));
+
+  g_object_set_data (G_OBJECT (drawable), TRANSFORM_JOB_KEY, job);
+
+  g_ptr_array_add (batch->jobs, job);
+}
+
+static void
+gimp_drawable_transform_batch_run_job (GimpAsync    *async,
+                                       TransformJob *job)
+{
+  const TransformPlan *plan = job->plan;
+  GeglBuffer          *buffer;
+  GimpMatrix3          gegl_matrix;
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                            plan->x2 - plan->x1,
+                                            plan->y2 - plan->y1),
+                            gegl_buffer_get_format (job->src_buffer));
+
+  gegl_matrix = plan->gegl_matrix;
+
+  gimp_gegl_apply_transform (job->src_buffer, NULL, NULL,
+                             buffer,
+                             job->batch->interpolation_type,
+                             &gegl_matrix);
+
+  gimp_async_finish_full (async, buffer, g_object_unref);
+}
+
+static void
+gimp_drawable_transform_batch_clear_job (TransformJob *job)
+{
+  if (job->async)
+    {
+      gimp_async_cancel_and_wait (job->async);
+
+      g_clear_object (&job->async);
+    }
+
+  g_clear_object (&job->src_buffer);
+  g_clear_object (&job->result);
+}
+
+static GeglBuffer *
+gimp_drawable_transform_batch_steal (GimpDrawable          *drawable,
+                                     GeglBuffer            *orig_buffer,
+                                     gint                   orig_offset_x,
+                                     gint                   orig_offset_y,
+                                     const GimpMatrix3     *matrix,
+                                     GimpInterpolationType  interpolation_type,
+                                     GimpTransformResize    clip_result,
+                                     gint                  *new_offset_x,
+                                     gint                  *new_offset_y)
+{
+  TransformJob        *job;
+  const TransformPlan *plan;
+  GeglBuffer          *result;
+
+  job = g_object_get_data (G_OBJECT (drawable), TRANSFORM_JOB_KEY);
+
+  if (! job || ! job->result)
+    return NULL;
+
+  plan = job->plan;
+
+  /*  only use the precomputed buffer if the caller asks for exactly the
+   *  transformation it was computed for
+   */
+  if (orig_buffer        != job->orig_buffer                              ||
+      orig_offset_x      != plan->u1                                      ||
+      orig_offset_y      != plan->v1                                      ||
+      clip_result        != plan->clip_result                             ||
+      interpolation_type != job->batch->interpolation_type                ||
+      ! gimp_matrix3_equal (matrix, &job->batch->matrix))
+    {
+      return NULL;
+    }
+
+  result      = job->result;
+  job->result = NULL;
+
+  *new_offset_x = plan->x1;
+  *new_offset_y = plan->y1;
+
+  return result;
+}
+
+
 /*  public functions  */
 
 GeglBuffer *
@@ -95,25 +374,33 @@ gimp_drawable_transform_buffer_affine (GimpDrawable            *drawable,
       gimp_matrix3_invert (&m);
     }
 
+  /*  Use the result of a batch transform, if one was prepared  */
+  new_buffer = gimp_drawable_transform_batch_steal (drawable, orig_buffer,
+                                                    orig_offset_x,
+                                                    orig_offset_y,
+                                                    &m,
+                                                    interpolation_type,
+                                                    clip_result,
+                                                    new_offset_x,
+                                                    new_offset_y);
+
+  if (new_buffer)
+    return new_buffer;
+
   u1 = orig_offset_x;
   v1 = orig_offset_y;
   u2 = u1 + gegl_buffer_get_width  (orig_buffer);
   v2 = v1 + gegl_buffer_get_height (orig_buffer);
 
-  /*  Find the bounding coordinates of target */
-  gimp_transform_resize_boundary (&m, clip_result,
-                                  u1, v1, u2, v2,
-                                  &x1, &y1, &x2, &y2);
+  gimp_drawable_transform_affine_bounds (&m, clip_result,
+                                         u1, v1, u2, v2,
+                                         &x1, &y1, &x2, &y2,
+                                         &gegl_matrix);
 
   /*  Get the new temporary buffer for the transformed result  */
   new_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, x2 - x1, y2 - y1),
                                 gegl_buffer_get_format (orig_buffer));
 
-  gimp_matrix3_identity (&gegl_matrix);
-  gimp_matrix3_translate (&gegl_matrix, u1, v1);
-  gimp_matrix3_mult (&m, &gegl_matrix);
-  gimp_matrix3_translate (&gegl_matrix, -x1, -y1);
-
   gimp_gegl_apply_transform (orig_buffer, progress, NULL,
                              new_buffer,
                              interpolation_type,
@@ -1080,3 +1367,191 @@ gimp_drawable_transform_paste (GimpDrawable     *drawable,
 
   return drawable;
 }
+
+
+/*  batch transform
+ *
+ *  transforming a whole image transforms every layer, mask and channel
+ *  with the same matrix.  a GimpDrawableTransformBatch resamples the
+ *  drawables of upcoming items concurrently ahead of time, bounded by a
+ *  memory budget, so that gimp_drawable_transform_buffer_affine() can pick
+ *  up the precomputed result instead of resampling serially.
+ */
+
+GimpDrawableTransformBatch *
+gimp_drawable_transform_batch_new (const GimpMatrix3      *matrix,
+                                   GimpTransformDirection  direction,
+                                   GimpInterpolationType   interpolation_type,
+                                   gint64                  memory_budget)
+{
+  GimpDrawableTransformBatch *batch;
+
+  g_return_val_if_fail (matrix != NULL, NULL);
+
+  batch = g_slice_new0 (GimpDrawableTransformBatch);
+
+  batch->matrix             = *matrix;
+  batch->interpolation_type = interpolation_type;
+  batch->memory_budget      = memory_budget;
+
+  if (direction == GIMP_TRANSFORM_BACKWARD)
+    gimp_matrix3_invert (&batch->matrix);
+
+  batch->plans = g_ptr_array_new ();
+  batch->jobs  = g_ptr_array_new ();
+
+  return batch;
+}
+
+void
+gimp_drawable_transform_batch_free (GimpDrawableTransformBatch *batch)
+{
+  gint i;
+
+  g_return_if_fail (batch != NULL);
+
+  for (i = 0; i < batch->jobs->len; i++)
+    {
+      TransformJob *job = g_ptr_array_index (batch->jobs, i);
+
+      gimp_drawable_transform_batch_clear_job (job);
+
+      g_object_set_data (G_OBJECT (job->drawable), TRANSFORM_JOB_KEY, NULL);
+      g_object_unref (job->orig_buffer);
+
+      g_slice_free (TransformJob, job);
+    }
+
+  for (i = 0; i < batch->plans->len; i++)
+    g_slice_free (TransformPlan, g_ptr_array_index (batch->plans, i));
+
+  g_ptr_array_free (batch->jobs,  TRUE);
+  g_ptr_array_free (batch->plans, TRUE);
+
+  g_slice_free (GimpDrawableTransformBatch, batch);
+}
+
+void
+gimp_drawable_transform_batch_add (GimpDrawableTransformBatch *batch,
+                                   GimpItem                   *item,
+                                   GimpTransformResize         clip_result)
+{
+  g_return_if_fail (batch != NULL);
+  g_return_if_fail (GIMP_IS_ITEM (item));
+
+  /*  collect the drawables which transforming 'item' will transform, in
+   *  the order in which they are going to be transformed
+   */
+  if (gimp_viewable_get_children (GIMP_VIEWABLE (item)))
+    {
+      GimpContainer *children;
+      GList         *list;
+
+      children = gimp_viewable_get_children (GIMP_VIEWABLE (item));
+
+      for (list = gimp_item_stack_get_item_iter (GIMP_ITEM_STACK (children));
+           list;
+           list = g_list_next (list))
+        {
+          GimpItem *child = list->data;
+          gint      i;
+
+          /*  attribute the child's drawables to 'item'  */
+          i = batch->jobs->len;
+
+          gimp_drawable_transform_batch_add (batch, child, clip_result);
+
+          for (; i < batch->jobs->len; i++)
+            {
+              TransformJob *job = g_ptr_array_index (batch->jobs, i);
+
+              job->owner = item;
+            }
+        }
+    }
+  else if (GIMP_IS_DRAWABLE (item))
+    {
+      gimp_drawable_transform_batch_add_drawable (batch, item,
+                                                  GIMP_DRAWABLE (item),
+                                                  clip_result);
+    }
+
+  if (GIMP_IS_LAYER (item) && gimp_layer_get_mask (GIMP_LAYER (item)))
+    {
+      gimp_drawable_transform_batch_add_drawable (
+        batch, item,
+        GIMP_DRAWABLE (gimp_layer_get_mask (GIMP_LAYER (item))),
+        clip_result);
+    }
+}
+
+void
+gimp_drawable_transform_batch_process (GimpDrawableTransformBatch *batch,
+                                       GimpItem                   *item,
+                                       GimpProgress               *progress)
+{
+  gint64 memsize = 0;
+  gint   start;
+  gint   end;
+  gint   i;
+
+  g_return_if_fail (batch != NULL);
+  g_return_if_fail (GIMP_IS_ITEM (item));
+  g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
+
+  /*  drop the results of earlier items, which weren't used  */
+  for (start = 0; start < batch->jobs->len; start++)
+    {
+      TransformJob *job = g_ptr_array_index (batch->jobs, start);
+
+      if (job->owner == item)
+        break;
+
+      gimp_drawable_transform_batch_clear_job (job);
+    }
+
+  if (start == batch->jobs->len ||
+      ((TransformJob *) g_ptr_array_index (batch->jobs, start))->processed)
+    {
+      return;
+    }
+
+  /*  start resampling the drawables of 'item', and of as many of the items
+   *  following it as fit into the memory budget, concurrently
+   */
+  for (end = start; end < batch->jobs->len; end++)
+    {
+      TransformJob *job = g_ptr_array_index (batch->jobs, end);
+
+      if (end > start && memsize + job->memsize > batch->memory_budget)
+        break;
+
+      memsize += job->memsize;
+
+      job->processed  = TRUE;
+      job->src_buffer = gimp_gegl_buffer_dup (job->orig_buffer);
+      job->async      = gimp_parallel_run_async (
+        (GimpRunAsyncFunc) gimp_drawable_transform_batch_run_job,
+        job);
+    }
+
+  for (i = start; i < end; i++)
+    {
+      TransformJob *job = g_ptr_array_index (batch->jobs, i);
+
+      gimp_waitable_wait (GIMP_WAITABLE (job->async));
+
+      if (gimp_async_is_finished (job->async))
+        job->result = g_object_ref (gimp_async_get_result (job->async));
+
+      g_clear_object (&job->async);
+      g_clear_object (&job->src_buffer);
+
+      if (progress)
+        {
+          gimp_progress_set_value (progress,
+                                   (gdouble) (i - start + 1) /
+                                   (gdouble) (end - start));
+        }
+    }
+}
@@ -90,5 +90,18 @@ GimpDrawable         * gimp_drawable_transform_paste             (GimpDrawable
                                                                   gint                     offset_y,
                                                                   gboolean                 new_layer);
 
+GimpDrawableTransformBatch *
+                       gimp_drawable_transform_batch_new         (const GimpMatrix3       *matrix,
+                                                                  GimpTransformDirection   direction,
+                                                                  GimpInterpolationType    interpolation_type,
+                                                                  gint64                   memory_budget);
+void                   gimp_drawable_transform_batch_free        (GimpDrawableTransformBatch *batch);
+void                   gimp_drawable_transform_batch_add         (GimpDrawableTransformBatch *batch,
+                                                                  GimpItem                *item,
+                                                                  GimpTransformResize      clip_result);
+void                   gimp_drawable_transform_batch_process     (GimpDrawableTransformBatch *batch,
+                                                                  GimpItem                *item,
+                                                                  GimpProgress            *progress);
+
 
 #endif  /*  __GIMP_DRAWABLE_TRANSFORM_H__  */
@@ -37,6 +37,7 @@
 #include "gimpchannel.h"
 #include "gimpcontext.h"
 #include "gimpdrawable-combine.h"
+#include "gimpdrawable-content-bounds.h"
 #include "gimpdrawable-fill.h"
 #include "gimpdrawable-floating-selection.h"
 #include "gimpdrawable-preview.h"
@@ -804,6 +805,8 @@ gimp_drawable_real_update (GimpDrawable *drawable,
                            gint          width,
                            gint          height)
 {
+  gimp_drawable_content_bounds_update (drawable, x, y, width, height);
+
   gimp_viewable_invalidate_preview (GIMP_VIEWABLE (drawable));
 }
 
@@ -896,6 +899,7 @@ gimp_drawable_real_set_buffer (GimpDrawable        *drawable,
   g_object_freeze_notify (G_OBJECT (drawable));
 
   gimp_drawable_invalidate_boundary (drawable);
+  gimp_drawable_content_bounds_invalidate (drawable);
 
   if (push_undo)
     gimp_image_undo_push_drawable_mod (gimp_item_get_image (item), undo_desc,
@@ -1892,6 +1896,7 @@ gimp_drawable_start_paint (GimpDrawable *drawable)
       g_return_if_fail (drawable->private->paint_buffer == NULL);
       g_return_if_fail (drawable->private->paint_copy_region == NULL);
       g_return_if_fail (drawable->private->paint_update_region == NULL);
+      g_return_if_fail (drawable->private->paint_flush_copy_region == NULL);
 
       drawable->private->paint_buffer = gimp_gegl_buffer_dup (buffer);
     }
@@ -1925,7 +1930,68 @@ gimp_drawable_flush_paint (GimpDrawable *drawable)
   g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
   g_return_val_if_fail (drawable->private->paint_count > 0, FALSE);
 
-  if (drawable->private->paint_copy_region)
+  gimp_drawable_snapshot_paint (drawable);
+
+  return gimp_drawable_flush_paint_snapshot (drawable);
+}
+
+/*  moves the regions painted so far aside, so that they can be flushed
+ *  by gimp_drawable_flush_paint_snapshot() while painting continues.
+ *  must be called with painting to the drawable stopped.
+ */
+gboolean
+gimp_drawable_snapshot_paint (GimpDrawable *drawable)
+{
+  GimpDrawablePrivate *private;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+  g_return_val_if_fail (drawable->private->paint_count > 0, FALSE);
+
+  private = drawable->private;
+
+  if (private->paint_copy_region)
+    {
+      if (private->paint_flush_copy_region)
+        {
+          cairo_region_union (private->paint_flush_copy_region,
+                              private->paint_copy_region);
+          cairo_region_union (private->paint_flush_update_region,
+                              private->paint_update_region);
+
+          g_clear_pointer (&private->paint_copy_region,
+                           cairo_region_destroy);
+          g_clear_pointer (&private->paint_update_region,
+                           cairo_region_destroy);
+        }
+      else
+        {
+          private->paint_flush_copy_region   = private->paint_copy_region;
+          private->paint_flush_update_region = private->paint_update_region;
+
+          private->paint_copy_region   = NULL;
+          private->paint_update_region = NULL;
+        }
+    }
+
+  return private->paint_flush_copy_region != NULL;
+}
+
+/*  copies the snapshotted regions from the paint buffer to the drawable
+ *  buffer, and emits their updates.  the paint buffer may be painted to
+ *  meanwhile; regions painted after the snapshot are flushed by the next
+ *  one.
+ */
+gboolean
+gimp_drawable_flush_paint_snapshot (GimpDrawable *drawable)
+{
+  GimpDrawablePrivate *private;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+  g_return_val_if_fail (drawable->private->paint_count > 0, FALSE);
+
+  private = drawable->private;
+
+  if (private->paint_flush_copy_region)
     {
       GeglBuffer *buffer;
       gint        n_rects;
@@ -1934,41 +2000,41 @@ gimp_drawable_flush_paint (GimpDrawable *drawable)
       buffer = GIMP_DRAWABLE_GET_CLASS (drawable)->get_buffer (drawable);
 
       g_return_val_if_fail (buffer != NULL, FALSE);
-      g_return_val_if_fail (drawable->private->paint_buffer != NULL, FALSE);
+      g_return_val_if_fail (private->paint_buffer != NULL, FALSE);
 
       n_rects = cairo_region_num_rectangles (
-        drawable->private->paint_copy_region);
+        private->paint_flush_copy_region);
 
       for (i = 0; i < n_rects; i++)
         {
           GeglRectangle rect;
 
-          cairo_region_get_rectangle (drawable->private->paint_copy_region,
+          cairo_region_get_rectangle (private->paint_flush_copy_region,
                                       i, (cairo_rectangle_int_t *) &rect);
 
           gimp_gegl_buffer_copy (
-            drawable->private->paint_buffer, &rect, GEGL_ABYSS_NONE,
+            private->paint_buffer, &rect, GEGL_ABYSS_NONE,
             buffer, NULL);
         }
 
-      g_clear_pointer (&drawable->private->paint_copy_region,
+      g_clear_pointer (&private->paint_flush_copy_region,
                        cairo_region_destroy);
 
       n_rects = cairo_region_num_rectangles (
-        drawable->private->paint_update_region);
+        private->paint_flush_update_region);
 
       for (i = 0; i < n_rects; i++)
         {
           GeglRectangle rect;
 
-          cairo_region_get_rectangle (drawable->private->paint_update_region,
+          cairo_region_get_rectangle (private->paint_flush_update_region,
                                       i, (cairo_rectangle_int_t *) &rect);
 
           g_signal_emit (drawable, gimp_drawable_signals[UPDATE], 0,
                          rect.x, rect.y, rect.width, rect.height);
         }
 
-      g_clear_pointer (&drawable->private->paint_update_region,
+      g_clear_pointer (&private->paint_flush_update_region,
                        cairo_region_destroy);
 
       return TRUE;
@@ -229,6 +229,8 @@ const guchar    * gimp_drawable_get_colormap         (GimpDrawable    *drawable)
 void              gimp_drawable_start_paint          (GimpDrawable    *drawable);
 gboolean          gimp_drawable_end_paint            (GimpDrawable    *drawable);
 gboolean          gimp_drawable_flush_paint          (GimpDrawable    *drawable);
+gboolean          gimp_drawable_snapshot_paint       (GimpDrawable    *drawable);
+gboolean          gimp_drawable_flush_paint_snapshot (GimpDrawable    *drawable);
 gboolean          gimp_drawable_is_painting          (GimpDrawable    *drawable);
 
 
@@ -47,6 +47,8 @@
 #include "gimplayer.h"
 #include "gimpprogress.h"
 
+#include "gimp-trace.h"
+
 
 enum
 {
@@ -581,7 +583,8 @@ gimp_drawable_filter_commit (GimpDrawableFilter *filter,
 
   if (gimp_drawable_filter_is_added (filter))
     {
-      const Babl *format;
+      GimpTraceSpan  span = GIMP_TRACE_BEGIN ();
+      const Babl    *format;
 
       format = gimp_drawable_filter_get_format (filter);
 
@@ -605,6 +608,9 @@ gimp_drawable_filter_commit (GimpDrawableFilter *filter,
         gimp_drawable_filter_update_drawable (filter, NULL);
 
       g_signal_emit (filter, drawable_filter_signals[FLUSH], 0);
+
+      GIMP_TRACE_END (span, "filter", gimp_object_get_name (filter),
+                      "%s", success ? "committed" : "canceled");
     }
 
   return success;
@@ -29,6 +29,7 @@
 
 #include "gegl/gimp-babl-compat.h"
 #include "gegl/gimp-gegl-apply-operation.h"
+#include "gegl/gimp-gegl-loops.h"
 #include "gegl/gimp-gegl-nodes.h"
 #include "gegl/gimp-gegl-utils.h"
 
@@ -52,6 +53,8 @@
 #include "gimpprojectable.h"
 #include "gimpundostack.h"
 
+#include "gimp-log.h"
+
 #include "gimp-intl.h"
 
 
@@ -761,6 +764,20 @@ gimp_image_merge_layers (GimpImage     *image,
   if (last_node_source)
     gegl_node_link (last_node_source, last_node);
 
+  /*  The graph renders every tile of the merge layer, including fully
+   *  transparent ones.  Turn them back into shared empty tiles, so that
+   *  they take no memory, and are elided by undo copies and XCF saving.
+   */
+  if (! flatten_node)
+    {
+      gint n_elided;
+
+      n_elided = gimp_gegl_buffer_elide_empty_tiles (
+        gimp_drawable_get_buffer (GIMP_DRAWABLE (merge_layer)), NULL);
+
+      GIMP_LOG (EMPTY_TILES, "merge: elided %d empty tiles", n_elided);
+    }
+
   /*  Clean up the graph  */
   gegl_node_remove_child (node, offset_node);
 
@@ -27,6 +27,8 @@
 
 #include "core-types.h"
 
+#include "config/gimpgeglconfig.h"
+
 #include "vectors/gimpvectors.h"
 
 #include "gimp.h"
@@ -34,6 +36,7 @@
 #include "gimp-transform-utils.h"
 #include "gimpchannel.h"
 #include "gimpcontext.h"
+#include "gimpdrawable-transform.h"
 #include "gimpguide.h"
 #include "gimpimage.h"
 #include "gimpimage-guides.h"
@@ -225,11 +228,13 @@ gimp_image_transform (GimpImage              *image,
                       GimpTransformResize     clip_result,
                       GimpProgress           *progress)
 {
-  GimpObjectQueue *queue;
-  GimpItem        *item;
-  GimpMatrix3      transform;
-  GeglRectangle    old_bounds;
-  GeglRectangle    new_bounds;
+  GimpObjectQueue            *queue;
+  GimpDrawableTransformBatch *batch;
+  GimpItem                   *item;
+  GList                      *list;
+  GimpMatrix3                 transform;
+  GeglRectangle               old_bounds;
+  GeglRectangle               new_bounds;
 
   g_return_if_fail (GIMP_IS_IMAGE (image));
   g_return_if_fail (GIMP_IS_CONTEXT (context));
@@ -275,6 +280,32 @@ gimp_image_transform (GimpImage              *image,
   gimp_object_queue_push_container (queue, gimp_image_get_channels (image));
   gimp_object_queue_push_container (queue, gimp_image_get_vectors (image));
 
+  /*  Resample the drawables of all layers and channels concurrently, as
+   *  far as the tile cache allows, ahead of transforming them in order
+   */
+  batch = gimp_drawable_transform_batch_new (
+    &transform, direction, interpolation_type,
+    GIMP_GEGL_CONFIG (image->gimp->config)->tile_cache_size / 2);
+
+  for (list = gimp_image_get_layer_iter (image);
+       list;
+       list = g_list_next (list))
+    {
+      gimp_drawable_transform_batch_add (batch, list->data,
+                                         GIMP_TRANSFORM_RESIZE_ADJUST);
+    }
+
+  gimp_drawable_transform_batch_add (batch,
+                                     GIMP_ITEM (gimp_image_get_mask (image)),
+                                     clip_result);
+
+  for (list = gimp_image_get_channel_iter (image);
+       list;
+       list = g_list_next (list))
+    {
+      gimp_drawable_transform_batch_add (batch, list->data, clip_result);
+    }
+
   g_object_freeze_notify (G_OBJECT (image));
 
   gimp_image_undo_group_start (image, GIMP_UNDO_GROUP_IMAGE_TRANSFORM, NULL);
@@ -287,6 +318,8 @@ gimp_image_transform (GimpImage              *image,
       if (GIMP_IS_CHANNEL (item))
         clip = clip_result;
 
+      gimp_drawable_transform_batch_process (batch, item, progress);
+
       gimp_item_transform (item,
                            context,
                            &transform, direction,
@@ -321,6 +354,8 @@ gimp_image_transform (GimpImage              *image,
 
   gimp_image_undo_group_end (image);
 
+  gimp_drawable_transform_batch_free (batch);
+
   g_object_unref (queue);
 
   if (! gegl_rectangle_equal (&new_bounds, &old_bounds))
@@ -79,6 +79,13 @@ static GimpObject * gimp_list_get_child_by_index (GimpContainer           *conta
 static gint         gimp_list_get_child_index    (GimpContainer           *container,
                                                   GimpObject              *object);
 
+static void         gimp_list_hash_add           (GimpList                *list,
+                                                  GimpObject              *object);
+static void         gimp_list_hash_remove        (GimpList                *list,
+                                                  GimpObject              *object);
+static gboolean     gimp_list_name_taken         (GimpList                *list,
+                                                  GimpObject              *object,
+                                                  const gchar             *name);
 static void         gimp_list_uniquefy_name      (GimpList                *gimp_list,
                                                   GimpObject              *object);
 static void         gimp_list_object_renamed     (GimpObject              *object,
@@ -140,6 +147,10 @@ static void
 gimp_list_init (GimpList *list)
 {
   list->queue        = g_queue_new ();
+  list->name_hash    = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              g_free,
+                                              (GDestroyNotify) g_ptr_array_unref);
+  list->child_names  = g_hash_table_new (g_direct_hash, g_direct_equal);
   list->unique_names = FALSE;
   list->sort_func    = NULL;
   list->append       = FALSE;
@@ -156,6 +167,9 @@ gimp_list_finalize (GObject *object)
       list->queue = NULL;
     }
 
+  g_clear_pointer (&list->child_names, g_hash_table_unref);
+  g_clear_pointer (&list->name_hash,   g_hash_table_unref);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -230,6 +244,9 @@ gimp_list_get_memsize (GimpObject *object,
       memsize += gimp_g_queue_get_memsize (list->queue, 0);
     }
 
+  memsize += gimp_g_hash_table_get_memsize (list->name_hash, 0);
+  memsize += gimp_g_hash_table_get_memsize (list->child_names, 0);
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -253,10 +270,11 @@ gimp_list_add (GimpContainer *container,
   if (list->unique_names)
     gimp_list_uniquefy_name (list, object);
 
-  if (list->unique_names || list->sort_func)
-    g_signal_connect (object, "name-changed",
-                      G_CALLBACK (gimp_list_object_renamed),
-                      list);
+  gimp_list_hash_add (list, object);
+
+  g_signal_connect (object, "name-changed",
+                    G_CALLBACK (gimp_list_object_renamed),
+                    list);
 
   if (list->sort_func)
     {
@@ -281,10 +299,11 @@ gimp_list_remove (GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
-  if (list->unique_names || list->sort_func)
-    g_signal_handlers_disconnect_by_func (object,
-                                          gimp_list_object_renamed,
-                                          list);
+  g_signal_handlers_disconnect_by_func (object,
+                                        gimp_list_object_renamed,
+                                        list);
+
+  gimp_list_hash_remove (list, object);
 
   g_queue_remove (list->queue, object);
 
@@ -321,7 +340,7 @@ gimp_list_have (GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
-  return g_queue_find (list->queue, object) ? TRUE : FALSE;
+  return g_hash_table_contains (list->child_names, object);
 }
 
 static void
@@ -369,14 +388,25 @@ static GimpObject *
 gimp_list_get_child_by_name (GimpContainer *container,
                              const gchar   *name)
 {
-  GimpList *list = GIMP_LIST (container);
-  GList    *glist;
+  GimpList  *list = GIMP_LIST (container);
+  GPtrArray *children;
+  GList     *glist;
+
+  children = g_hash_table_lookup (list->name_hash, name);
 
+  if (! children)
+    return NULL;
+
+  if (children->len == 1)
+    return children->pdata[0];
+
+  /*  several children share the name, return the first one  */
   for (glist = list->queue->head; glist; glist = g_list_next (glist))
     {
-      GimpObject *object = glist->data;
+      GimpObject  *object      = glist->data;
+      const gchar *object_name = gimp_object_get_name (object);
 
-      if (! strcmp (gimp_object_get_name (object), name))
+      if (object_name && ! strcmp (object_name, name))
         return object;
     }
 
@@ -569,28 +599,79 @@ gimp_list_sort_by_name (GimpList *list)
 
 /*  private functions  */
 
+/*  the name index makes gimp_list_get_child_by_name() and the checks of
+ *  gimp_list_uniquefy_name() independent of the number of children.
+ *  every child is in child_names, mapped to the key it was indexed
+ *  under in name_hash, so that it can be found again after a rename.
+ */
+static void
+gimp_list_hash_add (GimpList   *list,
+                    GimpObject *object)
+{
+  const gchar *name = gimp_object_get_name (object);
+  gchar       *key  = NULL;
+  GPtrArray   *children;
+
+  if (name)
+    {
+      if (! g_hash_table_lookup_extended (list->name_hash, name,
+                                          (gpointer *) &key,
+                                          (gpointer *) &children))
+        {
+          key      = g_strdup (name);
+          children = g_ptr_array_new ();
+
+          g_hash_table_insert (list->name_hash, key, children);
+        }
+
+      g_ptr_array_add (children, object);
+    }
+
+  g_hash_table_insert (list->child_names, object, key);
+}
+
+static void
+gimp_list_hash_remove (GimpList   *list,
+                       GimpObject *object)
+{
+  const gchar *key = g_hash_table_lookup (list->child_names, object);
+
+  if (key)
+    {
+      GPtrArray *children = g_hash_table_lookup (list->name_hash, key);
+
+      g_ptr_array_remove_fast (children, object);
+
+      if (children->len == 0)
+        g_hash_table_remove (list->name_hash, key);
+    }
+
+  g_hash_table_remove (list->child_names, object);
+}
+
+static gboolean
+gimp_list_name_taken (GimpList    *list,
+                      GimpObject  *object,
+                      const gchar *name)
+{
+  GPtrArray *children = g_hash_table_lookup (list->name_hash, name);
+
+  if (! children)
+    return FALSE;
+
+  return children->len > 1 || children->pdata[0] != object;
+}
+
 static void
 gimp_list_uniquefy_name (GimpList   *gimp_list,
                          GimpObject *object)
 {
   gchar *name = (gchar *) gimp_object_get_name (object);
-  GList *list;
 
   if (! name)
     return;
 
-  for (list = gimp_list->queue->head; list; list = g_list_next (list))
-    {
-      GimpObject  *object2 = list->data;
-      const gchar *name2   = gimp_object_get_name (object2);
-
-      if (object != object2 &&
-          name2             &&
-          ! strcmp (name, name2))
-        break;
-    }
-
-  if (list)
+  if (gimp_list_name_taken (gimp_list, object, name))
     {
       gchar *ext;
       gchar *new_name   = NULL;
@@ -629,19 +710,8 @@ gimp_list_uniquefy_name (GimpList   *gimp_list,
           g_free (new_name);
 
           new_name = g_strdup_printf ("%s #%d", name, unique_ext);
-
-          for (list = gimp_list->queue->head; list; list = g_list_next (list))
-            {
-              GimpObject  *object2 = list->data;
-              const gchar *name2   = gimp_object_get_name (object2);
-
-              if (object != object2 &&
-                  name2             &&
-                  ! strcmp (new_name, name2))
-                break;
-            }
         }
-      while (list);
+      while (gimp_list_name_taken (gimp_list, object, new_name));
 
       g_free (name);
 
@@ -666,6 +736,9 @@ gimp_list_object_renamed (GimpObject *object,
                                          list);
     }
 
+  gimp_list_hash_remove (list, object);
+  gimp_list_hash_add (list, object);
+
   if (list->sort_func)
     {
       GList *glist;
@@ -40,6 +40,8 @@ struct _GimpList
   GimpContainer  parent_instance;
 
   GQueue        *queue;
+  GHashTable    *name_hash;    /*  name -> GPtrArray of children        */
+  GHashTable    *child_names;  /*  child -> its key in name_hash, if any */
   gboolean       unique_names;
   GCompareFunc   sort_func;
   gboolean       append;
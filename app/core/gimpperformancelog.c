@@ -0,0 +1,1631 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpperformancelog.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "gimp.h"
+#include "gimp-gui.h"
+#include "gimp-parallel.h"
+#include "gimpasync.h"
+#include "gimpbacktrace.h"
+#include "gimpperformancelog.h"
+#include "gimptempbuf.h"
+#include "gimpwaitable.h"
+
+#include "gimp-intl.h"
+#include "gimp-log.h"
+#include "gimp-version.h"
+
+
+#define LOG_VERSION                  1
+#define LOG_DEFAULT_SAMPLE_FREQUENCY 10 /* samples per second */
+#define LOG_DEFAULT_BACKTRACE        TRUE
+#define LOG_DEFAULT_MESSAGES         TRUE
+#define LOG_DEFAULT_PROGRESSIVE      FALSE
+
+
+typedef enum
+{
+  RECORD_SOURCE_GEGL_STATS,
+  RECORD_SOURCE_GEGL_CONFIG,
+  RECORD_SOURCE_FUNCTION
+} RecordSource;
+
+typedef struct
+{
+  GimpPerformanceLogVar  var;
+  RecordSource           source;
+  gconstpointer          data;
+} RecordVar;
+
+
+struct _GimpPerformanceLog
+{
+  GMutex                    mutex;
+
+  GOutputStream            *output;
+  GError                   *error;
+  GimpPerformanceLogParams  params;
+  gint64                    start_time;
+  gint                      n_samples;
+  gint                      n_markers;
+
+  GimpPerformanceLogVar    *vars;
+  gint                      n_vars;
+  gchar                   **values;
+
+  GimpBacktrace            *backtrace;
+  GHashTable               *addresses;
+  GimpLogHandler            log_handler;
+};
+
+
+/*  local function prototypes  */
+
+static gboolean   gimp_performance_log_printf               (GimpPerformanceLog *log,
+                                                             const gchar        *format,
+                                                             ...) G_GNUC_PRINTF (2, 3);
+static gboolean   gimp_performance_log_print_escaped        (GimpPerformanceLog *log,
+                                                             const gchar        *string);
+static gint64     gimp_performance_log_time                 (GimpPerformanceLog *log);
+static void       gimp_performance_log_write_header         (GimpPerformanceLog *log,
+                                                             gboolean            has_backtrace);
+static void       gimp_performance_log_sample_unlocked      (GimpPerformanceLog *log,
+                                                             const gchar * const *values,
+                                                             gboolean            include_current_thread);
+static gint       gimp_performance_log_add_marker_unlocked  (GimpPerformanceLog *log,
+                                                             const gchar        *description);
+static void       gimp_performance_log_write_address_map    (GimpPerformanceLog *log,
+                                                             guintptr           *addresses,
+                                                             gint                n_addresses,
+                                                             GimpAsync          *async);
+static void       gimp_performance_log_write_global_address_map
+                                                            (GimpAsync          *async,
+                                                             GimpPerformanceLog *log);
+static void       gimp_performance_log_log_func             (const gchar        *log_domain,
+                                                             GLogLevelFlags      log_levels,
+                                                             const gchar        *message,
+                                                             GimpPerformanceLog *log);
+
+static gpointer   gimp_performance_log_record_thread        (gpointer            data);
+static gchar    * gimp_performance_log_record_value         (const RecordVar    *record_var);
+
+
+/*  static variables  */
+
+/*  the open logs, which receive the markers added through
+ *  gimp_performance_log_add_active_marker()
+ */
+static GSList             *active_logs = NULL;
+static GMutex              active_logs_mutex;
+
+/*  the variables recorded without a dashboard, named and typed like
+ *  the dashboard's own, so that logs look the same to the viewer
+ */
+static const RecordVar record_vars[] =
+{
+  { { "cache-occupied",    "size",       "Tile cache occupied size" },
+    RECORD_SOURCE_GEGL_STATS, "tile-cache-total" },
+  { { "cache-maximum",     "size",       "Maximal tile cache occupied size" },
+    RECORD_SOURCE_GEGL_STATS, "tile-cache-total-max" },
+  { { "cache-limit",       "size",       "Tile cache size limit" },
+    RECORD_SOURCE_GEGL_CONFIG, "tile-cache-size" },
+  { { "cache-compression", "size-ratio", "Tile cache compression ratio" },
+    RECORD_SOURCE_GEGL_STATS, "tile-cache-total\0"
+                              "tile-cache-total-uncompressed" },
+  { { "cache-hit-miss",    "int-ratio",  "Tile cache hit/miss ratio" },
+    RECORD_SOURCE_GEGL_STATS, "tile-cache-hits\0"
+                              "tile-cache-misses" },
+
+  { { "swap-occupied",     "size",       "Swap file occupied size" },
+    RECORD_SOURCE_GEGL_STATS, "swap-total" },
+  { { "swap-size",         "size",       "Swap file size" },
+    RECORD_SOURCE_GEGL_STATS, "swap-file-size" },
+  { { "swap-queued",       "size",       "Size of data queued for writing to the swap" },
+    RECORD_SOURCE_GEGL_STATS, "swap-queued-total" },
+  { { "swap-queue-stalls", "integer",    "Number of times the writing to the swap has been "
+                                         "stalled, due to a full queue" },
+    RECORD_SOURCE_GEGL_STATS, "swap-queue-stalls" },
+  { { "swap-read",         "size",       "Total amount of data read from the swap" },
+    RECORD_SOURCE_GEGL_STATS, "swap-read-total" },
+  { { "swap-written",      "size",       "Total amount of data written to the swap" },
+    RECORD_SOURCE_GEGL_STATS, "swap-write-total" },
+  { { "swap-compression",  "size-ratio", "Swap compression ratio" },
+    RECORD_SOURCE_GEGL_STATS, "swap-total\0"
+                              "swap-total-uncompressed" },
+
+  { { "mipmapped",         "size",       "Total size of processed mipmapped data" },
+    RECORD_SOURCE_GEGL_STATS, "zoom-total" },
+  { { "assigned-threads",  "integer",    "Number of assigned worker threads" },
+    RECORD_SOURCE_GEGL_STATS, "assigned-threads" },
+  { { "active-threads",    "integer",    "Number of active worker threads" },
+    RECORD_SOURCE_GEGL_STATS, "active-threads" },
+  { { "async-running",     "integer",    "Number of ongoing asynchronous operations" },
+    RECORD_SOURCE_FUNCTION, gimp_async_get_n_running },
+  { { "tile-alloc-total",  "size",       "Total size of tile memory" },
+    RECORD_SOURCE_GEGL_STATS, "tile-alloc-total" },
+  { { "scratch-total",     "size",       "Total size of scratch memory" },
+    RECORD_SOURCE_GEGL_STATS, "scratch-total" },
+  { { "temp-buf-total",    "size",       "Total size of temporary buffers" },
+    RECORD_SOURCE_FUNCTION, gimp_temp_buf_get_total_memsize }
+};
+
+static GimpPerformanceLog *record_log    = NULL;
+static GThread            *record_thread = NULL;
+static GMutex              record_mutex;
+static GCond               record_cond;
+static gboolean            record_quit   = FALSE;
+
+
+/*  public functions  */
+
+const GimpPerformanceLogParams *
+gimp_performance_log_get_default_params (void)
+{
+  static const GimpPerformanceLogParams default_params =
+  {
+    .sample_frequency = LOG_DEFAULT_SAMPLE_FREQUENCY,
+    .backtrace        = LOG_DEFAULT_BACKTRACE,
+    .messages         = LOG_DEFAULT_MESSAGES,
+    .progressive      = LOG_DEFAULT_PROGRESSIVE
+  };
+
+  return &default_params;
+}
+
+/**
+ * gimp_performance_log_new:
+ * @file:   the file to write the log to
+ * @params: the log parameters, or %NULL for the defaults
+ * @vars:   the definitions of the variables passed to
+ *          gimp_performance_log_sample(); the strings must stay around
+ *          for the lifetime of the log
+ * @n_vars: the number of variables
+ * @error:  return location for an error
+ *
+ * Starts writing a performance log, in the format read by
+ * tools/performance-log-viewer.py.  The parameters can be overridden by
+ * the GIMP_PERFORMANCE_LOG_* environment variables.
+ *
+ * While the log exists, it is the target of
+ * gimp_performance_log_add_active_marker().
+ *
+ * Returns: the new log, or %NULL on error.
+ **/
+GimpPerformanceLog *
+gimp_performance_log_new (GFile                           *file,
+                          const GimpPerformanceLogParams  *params,
+                          const GimpPerformanceLogVar     *vars,
+                          gint                             n_vars,
+                          GError                         **error)
+{
+  GimpPerformanceLog *log;
+  gboolean            has_backtrace;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (vars != NULL || n_vars == 0, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  log = g_slice_new0 (GimpPerformanceLog);
+
+  if (! params)
+    params = gimp_performance_log_get_default_params ();
+
+  log->params = *params;
+
+  if (g_getenv ("GIMP_PERFORMANCE_LOG_SAMPLE_FREQUENCY"))
+    {
+      log->params.sample_frequency =
+        atoi (g_getenv ("GIMP_PERFORMANCE_LOG_SAMPLE_FREQUENCY"));
+    }
+
+  if (g_getenv ("GIMP_PERFORMANCE_LOG_BACKTRACE"))
+    {
+      log->params.backtrace =
+        atoi (g_getenv ("GIMP_PERFORMANCE_LOG_BACKTRACE")) ? 1 : 0;
+    }
+
+  if (g_getenv ("GIMP_PERFORMANCE_LOG_MESSAGES"))
+    {
+      log->params.messages =
+        atoi (g_getenv ("GIMP_PERFORMANCE_LOG_MESSAGES")) ? 1 : 0;
+    }
+
+  if (g_getenv ("GIMP_PERFORMANCE_LOG_PROGRESSIVE"))
+    {
+      log->params.progressive =
+        atoi (g_getenv ("GIMP_PERFORMANCE_LOG_PROGRESSIVE")) ? 1 : 0;
+    }
+
+  log->params.sample_frequency =
+    CLAMP (log->params.sample_frequency,
+           GIMP_PERFORMANCE_LOG_SAMPLE_FREQUENCY_MIN,
+           GIMP_PERFORMANCE_LOG_SAMPLE_FREQUENCY_MAX);
+
+  if (log->params.progressive          &&
+      g_file_query_exists (file, NULL) &&
+      ! g_file_delete (file, NULL, error))
+    {
+      g_slice_free (GimpPerformanceLog, log);
+
+      return NULL;
+    }
+
+  log->output = G_OUTPUT_STREAM (g_file_replace (file,
+                                 NULL, FALSE, G_FILE_CREATE_NONE, NULL,
+                                 error));
+
+  if (! log->output)
+    {
+      g_slice_free (GimpPerformanceLog, log);
+
+      return NULL;
+    }
+
+  g_mutex_init (&log->mutex);
+
+  log->start_time = g_get_monotonic_time ();
+  log->vars       = g_memdup (vars, n_vars * sizeof (GimpPerformanceLogVar));
+  log->n_vars     = n_vars;
+  log->values     = g_new0 (gchar *, n_vars);
+  log->addresses  = g_hash_table_new (NULL, NULL);
+
+  if (log->params.backtrace)
+    has_backtrace = gimp_backtrace_start ();
+  else
+    has_backtrace = FALSE;
+
+  gimp_performance_log_write_header (log, has_backtrace);
+
+  if (log->error)
+    {
+      GCancellable *cancellable = g_cancellable_new ();
+
+      if (has_backtrace)
+        gimp_backtrace_stop ();
+
+      /* Cancel the overwrite initiated by g_file_replace(). */
+      g_cancellable_cancel (cancellable);
+      g_output_stream_close (log->output, cancellable, NULL);
+      g_object_unref (cancellable);
+
+      g_object_unref (log->output);
+
+      g_propagate_error (error, log->error);
+
+      g_hash_table_unref (log->addresses);
+      g_free (log->values);
+      g_free (log->vars);
+      g_mutex_clear (&log->mutex);
+
+      g_slice_free (GimpPerformanceLog, log);
+
+      return NULL;
+    }
+
+  /*  the header reports whether backtraces are actually available  */
+  log->params.backtrace = has_backtrace;
+
+  if (log->params.messages)
+    {
+      log->log_handler = gimp_log_set_handler (
+        TRUE,
+        G_LOG_LEVEL_MASK | G_LOG_FLAG_FATAL | G_LOG_FLAG_RECURSION,
+        (GLogFunc) gimp_performance_log_log_func,
+        log);
+    }
+
+  g_mutex_lock (&active_logs_mutex);
+
+  active_logs = g_slist_prepend (active_logs, log);
+
+  g_mutex_unlock (&active_logs_mutex);
+
+  return log;
+}
+
+/**
+ * gimp_performance_log_close:
+ * @log:   a #GimpPerformanceLog
+ * @gimp:  a #Gimp, used to wait for the symbol information to be
+ *         resolved, or %NULL
+ * @error: return location for an error
+ *
+ * Finishes the log, writing the address map of all the backtraces'
+ * frames unless it was written progressively, and frees it.
+ *
+ * Returns: %TRUE if the whole log has been written successfully.
+ **/
+gboolean
+gimp_performance_log_close (GimpPerformanceLog  *log,
+                            Gimp                *gimp,
+                            GError             **error)
+{
+  gboolean result = TRUE;
+
+  g_return_val_if_fail (log != NULL, FALSE);
+  g_return_val_if_fail (gimp == NULL || GIMP_IS_GIMP (gimp), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  g_mutex_lock (&active_logs_mutex);
+
+  active_logs = g_slist_remove (active_logs, log);
+
+  g_mutex_unlock (&active_logs_mutex);
+
+  g_mutex_lock (&log->mutex);
+
+  if (log->log_handler)
+    {
+      gimp_log_remove_handler (log->log_handler);
+
+      log->log_handler = 0;
+    }
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "</samples>\n");
+
+  if (! log->params.progressive &&
+      g_hash_table_size (log->addresses) > 0)
+    {
+      GimpAsync *async;
+
+      async = gimp_parallel_run_async_independent (
+        (GimpRunAsyncFunc) gimp_performance_log_write_global_address_map,
+        log);
+
+      if (gimp)
+        {
+          gimp_wait (gimp, GIMP_WAITABLE (async),
+                     _("Resolving symbol information..."));
+        }
+      else
+        {
+          gimp_waitable_wait (GIMP_WAITABLE (async));
+        }
+
+      g_object_unref (async);
+    }
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "</gimp-performance-log>\n");
+
+  if (log->params.backtrace)
+    gimp_backtrace_stop ();
+
+  if (! log->error)
+    {
+      g_output_stream_close (log->output, NULL, &log->error);
+    }
+  else
+    {
+      GCancellable *cancellable = g_cancellable_new ();
+
+      /* Cancel the overwrite initiated by g_file_replace(). */
+      g_cancellable_cancel (cancellable);
+      g_output_stream_close (log->output, cancellable, NULL);
+      g_object_unref (cancellable);
+    }
+
+  g_clear_object (&log->output);
+
+  if (log->error)
+    {
+      g_propagate_error (error, log->error);
+      log->error = NULL;
+
+      result = FALSE;
+    }
+
+  g_clear_pointer (&log->backtrace, gimp_backtrace_free);
+  g_clear_pointer (&log->addresses, g_hash_table_unref);
+
+  g_mutex_unlock (&log->mutex);
+
+  while (log->n_vars--)
+    g_free (log->values[log->n_vars]);
+
+  g_free (log->values);
+  g_free (log->vars);
+
+  g_mutex_clear (&log->mutex);
+
+  g_slice_free (GimpPerformanceLog, log);
+
+  return result;
+}
+
+const GimpPerformanceLogParams *
+gimp_performance_log_get_params (GimpPerformanceLog *log)
+{
+  g_return_val_if_fail (log != NULL, NULL);
+
+  return &log->params;
+}
+
+/**
+ * gimp_performance_log_sample:
+ * @log:                    a #GimpPerformanceLog
+ * @values:                 the current values of the log's variables,
+ *                          as strings, with %NULL for unavailable ones,
+ *                          or %NULL if none of them changed
+ * @include_current_thread: whether to include the calling thread in the
+ *                          backtrace
+ *
+ * Writes a sample to the log.  Only the values which differ from the
+ * previous sample are actually written.
+ *
+ * May be called from any thread.
+ **/
+void
+gimp_performance_log_sample (GimpPerformanceLog  *log,
+                             const gchar * const *values,
+                             gboolean             include_current_thread)
+{
+  g_return_if_fail (log != NULL);
+
+  g_mutex_lock (&log->mutex);
+
+  gimp_performance_log_sample_unlocked (log, values, include_current_thread);
+
+  g_mutex_unlock (&log->mutex);
+}
+
+/**
+ * gimp_performance_log_add_marker:
+ * @log:         a #GimpPerformanceLog
+ * @description: the marker's description, or %NULL
+ *
+ * Adds a marker to the log.  May be called from any thread.
+ *
+ * Returns: the new marker's number.
+ **/
+gint
+gimp_performance_log_add_marker (GimpPerformanceLog *log,
+                                 const gchar        *description)
+{
+  gint n_markers;
+
+  g_return_val_if_fail (log != NULL, 0);
+
+  g_mutex_lock (&log->mutex);
+
+  n_markers = gimp_performance_log_add_marker_unlocked (log, description);
+
+  g_mutex_unlock (&log->mutex);
+
+  return n_markers;
+}
+
+/*  adds a marker to every open log, returns FALSE if there is none  */
+gboolean
+gimp_performance_log_add_active_marker (const gchar *description)
+{
+  GSList   *list;
+  gboolean  added;
+
+  g_mutex_lock (&active_logs_mutex);
+
+  for (list = active_logs; list; list = g_slist_next (list))
+    gimp_performance_log_add_marker (list->data, description);
+
+  added = active_logs != NULL;
+
+  g_mutex_unlock (&active_logs_mutex);
+
+  return added;
+}
+
+/**
+ * gimp_performance_log_record_start:
+ * @file:  the file to write the log to
+ * @error: return location for an error
+ *
+ * Starts recording a performance log without a dashboard, sampling
+ * GEGL's and GIMP's memory and thread statistics, and backtraces, from
+ * a thread of its own.  This is how performance logs are recorded in
+ * gimp-console, and with the --performance-log command-line option.
+ *
+ * Returns: %TRUE if the recording has started.
+ **/
+gboolean
+gimp_performance_log_record_start (GFile   *file,
+                                   GError **error)
+{
+  GimpPerformanceLogVar *vars;
+  gint                   n_vars = G_N_ELEMENTS (record_vars);
+  gint                   i;
+
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  g_return_val_if_fail (! gimp_performance_log_is_recording (), FALSE);
+
+  vars = g_new (GimpPerformanceLogVar, n_vars);
+
+  for (i = 0; i < n_vars; i++)
+    vars[i] = record_vars[i].var;
+
+  record_log = gimp_performance_log_new (file, NULL, vars, n_vars, error);
+
+  g_free (vars);
+
+  if (! record_log)
+    return FALSE;
+
+  record_quit   = FALSE;
+  record_thread = g_thread_new ("performance-log",
+                                gimp_performance_log_record_thread,
+                                record_log);
+
+  return TRUE;
+}
+
+gboolean
+gimp_performance_log_record_stop (Gimp    *gimp,
+                                  GError **error)
+{
+  GimpPerformanceLog *log;
+
+  g_return_val_if_fail (gimp == NULL || GIMP_IS_GIMP (gimp), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (! gimp_performance_log_is_recording ())
+    return TRUE;
+
+  g_mutex_lock (&record_mutex);
+
+  record_quit = TRUE;
+  g_cond_signal (&record_cond);
+
+  g_mutex_unlock (&record_mutex);
+
+  g_clear_pointer (&record_thread, g_thread_join);
+
+  log        = record_log;
+  record_log = NULL;
+
+  return gimp_performance_log_close (log, gimp, error);
+}
+
+gboolean
+gimp_performance_log_is_recording (void)
+{
+  return record_log != NULL;
+}
+
+
+/*  private functions  */
+
+static gboolean
+gimp_performance_log_printf (GimpPerformanceLog *log,
+                             const gchar        *format,
+                             ...)
+{
+  va_list  args;
+  gboolean result;
+
+  if (log->error)
+    return FALSE;
+
+  va_start (args, format);
+
+  result = g_output_stream_vprintf (log->output,
+                                    NULL, NULL,
+                                    &log->error,
+                                    format, args);
+
+  va_end (args);
+
+  return result;
+}
+
+static gboolean
+gimp_performance_log_print_escaped (GimpPerformanceLog *log,
+                                    const gchar        *string)
+{
+  gchar        buffer[1024];
+  const gchar *s;
+  gint         i;
+
+  if (log->error)
+    return FALSE;
+
+  i = 0;
+
+  #define FLUSH()                                                \
+    G_STMT_START                                                 \
+      {                                                          \
+        if (! g_output_stream_write_all (log->output,            \
+                                         buffer, i, NULL,        \
+                                         NULL, &log->error))     \
+          {                                                      \
+            return FALSE;                                        \
+          }                                                      \
+                                                                 \
+        i = 0;                                                   \
+      }                                                          \
+    G_STMT_END
+
+  #define RESERVE(n)                   \
+    G_STMT_START                       \
+      {                                \
+        if (i + (n) > sizeof (buffer)) \
+          FLUSH ();                    \
+      }                                \
+    G_STMT_END
+
+  for (s = string; *s; s++)
+    {
+      #define ESCAPE(from, to)                      \
+        case from:                                  \
+          RESERVE (sizeof (to) - 1);                \
+          memcpy (&buffer[i], to, sizeof (to) - 1); \
+          i += sizeof (to) - 1;                     \
+          break;
+
+      switch (*s)
+        {
+        ESCAPE ('"',  "&quot;")
+        ESCAPE ('\'', "&apos;")
+        ESCAPE ('<',  "&lt;")
+        ESCAPE ('>',  "&gt;")
+        ESCAPE ('&',  "&amp;")
+
+        default:
+          RESERVE (1);
+          buffer[i++] = *s;
+          break;
+        }
+
+      #undef ESCAPE
+    }
+
+  FLUSH ();
+
+  #undef FLUSH
+  #undef RESERVE
+
+  return TRUE;
+}
+
+static gint64
+gimp_performance_log_time (GimpPerformanceLog *log)
+{
+  return g_get_monotonic_time () - log->start_time;
+}
+
+static void
+gimp_performance_log_write_header (GimpPerformanceLog *log,
+                                   gboolean            has_backtrace)
+{
+  gchar       *version;
+  gchar      **envp;
+  gchar      **env;
+  GParamSpec **pspecs;
+  guint        n_pspecs;
+  guint        i;
+  gint         var;
+
+  gimp_performance_log_printf (log,
+                               "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                               "<gimp-performance-log version=\"%d\">\n",
+                               LOG_VERSION);
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "<params>\n"
+                               "<sample-frequency>%d</sample-frequency>\n"
+                               "<backtrace>%d</backtrace>\n"
+                               "<messages>%d</messages>\n"
+                               "<progressive>%d</progressive>\n"
+                               "</params>\n",
+                               log->params.sample_frequency,
+                               has_backtrace,
+                               log->params.messages,
+                               log->params.progressive);
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "<info>\n");
+
+  version = gimp_version (TRUE, FALSE);
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "<gimp-version>\n");
+  gimp_performance_log_print_escaped (log, version);
+  gimp_performance_log_printf (log,
+                               "</gimp-version>\n");
+
+  g_free (version);
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "<env>\n");
+
+  envp = g_get_environ ();
+
+  for (env = envp; *env; env++)
+    {
+      if (g_str_has_prefix (*env, "BABL_") ||
+          g_str_has_prefix (*env, "GEGL_") ||
+          g_str_has_prefix (*env, "GIMP_"))
+        {
+          gchar       *delim = strchr (*env, '=');
+          const gchar *s;
+
+          if (! delim)
+            continue;
+
+          for (s = *env;
+               s != delim && (g_ascii_isalnum (*s) || *s == '_' || *s == '-');
+               s++);
+
+          if (s != delim)
+            continue;
+
+          *delim = '\0';
+
+          gimp_performance_log_printf (log,
+                                       "<%s>",
+                                       *env);
+          gimp_performance_log_print_escaped (log, delim + 1);
+          gimp_performance_log_printf (log,
+                                       "</%s>\n",
+                                       *env);
+        }
+    }
+
+  g_strfreev (envp);
+
+  gimp_performance_log_printf (log,
+                               "</env>\n");
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "<gegl-config>\n");
+
+  pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (gegl_config ()),
+                                           &n_pspecs);
+
+  for (i = 0; i < n_pspecs; i++)
+    {
+      const GParamSpec *pspec     = pspecs[i];
+      GValue            value     = {};
+      GValue            str_value = {};
+
+      g_value_init (&value,     pspec->value_type);
+      g_value_init (&str_value, G_TYPE_STRING);
+
+      g_object_get_property (G_OBJECT (gegl_config ()), pspec->name, &value);
+
+      if (g_value_transform (&value, &str_value))
+        {
+          gimp_performance_log_printf (log,
+                                       "<%s>",
+                                       pspec->name);
+          gimp_performance_log_print_escaped (log,
+                                              g_value_get_string (&str_value));
+          gimp_performance_log_printf (log,
+                                       "</%s>\n",
+                                       pspec->name);
+        }
+
+      g_value_unset (&str_value);
+      g_value_unset (&value);
+    }
+
+  g_free (pspecs);
+
+  gimp_performance_log_printf (log,
+                               "</gegl-config>\n");
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "</info>\n");
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "<var-defs>\n");
+
+  for (var = 0; var < log->n_vars; var++)
+    {
+      const GimpPerformanceLogVar *var_def = &log->vars[var];
+
+      gimp_performance_log_printf (log,
+                                   "<var name=\"%s\" type=\"%s\" desc=\"",
+                                   var_def->name,
+                                   var_def->type);
+      gimp_performance_log_print_escaped (log,
+                                          /* intentionally untranslated */
+                                          var_def->description);
+      gimp_performance_log_printf (log,
+                                   "\" />\n");
+    }
+
+  gimp_performance_log_printf (log,
+                               "</var-defs>\n");
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "<samples>\n");
+}
+
+static void
+gimp_performance_log_sample_unlocked (GimpPerformanceLog  *log,
+                                      const gchar * const *values,
+                                      gboolean             include_current_thread)
+{
+  GimpBacktrace *backtrace = NULL;
+  GArray        *addresses = NULL;
+  gboolean       empty     = TRUE;
+  gint           var;
+
+  #define NONEMPTY()                                \
+    G_STMT_START                                    \
+      {                                             \
+        if (empty)                                  \
+          {                                         \
+            gimp_performance_log_printf (log,       \
+                                         ">\n");    \
+                                                    \
+            empty = FALSE;                          \
+          }                                         \
+      }                                             \
+    G_STMT_END
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "<sample id=\"%d\" t=\"%lld\"",
+                               log->n_samples,
+                               (long long) gimp_performance_log_time (log));
+
+  if (log->n_vars > 0 && (log->n_samples == 0 || values))
+    {
+      gboolean vars_empty = TRUE;
+
+      for (var = 0; var < log->n_vars; var++)
+        {
+          const gchar *value = values ? values[var] : NULL;
+
+          if (log->n_samples > 0 &&
+              ! g_strcmp0 (value, log->values[var]))
+            {
+              continue;
+            }
+
+          if (vars_empty)
+            {
+              NONEMPTY ();
+
+              gimp_performance_log_printf (log,
+                                           "<vars>\n");
+
+              vars_empty = FALSE;
+            }
+
+          g_free (log->values[var]);
+          log->values[var] = g_strdup (value);
+
+          if (value)
+            {
+              gimp_performance_log_printf (log,
+                                           "<%s>%s</%s>\n",
+                                           log->vars[var].name,
+                                           value,
+                                           log->vars[var].name);
+            }
+          else
+            {
+              gimp_performance_log_printf (log,
+                                           "<%s />\n",
+                                           log->vars[var].name);
+            }
+        }
+
+      if (! vars_empty)
+        {
+          gimp_performance_log_printf (log,
+                                       "</vars>\n");
+        }
+    }
+
+  if (log->params.backtrace)
+    backtrace = gimp_backtrace_new (include_current_thread);
+
+  if (backtrace)
+    {
+      gboolean backtrace_empty = TRUE;
+      gint     n_threads;
+      gint     thread;
+
+      #define BACKTRACE_NONEMPTY()                             \
+        G_STMT_START                                           \
+          {                                                    \
+            if (backtrace_empty)                               \
+              {                                                \
+                NONEMPTY ();                                   \
+                                                               \
+                gimp_performance_log_printf (log,              \
+                                             "<backtrace>\n"); \
+                                                               \
+                backtrace_empty = FALSE;                       \
+              }                                                \
+          }                                                    \
+        G_STMT_END
+
+      if (log->backtrace)
+        {
+          n_threads = gimp_backtrace_get_n_threads (log->backtrace);
+
+          for (thread = 0; thread < n_threads; thread++)
+            {
+              guintptr thread_id;
+
+              thread_id = gimp_backtrace_get_thread_id (log->backtrace,
+                                                        thread);
+
+              if (gimp_backtrace_find_thread_by_id (backtrace,
+                                                    thread_id, thread) < 0)
+                {
+                  const gchar *thread_name;
+
+                  BACKTRACE_NONEMPTY ();
+
+                  thread_name =
+                    gimp_backtrace_get_thread_name (log->backtrace,
+                                                    thread);
+
+                  gimp_performance_log_printf (log,
+                                               "<thread id=\"%llu\"",
+                                               (unsigned long long) thread_id);
+
+                  if (thread_name)
+                    {
+                      gimp_performance_log_printf (log,
+                                                   " name=\"");
+                      gimp_performance_log_print_escaped (log, thread_name);
+                      gimp_performance_log_printf (log,
+                                                   "\"");
+                    }
+
+                  gimp_performance_log_printf (log,
+                                               " />\n");
+                }
+            }
+        }
+
+      n_threads = gimp_backtrace_get_n_threads (backtrace);
+
+      for (thread = 0; thread < n_threads; thread++)
+        {
+          guintptr     thread_id;
+          const gchar *thread_name;
+          gint         last_running  = -1;
+          gint         running;
+          gint         last_n_frames = -1;
+          gint         n_frames;
+          gint         n_head        = 0;
+          gint         n_tail        = 0;
+          gint         frame;
+
+          thread_id   = gimp_backtrace_get_thread_id     (backtrace, thread);
+          thread_name = gimp_backtrace_get_thread_name   (backtrace, thread);
+
+          running     = gimp_backtrace_is_thread_running (backtrace, thread);
+          n_frames    = gimp_backtrace_get_n_frames      (backtrace, thread);
+
+          if (log->backtrace)
+            {
+              gint other_thread = gimp_backtrace_find_thread_by_id (
+                log->backtrace, thread_id, thread);
+
+              if (other_thread >= 0)
+                {
+                  gint n;
+                  gint i;
+
+                  last_running  = gimp_backtrace_is_thread_running (
+                    log->backtrace, other_thread);
+                  last_n_frames = gimp_backtrace_get_n_frames (
+                    log->backtrace, other_thread);
+
+                  n = MIN (n_frames, last_n_frames);
+
+                  for (i = 0; i < n; i++)
+                    {
+                      if (gimp_backtrace_get_frame_address (backtrace,
+                                                            thread, i) !=
+                          gimp_backtrace_get_frame_address (log->backtrace,
+                                                            other_thread, i))
+                        {
+                          break;
+                        }
+                    }
+
+                  n_head  = i;
+                  n      -= i;
+
+                  for (i = 0; i < n; i++)
+                    {
+                      if (gimp_backtrace_get_frame_address (backtrace,
+                                                            thread, -i - 1) !=
+                          gimp_backtrace_get_frame_address (log->backtrace,
+                                                            other_thread, -i - 1))
+                        {
+                          break;
+                        }
+                    }
+
+                  n_tail = i;
+                }
+            }
+
+          if (running         == last_running  &&
+              n_frames        == last_n_frames &&
+              n_head + n_tail == n_frames)
+            {
+              continue;
+            }
+
+          BACKTRACE_NONEMPTY ();
+
+          gimp_performance_log_printf (log,
+                                       "<thread id=\"%llu\"",
+                                       (unsigned long long) thread_id);
+
+          if (thread_name)
+            {
+              gimp_performance_log_printf (log,
+                                           " name=\"");
+              gimp_performance_log_print_escaped (log, thread_name);
+              gimp_performance_log_printf (log,
+                                           "\"");
+            }
+
+          gimp_performance_log_printf (log,
+                                       " running=\"%d\"",
+                                       running);
+
+          if (n_head > 0)
+            {
+              gimp_performance_log_printf (log,
+                                           " head=\"%d\"",
+                                           n_head);
+            }
+
+          if (n_tail > 0)
+            {
+              gimp_performance_log_printf (log,
+                                           " tail=\"%d\"",
+                                           n_tail);
+            }
+
+          if (n_frames == 0 || n_head + n_tail < n_frames)
+            {
+              gimp_performance_log_printf (log,
+                                           ">\n");
+
+              for (frame = n_head; frame < n_frames - n_tail; frame++)
+                {
+                  guintptr address;
+
+                  address = gimp_backtrace_get_frame_address (backtrace,
+                                                              thread, frame);
+
+                  gimp_performance_log_printf (log,
+                                               "<frame address=\"0x%llx\" />\n",
+                                               (unsigned long long) address);
+
+                  if (g_hash_table_add (log->addresses,
+                                        (gpointer) address) &&
+                      log->params.progressive)
+                    {
+                      if (! addresses)
+                        {
+                          addresses = g_array_new (FALSE, FALSE,
+                                                   sizeof (guintptr));
+                        }
+
+                      g_array_append_val (addresses, address);
+                    }
+                }
+
+              gimp_performance_log_printf (log,
+                                           "</thread>\n");
+            }
+          else
+            {
+              gimp_performance_log_printf (log,
+                                           " />\n");
+            }
+        }
+
+      if (! backtrace_empty)
+        {
+          gimp_performance_log_printf (log,
+                                       "</backtrace>\n");
+        }
+
+      #undef BACKTRACE_NONEMPTY
+    }
+  else if (log->backtrace)
+    {
+      NONEMPTY ();
+
+      gimp_performance_log_printf (log,
+                                   "<backtrace />\n");
+    }
+
+  gimp_backtrace_free (log->backtrace);
+  log->backtrace = backtrace;
+
+  if (empty)
+    {
+      gimp_performance_log_printf (log,
+                                   " />\n");
+    }
+  else
+    {
+      gimp_performance_log_printf (log,
+                                   "</sample>\n");
+    }
+
+  if (addresses)
+    {
+      gimp_performance_log_write_address_map (log,
+                                              (guintptr *) addresses->data,
+                                              addresses->len,
+                                              NULL);
+
+      g_array_free (addresses, TRUE);
+    }
+
+  if (log->params.progressive)
+    g_output_stream_flush (log->output, NULL, NULL);
+
+  #undef NONEMPTY
+
+  log->n_samples++;
+}
+
+static gint
+gimp_performance_log_add_marker_unlocked (GimpPerformanceLog *log,
+                                          const gchar        *description)
+{
+  log->n_markers++;
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "<marker id=\"%d\" t=\"%lld\"",
+                               log->n_markers,
+                               (long long) gimp_performance_log_time (log));
+
+  if (description && description[0])
+    {
+      gimp_performance_log_printf (log,
+                                   ">\n");
+      gimp_performance_log_print_escaped (log, description);
+      gimp_performance_log_printf (log,
+                                   "\n"
+                                   "</marker>\n");
+    }
+  else
+    {
+      gimp_performance_log_printf (log,
+                                   " />\n");
+    }
+
+  if (log->params.progressive)
+    g_output_stream_flush (log->output, NULL, NULL);
+
+  return log->n_markers;
+}
+
+static gint
+gimp_performance_log_compare_addresses (gconstpointer a1,
+                                        gconstpointer a2)
+{
+  guintptr address1 = *(const guintptr *) a1;
+  guintptr address2 = *(const guintptr *) a2;
+
+  if (address1 < address2)
+    return -1;
+  else if (address1 > address2)
+    return +1;
+  else
+    return 0;
+}
+
+static void
+gimp_performance_log_write_address_map (GimpPerformanceLog *log,
+                                        guintptr           *addresses,
+                                        gint                n_addresses,
+                                        GimpAsync          *async)
+{
+  GimpBacktraceAddressInfo infos[2];
+  gint                     i;
+  gint                     n;
+
+  if (n_addresses == 0)
+    return;
+
+  qsort (addresses, n_addresses, sizeof (guintptr),
+         gimp_performance_log_compare_addresses);
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "<address-map>\n");
+
+  n = 0;
+
+  for (i = 0; i < n_addresses; i++)
+    {
+      GimpBacktraceAddressInfo       *info      = &infos[n       % 2];
+      const GimpBacktraceAddressInfo *prev_info = &infos[(n + 1) % 2];
+
+      if (async && gimp_async_is_canceled (async))
+        break;
+
+      if (gimp_backtrace_get_address_info (addresses[i], info))
+        {
+          gboolean empty = TRUE;
+
+          #define NONEMPTY()                                \
+            G_STMT_START                                    \
+              {                                             \
+                if (empty)                                  \
+                  {                                         \
+                    gimp_performance_log_printf (log,       \
+                                                 ">\n");    \
+                                                            \
+                    empty = FALSE;                          \
+                  }                                         \
+              }                                             \
+            G_STMT_END
+
+          gimp_performance_log_printf (log,
+                                       "\n"
+                                       "<address value=\"0x%llx\"",
+                                       (unsigned long long) addresses[i]);
+
+          if (n == 0 || strcmp (info->object_name, prev_info->object_name))
+            {
+              NONEMPTY ();
+
+              if (info->object_name[0])
+                {
+                  gimp_performance_log_printf (log,
+                                               "<object>");
+                  gimp_performance_log_print_escaped (log,
+                                                      info->object_name);
+                  gimp_performance_log_printf (log,
+                                               "</object>\n");
+                }
+              else
+                {
+                  gimp_performance_log_printf (log,
+                                               "<object />\n");
+                }
+            }
+
+          if (n == 0 || strcmp (info->symbol_name, prev_info->symbol_name))
+            {
+              NONEMPTY ();
+
+              if (info->symbol_name[0])
+                {
+                  gimp_performance_log_printf (log,
+                                               "<symbol>");
+                  gimp_performance_log_print_escaped (log,
+                                                      info->symbol_name);
+                  gimp_performance_log_printf (log,
+                                               "</symbol>\n");
+                }
+              else
+                {
+                  gimp_performance_log_printf (log,
+                                               "<symbol />\n");
+                }
+            }
+
+          if (n == 0 || info->symbol_address != prev_info->symbol_address)
+            {
+              NONEMPTY ();
+
+              if (info->symbol_address)
+                {
+                  gimp_performance_log_printf (log,
+                                               "<base>0x%llx</base>\n",
+                                               (unsigned long long)
+                                                 info->symbol_address);
+                }
+              else
+                {
+                  gimp_performance_log_printf (log,
+                                               "<base />\n");
+                }
+            }
+
+          if (n == 0 || strcmp (info->source_file, prev_info->source_file))
+            {
+              NONEMPTY ();
+
+              if (info->source_file[0])
+                {
+                  gimp_performance_log_printf (log,
+                                               "<source>");
+                  gimp_performance_log_print_escaped (log,
+                                                      info->source_file);
+                  gimp_performance_log_printf (log,
+                                               "</source>\n");
+                }
+              else
+                {
+                  gimp_performance_log_printf (log,
+                                               "<source />\n");
+                }
+            }
+
+          if (n == 0 || info->source_line != prev_info->source_line)
+            {
+              NONEMPTY ();
+
+              if (info->source_line)
+                {
+                  gimp_performance_log_printf (log,
+                                               "<line>%d</line>\n",
+                                               info->source_line);
+                }
+              else
+                {
+                  gimp_performance_log_printf (log,
+                                               "<line />\n");
+                }
+            }
+
+          if (empty)
+            {
+              gimp_performance_log_printf (log,
+                                           " />\n");
+            }
+          else
+            {
+              gimp_performance_log_printf (log,
+                                           "</address>\n");
+            }
+
+          #undef NONEMPTY
+
+          n++;
+        }
+    }
+
+  gimp_performance_log_printf (log,
+                               "\n"
+                               "</address-map>\n");
+}
+
+static void
+gimp_performance_log_write_global_address_map (GimpAsync          *async,
+                                               GimpPerformanceLog *log)
+{
+  gint n_addresses;
+
+  n_addresses = g_hash_table_size (log->addresses);
+
+  if (n_addresses > 0)
+    {
+      guintptr *addresses;
+      GList    *iter;
+      gint      i;
+
+      addresses = g_new (guintptr, n_addresses);
+
+      for (iter = g_hash_table_get_keys (log->addresses), i = 0;
+           iter;
+           iter = g_list_next (iter), i++)
+        {
+          addresses[i] = (guintptr) iter->data;
+        }
+
+      gimp_performance_log_write_address_map (log,
+                                              addresses, n_addresses,
+                                              async);
+
+      g_free (addresses);
+    }
+
+  gimp_async_finish (async, NULL);
+}
+
+static void
+gimp_performance_log_log_func (const gchar        *log_domain,
+                               GLogLevelFlags      log_levels,
+                               const gchar        *message,
+                               GimpPerformanceLog *log)
+{
+  const gchar *log_level = NULL;
+  gchar       *description;
+
+  g_mutex_lock (&log->mutex);
+
+  switch (log_levels & G_LOG_LEVEL_MASK)
+    {
+    case G_LOG_LEVEL_ERROR:    log_level = "ERROR";    break;
+    case G_LOG_LEVEL_CRITICAL: log_level = "CRITICAL"; break;
+    case G_LOG_LEVEL_WARNING:  log_level = "WARNING";  break;
+    case G_LOG_LEVEL_MESSAGE:  log_level = "MESSAGE";  break;
+    case G_LOG_LEVEL_INFO:     log_level = "INFO";     break;
+    case G_LOG_LEVEL_DEBUG:    log_level = "DEBUG";    break;
+    default:                   log_level = "UNKNOWN";  break;
+    }
+
+  description = g_strdup_printf ("[%s] %s: %s", log_domain, log_level, message);
+
+  gimp_performance_log_add_marker_unlocked (log, description);
+
+  gimp_performance_log_sample_unlocked (log, NULL, TRUE);
+
+  g_free (description);
+
+  g_mutex_unlock (&log->mutex);
+}
+
+static gpointer
+gimp_performance_log_record_thread (gpointer data)
+{
+  GimpPerformanceLog  *log          = data;
+  gint                 n_vars       = G_N_ELEMENTS (record_vars);
+  gchar              **values       = g_new0 (gchar *, n_vars);
+  gint64               sample_time  = g_get_monotonic_time ();
+  gint64               interval;
+  gint                 i;
+
+  interval = G_TIME_SPAN_SECOND / log->params.sample_frequency;
+
+  g_mutex_lock (&record_mutex);
+
+  while (! record_quit)
+    {
+      g_mutex_unlock (&record_mutex);
+
+      for (i = 0; i < n_vars; i++)
+        {
+          g_free (values[i]);
+
+          values[i] = gimp_performance_log_record_value (&record_vars[i]);
+        }
+
+      gimp_performance_log_sample (log, (const gchar * const *) values, FALSE);
+
+      g_mutex_lock (&record_mutex);
+
+      sample_time += interval;
+
+      /*  don't try to catch up if we fell behind  */
+      sample_time = MAX (sample_time, g_get_monotonic_time ());
+
+      while (! record_quit &&
+             g_cond_wait_until (&record_cond, &record_mutex, sample_time));
+    }
+
+  g_mutex_unlock (&record_mutex);
+
+  for (i = 0; i < n_vars; i++)
+    g_free (values[i]);
+
+  g_free (values);
+
+  return NULL;
+}
+
+static gchar *
+gimp_performance_log_record_value (const RecordVar *record_var)
+{
+  GObject      *object;
+  GObjectClass *klass;
+  const gchar  *type = record_var->var.type;
+
+  if (record_var->source == RECORD_SOURCE_FUNCTION)
+    {
+      if (! strcmp (type, "integer"))
+        {
+          gint (* func) (void) = (gint (*) (void)) record_var->data;
+
+          return g_strdup_printf ("%d", func ());
+        }
+      else
+        {
+          guint64 (* func) (void) = (guint64 (*) (void)) record_var->data;
+
+          return g_strdup_printf ("%llu", (unsigned long long) func ());
+        }
+    }
+
+  if (record_var->source == RECORD_SOURCE_GEGL_CONFIG)
+    object = G_OBJECT (gegl_config ());
+  else
+    object = G_OBJECT (gegl_stats ());
+
+  klass = G_OBJECT_GET_CLASS (object);
+
+  if (! strcmp (type, "size"))
+    {
+      guint64 size;
+
+      if (! g_object_class_find_property (klass, record_var->data))
+        return NULL;
+
+      g_object_get (object, record_var->data, &size, NULL);
+
+      return g_strdup_printf ("%llu", (unsigned long long) size);
+    }
+  else if (! strcmp (type, "integer"))
+    {
+      gint integer;
+
+      if (! g_object_class_find_property (klass, record_var->data))
+        return NULL;
+
+      g_object_get (object, record_var->data, &integer, NULL);
+
+      return g_strdup_printf ("%d", integer);
+    }
+  else
+    {
+      const gchar *antecedent = record_var->data;
+      const gchar *consequent = antecedent + strlen (antecedent) + 1;
+
+      if (! g_object_class_find_property (klass, antecedent) ||
+          ! g_object_class_find_property (klass, consequent))
+        {
+          return NULL;
+        }
+
+      if (! strcmp (type, "size-ratio"))
+        {
+          guint64 a, c;
+
+          g_object_get (object, antecedent, &a, consequent, &c, NULL);
+
+          return g_strdup_printf ("%llu/%llu",
+                                  (unsigned long long) a,
+                                  (unsigned long long) c);
+        }
+      else
+        {
+          gint a, c;
+
+          g_object_get (object, antecedent, &a, consequent, &c, NULL);
+
+          return g_strdup_printf ("%d:%d", a, c);
+        }
+    }
+}
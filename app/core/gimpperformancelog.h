@@ -0,0 +1,79 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpperformancelog.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_PERFORMANCE_LOG_H__
+#define __GIMP_PERFORMANCE_LOG_H__
+
+
+#define GIMP_PERFORMANCE_LOG_SAMPLE_FREQUENCY_MIN      1 /* samples per second */
+#define GIMP_PERFORMANCE_LOG_SAMPLE_FREQUENCY_MAX   1000 /* samples per second */
+
+
+typedef struct _GimpPerformanceLogVar GimpPerformanceLogVar;
+
+struct _GimpPerformanceLogParams
+{
+  gint     sample_frequency;
+  gboolean backtrace;
+  gboolean messages;
+  gboolean progressive;
+};
+
+struct _GimpPerformanceLogVar
+{
+  const gchar *name;
+  const gchar *type;        /* "boolean", "integer", "size", "size-ratio",
+                             * "int-ratio", "percentage", "duration" or
+                             * "rate-of-change"
+                             */
+  const gchar *description;
+};
+
+
+const GimpPerformanceLogParams *
+                     gimp_performance_log_get_default_params (void);
+
+GimpPerformanceLog * gimp_performance_log_new                (GFile                           *file,
+                                                              const GimpPerformanceLogParams  *params,
+                                                              const GimpPerformanceLogVar     *vars,
+                                                              gint                             n_vars,
+                                                              GError                         **error);
+gboolean             gimp_performance_log_close              (GimpPerformanceLog              *log,
+                                                              Gimp                            *gimp,
+                                                              GError                         **error);
+
+const GimpPerformanceLogParams *
+                     gimp_performance_log_get_params         (GimpPerformanceLog              *log);
+
+void                 gimp_performance_log_sample             (GimpPerformanceLog              *log,
+                                                              const gchar * const             *values,
+                                                              gboolean                         include_current_thread);
+gint                 gimp_performance_log_add_marker         (GimpPerformanceLog              *log,
+                                                              const gchar                     *description);
+
+gboolean             gimp_performance_log_add_active_marker  (const gchar                     *description);
+
+gboolean             gimp_performance_log_record_start       (GFile                           *file,
+                                                              GError                         **error);
+gboolean             gimp_performance_log_record_stop        (Gimp                            *gimp,
+                                                              GError                         **error);
+gboolean             gimp_performance_log_is_recording       (void);
+
+
+#endif  /*  __GIMP_PERFORMANCE_LOG_H__  */
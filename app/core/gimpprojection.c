@@ -45,12 +45,29 @@
 
 #include "gimp-log.h"
 #include "gimp-priorities.h"
+#include "gimp-trace.h"
 
 
 /*  chunk size for area updates  */
 #define GIMP_PROJECTION_UPDATE_CHUNK_WIDTH  32
 #define GIMP_PROJECTION_UPDATE_CHUNK_HEIGHT 32
 
+/*  prefetch margin around the viewport, as a fraction of its size  */
+#define GIMP_PROJECTION_PREFETCH_MARGIN     0.5
+/*  how many pan steps ahead of the viewport to prefetch  */
+#define GIMP_PROJECTION_PREFETCH_LOOKAHEAD  4
+/*  highest mipmap level to prefetch  */
+#define GIMP_PROJECTION_PREFETCH_MAX_LEVEL  8
+
+/*  how many levels of detail below the display to render the preview
+ *  pass at
+ */
+#define GIMP_PROJECTION_PREVIEW_LEVELS      2
+/*  minimal dirty area inside the viewport, in display pixels, for which
+ *  a preview pass is rendered
+ */
+#define GIMP_PROJECTION_PREVIEW_MIN_AREA    (512 * 512)
+
 
 enum
 {
@@ -79,6 +96,15 @@ struct _GimpProjectionPrivate
   GimpChunkIterator         *iter;
   guint                      idle_id;
 
+  GeglRectangle              prefetch_viewport;
+  gint                       prefetch_level;
+  GeglRectangle              prefetch_rect;
+  gint                       prefetch_min_level;
+  gint                       prefetch_max_level;
+  cairo_region_t            *prefetch_region;
+  GimpChunkIterator         *prefetch_iter;
+  guint                      prefetch_idle_id;
+
   gboolean                   invalidate_preview;
 };
 
@@ -147,6 +173,17 @@ static void        gimp_projection_paint_area            (GimpProjection  *proj,
                                                           gint             y,
                                                           gint             w,
                                                           gint             h);
+static void        gimp_projection_preview_area          (GimpProjection  *proj,
+                                                          gint             level,
+                                                          const GeglRectangle *rect);
+static gint        gimp_projection_get_preview_level     (GimpProjection  *proj,
+                                                          cairo_region_t  *region);
+static void        gimp_projection_prefetch_add_area     (GimpProjection  *proj,
+                                                          const GeglRectangle *rect);
+static void        gimp_projection_prefetch_stop         (GimpProjection  *proj);
+static gboolean    gimp_projection_prefetch_callback     (GimpProjection  *proj);
+static void        gimp_projection_prefetch_area         (GimpProjection  *proj,
+                                                          const GeglRectangle *rect);
 
 static void        gimp_projection_projectable_invalidate(GimpProjectable *projectable,
                                                           gint             x,
@@ -519,6 +556,183 @@ gimp_projection_set_priority_rect (GimpProjection *proj,
   gimp_projection_update_priority_rect (proj);
 }
 
+/**
+ * gimp_projection_set_prefetch_rect:
+ * @proj:  a #GimpProjection
+ * @x:     viewport x, in image coordinates
+ * @y:     viewport y, in image coordinates
+ * @w:     viewport width
+ * @h:     viewport height
+ * @scale: the scale at which the viewport is displayed
+ *
+ * Makes @proj build the mipmap levels used for displaying the viewport
+ * at @scale, and the levels adjacent to it, in the background, for the
+ * viewport and a margin around it.  The margin is extended in the
+ * direction of panning, if the viewport moved since the last call.
+ *
+ * The prefetched area is kept up to date as the projection changes,
+ * so that panning and zooming do not have to wait for whole mipmap
+ * levels to be generated on demand.
+ **/
+void
+gimp_projection_set_prefetch_rect (GimpProjection *proj,
+                                   gint            x,
+                                   gint            y,
+                                   gint            w,
+                                   gint            h,
+                                   gdouble         scale)
+{
+  GeglRectangle  old_rect;
+  GeglRectangle  viewport;
+  GeglRectangle  rect;
+  GeglRectangle  bounding_box;
+  gint           old_min_level;
+  gint           old_max_level;
+  gint           level;
+  gint           off_x, off_y;
+  gint           margin_x, margin_y;
+
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+  g_return_if_fail (scale > 0.0);
+
+  old_rect      = proj->priv->prefetch_rect;
+  old_min_level = proj->priv->prefetch_min_level;
+  old_max_level = proj->priv->prefetch_max_level;
+
+  viewport = *GEGL_RECTANGLE (x, y, w, h);
+
+  /*  level 0 is the projection itself, which is rendered regardless;
+   *  prefetch the level the viewport is displayed at, and the levels
+   *  directly above and below it.
+   */
+  level = 0;
+
+  if (scale < 1.0)
+    level = floor (log2 (1.0 / scale));
+
+  level = MIN (level, GIMP_PROJECTION_PREFETCH_MAX_LEVEL);
+
+  proj->priv->prefetch_level = level;
+
+  proj->priv->prefetch_min_level = MAX (level - 1, 1);
+  proj->priv->prefetch_max_level = MIN (level + 1,
+                                        GIMP_PROJECTION_PREFETCH_MAX_LEVEL);
+
+  margin_x = ceil (w * GIMP_PROJECTION_PREFETCH_MARGIN);
+  margin_y = ceil (h * GIMP_PROJECTION_PREFETCH_MARGIN);
+
+  rect = *GEGL_RECTANGLE (x - margin_x,     y - margin_y,
+                          w + 2 * margin_x, h + 2 * margin_y);
+
+  /*  when panning, extend the prefetch area along the direction of the
+   *  movement.
+   */
+  if (proj->priv->prefetch_viewport.width  == w &&
+      proj->priv->prefetch_viewport.height == h &&
+      old_min_level == proj->priv->prefetch_min_level)
+    {
+      gint dx = x - proj->priv->prefetch_viewport.x;
+      gint dy = y - proj->priv->prefetch_viewport.y;
+
+      dx = CLAMP (dx * GIMP_PROJECTION_PREFETCH_LOOKAHEAD, -w, w);
+      dy = CLAMP (dy * GIMP_PROJECTION_PREFETCH_LOOKAHEAD, -h, h);
+
+      if (dx < 0)
+        rect.x += dx;
+
+      if (dy < 0)
+        rect.y += dy;
+
+      rect.width  += ABS (dx);
+      rect.height += ABS (dy);
+    }
+
+  proj->priv->prefetch_viewport = viewport;
+
+  /*  subtract the projectable's offsets because the mipmap levels are
+   *  in tile-pyramid coordinates, but our external API is always in
+   *  terms of image coordinates.
+   */
+  gimp_projectable_get_offset (proj->priv->projectable, &off_x, &off_y);
+  bounding_box = gimp_projectable_get_bounding_box (proj->priv->projectable);
+
+  rect.x -= off_x;
+  rect.y -= off_y;
+
+  if (! gegl_rectangle_intersect (&rect, &rect, &bounding_box))
+    {
+      gimp_projection_prefetch_stop (proj);
+
+      proj->priv->prefetch_rect = rect;
+
+      return;
+    }
+
+  proj->priv->prefetch_rect = rect;
+
+  if (old_min_level == proj->priv->prefetch_min_level &&
+      old_max_level == proj->priv->prefetch_max_level)
+    {
+      cairo_region_t *region;
+
+      if (gegl_rectangle_equal (&rect, &old_rect))
+        return;
+
+      /*  drop the pending areas which fell out of the prefetch area, and
+       *  only add the newly exposed ones.
+       */
+      if (proj->priv->prefetch_iter)
+        {
+          region = gimp_chunk_iterator_stop (proj->priv->prefetch_iter, FALSE);
+
+          proj->priv->prefetch_iter = NULL;
+
+          if (proj->priv->prefetch_region)
+            {
+              cairo_region_union (proj->priv->prefetch_region, region);
+
+              cairo_region_destroy (region);
+            }
+          else
+            {
+              proj->priv->prefetch_region = region;
+            }
+        }
+
+      if (proj->priv->prefetch_region)
+        {
+          cairo_region_intersect_rectangle (
+            proj->priv->prefetch_region,
+            (const cairo_rectangle_int_t *) &rect);
+        }
+
+      region = cairo_region_create_rectangle (
+        (const cairo_rectangle_int_t *) &rect);
+
+      cairo_region_subtract_rectangle (
+        region, (const cairo_rectangle_int_t *) &old_rect);
+
+      if (proj->priv->prefetch_region)
+        {
+          cairo_region_union (proj->priv->prefetch_region, region);
+
+          cairo_region_destroy (region);
+        }
+      else
+        {
+          proj->priv->prefetch_region = region;
+        }
+
+      gimp_projection_prefetch_add_area (proj, NULL);
+    }
+  else
+    {
+      gimp_projection_prefetch_stop (proj);
+
+      gimp_projection_prefetch_add_area (proj, &rect);
+    }
+}
+
 void
 gimp_projection_stop_rendering (GimpProjection *proj)
 {
@@ -597,6 +811,7 @@ static void
 gimp_projection_free_buffer (GimpProjection  *proj)
 {
   gimp_projection_chunk_render_stop (proj, FALSE);
+  gimp_projection_prefetch_stop (proj);
 
   g_clear_pointer (&proj->priv->update_region, cairo_region_destroy);
 
@@ -749,8 +964,12 @@ gimp_projection_chunk_render_start (GimpProjection *proj)
 
   if (region && ! cairo_region_is_empty (region))
     {
+      gint preview_level = gimp_projection_get_preview_level (proj, region);
+
       proj->priv->iter = gimp_chunk_iterator_new (region);
 
+      gimp_chunk_iterator_set_preview_level (proj->priv->iter, preview_level);
+
       gimp_projection_update_priority_rect (proj);
 
       if (! proj->priv->idle_id)
@@ -848,8 +1067,23 @@ gimp_projection_chunk_render_iteration (GimpProjection *proj)
 
       while (gimp_chunk_iterator_get_rect (proj->priv->iter, &rect))
         {
-          gimp_projection_paint_area (proj, TRUE,
-                                      rect.x, rect.y, rect.width, rect.height);
+          GimpTraceSpan span  = GIMP_TRACE_BEGIN ();
+          gint          level = gimp_chunk_iterator_get_level (proj->priv->iter);
+
+          if (level > 0)
+            {
+              gimp_projection_preview_area (proj, level, &rect);
+            }
+          else
+            {
+              gimp_projection_paint_area (proj, TRUE,
+                                          rect.x, rect.y,
+                                          rect.width, rect.height);
+            }
+
+          GIMP_TRACE_END (span, "projection", "render chunk",
+                          "%dx%d at %d,%d, level %d",
+                          rect.width, rect.height, rect.x, rect.y, level);
         }
 
       gimp_tile_handler_validate_end_validate (proj->priv->validate_handler);
@@ -919,6 +1153,310 @@ gimp_projection_paint_area (GimpProjection *proj,
                      rect.y + off_y,
                      rect.width,
                      rect.height);
+
+      /*  the mipmap levels above the updated area are now stale  */
+      gimp_projection_prefetch_add_area (proj, &rect);
+    }
+}
+
+/*  renders @rect at a reduced level of detail, and writes the upscaled
+ *  result to the projection, so that the display shows an approximation
+ *  of the new content until @rect is rendered at full resolution.
+ */
+static void
+gimp_projection_preview_area (GimpProjection      *proj,
+                              gint                 level,
+                              const GeglRectangle *rect)
+{
+  GeglNode      *graph  = gimp_projectable_get_graph (proj->priv->projectable);
+  const Babl    *format = gegl_buffer_get_format (proj->priv->buffer);
+  gint           bpp    = babl_format_get_bytes_per_pixel (format);
+  GeglRectangle  level_rect;
+  guchar        *level_data;
+  gint           level_stride;
+  guchar        *rows;
+  gint           row_stride;
+  gint           off_x, off_y;
+  gint           x, y;
+
+  level_rect.x      = rect->x >> level;
+  level_rect.y      = rect->y >> level;
+  level_rect.width  = ((rect->x + rect->width  + (1 << level) - 1) >> level) -
+                      level_rect.x;
+  level_rect.height = ((rect->y + rect->height + (1 << level) - 1) >> level) -
+                      level_rect.y;
+
+  level_stride = level_rect.width * bpp;
+  level_data   = gegl_scratch_alloc (level_stride * level_rect.height);
+
+  gegl_node_blit (graph, 1.0 / (1 << level), &level_rect,
+                  format, level_data, level_stride,
+                  GEGL_BLIT_DEFAULT);
+
+  row_stride = rect->width * bpp;
+  rows       = gegl_scratch_alloc (row_stride << level);
+
+  for (y = rect->y; y < rect->y + rect->height;)
+    {
+      const guchar *src;
+      guchar       *dest = rows;
+      gint          height;
+      gint          i;
+
+      height = MIN (((y >> level) + 1) << level, rect->y + rect->height) - y;
+
+      src = level_data + ((y >> level) - level_rect.y) * level_stride;
+
+      for (x = rect->x; x < rect->x + rect->width; x++)
+        {
+          memcpy (dest, src + ((x >> level) - level_rect.x) * bpp, bpp);
+
+          dest += bpp;
+        }
+
+      for (i = 1; i < height; i++)
+        memcpy (rows + i * row_stride, rows, row_stride);
+
+      gegl_buffer_set (proj->priv->buffer,
+                       GEGL_RECTANGLE (rect->x, y, rect->width, height), 0,
+                       format, rows, row_stride);
+
+      y += height;
+    }
+
+  gegl_scratch_free (rows);
+  gegl_scratch_free (level_data);
+
+  /*  the pixels were written while the validate handler is suspended
+   *  by gimp_projection_chunk_render_iteration().  take @rect out of
+   *  its dirty region, or the display's next read would validate it
+   *  right away, replacing the preview and rendering @rect twice.
+   *  @rect stays in the chunk iterator's region, and its full
+   *  resolution pass validates it regardless of the dirty region.
+   */
+  gimp_tile_handler_validate_undo_invalidate (proj->priv->validate_handler,
+                                              rect);
+
+  gimp_projectable_get_offset (proj->priv->projectable, &off_x, &off_y);
+
+  g_signal_emit (proj, projection_signals[UPDATE], 0,
+                 TRUE,
+                 rect->x + off_x,
+                 rect->y + off_y,
+                 rect->width,
+                 rect->height);
+}
+
+static gint
+gimp_projection_get_preview_level (GimpProjection *proj,
+                                   cairo_region_t *region)
+{
+  GeglRectangle rect;
+  GeglRectangle bounding_box;
+  gint64        area = 0;
+  gint          off_x, off_y;
+  gint          n_rects;
+  gint          i;
+
+  if (gegl_rectangle_is_empty (&proj->priv->priority_rect))
+    return 0;
+
+  rect = proj->priv->priority_rect;
+
+  gimp_projectable_get_offset (proj->priv->projectable, &off_x, &off_y);
+  bounding_box = gimp_projectable_get_bounding_box (proj->priv->projectable);
+
+  rect.x -= off_x;
+  rect.y -= off_y;
+
+  if (! gegl_rectangle_intersect (&rect, &rect, &bounding_box))
+    return 0;
+
+  n_rects = cairo_region_num_rectangles (region);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      GeglRectangle area_rect;
+
+      cairo_region_get_rectangle (region, i,
+                                  (cairo_rectangle_int_t *) &area_rect);
+
+      if (gegl_rectangle_intersect (&area_rect, &area_rect, &rect))
+        area += (gint64) area_rect.width * area_rect.height;
+    }
+
+  /*  small updates are rendered at full resolution right away  */
+  if ((area >> (2 * proj->priv->prefetch_level)) <
+      GIMP_PROJECTION_PREVIEW_MIN_AREA)
+    {
+      return 0;
+    }
+
+  return proj->priv->prefetch_level + GIMP_PROJECTION_PREVIEW_LEVELS;
+}
+
+static void
+gimp_projection_prefetch_add_area (GimpProjection      *proj,
+                                   const GeglRectangle *rect)
+{
+  if (rect)
+    {
+      cairo_rectangle_int_t prefetch_rect;
+
+      if (! gegl_rectangle_intersect ((GeglRectangle *) &prefetch_rect,
+                                      rect, &proj->priv->prefetch_rect))
+        {
+          return;
+        }
+
+      if (proj->priv->prefetch_region)
+        {
+          cairo_region_union_rectangle (proj->priv->prefetch_region,
+                                        &prefetch_rect);
+        }
+      else
+        {
+          proj->priv->prefetch_region =
+            cairo_region_create_rectangle (&prefetch_rect);
+        }
+    }
+
+  if (! proj->priv->prefetch_idle_id &&
+      (proj->priv->prefetch_iter ||
+       (proj->priv->prefetch_region &&
+        ! cairo_region_is_empty (proj->priv->prefetch_region))))
+    {
+      /*  below the chunk renderer, so that we only prefetch once the
+       *  visible area is up to date.
+       */
+      proj->priv->prefetch_idle_id = g_idle_add_full (
+        GIMP_PRIORITY_PROJECTION_PREFETCH_IDLE + proj->priv->priority,
+        (GSourceFunc) gimp_projection_prefetch_callback,
+        proj, NULL);
+    }
+}
+
+static void
+gimp_projection_prefetch_stop (GimpProjection *proj)
+{
+  if (proj->priv->prefetch_idle_id)
+    {
+      g_source_remove (proj->priv->prefetch_idle_id);
+      proj->priv->prefetch_idle_id = 0;
+    }
+
+  if (proj->priv->prefetch_iter)
+    {
+      gimp_chunk_iterator_stop (proj->priv->prefetch_iter, TRUE);
+
+      proj->priv->prefetch_iter = NULL;
+    }
+
+  g_clear_pointer (&proj->priv->prefetch_region, cairo_region_destroy);
+}
+
+static gboolean
+gimp_projection_prefetch_callback (GimpProjection *proj)
+{
+  if (! proj->priv->buffer)
+    {
+      proj->priv->prefetch_idle_id = 0;
+
+      gimp_projection_prefetch_stop (proj);
+
+      return G_SOURCE_REMOVE;
+    }
+
+  if (! proj->priv->prefetch_iter)
+    {
+      if (! proj->priv->prefetch_region ||
+          cairo_region_is_empty (proj->priv->prefetch_region))
+        {
+          g_clear_pointer (&proj->priv->prefetch_region,
+                           cairo_region_destroy);
+
+          proj->priv->prefetch_idle_id = 0;
+
+          return G_SOURCE_REMOVE;
+        }
+
+      /*  consumes the prefetch region  */
+      proj->priv->prefetch_iter =
+        gimp_chunk_iterator_new (proj->priv->prefetch_region);
+      proj->priv->prefetch_region = NULL;
+
+      /*  prefetch the area around the viewport first  */
+      if (! gegl_rectangle_is_empty (&proj->priv->priority_rect))
+        {
+          GeglRectangle rect = proj->priv->priority_rect;
+          gint          off_x, off_y;
+
+          gimp_projectable_get_offset (proj->priv->projectable,
+                                       &off_x, &off_y);
+
+          rect.x -= off_x;
+          rect.y -= off_y;
+
+          gimp_chunk_iterator_set_priority_rect (proj->priv->prefetch_iter,
+                                                 &rect);
+        }
+    }
+
+  if (gimp_chunk_iterator_next (proj->priv->prefetch_iter))
+    {
+      GeglRectangle rect;
+
+      gimp_tile_handler_validate_begin_validate (proj->priv->validate_handler);
+
+      while (gimp_chunk_iterator_get_rect (proj->priv->prefetch_iter, &rect))
+        gimp_projection_prefetch_area (proj, &rect);
+
+      gimp_tile_handler_validate_end_validate (proj->priv->validate_handler);
+    }
+  else
+    {
+      /*  the iterator frees itself once it's done; areas which were
+       *  updated in the meantime are picked up in the next iteration.
+       */
+      proj->priv->prefetch_iter = NULL;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+gimp_projection_prefetch_area (GimpProjection      *proj,
+                               const GeglRectangle *rect)
+{
+  const Babl *format = gegl_buffer_get_format (proj->priv->buffer);
+  gint        bpp    = babl_format_get_bytes_per_pixel (format);
+  gint        level;
+
+  /*  fetching the area at the scale of each level makes GEGL build, and
+   *  cache, the corresponding mipmap tiles from the level below.
+   */
+  for (level = proj->priv->prefetch_min_level;
+       level <= proj->priv->prefetch_max_level;
+       level++)
+    {
+      GeglRectangle level_rect;
+      gpointer      data;
+
+      level_rect.x      = rect->x >> level;
+      level_rect.y      = rect->y >> level;
+      level_rect.width  = ((rect->x + rect->width  + (1 << level) - 1) >> level) -
+                          level_rect.x;
+      level_rect.height = ((rect->y + rect->height + (1 << level) - 1) >> level) -
+                          level_rect.y;
+
+      data = gegl_scratch_alloc (level_rect.width * level_rect.height * bpp);
+
+      gegl_buffer_get (proj->priv->buffer,
+                       &level_rect, 1.0 / (1 << level),
+                       format, data, GEGL_AUTO_ROWSTRIDE,
+                       GEGL_ABYSS_NONE);
+
+      gegl_scratch_free (data);
     }
 }
 
@@ -66,6 +66,12 @@ void             gimp_projection_set_priority_rect (GimpProjection    *proj,
                                                     gint               y,
                                                     gint               width,
                                                     gint               height);
+void             gimp_projection_set_prefetch_rect (GimpProjection    *proj,
+                                                    gint               x,
+                                                    gint               y,
+                                                    gint               width,
+                                                    gint               height,
+                                                    gdouble            scale);
 
 void             gimp_projection_stop_rendering    (GimpProjection    *proj);
 
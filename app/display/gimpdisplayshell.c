@@ -1901,6 +1901,11 @@ gimp_display_shell_update_priority_rect (GimpDisplayShell *shell)
       gimp_display_shell_untransform_viewport (shell, ! shell->show_all,
                                                &x, &y, &width, &height);
       gimp_projection_set_priority_rect (projection, x, y, width, height);
+
+      /*  use the same scale as gimp_display_shell_render()  */
+      gimp_projection_set_prefetch_rect (projection, x, y, width, height,
+                                         shell->render_scale *
+                                         MAX (shell->scale_x, shell->scale_y));
     }
 }
 
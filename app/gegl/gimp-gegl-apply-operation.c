@@ -38,6 +38,8 @@
 #include "gimp-gegl-nodes.h"
 #include "gimp-gegl-utils.h"
 
+#include "gimp-trace.h"
+
 
 /* iteration interval when applying an operation interactively
  * (with progress indication)
@@ -99,6 +101,7 @@ gimp_gegl_apply_cached_operation (GeglBuffer          *src_buffer,
   GeglBuffer        *result_buffer;
   GimpChunkIterator *iter;
   cairo_region_t    *region;
+  GimpTraceSpan      span               = GIMP_TRACE_BEGIN ();
   gboolean           progress_started   = FALSE;
   gboolean           cancel             = FALSE;
   gint64             all_pixels;
@@ -372,6 +375,12 @@ gimp_gegl_apply_cached_operation (GeglBuffer          *src_buffer,
                                               &cancel);
     }
 
+  GIMP_TRACE_END (span, "gegl", gegl_node_get_operation (underlying_operation),
+                  "%dx%d at %d,%d%s",
+                  dest_rect->width, dest_rect->height,
+                  dest_rect->x, dest_rect->y,
+                  cancel ? ", canceled" : "");
+
   return ! cancel;
 }
 
@@ -1099,4 +1099,196 @@ gimp_gegl_average_color (GeglBuffer          *buffer,
   babl_process (babl_fish (average_format, format), average.color, color, 1);
 }
 
+/*  finds the bounding box of the pixels of 'buffer', inside 'rect', whose
+ *  single component in 'format' (e.g., "A float") is nonzero.  returns FALSE
+ *  if there are no such pixels.
+ */
+gboolean
+gimp_gegl_buffer_get_content_bounds (GeglBuffer          *buffer,
+                                     const GeglRectangle *rect,
+                                     const Babl          *format,
+                                     GeglRectangle       *bounds)
+{
+  GMutex mutex;
+  gint   x1 = G_MAXINT;
+  gint   y1 = G_MAXINT;
+  gint   x2 = G_MININT;
+  gint   y2 = G_MININT;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), FALSE);
+  g_return_val_if_fail (babl_format_get_n_components (format) == 1, FALSE);
+  g_return_val_if_fail (bounds != NULL, FALSE);
+
+  if (! rect)
+    rect = gegl_buffer_get_extent (buffer);
+
+  g_mutex_init (&mutex);
+
+  gegl_parallel_distribute_area (
+    rect, PIXELS_PER_THREAD,
+    [&] (const GeglRectangle *area)
+    {
+      GeglBufferIterator *iter;
+      gint                area_x1 = G_MAXINT;
+      gint                area_y1 = G_MAXINT;
+      gint                area_x2 = G_MININT;
+      gint                area_y2 = G_MININT;
+
+      iter = gegl_buffer_iterator_new (buffer, area, 0, format,
+                                       GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          const GeglRectangle *roi = &iter->items[0].roi;
+          const gfloat        *row = (const gfloat *) iter->items[0].data;
+          gint                 y;
+
+          for (y = roi->y; y < roi->y + roi->height; y++)
+            {
+              gint first;
+              gint last;
+
+              for (first = 0; first < roi->width && ! row[first]; first++);
+
+              if (first < roi->width)
+                {
+                  for (last = roi->width - 1; ! row[last]; last--);
+
+                  area_x1 = MIN (area_x1, roi->x + first);
+                  area_x2 = MAX (area_x2, roi->x + last + 1);
+                  area_y1 = MIN (area_y1, y);
+                  area_y2 = MAX (area_y2, y + 1);
+                }
+
+              row += roi->width;
+            }
+        }
+
+      if (area_x1 < area_x2)
+        {
+          g_mutex_lock (&mutex);
+
+          x1 = MIN (x1, area_x1);
+          y1 = MIN (y1, area_y1);
+          x2 = MAX (x2, area_x2);
+          y2 = MAX (y2, area_y2);
+
+          g_mutex_unlock (&mutex);
+        }
+    });
+
+  g_mutex_clear (&mutex);
+
+  if (x1 >= x2)
+    {
+      gegl_rectangle_set (bounds, rect->x, rect->y, 0, 0);
+
+      return FALSE;
+    }
+
+  gegl_rectangle_set (bounds, x1, y1, x2 - x1, y2 - y1);
+
+  return TRUE;
+}
+
+/*  replaces all the tiles of 'buffer' which are fully contained in 'rect'
+ *  and whose data is all zero (i.e., fully transparent, or black without
+ *  alpha) with GEGL's shared empty tile, so that they take no memory, and
+ *  are shared by copies of the buffer.  returns the number of elided tiles.
+ */
+gint
+gimp_gegl_buffer_elide_empty_tiles (GeglBuffer          *buffer,
+                                    const GeglRectangle *rect)
+{
+  const Babl *format;
+  gint        bpp;
+  gint        tile_width;
+  gint        tile_height;
+  gint        shift_x;
+  gint        shift_y;
+  gint        tile_x1, tile_y1;
+  gint        tile_x2, tile_y2;
+  gint        n_tile_cols;
+  gint        n_tiles;
+  gint        n_elided = 0;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), 0);
+
+  if (! rect)
+    rect = gegl_buffer_get_extent (buffer);
+
+  format = gegl_buffer_get_format (buffer);
+  bpp    = babl_format_get_bytes_per_pixel (format);
+
+  g_object_get (buffer,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                "shift-x",     &shift_x,
+                "shift-y",     &shift_y,
+                NULL);
+
+  /*  the range of tiles fully contained in 'rect'  */
+  tile_x1 = (gint) ceil  ((gdouble) (rect->x + shift_x) / tile_width);
+  tile_y1 = (gint) ceil  ((gdouble) (rect->y + shift_y) / tile_height);
+  tile_x2 = (gint) floor ((gdouble) (rect->x + rect->width  + shift_x) /
+                          tile_width);
+  tile_y2 = (gint) floor ((gdouble) (rect->y + rect->height + shift_y) /
+                          tile_height);
+
+  if (tile_x2 <= tile_x1 || tile_y2 <= tile_y1)
+    return 0;
+
+  n_tile_cols = tile_x2 - tile_x1;
+  n_tiles     = n_tile_cols * (tile_y2 - tile_y1);
+
+  gegl_parallel_distribute_range (
+    n_tiles, 1,
+    [=, &n_elided] (gint offset, gint size)
+    {
+      gint i;
+
+      for (i = offset; i < offset + size; i++)
+        {
+          GeglBufferIterator *iter;
+          GeglRectangle       tile_rect;
+          gboolean            empty = TRUE;
+
+          tile_rect.x      = (tile_x1 + i % n_tile_cols) * tile_width  -
+                             shift_x;
+          tile_rect.y      = (tile_y1 + i / n_tile_cols) * tile_height -
+                             shift_y;
+          tile_rect.width  = tile_width;
+          tile_rect.height = tile_height;
+
+          iter = gegl_buffer_iterator_new (buffer, &tile_rect, 0, format,
+                                           GEGL_ACCESS_READ, GEGL_ABYSS_NONE,
+                                           1);
+
+          while (gegl_buffer_iterator_next (iter))
+            {
+              const guint8 *data = (const guint8 *) iter->items[0].data;
+              gint          n    = iter->length * bpp;
+
+              if (data[0] || (n > 1 && memcmp (data, data + 1, n - 1)))
+                {
+                  empty = FALSE;
+
+                  gegl_buffer_iterator_stop (iter);
+
+                  break;
+                }
+            }
+
+          if (empty)
+            {
+              gegl_buffer_clear (buffer, &tile_rect);
+
+              g_atomic_int_inc (&n_elided);
+            }
+        }
+    });
+
+  return n_elided;
+}
+
 } /* extern "C" */
@@ -105,5 +105,15 @@ void   gimp_gegl_average_color         (GeglBuffer               *buffer,
                                         const Babl               *format,
                                         gpointer                  color);
 
+gboolean gimp_gegl_buffer_get_content_bounds
+                                       (GeglBuffer               *buffer,
+                                        const GeglRectangle      *rect,
+                                        const Babl               *format,
+                                        GeglRectangle            *bounds);
+
+gint   gimp_gegl_buffer_elide_empty_tiles
+                                       (GeglBuffer               *buffer,
+                                        const GeglRectangle      *rect);
+
 
 #endif /* __GIMP_GEGL_LOOPS_H__ */
@@ -0,0 +1,520 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-batch-farm.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The batch farm runs a list of batch commands on a pool of warm GIMP
+ * instances instead of in the current process.  Each worker is a
+ * "gimp --no-interface --batch-farm-worker" child which goes through
+ * gimp_restore() once and then runs one command after the other as it
+ * reads them from its stdin (see gimp_batch_serve()).  The worker's
+ * stdout only carries its messages to the farm; the commands' own
+ * output goes to its stderr, which is shared with the farm's.
+ *
+ * A worker which crashes or exceeds the per-command timeout only costs
+ * the command it was running; it is replaced by a fresh one and the
+ * farm carries on with the remaining commands.
+ *
+ * Workers are started as separate processes rather than forked off an
+ * initialized instance, because GEGL's worker threads and the running
+ * extension plug-ins do not survive a fork().
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "core/core-types.h"
+
+#include "core/gimp-batch.h"
+
+#include "gimp-batch-farm.h"
+
+#include "gimp-intl.h"
+
+
+typedef struct _GimpBatchFarm   GimpBatchFarm;
+typedef struct _GimpBatchWorker GimpBatchWorker;
+
+struct _GimpBatchWorker
+{
+  GimpBatchFarm    *farm;
+  GSubprocess      *process;
+  GOutputStream    *input;
+  GDataInputStream *output;
+
+  gint              job;        /*  index of the running job, or -1   */
+  guint             timeout_id;
+  gboolean          ready;      /*  has asked for a job at least once */
+  gboolean          quitting;   /*  its job called gimp-quit          */
+  gboolean          timed_out;
+  gboolean          closed;     /*  its stdout reached EOF            */
+  gboolean          exited;
+};
+
+struct _GimpBatchFarm
+{
+  const gchar     **worker_argv;
+  GPtrArray        *jobs;
+  guint             next_job;
+  gint              timeout;
+
+  GimpBatchWorker  *workers;
+  gint              n_workers;
+  gint              n_running;
+
+  GMainLoop        *loop;
+
+  gint              n_succeeded;
+  gint              n_failed;
+  gint              n_crashed;
+  gint              n_timed_out;
+};
+
+
+static gboolean   gimp_batch_farm_read_jobs      (GPtrArray        *jobs,
+                                                  const gchar      *filename);
+
+static gboolean   gimp_batch_worker_start        (GimpBatchWorker  *worker);
+static void       gimp_batch_worker_dispatch     (GimpBatchWorker  *worker);
+static void       gimp_batch_worker_finish_job   (GimpBatchWorker  *worker,
+                                                  gboolean          success);
+static void       gimp_batch_worker_gone         (GimpBatchWorker  *worker);
+static void       gimp_batch_worker_read_line    (GimpBatchWorker  *worker);
+static void       gimp_batch_worker_line_read    (GObject          *source,
+                                                  GAsyncResult     *result,
+                                                  gpointer          data);
+static void       gimp_batch_worker_exited       (GObject          *source,
+                                                  GAsyncResult     *result,
+                                                  gpointer          data);
+static gboolean   gimp_batch_worker_timeout      (gpointer          data);
+
+
+/*  public functions  */
+
+/*
+ * Runs batch_commands, followed by the commands read from the file
+ * batch_jobs, one per line ("-" for stdin), on n_workers worker
+ * processes started with worker_argv.  A command still running after
+ * timeout seconds gets its worker killed, unless timeout is 0.
+ *
+ * Prints a summary to stderr when all commands are done, and returns
+ * the exit status for the farm: EXIT_SUCCESS if all of them succeeded.
+ */
+gint
+gimp_batch_farm_run (const gchar **worker_argv,
+                     const gchar **batch_commands,
+                     const gchar  *batch_jobs,
+                     gint          n_workers,
+                     gint          timeout)
+{
+  GimpBatchFarm  farm = { 0, };
+  gint64         start_time;
+  gdouble        elapsed;
+  gint           n_not_run;
+  gint           status;
+  gint           i;
+
+  g_return_val_if_fail (worker_argv != NULL, EXIT_FAILURE);
+  g_return_val_if_fail (n_workers > 0, EXIT_FAILURE);
+
+  farm.worker_argv = worker_argv;
+  farm.jobs        = g_ptr_array_new_with_free_func (g_free);
+  farm.timeout     = MAX (timeout, 0);
+
+  for (i = 0; batch_commands && batch_commands[i]; i++)
+    {
+      /*  the worker protocol is line based  */
+      gchar *cmd = g_strdelimit (g_strdup (batch_commands[i]), "\r\n", ' ');
+
+      g_ptr_array_add (farm.jobs, cmd);
+    }
+
+  if (batch_jobs && ! gimp_batch_farm_read_jobs (farm.jobs, batch_jobs))
+    {
+      g_ptr_array_free (farm.jobs, TRUE);
+
+      return EXIT_FAILURE;
+    }
+
+  if (farm.jobs->len == 0)
+    {
+      g_printerr ("%s\n", _("The batch farm has no commands to run."));
+      g_ptr_array_free (farm.jobs, TRUE);
+
+      return EXIT_FAILURE;
+    }
+
+  farm.n_workers = MIN (n_workers, (gint) farm.jobs->len);
+  farm.workers   = g_new0 (GimpBatchWorker, farm.n_workers);
+  farm.loop      = g_main_loop_new (NULL, FALSE);
+
+  start_time = g_get_monotonic_time ();
+
+  for (i = 0; i < farm.n_workers; i++)
+    {
+      farm.workers[i].farm = &farm;
+
+      gimp_batch_worker_start (&farm.workers[i]);
+    }
+
+  if (farm.n_running > 0)
+    g_main_loop_run (farm.loop);
+
+  elapsed = (g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC;
+
+  n_not_run = ((gint) farm.jobs->len -
+               (farm.n_succeeded + farm.n_failed +
+                farm.n_crashed   + farm.n_timed_out));
+
+  g_printerr ("batch farm: %u commands in %.2f s (%.2f commands/s) "
+              "on %d workers\n",
+              farm.jobs->len, elapsed,
+              elapsed > 0.0 ? farm.jobs->len / elapsed : 0.0,
+              farm.n_workers);
+  g_printerr ("batch farm: %d succeeded, %d failed, %d crashed, "
+              "%d timed out, %d not run\n",
+              farm.n_succeeded, farm.n_failed, farm.n_crashed,
+              farm.n_timed_out, n_not_run);
+
+  if (farm.n_succeeded == (gint) farm.jobs->len)
+    status = EXIT_SUCCESS;
+  else
+    status = EXIT_FAILURE;
+
+  g_main_loop_unref (farm.loop);
+  g_free (farm.workers);
+  g_ptr_array_free (farm.jobs, TRUE);
+
+  return status;
+}
+
+
+/*  private functions  */
+
+static gboolean
+gimp_batch_farm_read_jobs (GPtrArray   *jobs,
+                           const gchar *filename)
+{
+  FILE    *file;
+  GString *line;
+  gchar    buf[1024];
+
+  if (! strcmp (filename, "-"))
+    file = stdin;
+  else
+    file = g_fopen (filename, "r");
+
+  if (! file)
+    {
+      g_printerr (_("Could not open '%s' for reading: %s"),
+                  filename, g_strerror (errno));
+      g_printerr ("\n");
+
+      return FALSE;
+    }
+
+  line = g_string_new (NULL);
+
+  while (TRUE)
+    {
+      gboolean eof = ! fgets (buf, sizeof (buf), file);
+
+      if (! eof)
+        g_string_append (line, buf);
+
+      if (eof || (line->len > 0 && line->str[line->len - 1] == '\n'))
+        {
+          g_strstrip (line->str);
+
+          /*  skip empty lines and comments  */
+          if (line->str[0] && line->str[0] != '#')
+            g_ptr_array_add (jobs, g_strdup (line->str));
+
+          g_string_truncate (line, 0);
+        }
+
+      if (eof)
+        break;
+    }
+
+  g_string_free (line, TRUE);
+
+  if (file != stdin)
+    fclose (file);
+
+  return TRUE;
+}
+
+static gboolean
+gimp_batch_worker_start (GimpBatchWorker *worker)
+{
+  GimpBatchFarm *farm  = worker->farm;
+  GError        *error = NULL;
+
+  worker->process =
+    g_subprocess_newv (farm->worker_argv,
+                       G_SUBPROCESS_FLAGS_STDIN_PIPE |
+                       G_SUBPROCESS_FLAGS_STDOUT_PIPE,
+                       &error);
+
+  if (! worker->process)
+    {
+      g_printerr ("batch farm: could not start a worker: %s\n",
+                  error->message);
+      g_clear_error (&error);
+
+      return FALSE;
+    }
+
+  worker->input  = g_subprocess_get_stdin_pipe (worker->process);
+  worker->output =
+    g_data_input_stream_new (g_subprocess_get_stdout_pipe (worker->process));
+
+  worker->job       = -1;
+  worker->ready     = FALSE;
+  worker->quitting  = FALSE;
+  worker->timed_out = FALSE;
+  worker->closed    = FALSE;
+  worker->exited    = FALSE;
+
+  farm->n_running++;
+
+  gimp_batch_worker_read_line (worker);
+
+  g_subprocess_wait_async (worker->process, NULL,
+                           gimp_batch_worker_exited, worker);
+
+  return TRUE;
+}
+
+static void
+gimp_batch_worker_dispatch (GimpBatchWorker *worker)
+{
+  GimpBatchFarm *farm  = worker->farm;
+  GError        *error = NULL;
+
+  if (farm->next_job < farm->jobs->len)
+    {
+      const gchar *cmd;
+      gchar       *line;
+
+      /*  never leave the previous job's timeout armed  */
+      if (worker->timeout_id)
+        {
+          g_source_remove (worker->timeout_id);
+          worker->timeout_id = 0;
+        }
+
+      worker->job = farm->next_job++;
+
+      cmd  = g_ptr_array_index (farm->jobs, worker->job);
+      line = g_strconcat (cmd, "\n", NULL);
+
+      if (farm->timeout > 0)
+        worker->timeout_id = g_timeout_add_seconds (farm->timeout,
+                                                    gimp_batch_worker_timeout,
+                                                    worker);
+
+      /*  if this fails, the worker is gone and we'll hear about it  */
+      g_output_stream_write_all (worker->input, line, strlen (line),
+                                 NULL, NULL, NULL);
+
+      g_free (line);
+    }
+  else
+    {
+      /*  nothing left to do, let the worker exit  */
+      if (! g_output_stream_close (worker->input, NULL, &error))
+        g_clear_error (&error);
+    }
+}
+
+static void
+gimp_batch_worker_finish_job (GimpBatchWorker *worker,
+                              gboolean         success)
+{
+  GimpBatchFarm *farm = worker->farm;
+
+  if (worker->timeout_id)
+    {
+      g_source_remove (worker->timeout_id);
+      worker->timeout_id = 0;
+    }
+
+  if (success)
+    {
+      farm->n_succeeded++;
+    }
+  else
+    {
+      farm->n_failed++;
+
+      g_printerr ("batch farm: command failed: %s\n",
+                  (const gchar *) g_ptr_array_index (farm->jobs, worker->job));
+    }
+
+  worker->job = -1;
+}
+
+/*  called once the worker has both exited and closed its stdout  */
+static void
+gimp_batch_worker_gone (GimpBatchWorker *worker)
+{
+  GimpBatchFarm *farm = worker->farm;
+
+  if (worker->timeout_id)
+    {
+      g_source_remove (worker->timeout_id);
+      worker->timeout_id = 0;
+    }
+
+  if (worker->job >= 0)
+    {
+      const gchar *cmd = g_ptr_array_index (farm->jobs, worker->job);
+
+      if (worker->quitting)
+        {
+          farm->n_succeeded++;
+        }
+      else if (worker->timed_out)
+        {
+          farm->n_timed_out++;
+
+          g_printerr ("batch farm: command timed out after %d s: %s\n",
+                      farm->timeout, cmd);
+        }
+      else
+        {
+          farm->n_crashed++;
+
+          g_printerr ("batch farm: worker died while running: %s\n", cmd);
+        }
+
+      worker->job = -1;
+    }
+
+  g_clear_object (&worker->output);
+  g_clear_object (&worker->process);
+  worker->input = NULL;
+
+  farm->n_running--;
+
+  /*  replace the worker if there's work left, unless it didn't even
+   *  make it to its first command, which would happen again
+   */
+  if (farm->next_job < farm->jobs->len && worker->ready)
+    gimp_batch_worker_start (worker);
+
+  if (farm->n_running == 0)
+    g_main_loop_quit (farm->loop);
+}
+
+static void
+gimp_batch_worker_read_line (GimpBatchWorker *worker)
+{
+  g_data_input_stream_read_line_async (worker->output, G_PRIORITY_DEFAULT,
+                                       NULL,
+                                       gimp_batch_worker_line_read, worker);
+}
+
+static void
+gimp_batch_worker_line_read (GObject      *source,
+                             GAsyncResult *result,
+                             gpointer      data)
+{
+  GimpBatchWorker *worker = data;
+  gchar           *line;
+
+  line = g_data_input_stream_read_line_finish (G_DATA_INPUT_STREAM (source),
+                                               result, NULL, NULL);
+
+  if (! line)
+    {
+      worker->closed = TRUE;
+
+      if (worker->exited)
+        gimp_batch_worker_gone (worker);
+
+      return;
+    }
+
+  if (g_str_has_prefix (line, GIMP_BATCH_FARM_TAG " "))
+    {
+      const gchar *message = line + strlen (GIMP_BATCH_FARM_TAG " ");
+
+      if (! strcmp (message, "ready"))
+        {
+          /*  a job whose status never arrived  */
+          if (worker->job >= 0)
+            gimp_batch_worker_finish_job (worker, FALSE);
+
+          worker->ready = TRUE;
+
+          gimp_batch_worker_dispatch (worker);
+        }
+      else if (g_str_has_prefix (message, "done ") && worker->job >= 0)
+        {
+          gimp_batch_worker_finish_job (worker,
+                                        ! strcmp (message + strlen ("done "),
+                                                  "success"));
+        }
+      else if (! strcmp (message, "quit"))
+        {
+          worker->quitting = TRUE;
+        }
+    }
+
+  g_free (line);
+
+  gimp_batch_worker_read_line (worker);
+}
+
+static void
+gimp_batch_worker_exited (GObject      *source,
+                          GAsyncResult *result,
+                          gpointer      data)
+{
+  GimpBatchWorker *worker = data;
+
+  g_subprocess_wait_finish (G_SUBPROCESS (source), result, NULL);
+
+  worker->exited = TRUE;
+
+  if (worker->closed)
+    gimp_batch_worker_gone (worker);
+}
+
+static gboolean
+gimp_batch_worker_timeout (gpointer data)
+{
+  GimpBatchWorker *worker = data;
+
+  worker->timeout_id = 0;
+  worker->timed_out  = TRUE;
+
+  g_subprocess_force_exit (worker->process);
+
+  return G_SOURCE_REMOVE;
+}
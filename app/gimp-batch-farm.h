@@ -0,0 +1,33 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_BATCH_FARM_H__
+#define __GIMP_BATCH_FARM_H__
+
+#ifndef GIMP_APP_GLUE_COMPILATION
+#error You must not #include "gimp-batch-farm.h" from a subdir
+#endif
+
+
+gint   gimp_batch_farm_run (const gchar **worker_argv,
+                            const gchar **batch_commands,
+                            const gchar  *batch_jobs,
+                            gint          n_workers,
+                            gint          timeout);
+
+
+#endif /* __GIMP_BATCH_FARM_H__ */
@@ -45,7 +45,8 @@ typedef enum
   GIMP_LOG_BRUSH_CACHE        = 1 << 18,
   GIMP_LOG_PROJECTION         = 1 << 19,
   GIMP_LOG_XCF                = 1 << 20,
-  GIMP_LOG_MAGIC_MATCH        = 1 << 21
+  GIMP_LOG_MAGIC_MATCH        = 1 << 21,
+  GIMP_LOG_EMPTY_TILES        = 1 << 22
 } GimpLogFlags;
 
 
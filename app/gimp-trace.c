@@ -0,0 +1,398 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gio/gio.h>
+
+#include "gimp-trace.h"
+
+
+#define N_EVENTS  4096 /* per thread; older events are overwritten */
+#define NAME_SIZE 64
+#define ARGS_SIZE 160
+
+
+typedef struct
+{
+  gint64       start;
+  gint64       duration;
+  const gchar *category;
+  gchar        name[NAME_SIZE];
+  gchar        args[ARGS_SIZE];
+} GimpTraceEvent;
+
+typedef struct
+{
+  GMutex         mutex;
+  gint           tid;
+  gboolean       is_main;
+  guint64        n_events;
+  GimpTraceEvent events[N_EVENTS];
+} GimpTraceBuffer;
+
+
+/*  local function prototypes  */
+
+static GimpTraceBuffer * gimp_trace_get_buffer   (void);
+static void              gimp_trace_copy_string  (gchar           *dest,
+                                                  const gchar     *src,
+                                                  gsize            size);
+static gboolean          gimp_trace_print_escaped (GOutputStream  *output,
+                                                   const gchar    *string,
+                                                   GError        **error);
+static gboolean          gimp_trace_write        (GOutputStream   *output,
+                                                  GError         **error);
+
+
+/*  public variables  */
+
+gboolean gimp_trace_enabled = FALSE;
+
+
+/*  local variables  */
+
+static GMutex     trace_mutex;
+/*  buffers are never freed, since threads may hold on to them for as
+ *  long as they live
+ */
+static GPtrArray *trace_buffers    = NULL;
+static GPrivate   trace_buffer;
+static GThread   *trace_main_thread;
+static GFile     *trace_file       = NULL;
+static gint64     trace_start_time = 0;
+
+
+/*  public functions  */
+
+/**
+ * gimp_trace_start:
+ * @file:  the file to write the trace to
+ * @error: return location for an error
+ *
+ * Starts recording trace spans.  Each thread keeps its most recent
+ * spans in a ring buffer of its own, which are written to @file in
+ * the Chrome trace-event JSON format by gimp_trace_stop(), to be
+ * viewed in chrome://tracing, Perfetto, or similar tools.
+ *
+ * Should be called from the main thread.
+ *
+ * Returns: %TRUE if tracing has started.
+ **/
+gboolean
+gimp_trace_start (GFile   *file,
+                  GError **error)
+{
+  guint i;
+
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  g_return_val_if_fail (! gimp_trace_enabled, FALSE);
+
+  g_mutex_lock (&trace_mutex);
+
+  if (! trace_buffers)
+    trace_buffers = g_ptr_array_new ();
+
+  for (i = 0; i < trace_buffers->len; i++)
+    {
+      GimpTraceBuffer *buffer = trace_buffers->pdata[i];
+
+      g_mutex_lock (&buffer->mutex);
+      buffer->n_events = 0;
+      g_mutex_unlock (&buffer->mutex);
+    }
+
+  trace_file        = g_object_ref (file);
+  trace_main_thread = g_thread_self ();
+  trace_start_time  = g_get_monotonic_time ();
+
+  g_mutex_unlock (&trace_mutex);
+
+  gimp_trace_enabled = TRUE;
+
+  return TRUE;
+}
+
+/**
+ * gimp_trace_stop:
+ * @error: return location for an error
+ *
+ * Stops recording trace spans, and writes the recorded spans to the
+ * file passed to gimp_trace_start().  Does nothing if tracing is off.
+ *
+ * Returns: %TRUE if the trace was written successfully.
+ **/
+gboolean
+gimp_trace_stop (GError **error)
+{
+  GOutputStream *output;
+  gboolean       success;
+
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (! gimp_trace_enabled)
+    return TRUE;
+
+  gimp_trace_enabled = FALSE;
+
+  output = G_OUTPUT_STREAM (g_file_replace (trace_file,
+                                            NULL, FALSE, G_FILE_CREATE_NONE,
+                                            NULL, error));
+
+  if (! output)
+    {
+      g_clear_object (&trace_file);
+
+      return FALSE;
+    }
+
+  g_mutex_lock (&trace_mutex);
+
+  success = gimp_trace_write (output, error);
+
+  g_mutex_unlock (&trace_mutex);
+
+  if (success)
+    {
+      success = g_output_stream_close (output, NULL, error);
+    }
+  else
+    {
+      GCancellable *cancellable = g_cancellable_new ();
+
+      /* Cancel the overwrite initiated by g_file_replace(). */
+      g_cancellable_cancel (cancellable);
+      g_output_stream_close (output, cancellable, NULL);
+      g_object_unref (cancellable);
+    }
+
+  g_object_unref (output);
+  g_clear_object (&trace_file);
+
+  return success;
+}
+
+/*  records a span which began at @span and ends now.  called through
+ *  GIMP_TRACE_END(), which skips spans that began while tracing was off.
+ */
+void
+gimp_trace_end (GimpTraceSpan  span,
+                const gchar   *category,
+                const gchar   *name,
+                const gchar   *format,
+                ...)
+{
+  GimpTraceBuffer *buffer;
+  GimpTraceEvent  *event;
+  gint64           now = g_get_monotonic_time ();
+
+  /*  tracing was stopped after the span began  */
+  if (! gimp_trace_enabled || span < trace_start_time)
+    return;
+
+  buffer = gimp_trace_get_buffer ();
+
+  g_mutex_lock (&buffer->mutex);
+
+  event = &buffer->events[buffer->n_events++ % N_EVENTS];
+
+  event->start    = span - trace_start_time;
+  event->duration = now  - span;
+  event->category = category;
+
+  gimp_trace_copy_string (event->name, name ? name : "", NAME_SIZE);
+
+  if (format)
+    {
+      va_list args;
+
+      va_start (args, format);
+      g_vsnprintf (event->args, ARGS_SIZE, format, args);
+      va_end (args);
+
+      gimp_trace_copy_string (event->args, event->args, ARGS_SIZE);
+    }
+  else
+    {
+      event->args[0] = '\0';
+    }
+
+  g_mutex_unlock (&buffer->mutex);
+}
+
+
+/*  private functions  */
+
+static GimpTraceBuffer *
+gimp_trace_get_buffer (void)
+{
+  GimpTraceBuffer *buffer = g_private_get (&trace_buffer);
+
+  if (! buffer)
+    {
+      buffer = g_new0 (GimpTraceBuffer, 1);
+
+      g_mutex_init (&buffer->mutex);
+
+      buffer->is_main = g_thread_self () == trace_main_thread;
+
+      g_mutex_lock (&trace_mutex);
+
+      buffer->tid = trace_buffers->len + 1;
+      g_ptr_array_add (trace_buffers, buffer);
+
+      g_mutex_unlock (&trace_mutex);
+
+      g_private_set (&trace_buffer, buffer);
+    }
+
+  return buffer;
+}
+
+/*  copies as much of @src as fits, without leaving a partial UTF-8
+ *  sequence at the end.  @dest and @src may be the same.
+ */
+static void
+gimp_trace_copy_string (gchar       *dest,
+                        const gchar *src,
+                        gsize        size)
+{
+  const gchar *end;
+
+  if (dest != src)
+    g_strlcpy (dest, src, size);
+
+  if (! g_utf8_validate (dest, -1, &end))
+    dest[end - dest] = '\0';
+}
+
+static gboolean
+gimp_trace_print_escaped (GOutputStream  *output,
+                          const gchar    *string,
+                          GError        **error)
+{
+  GString     *str = g_string_sized_new (strlen (string) + 8);
+  const gchar *s;
+  gboolean     success;
+
+  for (s = string; *s; s++)
+    {
+      switch (*s)
+        {
+        case '"':  g_string_append (str, "\\\""); break;
+        case '\\': g_string_append (str, "\\\\"); break;
+        case '\n': g_string_append (str, "\\n");  break;
+        case '\t': g_string_append (str, "\\t");  break;
+
+        default:
+          if ((guchar) *s < 0x20)
+            g_string_append_printf (str, "\\u%04x", (guchar) *s);
+          else
+            g_string_append_c (str, *s);
+          break;
+        }
+    }
+
+  success = g_output_stream_write_all (output, str->str, str->len,
+                                       NULL, NULL, error);
+
+  g_string_free (str, TRUE);
+
+  return success;
+}
+
+/*  writes the spans of all threads in the Chrome trace-event format,
+ *  as complete ("X") events, with a metadata event naming each thread.
+ *  called with trace_mutex held.
+ */
+static gboolean
+gimp_trace_write (GOutputStream  *output,
+                  GError        **error)
+{
+  guint i;
+
+  if (! g_output_stream_printf (
+        output, NULL, NULL, error,
+        "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+        "\"args\":{\"name\":\"gimp\"}}"))
+    {
+      return FALSE;
+    }
+
+  for (i = 0; i < trace_buffers->len; i++)
+    {
+      GimpTraceBuffer *buffer  = trace_buffers->pdata[i];
+      gboolean         success = TRUE;
+      guint64          first;
+      guint64          n;
+
+      g_mutex_lock (&buffer->mutex);
+
+      if (buffer->is_main)
+        {
+          success = g_output_stream_printf (
+            output, NULL, NULL, error,
+            ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"main\"}}",
+            buffer->tid);
+        }
+      else
+        {
+          success = g_output_stream_printf (
+            output, NULL, NULL, error,
+            ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"thread %d\"}}",
+            buffer->tid, buffer->tid);
+        }
+
+      first = buffer->n_events > N_EVENTS ? buffer->n_events - N_EVENTS : 0;
+
+      for (n = first; success && n < buffer->n_events; n++)
+        {
+          const GimpTraceEvent *event = &buffer->events[n % N_EVENTS];
+
+          success =
+            g_output_stream_printf (output, NULL, NULL, error,
+                                    ",\n{\"name\":\"") &&
+            gimp_trace_print_escaped (output, event->name, error) &&
+            g_output_stream_printf (
+              output, NULL, NULL, error,
+              "\",\"cat\":\"%s\",\"ph\":\"X\","
+              "\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT ","
+              "\"pid\":1,\"tid\":%d,\"args\":{\"detail\":\"",
+              event->category,
+              event->start,
+              event->duration,
+              buffer->tid) &&
+            gimp_trace_print_escaped (output, event->args, error) &&
+            g_output_stream_printf (output, NULL, NULL, error,
+                                    "\"}}");
+        }
+
+      g_mutex_unlock (&buffer->mutex);
+
+      if (! success)
+        return FALSE;
+    }
+
+  return g_output_stream_printf (output, NULL, NULL, error,
+                                 "\n]}\n");
+}
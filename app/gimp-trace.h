@@ -0,0 +1,62 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_TRACE_H__
+#define __GIMP_TRACE_H__
+
+
+/*  a span is the time it began at, or 0 if tracing was off at the time  */
+typedef gint64 GimpTraceSpan;
+
+
+extern gboolean gimp_trace_enabled;
+
+
+gboolean   gimp_trace_start (GFile          *file,
+                             GError        **error);
+gboolean   gimp_trace_stop  (GError        **error);
+
+void       gimp_trace_end   (GimpTraceSpan   span,
+                             const gchar    *category,
+                             const gchar    *name,
+                             const gchar    *format,
+                             ...) G_GNUC_PRINTF (4, 5);
+
+
+/*  GIMP_TRACE_BEGIN() returns a span, which is passed to GIMP_TRACE_END()
+ *  together with the span's category, name, and an optional printf-style
+ *  description of its arguments.  both are no-ops while tracing is off,
+ *  short of reading a global.
+ *
+ *    GimpTraceSpan span = GIMP_TRACE_BEGIN ();
+ *
+ *    ...
+ *
+ *    GIMP_TRACE_END (span, "xcf", "load", "%s", filename);
+ */
+
+#define GIMP_TRACE_BEGIN() \
+        (gimp_trace_enabled ? g_get_monotonic_time () : 0)
+
+#define GIMP_TRACE_END(span, category, ...) \
+        G_STMT_START { \
+        if (span) \
+          gimp_trace_end ((span), (category), __VA_ARGS__); \
+        } G_STMT_END
+
+
+#endif /* __GIMP_TRACE_H__ */
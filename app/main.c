@@ -67,6 +67,7 @@
 
 #include "about.h"
 #include "app.h"
+#include "gimp-batch-farm.h"
 #include "sanity.h"
 #include "signals.h"
 #include "unique.h"
@@ -113,6 +114,8 @@ static gboolean  gimp_option_dump_pdb_procedures_deprecated
 static void      gimp_show_version_and_exit   (void) G_GNUC_NORETURN;
 static void      gimp_show_license_and_exit   (void) G_GNUC_NORETURN;
 
+static gchar  ** gimp_batch_farm_worker_argv  (const gchar  *prog);
+
 static void      gimp_init_i18n               (void);
 static void      gimp_init_malloc             (void);
 
@@ -127,6 +130,12 @@ static const gchar        *user_gimprc       = NULL;
 static const gchar        *session_name      = NULL;
 static const gchar        *batch_interpreter = NULL;
 static const gchar       **batch_commands    = NULL;
+static const gchar        *batch_jobs        = NULL;
+static gint                batch_workers     = 0;
+static gint                batch_timeout     = 0;
+static gboolean            batch_farm_worker = FALSE;
+static const gchar        *performance_log   = NULL;
+static const gchar        *trace_log         = NULL;
 static const gchar       **filenames         = NULL;
 static gboolean            as_new            = FALSE;
 static gboolean            no_interface      = FALSE;
@@ -238,6 +247,28 @@ static const GOptionEntry main_entries[] =
     G_OPTION_ARG_STRING, &batch_interpreter,
     N_("The procedure to process batch commands with"), "<proc>"
   },
+  {
+    "batch-workers", 0, 0,
+    G_OPTION_ARG_INT, &batch_workers,
+    N_("Run the batch commands on a farm of worker processes"), "<num>"
+  },
+  {
+    "batch-jobs", 0, 0,
+    G_OPTION_ARG_FILENAME, &batch_jobs,
+    N_("Read more batch commands for the worker farm from a file, "
+       "one per line"), "<filename>"
+  },
+  {
+    "batch-timeout", 0, 0,
+    G_OPTION_ARG_INT, &batch_timeout,
+    N_("Abort batch commands on the worker farm after this many seconds"),
+    "<seconds>"
+  },
+  {
+    "batch-farm-worker", 0, G_OPTION_FLAG_HIDDEN,
+    G_OPTION_ARG_NONE, &batch_farm_worker,
+    NULL, NULL
+  },
   {
     "console-messages", 'c', 0,
     G_OPTION_ARG_NONE, &console_messages,
@@ -260,6 +291,17 @@ static const GOptionEntry main_entries[] =
     G_OPTION_ARG_NONE, &use_debug_handler,
     N_("Enable non-fatal debugging signal handlers"), NULL
   },
+  {
+    "performance-log", 0, 0,
+    G_OPTION_ARG_FILENAME, &performance_log,
+    N_("Record a performance log to this file"), "<filename>"
+  },
+  {
+    "trace-log", 0, 0,
+    G_OPTION_ARG_FILENAME, &trace_log,
+    N_("Record trace spans to this file, in Chrome's JSON format"),
+    "<filename>"
+  },
   {
     "g-fatal-warnings", 0, G_OPTION_FLAG_NO_ARG,
     G_OPTION_ARG_CALLBACK, gimp_option_fatal_warnings,
@@ -394,6 +436,8 @@ main (int    argc,
   gchar          *basename;
   GFile          *system_gimprc_file = NULL;
   GFile          *user_gimprc_file   = NULL;
+  GFile          *performance_file   = NULL;
+  GFile          *trace_file         = NULL;
   gchar          *backtrace_file     = NULL;
   gint            i;
 
@@ -604,6 +648,23 @@ main (int    argc,
   if (no_interface || be_verbose || console_messages || batch_commands != NULL)
     gimp_open_console_window ();
 
+  if (batch_workers > 0)
+    {
+      /*  the farm runs the commands in other GIMP processes, so don't
+       *  bother initializing one here
+       */
+      gchar **worker_argv = gimp_batch_farm_worker_argv (argv[0]);
+      gint    status;
+
+      status = gimp_batch_farm_run ((const gchar **) worker_argv,
+                                    batch_commands, batch_jobs,
+                                    batch_workers, batch_timeout);
+
+      g_strfreev (worker_argv);
+
+      app_exit (status);
+    }
+
   if (no_interface)
     new_instance = TRUE;
 
@@ -633,6 +694,21 @@ main (int    argc,
   if (user_gimprc)
     user_gimprc_file = g_file_new_for_commandline_arg (user_gimprc);
 
+  /*  farm workers inherit the environment, don't let them all write
+   *  to the same log
+   */
+  if (! performance_log && ! batch_farm_worker)
+    performance_log = g_getenv ("GIMP_PERFORMANCE_LOG");
+
+  if (! trace_log && ! batch_farm_worker)
+    trace_log = g_getenv ("GIMP_TRACE_LOG");
+
+  if (performance_log && *performance_log)
+    performance_file = g_file_new_for_commandline_arg (performance_log);
+
+  if (trace_log && *trace_log)
+    trace_file = g_file_new_for_commandline_arg (trace_log);
+
   app_run (argv[0],
            filenames,
            system_gimprc_file,
@@ -640,6 +716,7 @@ main (int    argc,
            session_name,
            batch_interpreter,
            batch_commands,
+           batch_farm_worker,
            as_new,
            no_interface,
            no_data,
@@ -654,7 +731,9 @@ main (int    argc,
            show_debug_menu,
            stack_trace_mode,
            pdb_compat_mode,
-           backtrace_file);
+           backtrace_file,
+           performance_file,
+           trace_file);
 
   if (backtrace_file)
     g_free (backtrace_file);
@@ -665,6 +744,12 @@ main (int    argc,
   if (user_gimprc_file)
     g_object_unref (user_gimprc_file);
 
+  if (performance_file)
+    g_object_unref (performance_file);
+
+  if (trace_file)
+    g_object_unref (trace_file);
+
   g_strfreev (argv);
 
   g_option_context_free (context);
@@ -882,6 +967,59 @@ gimp_show_license_and_exit (void)
   app_exit (EXIT_SUCCESS);
 }
 
+/*  the command line for the batch farm's workers, passing on the
+ *  options that matter to a batch instance
+ */
+static gchar **
+gimp_batch_farm_worker_argv (const gchar *prog)
+{
+  GPtrArray *argv = g_ptr_array_new ();
+
+  g_ptr_array_add (argv, g_strdup (prog));
+  g_ptr_array_add (argv, g_strdup ("--no-interface"));
+  g_ptr_array_add (argv, g_strdup ("--batch-farm-worker"));
+
+  if (batch_interpreter)
+    {
+      g_ptr_array_add (argv, g_strdup ("--batch-interpreter"));
+      g_ptr_array_add (argv, g_strdup (batch_interpreter));
+    }
+
+  if (system_gimprc)
+    {
+      g_ptr_array_add (argv, g_strdup ("--system-gimprc"));
+      g_ptr_array_add (argv, g_strdup (system_gimprc));
+    }
+
+  if (user_gimprc)
+    {
+      g_ptr_array_add (argv, g_strdup ("--gimprc"));
+      g_ptr_array_add (argv, g_strdup (user_gimprc));
+    }
+
+  if (no_data)
+    g_ptr_array_add (argv, g_strdup ("--no-data"));
+
+  if (no_fonts)
+    g_ptr_array_add (argv, g_strdup ("--no-fonts"));
+
+  if (! use_shm)
+    g_ptr_array_add (argv, g_strdup ("--no-shm"));
+
+  if (! use_cpu_accel)
+    g_ptr_array_add (argv, g_strdup ("--no-cpu-accel"));
+
+  if (be_verbose)
+    g_ptr_array_add (argv, g_strdup ("--verbose"));
+
+  if (console_messages)
+    g_ptr_array_add (argv, g_strdup ("--console-messages"));
+
+  g_ptr_array_add (argv, NULL);
+
+  return (gchar **) g_ptr_array_free (argv, FALSE);
+}
+
 static void
 gimp_init_malloc (void)
 {
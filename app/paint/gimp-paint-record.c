@@ -0,0 +1,356 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995-2001 Spencer Kimball, Peter Mattis and others
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*  Records the input of paint strokes to a file, so that they can be
+ *  replayed without a display, see app/tests/benchmark-paint.c.
+ *
+ *  The file is line-based text: a "stroke" line naming the paint
+ *  method, followed by one line per event, holding the time in
+ *  milliseconds since the start of the stroke and all GimpCoords
+ *  fields, in order:
+ *
+ *    # GIMP paint record 1
+ *    stroke gimp-paintbrush
+ *    0 120.5 88 0.41 0 0 0.5 0 0 0.5 0 0 1 1 0 0
+ *    ...
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "paint-types.h"
+
+#include "gimp-paint-record.h"
+
+#include "gimp-intl.h"
+
+
+#define RECORD_HEADER   "# GIMP paint record 1\n"
+#define N_EVENT_FIELDS  16 /*  the time, 14 doubles and "reflect"  */
+
+
+/*  the events are written and parsed by treating the coords as an
+ *  array of doubles, up to "reflect"
+ */
+G_STATIC_ASSERT (G_STRUCT_OFFSET (GimpCoords, reflect) ==
+                 (N_EVENT_FIELDS - 2) * sizeof (gdouble));
+
+
+/*  local function prototypes  */
+
+static gboolean   gimp_paint_record_parse_event (gchar                 *line,
+                                                 GimpPaintRecordEvent  *event);
+
+
+/*  local variables  */
+
+static GOutputStream *record_output = NULL;
+static GFile         *record_file   = NULL;
+static gchar         *record_paint_info;
+static GArray        *record_events;
+static guint32        record_start_time;
+
+
+/*  public functions  */
+
+/**
+ * gimp_paint_record_start:
+ * @file:  the file to record to
+ * @error: return location for an error
+ *
+ * Starts recording the input of paint strokes made with the paint
+ * tools to @file.  Each stroke is written when it ends, so that
+ * recording doesn't add I/O to the painting itself.
+ *
+ * Returns: %TRUE if recording has started.
+ **/
+gboolean
+gimp_paint_record_start (GFile   *file,
+                         GError **error)
+{
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  g_return_val_if_fail (record_output == NULL, FALSE);
+
+  record_output = G_OUTPUT_STREAM (g_file_replace (file,
+                                                   NULL, FALSE,
+                                                   G_FILE_CREATE_NONE,
+                                                   NULL, error));
+
+  if (! record_output)
+    return FALSE;
+
+  if (! g_output_stream_write_all (record_output,
+                                   RECORD_HEADER, strlen (RECORD_HEADER),
+                                   NULL, NULL, error))
+    {
+      g_clear_object (&record_output);
+
+      return FALSE;
+    }
+
+  record_file = g_object_ref (file);
+
+  return TRUE;
+}
+
+/**
+ * gimp_paint_record_stop:
+ * @error: return location for an error
+ *
+ * Stops recording, dropping a stroke which is still in progress.
+ * Does nothing if no recording is in progress.
+ *
+ * Returns: %TRUE if the recording was written successfully.
+ **/
+gboolean
+gimp_paint_record_stop (GError **error)
+{
+  gboolean success;
+
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (! record_output)
+    return TRUE;
+
+  gimp_paint_record_stroke_end (TRUE);
+
+  success = g_output_stream_close (record_output, NULL, error);
+
+  g_clear_object (&record_output);
+  g_clear_object (&record_file);
+
+  return success;
+}
+
+gboolean
+gimp_paint_record_is_recording (void)
+{
+  return record_output != NULL;
+}
+
+void
+gimp_paint_record_stroke_start (const gchar      *paint_info,
+                                const GimpCoords *coords,
+                                guint32           time)
+{
+  g_return_if_fail (paint_info != NULL);
+  g_return_if_fail (coords != NULL);
+
+  if (! record_output)
+    return;
+
+  gimp_paint_record_stroke_end (TRUE);
+
+  record_paint_info = g_strdup (paint_info);
+  record_events     = g_array_new (FALSE, FALSE,
+                                   sizeof (GimpPaintRecordEvent));
+  record_start_time = time;
+
+  gimp_paint_record_stroke_motion (coords, time);
+}
+
+void
+gimp_paint_record_stroke_motion (const GimpCoords *coords,
+                                 guint32           time)
+{
+  GimpPaintRecordEvent event;
+
+  g_return_if_fail (coords != NULL);
+
+  if (! record_events)
+    return;
+
+  event.time   = time - record_start_time;
+  event.coords = *coords;
+
+  g_array_append_val (record_events, event);
+}
+
+/*  writes the current stroke, unless @cancel is %TRUE  */
+void
+gimp_paint_record_stroke_end (gboolean cancel)
+{
+  if (! record_events)
+    return;
+
+  if (! cancel && record_output)
+    {
+      GString *str = g_string_new (NULL);
+      GError  *error = NULL;
+      guint    i;
+
+      g_string_append_printf (str, "stroke %s\n", record_paint_info);
+
+      for (i = 0; i < record_events->len; i++)
+        {
+          const GimpPaintRecordEvent *event;
+          const gdouble              *values;
+          gchar                       buf[G_ASCII_DTOSTR_BUF_SIZE];
+          gint                        j;
+
+          event  = &g_array_index (record_events, GimpPaintRecordEvent, i);
+          values = &event->coords.x;
+
+          g_string_append_printf (str, "%u", event->time);
+
+          for (j = 0; j < N_EVENT_FIELDS - 2; j++)
+            {
+              g_string_append_c (str, ' ');
+              g_string_append (str, g_ascii_dtostr (buf, sizeof (buf),
+                                                    values[j]));
+            }
+
+          g_string_append_printf (str, " %d\n", event->coords.reflect ? 1 : 0);
+        }
+
+      if (! g_output_stream_write_all (record_output, str->str, str->len,
+                                       NULL, NULL, &error))
+        {
+          g_printerr ("Stopped recording paint strokes to '%s': %s\n",
+                      gimp_file_get_utf8_name (record_file),
+                      error->message);
+          g_clear_error (&error);
+
+          g_clear_object (&record_output);
+          g_clear_object (&record_file);
+        }
+
+      g_string_free (str, TRUE);
+    }
+
+  g_clear_pointer (&record_paint_info, g_free);
+  g_clear_pointer (&record_events, g_array_unref);
+}
+
+/**
+ * gimp_paint_record_load:
+ * @file:  a file written by a recording
+ * @error: return location for an error
+ *
+ * Returns: the list of #GimpPaintRecordStroke in @file, to be freed
+ *          with gimp_paint_record_stroke_free(), or %NULL on error.
+ **/
+GList *
+gimp_paint_record_load (GFile   *file,
+                        GError **error)
+{
+  GimpPaintRecordStroke  *stroke  = NULL;
+  GList                  *strokes = NULL;
+  gchar                  *contents;
+  gchar                 **lines;
+  gint                    i;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (! g_file_load_contents (file, NULL, &contents, NULL, NULL, error))
+    return NULL;
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (i = 0; lines[i]; i++)
+    {
+      gchar *line = g_strstrip (lines[i]);
+
+      if (! *line || *line == '#')
+        continue;
+
+      if (g_str_has_prefix (line, "stroke "))
+        {
+          stroke = g_slice_new (GimpPaintRecordStroke);
+
+          stroke->paint_info = g_strdup (g_strstrip (line + strlen ("stroke")));
+          stroke->events     = g_array_new (FALSE, FALSE,
+                                            sizeof (GimpPaintRecordEvent));
+
+          strokes = g_list_prepend (strokes, stroke);
+        }
+      else
+        {
+          GimpPaintRecordEvent event;
+
+          if (! stroke || ! gimp_paint_record_parse_event (line, &event))
+            {
+              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                           _("Error while parsing '%s' in line %d"),
+                           gimp_file_get_utf8_name (file), i + 1);
+
+              g_list_free_full (strokes,
+                                (GDestroyNotify) gimp_paint_record_stroke_free);
+              g_strfreev (lines);
+
+              return NULL;
+            }
+
+          g_array_append_val (stroke->events, event);
+        }
+    }
+
+  g_strfreev (lines);
+
+  return g_list_reverse (strokes);
+}
+
+void
+gimp_paint_record_stroke_free (GimpPaintRecordStroke *stroke)
+{
+  g_return_if_fail (stroke != NULL);
+
+  g_free (stroke->paint_info);
+  g_array_unref (stroke->events);
+
+  g_slice_free (GimpPaintRecordStroke, stroke);
+}
+
+
+/*  private functions  */
+
+static gboolean
+gimp_paint_record_parse_event (gchar                *line,
+                               GimpPaintRecordEvent *event)
+{
+  gdouble *values = &event->coords.x;
+  gchar   *end;
+  gint     i;
+
+  event->time = strtoul (line, &end, 10);
+
+  if (end == line)
+    return FALSE;
+
+  for (i = 0; i < N_EVENT_FIELDS - 2; i++)
+    {
+      line      = end;
+      values[i] = g_ascii_strtod (line, &end);
+
+      if (end == line)
+        return FALSE;
+    }
+
+  line                  = end;
+  event->coords.reflect = strtol (line, &end, 10) != 0;
+
+  return end != line;
+}
@@ -0,0 +1,57 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995-2001 Spencer Kimball, Peter Mattis and others
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_PAINT_RECORD_H__
+#define __GIMP_PAINT_RECORD_H__
+
+
+typedef struct _GimpPaintRecordEvent  GimpPaintRecordEvent;
+typedef struct _GimpPaintRecordStroke GimpPaintRecordStroke;
+
+struct _GimpPaintRecordEvent
+{
+  guint32     time;       /*  milliseconds since the start of the stroke  */
+  GimpCoords  coords;     /*  in drawable coordinates, after smoothing    */
+};
+
+struct _GimpPaintRecordStroke
+{
+  gchar      *paint_info; /*  identifier of the recorded paint method     */
+  GArray     *events;     /*  of GimpPaintRecordEvent; the first event is
+                           *  where the stroke started
+                           */
+};
+
+
+gboolean   gimp_paint_record_start         (GFile                  *file,
+                                            GError                **error);
+gboolean   gimp_paint_record_stop          (GError                **error);
+gboolean   gimp_paint_record_is_recording  (void);
+
+void       gimp_paint_record_stroke_start  (const gchar            *paint_info,
+                                            const GimpCoords       *coords,
+                                            guint32                 time);
+void       gimp_paint_record_stroke_motion (const GimpCoords       *coords,
+                                            guint32                 time);
+void       gimp_paint_record_stroke_end    (gboolean                cancel);
+
+GList    * gimp_paint_record_load          (GFile                  *file,
+                                            GError                **error);
+void       gimp_paint_record_stroke_free   (GimpPaintRecordStroke  *stroke);
+
+
+#endif  /* __GIMP_PAINT_RECORD_H__ */
@@ -27,6 +27,7 @@
 #include "core/gimppaintinfo.h"
 
 #include "gimp-paint.h"
+#include "gimp-paint-record.h"
 #include "gimpairbrush.h"
 #include "gimpclone.h"
 #include "gimpconvolve.h"
@@ -41,6 +42,8 @@
 #include "gimpperspectiveclone.h"
 #include "gimpsmudge.h"
 
+#include "gimp-intl.h"
+
 
 /*  local function prototypes  */
 
@@ -52,6 +55,11 @@ static void   gimp_paint_register (Gimp        *gimp,
                                    const gchar *icon_name);
 
 
+/*  local variables  */
+
+static gint gimp_paint_latency = 0;
+
+
 /*  public functions  */
 
 void
@@ -89,13 +97,37 @@ gimp_paint_init (Gimp *gimp)
     }
 
   gimp_container_thaw (gimp->paint_info_list);
+
+  if (g_getenv ("GIMP_PAINT_RECORD") && ! gimp->no_interface)
+    {
+      GFile  *file  = g_file_new_for_path (g_getenv ("GIMP_PAINT_RECORD"));
+      GError *error = NULL;
+
+      if (! gimp_paint_record_start (file, &error))
+        {
+          g_printerr (_("Failed to record paint strokes: %s\n"),
+                      error->message);
+          g_clear_error (&error);
+        }
+
+      g_object_unref (file);
+    }
 }
 
 void
 gimp_paint_exit (Gimp *gimp)
 {
+  GError *error = NULL;
+
   g_return_if_fail (GIMP_IS_GIMP (gimp));
 
+  if (! gimp_paint_record_stop (&error))
+    {
+      g_printerr (_("Failed to record paint strokes: %s\n"),
+                  error->message);
+      g_clear_error (&error);
+    }
+
   gimp_paint_info_set_standard (gimp, NULL);
 
   if (gimp->paint_info_list)
@@ -106,6 +138,32 @@ gimp_paint_exit (Gimp *gimp)
     }
 }
 
+/**
+ * gimp_paint_set_latency:
+ * @latency: the time, in microseconds, between an input event and the
+ *           display update showing the pixels it painted
+ *
+ * Records the current painting latency, for the dashboard.  May be
+ * called from any thread.
+ **/
+void
+gimp_paint_set_latency (gint64 latency)
+{
+  g_atomic_int_set (&gimp_paint_latency,
+                    CLAMP ((latency + 500) / 1000, 0, G_MAXINT));
+}
+
+/**
+ * gimp_paint_get_latency:
+ *
+ * Returns: the most recent painting latency, in milliseconds.
+ **/
+gint
+gimp_paint_get_latency (void)
+{
+  return g_atomic_int_get (&gimp_paint_latency);
+}
+
 
 /*  private functions  */
 
@@ -22,5 +22,8 @@
 void   gimp_paint_init (Gimp *gimp);
 void   gimp_paint_exit (Gimp *gimp);
 
+void   gimp_paint_set_latency (gint64 latency);
+gint   gimp_paint_get_latency (void);
+
 
 #endif  /* __GIMP_PAINT_H__ */
@@ -270,6 +270,11 @@ _gimp_paintbrush_motion (GimpPaintCore    *paint_core,
                                                fade_point);
 
   n_strokes = gimp_symmetry_get_size (sym);
+
+  /*  apply the dabs of all the symmetry strokes concurrently  */
+  if (n_strokes > 1 && ! paint_core->applicator)
+    gimp_paint_core_begin_paste_batch (paint_core);
+
   for (i = 0; i < n_strokes; i++)
     {
       GimpLayerMode             paint_mode;
@@ -393,4 +398,7 @@ _gimp_paintbrush_motion (GimpPaintCore    *paint_core,
                                     force,
                                     paint_appl_mode);
     }
+
+  if (paint_core->paste_batch)
+    gimp_paint_core_end_paste_batch (paint_core, drawable);
 }
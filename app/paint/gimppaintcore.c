@@ -58,6 +58,15 @@
 #include "gimp-intl.h"
 
 
+typedef struct
+{
+  GimpPaintCoreLoopsParams    params;
+  GimpPaintCoreLoopsAlgorithm algorithms;
+  GeglRectangle               rect;
+  gint                        wave;
+} GimpPaintCoreDab;
+
+
 #define STROKE_BUFFER_INIT_SIZE 2000
 
 enum
@@ -118,6 +127,10 @@ static GimpUndo* gimp_paint_core_real_push_undo      (GimpPaintCore    *core,
                                                       GimpImage        *image,
                                                       const gchar      *undo_desc);
 
+static void      gimp_paint_core_paste_batch_func    (gsize             offset,
+                                                      gsize             size,
+                                                      GimpPaintCoreDab **dabs);
+
 
 G_DEFINE_TYPE (GimpPaintCore, gimp_paint_core, GIMP_TYPE_OBJECT)
 
@@ -171,6 +184,8 @@ gimp_paint_core_finalize (GObject *object)
       core->stroke_buffer = NULL;
     }
 
+  g_warn_if_fail (core->paste_batch == NULL);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -292,6 +307,17 @@ gimp_paint_core_real_push_undo (GimpPaintCore *core,
                                NULL);
 }
 
+static void
+gimp_paint_core_paste_batch_func (gsize              offset,
+                                  gsize              size,
+                                  GimpPaintCoreDab **dabs)
+{
+  gsize i;
+
+  for (i = offset; i < offset + size; i++)
+    gimp_paint_core_loops_process (&dabs[i]->params, dabs[i]->algorithms);
+}
+
 
 /*  public functions  */
 
@@ -318,6 +344,7 @@ gimp_paint_core_paint (GimpPaintCore    *core,
       GimpSymmetry *sym;
       GimpImage    *image;
       GimpItem     *item;
+      gint64        start_time = 0;
 
       item  = GIMP_ITEM (drawable);
       image = gimp_item_get_image (item);
@@ -332,10 +359,20 @@ gimp_paint_core_paint (GimpPaintCore    *core,
       sym = g_object_ref (gimp_image_get_active_symmetry (image));
       gimp_symmetry_set_origin (sym, drawable, &core->cur_coords);
 
+      if (core->dab_times && paint_state == GIMP_PAINT_STATE_MOTION)
+        start_time = g_get_monotonic_time ();
+
       core_class->paint (core, drawable,
                          paint_options,
                          sym, paint_state, time);
 
+      if (start_time)
+        {
+          gint64 duration = g_get_monotonic_time () - start_time;
+
+          g_array_append_val (core->dab_times, duration);
+        }
+
       gimp_symmetry_clear_origin (sym);
       g_object_unref (sym);
 
@@ -964,7 +1001,35 @@ gimp_paint_core_paste (GimpPaintCore            *core,
           algorithms |= GIMP_PAINT_CORE_LOOPS_ALGORITHM_MASK_COMPONENTS;
         }
 
-      gimp_paint_core_loops_process (&params, algorithms);
+      if (core->paste_batch)
+        {
+          GimpPaintCoreDab dab;
+
+          /*  the paint buffer is reused by the next dab, and the paint
+           *  mask may be evicted from the brush core's cache, so hold on
+           *  to our own copies until the batch is processed.
+           */
+          dab.params           = params;
+          dab.params.paint_buf = gimp_temp_buf_copy (params.paint_buf);
+
+          if (params.paint_mask)
+            {
+              dab.params.paint_mask =
+                gimp_temp_buf_ref ((GimpTempBuf *) params.paint_mask);
+            }
+
+          dab.algorithms = algorithms;
+          dab.rect       = *GEGL_RECTANGLE (core->paint_buffer_x,
+                                            core->paint_buffer_y,
+                                            width, height);
+          dab.wave       = 0;
+
+          g_array_append_val (core->paste_batch, dab);
+        }
+      else
+        {
+          gimp_paint_core_loops_process (&params, algorithms);
+        }
     }
 
   /*  Update the undo extents  */
@@ -973,11 +1038,14 @@ gimp_paint_core_paste (GimpPaintCore            *core,
   core->x2 = MAX (core->x2, core->paint_buffer_x + width);
   core->y2 = MAX (core->y2, core->paint_buffer_y + height);
 
-  /*  Update the drawable  */
-  gimp_drawable_update (drawable,
-                        core->paint_buffer_x,
-                        core->paint_buffer_y,
-                        width, height);
+  /*  Update the drawable, unless the dab was deferred  */
+  if (! core->paste_batch || core->applicator)
+    {
+      gimp_drawable_update (drawable,
+                            core->paint_buffer_x,
+                            core->paint_buffer_y,
+                            width, height);
+    }
 }
 
 /* This works similarly to gimp_paint_core_paste. However, instead of
@@ -1179,6 +1247,98 @@ gimp_paint_core_replace (GimpPaintCore            *core,
  * Smooth and store coords in the stroke buffer
  */
 
+/*  Defers the dabs pasted by gimp_paint_core_paste() until
+ *  gimp_paint_core_end_paste_batch(), which applies them concurrently.
+ *  Dabs whose areas overlap are applied in the order they were pasted;
+ *  this is used to paint all the strokes of a symmetry at once.
+ */
+void
+gimp_paint_core_begin_paste_batch (GimpPaintCore *core)
+{
+  g_return_if_fail (GIMP_IS_PAINT_CORE (core));
+  g_return_if_fail (core->paste_batch == NULL);
+
+  core->paste_batch = g_array_new (FALSE, FALSE, sizeof (GimpPaintCoreDab));
+}
+
+void
+gimp_paint_core_end_paste_batch (GimpPaintCore *core,
+                                 GimpDrawable  *drawable)
+{
+  GArray            *batch;
+  GimpPaintCoreDab **wave_dabs;
+  gint               n_waves = 0;
+  gint               wave;
+  gint               i, j;
+
+  g_return_if_fail (GIMP_IS_PAINT_CORE (core));
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+  g_return_if_fail (core->paste_batch != NULL);
+
+  batch             = core->paste_batch;
+  core->paste_batch = NULL;
+
+  /*  assign each dab to the wave following the last wave containing an
+   *  earlier dab it overlaps, so that overlapping dabs are composited in
+   *  order, while the dabs of each wave can be applied concurrently.
+   */
+  for (i = 0; i < batch->len; i++)
+    {
+      GimpPaintCoreDab *dab = &g_array_index (batch, GimpPaintCoreDab, i);
+
+      for (j = 0; j < i; j++)
+        {
+          GimpPaintCoreDab *prev = &g_array_index (batch, GimpPaintCoreDab, j);
+
+          if (prev->wave >= dab->wave &&
+              gegl_rectangle_intersect (NULL, &dab->rect, &prev->rect))
+            {
+              dab->wave = prev->wave + 1;
+            }
+        }
+
+      n_waves = MAX (n_waves, dab->wave + 1);
+    }
+
+  wave_dabs = g_new (GimpPaintCoreDab *, batch->len);
+
+  for (wave = 0; wave < n_waves; wave++)
+    {
+      gint n_dabs = 0;
+
+      for (i = 0; i < batch->len; i++)
+        {
+          GimpPaintCoreDab *dab = &g_array_index (batch, GimpPaintCoreDab, i);
+
+          if (dab->wave == wave)
+            wave_dabs[n_dabs++] = dab;
+        }
+
+      gegl_parallel_distribute_range (
+        n_dabs, 1,
+        (GeglParallelDistributeRangeFunc) gimp_paint_core_paste_batch_func,
+        wave_dabs);
+    }
+
+  g_free (wave_dabs);
+
+  for (i = 0; i < batch->len; i++)
+    {
+      GimpPaintCoreDab *dab = &g_array_index (batch, GimpPaintCoreDab, i);
+
+      gimp_drawable_update (drawable,
+                            dab->rect.x,     dab->rect.y,
+                            dab->rect.width, dab->rect.height);
+
+      gimp_temp_buf_unref (dab->params.paint_buf);
+
+      if (dab->params.paint_mask)
+        gimp_temp_buf_unref ((GimpTempBuf *) dab->params.paint_mask);
+    }
+
+  g_array_free (batch, TRUE);
+}
+
 void
 gimp_paint_core_smooth_coords (GimpPaintCore    *core,
                                GimpPaintOptions *paint_options,
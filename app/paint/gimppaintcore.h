@@ -73,6 +73,11 @@ struct _GimpPaintCore
   GimpApplicator *applicator;
 
   GArray         *stroke_buffer;
+
+  GArray         *paste_batch;       /*  deferred dabs                       */
+
+  GArray         *dab_times;         /*  if set, receives the duration of    */
+                                     /*  each dab, in microseconds           */
 };
 
 struct _GimpPaintCoreClass
@@ -208,6 +213,10 @@ void      gimp_paint_core_replace           (GimpPaintCore            *core,
                                              gdouble                   image_opacity,
                                              GimpPaintApplicationMode  mode);
 
+void      gimp_paint_core_begin_paste_batch (GimpPaintCore            *core);
+void      gimp_paint_core_end_paste_batch   (GimpPaintCore            *core,
+                                             GimpDrawable             *drawable);
+
 void      gimp_paint_core_smooth_coords             (GimpPaintCore    *core,
                                                      GimpPaintOptions *paint_options,
                                                      GimpCoords       *coords);
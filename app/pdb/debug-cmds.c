@@ -28,6 +28,7 @@
 #include "pdb-types.h"
 
 #include "core/gimpparamspecs.h"
+#include "core/gimpperformancelog.h"
 
 #include "gimppdb.h"
 #include "gimpprocedure.h"
@@ -87,6 +88,28 @@ debug_timer_end_invoker (GimpProcedure         *procedure,
   return return_vals;
 }
 
+static GimpValueArray *
+debug_performance_log_add_marker_invoker (GimpProcedure         *procedure,
+                                          Gimp                  *gimp,
+                                          GimpContext           *context,
+                                          GimpProgress          *progress,
+                                          const GimpValueArray  *args,
+                                          GError               **error)
+{
+  gboolean success = TRUE;
+  const gchar *description;
+
+  description = g_value_get_string (gimp_value_array_index (args, 0));
+
+  if (success)
+    {
+      success = gimp_performance_log_add_active_marker (description);
+    }
+
+  return gimp_procedure_get_return_values (procedure, success,
+                                           error ? *error : NULL);
+}
+
 void
 register_debug_procs (GimpPDB *pdb)
 {
@@ -137,4 +160,31 @@ register_debug_procs (GimpPDB *pdb)
                                                         GIMP_PARAM_READWRITE));
   gimp_pdb_register_procedure (pdb, procedure);
   g_object_unref (procedure);
+
+  /*
+   * gimp-debug-performance-log-add-marker
+   */
+  procedure = gimp_procedure_new (debug_performance_log_add_marker_invoker);
+  gimp_object_set_static_name (GIMP_OBJECT (procedure),
+                               "gimp-debug-performance-log-add-marker");
+  gimp_procedure_set_static_help (procedure,
+                                  "Adds a marker to the active performance log.",
+                                  "This procedure adds an event marker with the given description to the performance log that is currently being recorded, either from the Dashboard, or using the --performance-log command-line option. Markers can be used to delimit the parts of a script whose performance is of interest, when viewing the log.\n"
+                                     "The procedure fails if no performance log is being recorded.\n"
+                                     "\n"
+                                     "This is a debug utility procedure. It is subject to change at any point, and should not be used in production.",
+                                  NULL);
+  gimp_procedure_set_static_attribution (procedure,
+                                         "GIMP developers",
+                                         "GIMP developers",
+                                         "2023");
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_string ("description",
+                                                       "description",
+                                                       "The marker description",
+                                                       FALSE, TRUE, FALSE,
+                                                       NULL,
+                                                       GIMP_PARAM_READWRITE));
+  gimp_pdb_register_procedure (pdb, procedure);
+  g_object_unref (procedure);
 }
@@ -30,6 +30,7 @@
 #include "config/gimpcoreconfig.h"
 #include "core/gimp.h"
 #include "core/gimpchannel-select.h"
+#include "core/gimpdrawable-content-bounds.h"
 #include "core/gimpdrawable-fill.h"
 #include "core/gimpdrawable-foreground-extract.h"
 #include "core/gimpdrawable-offset.h"
@@ -500,6 +501,54 @@ drawable_mask_intersect_invoker (GimpProcedure         *procedure,
   return return_vals;
 }
 
+static GimpValueArray *
+drawable_get_content_bounds_invoker (GimpProcedure         *procedure,
+                                     Gimp                  *gimp,
+                                     GimpContext           *context,
+                                     GimpProgress          *progress,
+                                     const GimpValueArray  *args,
+                                     GError               **error)
+{
+  gboolean success = TRUE;
+  GimpValueArray *return_vals;
+  GimpDrawable *drawable;
+  gboolean exact;
+  gboolean non_empty = FALSE;
+  gint x = 0;
+  gint y = 0;
+  gint width = 0;
+  gint height = 0;
+
+  drawable = g_value_get_object (gimp_value_array_index (args, 0));
+  exact = g_value_get_boolean (gimp_value_array_index (args, 1));
+
+  if (success)
+    {
+      GeglRectangle bounds;
+
+      non_empty = gimp_drawable_get_content_bounds (drawable, exact, &bounds);
+
+      x      = bounds.x;
+      y      = bounds.y;
+      width  = bounds.width;
+      height = bounds.height;
+    }
+
+  return_vals = gimp_procedure_get_return_values (procedure, success,
+                                                  error ? *error : NULL);
+
+  if (success)
+    {
+      g_value_set_boolean (gimp_value_array_index (return_vals, 1), non_empty);
+      g_value_set_int (gimp_value_array_index (return_vals, 2), x);
+      g_value_set_int (gimp_value_array_index (return_vals, 3), y);
+      g_value_set_int (gimp_value_array_index (return_vals, 4), width);
+      g_value_set_int (gimp_value_array_index (return_vals, 5), height);
+    }
+
+  return return_vals;
+}
+
 static GimpValueArray *
 drawable_merge_shadow_invoker (GimpProcedure         *procedure,
                                Gimp                  *gimp,
@@ -1446,6 +1495,66 @@ register_drawable_procs (GimpPDB *pdb)
   gimp_pdb_register_procedure (pdb, procedure);
   g_object_unref (procedure);
 
+  /*
+   * gimp-drawable-get-content-bounds
+   */
+  procedure = gimp_procedure_new (drawable_get_content_bounds_invoker);
+  gimp_object_set_static_name (GIMP_OBJECT (procedure),
+                               "gimp-drawable-get-content-bounds");
+  gimp_procedure_set_static_help (procedure,
+                                  "Find the bounding box of the non-transparent content of a drawable.",
+                                  "This procedure returns whether the drawable has any content, i.e., non-transparent pixels (nonzero pixels for channels). If it does, the bounds of the content are returned as x, y, width, height, relative to the drawable's origin. Drawables without an alpha channel are always considered to be completely filled.\n"
+                                     "The content bounds are tracked by GIMP as the drawable is modified, so this procedure is cheap to call repeatedly. Unless exact bounds are requested, the returned bounds may be larger than the exact bounds, but they always contain all of the drawable's content.",
+                                  NULL);
+  gimp_procedure_set_static_attribution (procedure,
+                                         "GIMP developers",
+                                         "GIMP developers",
+                                         "2023");
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_drawable ("drawable",
+                                                         "drawable",
+                                                         "The drawable",
+                                                         FALSE,
+                                                         GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               g_param_spec_boolean ("exact",
+                                                     "exact",
+                                                     "Whether to return the exact content bounds",
+                                                     FALSE,
+                                                     GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   g_param_spec_boolean ("non-empty",
+                                                         "non empty",
+                                                         "TRUE if the drawable has any content",
+                                                         FALSE,
+                                                         GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   g_param_spec_int ("x",
+                                                     "x",
+                                                     "x coordinate of the upper left corner of the content bounds",
+                                                     G_MININT32, G_MAXINT32, 0,
+                                                     GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   g_param_spec_int ("y",
+                                                     "y",
+                                                     "y coordinate of the upper left corner of the content bounds",
+                                                     G_MININT32, G_MAXINT32, 0,
+                                                     GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   g_param_spec_int ("width",
+                                                     "width",
+                                                     "width of the content bounds",
+                                                     G_MININT32, G_MAXINT32, 0,
+                                                     GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   g_param_spec_int ("height",
+                                                     "height",
+                                                     "height of the content bounds",
+                                                     G_MININT32, G_MAXINT32, 0,
+                                                     GIMP_PARAM_READWRITE));
+  gimp_pdb_register_procedure (pdb, procedure);
+  g_object_unref (procedure);
+
   /*
    * gimp-drawable-merge-shadow
    */
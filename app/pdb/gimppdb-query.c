@@ -393,6 +393,8 @@ gimp_pdb_print_entry (gpointer key,
 
       num++;
 
+      gimp_procedure_ensure_args (procedure);
+
       gimp_pdb_get_strings (&strings, procedure, pdb_dump->dumping_compat);
 
 #ifdef DEBUG_OUTPUT
@@ -41,6 +41,7 @@
 #include "gimpprocedure.h"
 
 #include "gimp-intl.h"
+#include "gimp-trace.h"
 
 
 enum
@@ -250,7 +251,14 @@ gimp_pdb_lookup_procedure (GimpPDB     *pdb,
   list = g_hash_table_lookup (pdb->procedures, name);
 
   if (list)
-    return list->data;
+    {
+      /*  procedures may be registered without their arguments, which
+       *  are then created on the first lookup
+       */
+      gimp_procedure_ensure_args (list->data);
+
+      return list->data;
+    }
 
   return NULL;
 }
@@ -289,6 +297,7 @@ gimp_pdb_execute_procedure_by_name_args (GimpPDB         *pdb,
 {
   GimpValueArray *return_vals = NULL;
   GList          *list;
+  GimpTraceSpan   span        = GIMP_TRACE_BEGIN ();
 
   g_return_val_if_fail (GIMP_IS_PDB (pdb), NULL);
   g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
@@ -307,6 +316,8 @@ gimp_pdb_execute_procedure_by_name_args (GimpPDB         *pdb,
       return_vals = gimp_procedure_get_return_values (NULL, FALSE, pdb_error);
       g_propagate_error (error, pdb_error);
 
+      GIMP_TRACE_END (span, "pdb", name, "not found");
+
       return return_vals;
     }
 
@@ -344,6 +355,18 @@ gimp_pdb_execute_procedure_by_name_args (GimpPDB         *pdb,
         }
     }
 
+  if (span)
+    {
+      const gchar *status = NULL;
+
+      gimp_enum_get_value (GIMP_TYPE_PDB_STATUS_TYPE,
+                           g_value_get_enum (gimp_value_array_index (return_vals,
+                                                                     0)),
+                           NULL, &status, NULL, NULL);
+
+      GIMP_TRACE_END (span, "pdb", name, "%s", status);
+    }
+
   return return_vals;
 }
 
@@ -486,6 +486,8 @@ gimp_procedure_execute (GimpProcedure   *procedure,
   g_return_val_if_fail (args != NULL, NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
+  gimp_procedure_ensure_args (procedure);
+
   if (! gimp_procedure_validate_args (procedure,
                                       procedure->args, procedure->num_args,
                                       args, FALSE, &pdb_error))
@@ -590,6 +592,8 @@ gimp_procedure_execute_async (GimpProcedure  *procedure,
   g_return_if_fail (display == NULL || GIMP_IS_DISPLAY (display));
   g_return_if_fail (error == NULL || *error == NULL);
 
+  gimp_procedure_ensure_args (procedure);
+
   if (gimp_procedure_validate_args (procedure,
                                     procedure->args, procedure->num_args,
                                     args, FALSE, error))
@@ -622,6 +626,8 @@ gimp_procedure_get_arguments (GimpProcedure *procedure)
 
   g_return_val_if_fail (GIMP_IS_PROCEDURE (procedure), NULL);
 
+  gimp_procedure_ensure_args (procedure);
+
   args = gimp_value_array_new (procedure->num_args);
 
   for (i = 0; i < procedure->num_args; i++)
@@ -649,6 +655,8 @@ gimp_procedure_get_return_values (GimpProcedure *procedure,
 
   if (success)
     {
+      gimp_procedure_ensure_args (procedure);
+
       args = gimp_value_array_new (procedure->num_values + 1);
 
       g_value_init (&value, GIMP_TYPE_PDB_STATUS_TYPE);
@@ -711,6 +719,24 @@ gimp_procedure_get_return_values (GimpProcedure *procedure,
   return args;
 }
 
+/**
+ * gimp_procedure_ensure_args:
+ * @procedure: a #GimpProcedure
+ *
+ * Makes sure that the arguments and return values of @procedure are
+ * set up.  Procedures may create them lazily, so this must be called
+ * before accessing @procedure->args or @procedure->values directly,
+ * unless @procedure was looked up in the PDB or executed before.
+ **/
+void
+gimp_procedure_ensure_args (GimpProcedure *procedure)
+{
+  g_return_if_fail (GIMP_IS_PROCEDURE (procedure));
+
+  if (GIMP_PROCEDURE_GET_CLASS (procedure)->ensure_args)
+    GIMP_PROCEDURE_GET_CLASS (procedure)->ensure_args (procedure);
+}
+
 void
 gimp_procedure_add_argument (GimpProcedure *procedure,
                              GParamSpec    *pspec)
@@ -763,6 +789,8 @@ gimp_procedure_create_override (GimpProcedure   *procedure,
   const gchar   *name          = NULL;
   int            i             = 0;
 
+  gimp_procedure_ensure_args (procedure);
+
   new_procedure = gimp_procedure_new (new_marshal_func);
   name          = gimp_object_get_name (procedure);
 
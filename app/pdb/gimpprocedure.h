@@ -93,6 +93,8 @@ struct _GimpProcedureClass
                                        GimpProgress    *progress,
                                        GimpValueArray  *args,
                                        GimpDisplay     *display);
+
+  void             (* ensure_args)    (GimpProcedure   *procedure);
 };
 
 
@@ -139,6 +141,8 @@ gboolean         gimp_procedure_get_sensitive      (GimpProcedure    *procedure,
                                                     GimpObject       *object,
                                                     const gchar     **tooltip);
 
+void             gimp_procedure_ensure_args        (GimpProcedure    *procedure);
+
 void             gimp_procedure_add_argument       (GimpProcedure    *procedure,
                                                     GParamSpec       *pspec);
 void             gimp_procedure_add_return_value   (GimpProcedure    *procedure,
@@ -47,6 +47,7 @@
 #include "gimpplugin-cleanup.h"
 #include "gimpplugin-message.h"
 #include "gimppluginmanager.h"
+#include "gimppluginmanager-persistent.h"
 #include "gimpplugindef.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
@@ -75,6 +76,7 @@ static void gimp_plug_in_handle_proc_uninstall   (GimpPlugIn      *plug_in,
                                                   GPProcUninstall *proc_uninstall);
 static void gimp_plug_in_handle_extension_ack    (GimpPlugIn      *plug_in);
 static void gimp_plug_in_handle_has_init         (GimpPlugIn      *plug_in);
+static void gimp_plug_in_handle_persist          (GimpPlugIn      *plug_in);
 
 
 /*  public functions  */
@@ -160,6 +162,10 @@ gimp_plug_in_handle_message (GimpPlugIn      *plug_in,
     case GP_HAS_INIT:
       gimp_plug_in_handle_has_init (plug_in);
       break;
+
+    case GP_PERSIST:
+      gimp_plug_in_handle_persist (plug_in);
+      break;
     }
 }
 
@@ -661,7 +667,15 @@ gimp_plug_in_handle_proc_return (GimpPlugIn   *plug_in,
                                                    proc_frame->return_vals);
     }
 
-  gimp_plug_in_close (plug_in, FALSE);
+  /*  a persistent plug-in doesn't exit by itself, it is either kept
+   *  for the next call or asked to quit. If the call is synchronous,
+   *  gimp_plug_in_manager_call_run() does this after taking the
+   *  return values
+   */
+  if (! plug_in->persistent)
+    gimp_plug_in_close (plug_in, FALSE);
+  else if (! proc_frame->main_loop)
+    gimp_plug_in_manager_persistent_keep (plug_in->manager, plug_in);
 }
 
 static void
@@ -930,3 +944,23 @@ gimp_plug_in_handle_has_init (GimpPlugIn *plug_in)
       gimp_plug_in_close (plug_in, TRUE);
     }
 }
+
+static void
+gimp_plug_in_handle_persist (GimpPlugIn *plug_in)
+{
+  if (plug_in->call_mode == GIMP_PLUG_IN_CALL_RUN &&
+      ! plug_in->temp_proc_frames)
+    {
+      plug_in->persistent = TRUE;
+    }
+  else
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "sent a PERSIST message while not in run().  "
+                    "This should not happen.",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file));
+      gimp_plug_in_close (plug_in, TRUE);
+    }
+}
@@ -581,5 +581,8 @@ gimp_plug_in_proc_find (GimpPlugIn  *plug_in,
   if (! proc)
     proc = gimp_plug_in_procedure_find (plug_in->temp_procedures, proc_name);
 
+  if (proc)
+    gimp_procedure_ensure_args (GIMP_PROCEDURE (proc));
+
   return proc;
 }
@@ -106,6 +106,12 @@ static gboolean   gimp_plug_in_write         (GIOChannel   *channel,
                                               gpointer      data);
 static gboolean   gimp_plug_in_flush         (GIOChannel   *channel,
                                               gpointer      data);
+#ifdef G_OS_UNIX
+static gboolean   gimp_plug_in_write_vectored (GIOChannel   *channel,
+                                               GimpPlugIn   *plug_in,
+                                               const guint8 *buf,
+                                               gulong        count);
+#endif
 
 #if defined G_OS_WIN32 && defined WIN32_32BIT_DLL_FOLDER
 static void       gimp_plug_in_set_dll_directory (const gchar *path);
@@ -142,6 +148,7 @@ gimp_plug_in_init (GimpPlugIn *plug_in)
   plug_in->call_mode          = GIMP_PLUG_IN_CALL_NONE;
   plug_in->open               = FALSE;
   plug_in->hup                = FALSE;
+  plug_in->persistent         = FALSE;
   plug_in->pid                = 0;
 
   plug_in->my_read            = NULL;
@@ -150,6 +157,7 @@ gimp_plug_in_init (GimpPlugIn *plug_in)
   plug_in->his_write          = NULL;
 
   plug_in->input_id           = 0;
+  plug_in->idle_id            = 0;
   plug_in->write_buffer_index = 0;
 
   plug_in->temp_procedures    = NULL;
@@ -250,6 +258,11 @@ gimp_plug_in_write (GIOChannel   *channel,
   GimpPlugIn *plug_in = data;
   gulong      bytes;
 
+#ifdef G_OS_UNIX
+  if (count >= WRITE_BUFFER_SIZE)
+    return gimp_plug_in_write_vectored (channel, plug_in, buf, count);
+#endif
+
   while (count > 0)
     {
       if ((plug_in->write_buffer_index + count) >= WRITE_BUFFER_SIZE)
@@ -330,6 +343,35 @@ gimp_plug_in_flush (GIOChannel *channel,
   return TRUE;
 }
 
+#ifdef G_OS_UNIX
+/*  writes the buffered data, followed by @count bytes of @buf, with a
+ *  single writev() if possible, instead of copying @buf through the
+ *  write buffer
+ */
+static gboolean
+gimp_plug_in_write_vectored (GIOChannel   *channel,
+                             GimpPlugIn   *plug_in,
+                             const guint8 *buf,
+                             gulong        count)
+{
+  if (! gimp_wire_write_vectored (g_io_channel_unix_get_fd (channel),
+                                  plug_in->write_buffer,
+                                  plug_in->write_buffer_index,
+                                  buf, count))
+    {
+      g_warning ("%s: plug_in_write(): error: %s",
+                 gimp_filename_to_utf8 (g_get_prgname ()),
+                 g_strerror (errno));
+
+      return FALSE;
+    }
+
+  plug_in->write_buffer_index = 0;
+
+  return TRUE;
+}
+#endif
+
 #if defined G_OS_WIN32 && defined WIN32_32BIT_DLL_FOLDER
 static void
 gimp_plug_in_set_dll_directory (const gchar *path)
@@ -474,7 +516,12 @@ gimp_plug_in_open (GimpPlugIn         *plug_in,
   g_io_channel_set_encoding (plug_in->his_read, NULL, NULL);
   g_io_channel_set_encoding (plug_in->his_write, NULL, NULL);
 
-  g_io_channel_set_buffered (plug_in->my_read, FALSE);
+  /*  read ahead, so that each field of a message doesn't need a
+   *  read() of its own.  GIOChannel watches take the buffered data into
+   *  account, code polling the file descriptor has to check
+   *  g_io_channel_get_buffer_condition() first.
+   */
+  g_io_channel_set_buffer_size (plug_in->my_read, READ_BUFFER_SIZE);
   g_io_channel_set_buffered (plug_in->my_write, FALSE);
   g_io_channel_set_buffered (plug_in->his_read, FALSE);
   g_io_channel_set_buffered (plug_in->his_write, FALSE);
@@ -25,7 +25,8 @@
 #include "gimppluginprocframe.h"
 
 
-#define WRITE_BUFFER_SIZE  512
+#define WRITE_BUFFER_SIZE  4096   /*  larger writes bypass the buffer  */
+#define READ_BUFFER_SIZE   65536  /*  the size of a pipe on Linux        */
 
 
 #define GIMP_TYPE_PLUG_IN            (gimp_plug_in_get_type ())
@@ -47,6 +48,7 @@ struct _GimpPlugIn
   GimpPlugInCallMode   call_mode;       /*  QUERY, INIT or RUN                */
   guint                open : 1;        /*  Is the plug-in open?              */
   guint                hup : 1;         /*  Did we receive a G_IO_HUP         */
+  guint                persistent : 1;  /*  Does it wait for another call     */
   GPid                 pid;             /*  Plug-in's process id              */
 
   GIOChannel          *my_read;         /*  App's read and write channels     */
@@ -55,6 +57,9 @@ struct _GimpPlugIn
   GIOChannel          *his_write;
 
   guint                input_id;        /*  Id of input proc                  */
+  guint                idle_id;         /*  Id of the idle timeout while the
+                                         *  plug-in waits for another call
+                                         */
 
   gchar                write_buffer[WRITE_BUFFER_SIZE]; /* Buffer for writing */
   gint                 write_buffer_index;              /* Buffer index       */
@@ -49,10 +49,12 @@
 #include "gimppluginmanager.h"
 #define __YES_I_NEED_GIMP_PLUG_IN_MANAGER_CALL__
 #include "gimppluginmanager-call.h"
+#include "gimppluginmanager-persistent.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
 
 #include "gimp-intl.h"
+#include "gimp-trace.h"
 
 
 static void
@@ -157,6 +159,8 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
 {
   GimpValueArray *return_vals = NULL;
   GimpPlugIn     *plug_in;
+  gboolean        reused;
+  GimpTraceSpan   span        = GIMP_TRACE_BEGIN ();
 
   g_return_val_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager), NULL);
   g_return_val_if_fail (GIMP_IS_PDB_CONTEXT (context), NULL);
@@ -165,7 +169,13 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
   g_return_val_if_fail (args != NULL, NULL);
   g_return_val_if_fail (display == NULL || GIMP_IS_DISPLAY (display), NULL);
 
-  plug_in = gimp_plug_in_new (manager, context, progress, procedure, NULL);
+  /*  reuse a plug-in process which waits for another call  */
+  plug_in = gimp_plug_in_manager_persistent_take (manager, context, progress,
+                                                  procedure);
+  reused  = (plug_in != NULL);
+
+  if (! plug_in)
+    plug_in = gimp_plug_in_new (manager, context, progress, procedure, NULL);
 
   if (plug_in)
     {
@@ -179,7 +189,8 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
       GObject           *monitor;
       GFile             *icon_theme_dir;
 
-      if (! gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_RUN, FALSE))
+      if (! plug_in->open &&
+          ! gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_RUN, FALSE))
         {
           const gchar *name  = gimp_object_get_name (plug_in);
           GError      *error = g_error_new (GIMP_PLUG_IN_ERROR,
@@ -193,6 +204,9 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
                                                           FALSE, error);
           g_error_free (error);
 
+          GIMP_TRACE_END (span, "plug-in", gimp_object_get_name (procedure),
+                          "failed to start");
+
           return return_vals;
         }
 
@@ -236,27 +250,55 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
       proc_run.n_params = gimp_value_array_length (args);
       proc_run.params   = _gimp_value_array_to_gp_params (args, FALSE);
 
-      if (! gp_config_write (plug_in->my_write, &config, plug_in)     ||
-          ! gp_proc_run_write (plug_in->my_write, &proc_run, plug_in) ||
-          ! gimp_wire_flush (plug_in->my_write, plug_in))
+      while (! gp_config_write (plug_in->my_write, &config, plug_in)     ||
+             ! gp_proc_run_write (plug_in->my_write, &proc_run, plug_in) ||
+             ! gimp_wire_flush (plug_in->my_write, plug_in))
         {
-          const gchar *name  = gimp_object_get_name (plug_in);
-          GError      *error = g_error_new (GIMP_PLUG_IN_ERROR,
-                                            GIMP_PLUG_IN_EXECUTION_FAILED,
-                                            _("Failed to run plug-in \"%s\""),
-                                            name);
+          const gchar *name;
+          GError      *error;
+
+          /*  an idle plug-in may have exited before its hangup was
+           *  handled, so try once more with a new process
+           */
+          if (reused)
+            {
+              reused = FALSE;
+
+              gimp_plug_in_close (plug_in, TRUE);
+              g_object_unref (plug_in);
+
+              plug_in = gimp_plug_in_new (manager, context, progress,
+                                          procedure, NULL);
+
+              if (plug_in &&
+                  gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_RUN, FALSE))
+                continue;
+            }
+
+          if (plug_in)
+            name = gimp_object_get_name (plug_in);
+          else
+            name = gimp_object_get_name (procedure);
+
+          error = g_error_new (GIMP_PLUG_IN_ERROR,
+                               GIMP_PLUG_IN_EXECUTION_FAILED,
+                               _("Failed to run plug-in \"%s\""),
+                               name);
 
           g_free (config.display_name);
           g_free (config.icon_theme_dir);
 
           _gimp_gp_params_free (proc_run.params, proc_run.n_params, FALSE);
 
-          g_object_unref (plug_in);
+          g_clear_object (&plug_in);
 
           return_vals = gimp_procedure_get_return_values (GIMP_PROCEDURE (procedure),
                                                           FALSE, error);
           g_error_free (error);
 
+          GIMP_TRACE_END (span, "plug-in", gimp_object_get_name (procedure),
+                          "failed to run");
+
           return return_vals;
         }
 
@@ -295,11 +337,17 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
           g_clear_pointer (&proc_frame->main_loop, g_main_loop_unref);
 
           return_vals = gimp_plug_in_proc_frame_get_return_values (proc_frame);
+
+          if (plug_in->persistent)
+            gimp_plug_in_manager_persistent_keep (manager, plug_in);
         }
 
       g_object_unref (plug_in);
     }
 
+  GIMP_TRACE_END (span, "plug-in", gimp_object_get_name (procedure),
+                  "%s", synchronous ? "synchronous" : "asynchronous");
+
   return return_vals;
 }
 
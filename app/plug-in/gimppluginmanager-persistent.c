@@ -0,0 +1,284 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppluginmanager-persistent.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*  A plug-in which called gimp_plug_in_set_persistent() sends
+ *  GP_PERSIST before returning from a procedure, and then waits for
+ *  either another GP_PROC_RUN or GP_QUIT instead of exiting.  The
+ *  functions here keep such plug-ins around while they are idle, for
+ *  at most "plug-in-persistent-timeout" seconds and one process per
+ *  plug-in file, and hand them out again for the next call.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpprotocol.h"
+
+#include "plug-in-types.h"
+
+#include "config/gimpcoreconfig.h"
+
+#include "core/gimp.h"
+
+#include "gimpplugin.h"
+#include "gimppluginmanager.h"
+#include "gimppluginmanager-persistent.h"
+#include "gimppluginprocedure.h"
+
+
+/*  local function prototypes  */
+
+static gboolean   gimp_plug_in_manager_persistent_idle       (GimpPlugIn *plug_in);
+static void       gimp_plug_in_manager_persistent_quit       (GimpPlugIn *plug_in);
+static guint64    gimp_plug_in_manager_persistent_get_memory (GimpPlugIn *plug_in);
+
+
+/*  public functions  */
+
+/*  returns a reference to an idle plug-in which can run @procedure,
+ *  set up for the call, or %NULL
+ */
+GimpPlugIn *
+gimp_plug_in_manager_persistent_take (GimpPlugInManager   *manager,
+                                      GimpContext         *context,
+                                      GimpProgress        *progress,
+                                      GimpPlugInProcedure *procedure)
+{
+  GFile  *file;
+  GSList *list;
+
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager), NULL);
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_PROCEDURE (procedure), NULL);
+
+  if (GIMP_PROCEDURE (procedure)->proc_type != GIMP_PDB_PROC_TYPE_PLUGIN)
+    return NULL;
+
+  file = gimp_plug_in_procedure_get_file (procedure);
+
+  for (list = manager->persistent_plug_ins; list; list = g_slist_next (list))
+    {
+      GimpPlugIn *plug_in = list->data;
+
+      if (g_file_equal (plug_in->file, file))
+        {
+          /*  the list's reference is passed to the caller  */
+          manager->persistent_plug_ins =
+            g_slist_remove (manager->persistent_plug_ins, plug_in);
+
+          g_source_remove (plug_in->idle_id);
+          plug_in->idle_id = 0;
+
+          gimp_plug_in_proc_frame_init (&plug_in->main_proc_frame,
+                                        context, progress, procedure);
+
+          if (manager->gimp->be_verbose)
+            g_print ("Reusing plug-in: '%s'\n",
+                     gimp_file_get_utf8_name (plug_in->file));
+
+          return plug_in;
+        }
+    }
+
+  return NULL;
+}
+
+/*  called when a plug-in which sent GP_PERSIST returned from its
+ *  procedure, either keeps the plug-in for the next call or asks it
+ *  to quit
+ */
+void
+gimp_plug_in_manager_persistent_keep (GimpPlugInManager *manager,
+                                      GimpPlugIn        *plug_in)
+{
+  GimpCoreConfig *config;
+  GSList         *list;
+  gboolean        keep;
+  guint64         memory;
+
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+
+  if (! plug_in->open)
+    return;
+
+  config = manager->gimp->config;
+
+  /*  the plug-in sends GP_PERSIST again with each call  */
+  plug_in->persistent = FALSE;
+
+  keep = (config->plug_in_persistent_timeout > 0 &&
+          ! plug_in->temp_procedures              &&
+          ! plug_in->temp_proc_frames);
+
+  for (list = manager->persistent_plug_ins;
+       list && keep;
+       list = g_slist_next (list))
+    {
+      GimpPlugIn *other = list->data;
+
+      if (g_file_equal (other->file, plug_in->file))
+        keep = FALSE;
+    }
+
+  if (keep)
+    {
+      memory = gimp_plug_in_manager_persistent_get_memory (plug_in);
+
+      if (memory > config->plug_in_persistent_memory)
+        {
+          if (manager->gimp->be_verbose)
+            {
+              gchar *str = g_format_size (memory);
+
+              g_print ("Not keeping plug-in: '%s' uses %s\n",
+                       gimp_file_get_utf8_name (plug_in->file), str);
+              g_free (str);
+            }
+
+          keep = FALSE;
+        }
+    }
+
+  if (! keep)
+    {
+      gimp_plug_in_manager_persistent_quit (plug_in);
+      return;
+    }
+
+  /*  finish the call now, instead of when the plug-in is closed  */
+  gimp_plug_in_proc_frame_dispose (&plug_in->main_proc_frame, plug_in);
+
+  plug_in->idle_id =
+    g_timeout_add_seconds (config->plug_in_persistent_timeout,
+                           (GSourceFunc) gimp_plug_in_manager_persistent_idle,
+                           plug_in);
+
+  manager->persistent_plug_ins = g_slist_prepend (manager->persistent_plug_ins,
+                                                  g_object_ref (plug_in));
+}
+
+/*  called when @plug_in is closed  */
+void
+gimp_plug_in_manager_persistent_remove (GimpPlugInManager *manager,
+                                        GimpPlugIn        *plug_in)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+
+  if (g_slist_find (manager->persistent_plug_ins, plug_in))
+    {
+      manager->persistent_plug_ins =
+        g_slist_remove (manager->persistent_plug_ins, plug_in);
+
+      if (plug_in->idle_id)
+        {
+          g_source_remove (plug_in->idle_id);
+          plug_in->idle_id = 0;
+        }
+
+      g_object_unref (plug_in);
+    }
+}
+
+void
+gimp_plug_in_manager_persistent_exit (GimpPlugInManager *manager)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+
+  /*  closing the plug-in removes it from the list  */
+  while (manager->persistent_plug_ins)
+    {
+      GimpPlugIn *plug_in = g_object_ref (manager->persistent_plug_ins->data);
+
+      gimp_plug_in_manager_persistent_quit (plug_in);
+      g_object_unref (plug_in);
+    }
+}
+
+
+/*  private functions  */
+
+static gboolean
+gimp_plug_in_manager_persistent_idle (GimpPlugIn *plug_in)
+{
+  plug_in->idle_id = 0;
+
+  if (plug_in->manager->gimp->be_verbose)
+    g_print ("Stopping idle plug-in: '%s'\n",
+             gimp_file_get_utf8_name (plug_in->file));
+
+  g_object_ref (plug_in);
+  gimp_plug_in_manager_persistent_quit (plug_in);
+  g_object_unref (plug_in);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gimp_plug_in_manager_persistent_quit (GimpPlugIn *plug_in)
+{
+  /*  the plug-in waits for a message, so tell it to exit before
+   *  gimp_plug_in_close() waits for the process
+   */
+  if (gp_quit_write (plug_in->my_write, plug_in))
+    gimp_plug_in_close (plug_in, FALSE);
+  else
+    gimp_plug_in_close (plug_in, TRUE);
+}
+
+/*  returns the resident memory of the plug-in process, or 0 if unknown  */
+static guint64
+gimp_plug_in_manager_persistent_get_memory (GimpPlugIn *plug_in)
+{
+  guint64 memory = 0;
+
+#ifdef G_OS_UNIX
+  gchar  *filename;
+  gchar  *contents;
+
+  filename = g_strdup_printf ("/proc/%d/statm", (gint) plug_in->pid);
+
+  if (g_file_get_contents (filename, &contents, NULL, NULL))
+    {
+      guint64 resident;
+      glong   page_size = sysconf (_SC_PAGESIZE);
+
+      if (page_size > 0 &&
+          sscanf (contents, "%*u %" G_GUINT64_FORMAT, &resident) == 1)
+        {
+          memory = resident * page_size;
+        }
+
+      g_free (contents);
+    }
+
+  g_free (filename);
+#endif
+
+  return memory;
+}
@@ -19,12 +19,14 @@
 
 #include "config.h"
 
+#include <errno.h>
 #include <string.h>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
 
 #include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpwire.h"
 #include "libgimpconfig/gimpconfig.h"
 
 #include "plug-in-types.h"
@@ -38,6 +40,8 @@
 #include "pdb/gimppdbcontext.h"
 
 #include "gimpinterpreterdb.h"
+#include "gimpplugin.h"
+#include "gimpplugin-message.h"
 #include "gimpplugindef.h"
 #include "gimppluginmanager.h"
 #define __YES_I_NEED_GIMP_PLUG_IN_MANAGER_CALL__
@@ -48,40 +52,50 @@
 #include "gimppluginmanager-restore.h"
 #include "gimppluginprocedure.h"
 #include "plug-in-rc.h"
+#include "plug-in-rc-binary.h"
 
 #include "gimp-intl.h"
 
 
-static void    gimp_plug_in_manager_search            (GimpPlugInManager    *manager,
-                                                       GimpInitStatusFunc    status_callback);
-static void    gimp_plug_in_manager_search_directory  (GimpPlugInManager    *manager,
-                                                       GFile                *directory);
-static GFile * gimp_plug_in_manager_get_pluginrc      (GimpPlugInManager    *manager);
-static void    gimp_plug_in_manager_read_pluginrc     (GimpPlugInManager    *manager,
-                                                       GFile                *file,
-                                                       GimpInitStatusFunc    status_callback);
-static void    gimp_plug_in_manager_query_new         (GimpPlugInManager    *manager,
-                                                       GimpContext          *context,
-                                                       GimpInitStatusFunc    status_callback);
-static void    gimp_plug_in_manager_init_plug_ins     (GimpPlugInManager    *manager,
-                                                       GimpContext          *context,
-                                                       GimpInitStatusFunc    status_callback);
-static void    gimp_plug_in_manager_run_extensions    (GimpPlugInManager    *manager,
-                                                       GimpContext          *context,
-                                                       GimpInitStatusFunc    status_callback);
-static void    gimp_plug_in_manager_bind_text_domains (GimpPlugInManager    *manager);
-static void    gimp_plug_in_manager_add_from_file     (GimpPlugInManager    *manager,
-                                                       GFile                *file,
-                                                       guint64               mtime);
-static void    gimp_plug_in_manager_add_from_rc       (GimpPlugInManager    *manager,
-                                                       GimpPlugInDef        *plug_in_def);
-static void    gimp_plug_in_manager_add_to_db         (GimpPlugInManager    *manager,
-                                                       GimpContext          *context,
-                                                       GimpPlugInProcedure  *proc);
-static void    gimp_plug_in_manager_sort_file_procs   (GimpPlugInManager    *manager);
-static gint    gimp_plug_in_manager_file_proc_compare (gconstpointer         a,
-                                                       gconstpointer         b,
-                                                       gpointer              data);
+static void     gimp_plug_in_manager_search            (GimpPlugInManager    *manager,
+                                                        GimpInitStatusFunc    status_callback);
+static void     gimp_plug_in_manager_search_directory  (GimpPlugInManager    *manager,
+                                                        GFile                *directory);
+static GFile *  gimp_plug_in_manager_get_pluginrc      (GimpPlugInManager    *manager);
+static GFile *  gimp_plug_in_manager_get_pluginrc_binary
+                                                        (GFile                *pluginrc);
+static gboolean gimp_plug_in_manager_read_pluginrc     (GimpPlugInManager    *manager,
+                                                        GFile                *file,
+                                                        GFile                *pluginrc_binary,
+                                                        GimpInitStatusFunc    status_callback);
+static void     gimp_plug_in_manager_query_new         (GimpPlugInManager    *manager,
+                                                        GimpContext          *context,
+                                                        GimpInitStatusFunc    status_callback);
+static gint     gimp_plug_in_manager_get_n_query_jobs  (GimpPlugInManager    *manager);
+static GimpPlugIn *
+                gimp_plug_in_manager_query_start       (GimpPlugInManager    *manager,
+                                                        GimpContext          *context,
+                                                        GimpPlugInDef        *plug_in_def);
+static void     gimp_plug_in_manager_query_wait        (GPtrArray            *plug_ins);
+static void     gimp_plug_in_manager_init_plug_ins     (GimpPlugInManager    *manager,
+                                                        GimpContext          *context,
+                                                        GimpInitStatusFunc    status_callback);
+static void     gimp_plug_in_manager_run_extensions    (GimpPlugInManager    *manager,
+                                                        GimpContext          *context,
+                                                        GimpInitStatusFunc    status_callback);
+static void     gimp_plug_in_manager_bind_text_domains (GimpPlugInManager    *manager);
+static void     gimp_plug_in_manager_add_from_file     (GimpPlugInManager    *manager,
+                                                        GFile                *file,
+                                                        guint64               mtime);
+static void     gimp_plug_in_manager_add_from_rc       (GimpPlugInManager    *manager,
+                                                        GimpPlugInDef        *plug_in_def);
+static void     gimp_plug_in_manager_add_to_db         (GimpPlugInManager    *manager,
+                                                        GimpContext          *context,
+                                                        GimpPlugInProcedure  *proc);
+static void     gimp_plug_in_manager_sort_file_procs   (GimpPlugInManager    *manager);
+static gint     gimp_plug_in_manager_file_proc_compare (gconstpointer         a,
+                                                        gconstpointer         b,
+                                                        gpointer              data);
 
 
 
@@ -90,10 +104,12 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
                               GimpContext        *context,
                               GimpInitStatusFunc  status_callback)
 {
-  Gimp   *gimp;
-  GFile  *pluginrc;
-  GSList *list;
-  GError *error = NULL;
+  Gimp     *gimp;
+  GFile    *pluginrc;
+  GFile    *pluginrc_binary;
+  gboolean  write_binary;
+  GSList   *list;
+  GError   *error = NULL;
 
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
   g_return_if_fail (GIMP_IS_CONTEXT (context));
@@ -108,9 +124,13 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
   gimp_plug_in_manager_search (manager, status_callback);
 
   /* read the pluginrc file for cached data */
-  pluginrc = gimp_plug_in_manager_get_pluginrc (manager);
+  pluginrc        = gimp_plug_in_manager_get_pluginrc (manager);
+  pluginrc_binary = gimp_plug_in_manager_get_pluginrc_binary (pluginrc);
 
-  gimp_plug_in_manager_read_pluginrc (manager, pluginrc, status_callback);
+  write_binary = ! gimp_plug_in_manager_read_pluginrc (manager,
+                                                       pluginrc,
+                                                       pluginrc_binary,
+                                                       status_callback);
 
   /* query any plug-ins that changed since we last wrote out pluginrc */
   gimp_plug_in_manager_query_new (manager, context, status_callback);
@@ -136,16 +156,40 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
       if (gimp->be_verbose)
         g_print ("Writing '%s'\n", gimp_file_get_utf8_name (pluginrc));
 
-      if (! plug_in_rc_write (manager->plug_in_defs, pluginrc, &error))
+      if (plug_in_rc_write (manager->plug_in_defs, pluginrc, &error))
+        {
+          write_binary = TRUE;
+        }
+      else
         {
           gimp_message_literal (gimp,
                                 NULL, GIMP_MESSAGE_ERROR, error->message);
           g_clear_error (&error);
+
+          /*  the binary pluginrc must not be newer than the text file  */
+          write_binary = FALSE;
         }
 
       manager->write_pluginrc = FALSE;
     }
 
+  /* the binary pluginrc is only a cache, failing to write it is harmless */
+  if (write_binary)
+    {
+      if (gimp->be_verbose)
+        g_print ("Writing '%s'\n", gimp_file_get_utf8_name (pluginrc_binary));
+
+      if (! plug_in_rc_binary_write (manager->plug_in_defs,
+                                     pluginrc_binary, pluginrc, &error))
+        {
+          if (gimp->be_verbose)
+            g_printerr ("%s\n", error->message);
+
+          g_clear_error (&error);
+        }
+    }
+
+  g_object_unref (pluginrc_binary);
   g_object_unref (pluginrc);
 
   /* create locale and help domain lists */
@@ -418,22 +462,62 @@ gimp_plug_in_manager_get_pluginrc (GimpPlugInManager *manager)
   return pluginrc;
 }
 
-/* read the pluginrc file for cached data */
-static void
+/* the binary pluginrc lives next to the text file, see plug-in-rc-binary.c */
+static GFile *
+gimp_plug_in_manager_get_pluginrc_binary (GFile *pluginrc)
+{
+  GFile *file;
+  gchar *uri;
+  gchar *binary_uri;
+
+  uri        = g_file_get_uri (pluginrc);
+  binary_uri = g_strconcat (uri, ".bin", NULL);
+
+  file = g_file_new_for_uri (binary_uri);
+
+  g_free (binary_uri);
+  g_free (uri);
+
+  return file;
+}
+
+/* read the pluginrc file for cached data, preferring the binary file.
+ * returns whether the binary file was up to date.
+ */
+static gboolean
 gimp_plug_in_manager_read_pluginrc (GimpPlugInManager  *manager,
                                     GFile              *pluginrc,
+                                    GFile              *pluginrc_binary,
                                     GimpInitStatusFunc  status_callback)
 {
-  GSList *rc_defs;
-  GError *error = NULL;
+  GSList   *rc_defs;
+  gboolean  binary_valid = TRUE;
+  GError   *error        = NULL;
 
   status_callback (_("Resource configuration"),
                    gimp_file_get_utf8_name (pluginrc), 0.0);
 
   if (manager->gimp->be_verbose)
-    g_print ("Parsing '%s'\n", gimp_file_get_utf8_name (pluginrc));
+    g_print ("Parsing '%s'\n", gimp_file_get_utf8_name (pluginrc_binary));
+
+  rc_defs = plug_in_rc_binary_parse (manager->gimp,
+                                     pluginrc_binary, pluginrc, &error);
 
-  rc_defs = plug_in_rc_parse (manager->gimp, pluginrc, &error);
+  if (! rc_defs)
+    {
+      if (error && manager->gimp->be_verbose)
+        g_print ("Skipping '%s': %s\n",
+                 gimp_file_get_utf8_name (pluginrc_binary), error->message);
+
+      g_clear_error (&error);
+
+      binary_valid = FALSE;
+
+      if (manager->gimp->be_verbose)
+        g_print ("Parsing '%s'\n", gimp_file_get_utf8_name (pluginrc));
+
+      rc_defs = plug_in_rc_parse (manager->gimp, pluginrc, &error);
+    }
 
   if (rc_defs)
     {
@@ -452,6 +536,8 @@ gimp_plug_in_manager_read_pluginrc (GimpPlugInManager  *manager,
 
       g_clear_error (&error);
     }
+
+  return binary_valid;
 }
 
 /* query any plug-ins that changed since we last wrote out pluginrc */
@@ -475,36 +561,178 @@ gimp_plug_in_manager_query_new (GimpPlugInManager  *manager,
 
   if (n_plugins)
     {
-      gint nth;
+      GPtrArray *running = g_ptr_array_new ();
+      gint       n_jobs  = gimp_plug_in_manager_get_n_query_jobs (manager);
+      gint       nth;
 
       manager->write_pluginrc = TRUE;
 
-      for (list = manager->plug_in_defs, nth = 0; list; list = list->next)
-        {
-          GimpPlugInDef *plug_in_def = list->data;
+      if (manager->gimp->be_verbose && n_jobs > 1)
+        g_print ("Querying %d plug-ins, %d at a time\n", n_plugins, n_jobs);
 
-          if (plug_in_def->needs_query)
+      /*  each query only adds procedures to its own plug-in def, which
+       *  keep their order in manager->plug_in_defs, so the PDB and the
+       *  pluginrc don't depend on the order in which the queries finish
+       */
+      list = manager->plug_in_defs;
+      nth  = 0;
+
+      while (list || running->len > 0)
+        {
+          for (; list && running->len < n_jobs; list = list->next)
             {
-              gchar *basename;
+              GimpPlugInDef *plug_in_def = list->data;
 
-              basename =
-                g_path_get_basename (gimp_file_get_utf8_name (plug_in_def->file));
-              status_callback (NULL, basename,
-                               (gdouble) nth++ / (gdouble) n_plugins);
-              g_free (basename);
+              if (plug_in_def->needs_query)
+                {
+                  gchar *basename;
 
-              if (manager->gimp->be_verbose)
-                g_print ("Querying plug-in: '%s'\n",
-                         gimp_file_get_utf8_name (plug_in_def->file));
+                  basename =
+                    g_path_get_basename (gimp_file_get_utf8_name (plug_in_def->file));
+                  status_callback (NULL, basename,
+                                   (gdouble) nth++ / (gdouble) n_plugins);
+                  g_free (basename);
+
+                  if (manager->gimp->be_verbose)
+                    g_print ("Querying plug-in: '%s'\n",
+                             gimp_file_get_utf8_name (plug_in_def->file));
+
+                  if (n_jobs == 1)
+                    {
+                      gimp_plug_in_manager_call_query (manager, context,
+                                                       plug_in_def);
+                    }
+                  else
+                    {
+                      GimpPlugIn *plug_in;
 
-              gimp_plug_in_manager_call_query (manager, context, plug_in_def);
+                      plug_in = gimp_plug_in_manager_query_start (manager,
+                                                                  context,
+                                                                  plug_in_def);
+                      if (plug_in)
+                        g_ptr_array_add (running, plug_in);
+                    }
+                }
             }
+
+          if (running->len > 0)
+            gimp_plug_in_manager_query_wait (running);
         }
+
+      g_ptr_array_free (running, TRUE);
     }
 
   status_callback (NULL, "", 1.0);
 }
 
+/*  the number of plug-ins to query at the same time  */
+static gint
+gimp_plug_in_manager_get_n_query_jobs (GimpPlugInManager *manager)
+{
+#ifdef G_OS_WIN32
+  /*  g_poll() can't wait on pipes on Windows  */
+  return 1;
+#else
+  /*  a debugger or other wrapper may need the terminal for itself  */
+  if (manager->debug)
+    return 1;
+
+  return MAX (1, GIMP_GEGL_CONFIG (manager->gimp->config)->num_processors);
+#endif
+}
+
+/*  like gimp_plug_in_manager_call_query(), but returns the running
+ *  plug-in instead of waiting for it to finish
+ */
+static GimpPlugIn *
+gimp_plug_in_manager_query_start (GimpPlugInManager *manager,
+                                  GimpContext       *context,
+                                  GimpPlugInDef     *plug_in_def)
+{
+  GimpPlugIn *plug_in;
+
+  plug_in = gimp_plug_in_new (manager, context, NULL,
+                              NULL, plug_in_def->file);
+
+  if (! plug_in)
+    return NULL;
+
+  plug_in->plug_in_def = plug_in_def;
+
+  if (! gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_QUERY, TRUE))
+    {
+      g_object_unref (plug_in);
+      return NULL;
+    }
+
+  return plug_in;
+}
+
+/*  waits until at least one of @plug_ins sent a message, handles the
+ *  messages, and removes the plug-ins that are done from @plug_ins
+ */
+static void
+gimp_plug_in_manager_query_wait (GPtrArray *plug_ins)
+{
+  GPollFD *fds;
+  gint     n_fds   = plug_ins->len;
+  gint     timeout = -1;
+  gint     i;
+
+  fds = g_new0 (GPollFD, n_fds);
+
+  for (i = 0; i < n_fds; i++)
+    {
+      GimpPlugIn *plug_in = g_ptr_array_index (plug_ins, i);
+
+      fds[i].fd     = g_io_channel_unix_get_fd (plug_in->my_read);
+      fds[i].events = G_IO_IN | G_IO_HUP | G_IO_ERR;
+
+      /*  messages which are already read ahead don't wake up g_poll()  */
+      if (g_io_channel_get_buffer_condition (plug_in->my_read) & G_IO_IN)
+        timeout = 0;
+    }
+
+  if (g_poll (fds, n_fds, timeout) < 0)
+    {
+      if (errno != EINTR)
+        g_warning ("%s: g_poll() failed: %s", G_STRFUNC, g_strerror (errno));
+
+      g_free (fds);
+
+      return;
+    }
+
+  /*  backwards, so removing a plug-in doesn't move the ones to come  */
+  for (i = n_fds - 1; i >= 0; i--)
+    {
+      GimpPlugIn      *plug_in = g_ptr_array_index (plug_ins, i);
+      GimpWireMessage  msg;
+
+      if (! fds[i].revents &&
+          ! (g_io_channel_get_buffer_condition (plug_in->my_read) & G_IO_IN))
+        continue;
+
+      if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
+        {
+          gimp_plug_in_close (plug_in, TRUE);
+        }
+      else
+        {
+          gimp_plug_in_handle_message (plug_in, &msg);
+          gimp_wire_destroy (&msg);
+        }
+
+      if (! plug_in->open)
+        {
+          g_ptr_array_remove_index (plug_ins, i);
+          g_object_unref (plug_in);
+        }
+    }
+
+  g_free (fds);
+}
+
 /* initialize the plug-ins */
 static void
 gimp_plug_in_manager_init_plug_ins (GimpPlugInManager  *manager,
@@ -570,11 +798,13 @@ gimp_plug_in_manager_run_extensions (GimpPlugInManager  *manager,
     {
       GimpPlugInProcedure *proc = list->data;
 
-      if (proc->file                                                       &&
-          GIMP_PROCEDURE (proc)->proc_type == GIMP_PDB_PROC_TYPE_EXTENSION &&
-          GIMP_PROCEDURE (proc)->num_args  == 0)
+      if (proc->file &&
+          GIMP_PROCEDURE (proc)->proc_type == GIMP_PDB_PROC_TYPE_EXTENSION)
         {
-          extensions = g_list_prepend (extensions, proc);
+          gimp_procedure_ensure_args (GIMP_PROCEDURE (proc));
+
+          if (GIMP_PROCEDURE (proc)->num_args == 0)
+            extensions = g_list_prepend (extensions, proc);
         }
     }
 
@@ -48,6 +48,7 @@
 #include "gimppluginmanager-help-domain.h"
 #include "gimppluginmanager-locale-domain.h"
 #include "gimppluginmanager-menu-branch.h"
+#include "gimppluginmanager-persistent.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
 
@@ -262,6 +263,8 @@ gimp_plug_in_manager_exit (GimpPlugInManager *manager)
 {
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
 
+  gimp_plug_in_manager_persistent_exit (manager);
+
   while (manager->open_plug_ins)
     gimp_plug_in_close (manager->open_plug_ins->data, TRUE);
 
@@ -387,6 +390,8 @@ gimp_plug_in_manager_remove_open_plug_in (GimpPlugInManager *manager,
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
   g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
 
+  gimp_plug_in_manager_persistent_remove (manager, plug_in);
+
   manager->open_plug_ins = g_slist_remove (manager->open_plug_ins, plug_in);
 
   g_signal_emit (manager, manager_signals[PLUG_IN_CLOSED], 0,
@@ -44,6 +44,7 @@
 #include "gimppluginerror.h"
 #include "gimppluginprocedure.h"
 #include "plug-in-menu-path.h"
+#include "plug-in-rc-binary.h"
 
 #include "gimp-intl.h"
 
@@ -83,6 +84,7 @@ static void     gimp_plug_in_procedure_execute_async   (GimpProcedure  *procedur
                                                         GimpProgress   *progress,
                                                         GimpValueArray *args,
                                                         GimpDisplay    *display);
+static void     gimp_plug_in_procedure_ensure_args     (GimpProcedure  *procedure);
 
 static GFile  * gimp_plug_in_procedure_real_get_file   (GimpPlugInProcedure *procedure);
 
@@ -131,6 +133,7 @@ gimp_plug_in_procedure_class_init (GimpPlugInProcedureClass *klass)
   proc_class->get_sensitive         = gimp_plug_in_procedure_get_sensitive;
   proc_class->execute               = gimp_plug_in_procedure_execute;
   proc_class->execute_async         = gimp_plug_in_procedure_execute_async;
+  proc_class->ensure_args           = gimp_plug_in_procedure_ensure_args;
 
   klass->get_file                   = gimp_plug_in_procedure_real_get_file;
   klass->menu_path_added            = NULL;
@@ -172,6 +175,8 @@ gimp_plug_in_procedure_finalize (GObject *object)
 
   g_free (proc->thumb_loader);
 
+  g_clear_pointer (&proc->lazy_args, g_variant_unref);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -419,6 +424,22 @@ gimp_plug_in_procedure_execute_async (GimpProcedure  *procedure,
     }
 }
 
+static void
+gimp_plug_in_procedure_ensure_args (GimpProcedure *procedure)
+{
+  GimpPlugInProcedure *proc  = GIMP_PLUG_IN_PROCEDURE (procedure);
+  GError              *error = NULL;
+
+  /*  procedures read from the binary pluginrc load their arguments on
+   *  first use
+   */
+  if (proc->lazy_args && ! plug_in_rc_binary_load_args (proc, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_clear_error (&error);
+    }
+}
+
 static GFile *
 gimp_plug_in_procedure_real_get_file (GimpPlugInProcedure *procedure)
 {
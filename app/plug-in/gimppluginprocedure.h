@@ -53,6 +53,7 @@ struct _GimpPlugInProcedure
   gchar               *image_types_tooltip;
   gint64               mtime;
   gboolean             installed_during_init;
+  GVariant            *lazy_args; /* not yet loaded args and values */
 
   /*  file proc specific members  */
   gboolean             file_proc;
@@ -0,0 +1,1044 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * plug-in-rc-binary.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*  A binary copy of the pluginrc, stored as a single GVariant next to
+ *  the text file.  It is memory-mapped when read, so startup doesn't
+ *  have to tokenize the (large) text pluginrc.  The text pluginrc stays
+ *  the authoritative copy: the binary file records the modification
+ *  time and size of the text file it was written along with, and is
+ *  ignored as soon as they don't match anymore.
+ *
+ *  The procedures read from the file only get what the menus and the
+ *  file procedure lookup need.  Their arguments and return values stay
+ *  in the mapped file until the procedure is first looked up in the
+ *  PDB or run, see plug_in_rc_binary_load_args().
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpprotocol.h"
+#include "libgimpconfig/gimpconfig.h"
+
+#include "libgimp/gimpgpparams.h"
+
+#include "plug-in-types.h"
+
+#include "core/gimp.h"
+
+#include "gimpplugindef.h"
+#include "gimppluginprocedure.h"
+#include "plug-in-rc-binary.h"
+
+
+#define PLUG_IN_RC_BINARY_VERSION 3
+
+/*  the GVariant types of the file's contents  */
+#define ARG_TYPE       "(usssmsmsuv)"
+#define ARGS_TYPE      "(a" ARG_TYPE "a" ARG_TYPE ")"
+#define ICON_TYPE      "(iay)"
+#define FILE_PROC_TYPE "(msmsmayimsbbms)"
+#define PROC_TYPE      "(simsmsmsmsmsmsas" ICON_TYPE "m" FILE_PROC_TYPE \
+                       "ms" ARGS_TYPE ")"
+#define DEF_TYPE       "(sxa" PROC_TYPE "msmsmsmsb)"
+#define RC_TYPE        "(uuxta" DEF_TYPE ")"
+
+
+static gboolean              plug_in_rc_binary_get_stamp       (GFile          *pluginrc,
+                                                                gint64         *mtime,
+                                                                guint64        *size,
+                                                                GError        **error);
+
+static GimpPlugInDef       * plug_in_rc_binary_parse_def       (GVariant       *value,
+                                                                GError        **error);
+static GimpPlugInProcedure * plug_in_rc_binary_parse_proc      (GVariant       *value,
+                                                                GFile          *file,
+                                                                GError        **error);
+static gboolean              plug_in_rc_binary_parse_icon      (GVariant       *value,
+                                                                GimpPlugInProcedure *proc);
+static void                  plug_in_rc_binary_parse_file_proc (GVariant       *value,
+                                                                GimpPlugInProcedure *proc);
+static GParamSpec          * plug_in_rc_binary_parse_arg       (GVariant       *value);
+static gboolean              plug_in_rc_binary_get_meta        (GVariant       *meta,
+                                                                const gchar    *format,
+                                                                ...);
+
+static GVariant            * plug_in_rc_binary_serialize_def   (GimpPlugInDef  *plug_in_def,
+                                                                const gchar    *path);
+static GVariant            * plug_in_rc_binary_serialize_proc  (GimpPlugInProcedure *proc);
+static GVariant            * plug_in_rc_binary_serialize_args  (GimpProcedure  *procedure);
+static GVariant            * plug_in_rc_binary_serialize_arg   (GParamSpec     *pspec);
+
+
+/*  public functions  */
+
+/**
+ * plug_in_rc_binary_parse:
+ * @gimp:     a #Gimp
+ * @file:     the binary pluginrc
+ * @pluginrc: the text pluginrc @file was written along with
+ * @error:    return location for an error
+ *
+ * Reads the plug-in definitions from the binary pluginrc @file, which
+ * is only used if it was written by this version of GIMP, and if
+ * @pluginrc didn't change since.
+ *
+ * Returns: the list of #GimpPlugInDef in @file, or %NULL on error.
+ **/
+GSList *
+plug_in_rc_binary_parse (Gimp    *gimp,
+                         GFile   *file,
+                         GFile   *pluginrc,
+                         GError **error)
+{
+  GMappedFile  *mapped;
+  GBytes       *bytes;
+  GVariant     *rc;
+  GVariant     *defs;
+  GVariant     *def;
+  GVariantIter  iter;
+  GSList       *plug_in_defs = NULL;
+  gchar        *path;
+  guint32       protocol_version;
+  guint32       file_version;
+  gint64        rc_mtime;
+  guint64       rc_size;
+  gint64        mtime;
+  guint64       size;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (G_IS_FILE (pluginrc), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  path = g_file_get_path (file);
+
+  if (! path)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_OPEN,
+                   "'%s' is not a local file",
+                   gimp_file_get_utf8_name (file));
+      return NULL;
+    }
+
+  mapped = g_mapped_file_new (path, FALSE, error);
+  g_free (path);
+
+  if (! mapped)
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  g_mapped_file_unref (mapped);
+
+  /*  the data is not trusted, GVariant returns default values for
+   *  anything that doesn't fit the type instead
+   */
+  rc = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (RC_TYPE),
+                                                     bytes, FALSE));
+  g_bytes_unref (bytes);
+
+  g_variant_get (rc, "(uuxt@a" DEF_TYPE ")",
+                 &protocol_version, &file_version, &rc_mtime, &rc_size,
+                 &defs);
+
+  if (protocol_version != GIMP_PROTOCOL_VERSION ||
+      file_version     != PLUG_IN_RC_BINARY_VERSION)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_VERSION,
+                   "'%s' was written by a different version of GIMP",
+                   gimp_file_get_utf8_name (file));
+      goto out;
+    }
+
+  if (! plug_in_rc_binary_get_stamp (pluginrc, &mtime, &size, error))
+    goto out;
+
+  if (mtime != rc_mtime || size != rc_size)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_VERSION,
+                   "'%s' is out of date",
+                   gimp_file_get_utf8_name (file));
+      goto out;
+    }
+
+  g_variant_iter_init (&iter, defs);
+
+  while ((def = g_variant_iter_next_value (&iter)))
+    {
+      GimpPlugInDef *plug_in_def = plug_in_rc_binary_parse_def (def, error);
+
+      g_variant_unref (def);
+
+      if (! plug_in_def)
+        {
+          g_slist_free_full (plug_in_defs, (GDestroyNotify) g_object_unref);
+          plug_in_defs = NULL;
+          break;
+        }
+
+      plug_in_defs = g_slist_prepend (plug_in_defs, plug_in_def);
+    }
+
+ out:
+  g_variant_unref (defs);
+  g_variant_unref (rc);
+
+  return g_slist_reverse (plug_in_defs);
+}
+
+/**
+ * plug_in_rc_binary_write:
+ * @plug_in_defs: a list of #GimpPlugInDef
+ * @file:         the binary pluginrc
+ * @pluginrc:     the text pluginrc, which must be up to date
+ * @error:        return location for an error
+ *
+ * Writes @plug_in_defs to @file, tied to the current state of
+ * @pluginrc.
+ *
+ * Returns: %TRUE on success.
+ **/
+gboolean
+plug_in_rc_binary_write (GSList  *plug_in_defs,
+                         GFile   *file,
+                         GFile   *pluginrc,
+                         GError **error)
+{
+  GVariantBuilder  builder;
+  GVariant        *rc;
+  GSList          *list;
+  gint64           rc_mtime;
+  guint64          rc_size;
+  gboolean         success;
+
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (G_IS_FILE (pluginrc), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (! plug_in_rc_binary_get_stamp (pluginrc, &rc_mtime, &rc_size, error))
+    return FALSE;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" DEF_TYPE));
+
+  for (list = plug_in_defs; list; list = list->next)
+    {
+      GimpPlugInDef *plug_in_def = list->data;
+      gchar         *path;
+
+      if (! plug_in_def->procedures)
+        continue;
+
+      path = gimp_file_get_config_path (plug_in_def->file, NULL);
+      if (! path)
+        continue;
+
+      g_variant_builder_add_value (&builder,
+                                   plug_in_rc_binary_serialize_def (plug_in_def,
+                                                                    path));
+
+      g_free (path);
+    }
+
+  rc = g_variant_ref_sink (g_variant_new ("(uuxt@a" DEF_TYPE ")",
+                                          GIMP_PROTOCOL_VERSION,
+                                          PLUG_IN_RC_BINARY_VERSION,
+                                          rc_mtime, rc_size,
+                                          g_variant_builder_end (&builder)));
+
+  success = g_file_replace_contents (file,
+                                     g_variant_get_data (rc),
+                                     g_variant_get_size (rc),
+                                     NULL, FALSE, G_FILE_CREATE_NONE,
+                                     NULL, NULL, error);
+
+  g_variant_unref (rc);
+
+  return success;
+}
+
+/**
+ * plug_in_rc_binary_load_args:
+ * @proc:  a #GimpPlugInProcedure read by plug_in_rc_binary_parse()
+ * @error: return location for an error
+ *
+ * Creates the arguments and return values of @proc from the binary
+ * pluginrc it was read from, if that didn't happen yet.  This is the
+ * #GimpProcedure::ensure_args() implementation of such procedures.
+ *
+ * Returns: %TRUE on success.
+ **/
+gboolean
+plug_in_rc_binary_load_args (GimpPlugInProcedure  *proc,
+                             GError              **error)
+{
+  GimpProcedure *procedure;
+  GVariant      *args;
+  GVariant      *values;
+  GVariant      *arg;
+  GVariantIter   iter;
+  GSList        *pspecs = NULL;
+  GSList        *list;
+  gint           n_args;
+  gboolean       success = TRUE;
+
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_PROCEDURE (proc), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (! proc->lazy_args)
+    return TRUE;
+
+  procedure = GIMP_PROCEDURE (proc);
+
+  g_variant_get (proc->lazy_args, "(@a" ARG_TYPE "@a" ARG_TYPE ")",
+                 &args, &values);
+
+  g_clear_pointer (&proc->lazy_args, g_variant_unref);
+
+  /*  parse everything before adding anything, so that an invalid file
+   *  can't leave the procedure with part of its arguments
+   */
+  g_variant_iter_init (&iter, args);
+
+  while (success && (arg = g_variant_iter_next_value (&iter)))
+    {
+      GParamSpec *pspec = plug_in_rc_binary_parse_arg (arg);
+
+      g_variant_unref (arg);
+
+      if (pspec)
+        pspecs = g_slist_prepend (pspecs, g_param_spec_ref_sink (pspec));
+      else
+        success = FALSE;
+    }
+
+  n_args = g_slist_length (pspecs);
+
+  g_variant_iter_init (&iter, values);
+
+  while (success && (arg = g_variant_iter_next_value (&iter)))
+    {
+      GParamSpec *pspec = plug_in_rc_binary_parse_arg (arg);
+
+      g_variant_unref (arg);
+
+      if (pspec)
+        pspecs = g_slist_prepend (pspecs, g_param_spec_ref_sink (pspec));
+      else
+        success = FALSE;
+    }
+
+  g_variant_unref (args);
+  g_variant_unref (values);
+
+  if (success)
+    {
+      pspecs = g_slist_reverse (pspecs);
+
+      for (list = pspecs; list; list = g_slist_next (list), n_args--)
+        {
+          if (n_args > 0)
+            gimp_procedure_add_argument (procedure, list->data);
+          else
+            gimp_procedure_add_return_value (procedure, list->data);
+        }
+    }
+  else
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_PARSE,
+                   "invalid arguments for procedure '%s' in the binary "
+                   "pluginrc",
+                   gimp_object_get_name (proc));
+    }
+
+  g_slist_free_full (pspecs, (GDestroyNotify) g_param_spec_unref);
+
+  return success;
+}
+
+
+/*  private functions  */
+
+static gboolean
+plug_in_rc_binary_get_stamp (GFile    *pluginrc,
+                             gint64   *mtime,
+                             guint64  *size,
+                             GError  **error)
+{
+  GFileInfo *info;
+
+  info = g_file_query_info (pluginrc,
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                            G_FILE_QUERY_INFO_NONE,
+                            NULL, error);
+
+  if (! info)
+    return FALSE;
+
+  *mtime = (g_file_info_get_attribute_uint64 (info,
+                                              G_FILE_ATTRIBUTE_TIME_MODIFIED) *
+            G_USEC_PER_SEC +
+            g_file_info_get_attribute_uint32 (info,
+                                              G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC));
+  *size  = g_file_info_get_size (info);
+
+  g_object_unref (info);
+
+  return TRUE;
+}
+
+static GimpPlugInDef *
+plug_in_rc_binary_parse_def (GVariant  *value,
+                             GError   **error)
+{
+  GimpPlugInDef *plug_in_def;
+  GVariant      *procs;
+  GVariant      *proc_value;
+  GVariantIter   iter;
+  GFile         *file;
+  const gchar   *path;
+  const gchar   *locale_name;
+  const gchar   *locale_path;
+  const gchar   *help_name;
+  const gchar   *help_uri;
+  gint64         mtime;
+  gboolean       has_init;
+
+  g_variant_get (value, "(&sx@a" PROC_TYPE "m&sm&sm&sm&sb)",
+                 &path, &mtime, &procs,
+                 &locale_name, &locale_path,
+                 &help_name, &help_uri,
+                 &has_init);
+
+  if (! *path)
+    {
+      g_set_error_literal (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_PARSE,
+                           "plug-in filename is empty");
+      g_variant_unref (procs);
+      return NULL;
+    }
+
+  file = gimp_file_new_for_config_path (path, error);
+
+  if (! file)
+    {
+      g_variant_unref (procs);
+      return NULL;
+    }
+
+  plug_in_def = gimp_plug_in_def_new (file);
+  g_object_unref (file);
+
+  plug_in_def->mtime = mtime;
+
+  g_variant_iter_init (&iter, procs);
+
+  while ((proc_value = g_variant_iter_next_value (&iter)))
+    {
+      GimpPlugInProcedure *proc;
+
+      proc = plug_in_rc_binary_parse_proc (proc_value, plug_in_def->file,
+                                           error);
+      g_variant_unref (proc_value);
+
+      if (! proc)
+        {
+          g_variant_unref (procs);
+          g_object_unref (plug_in_def);
+          return NULL;
+        }
+
+      gimp_plug_in_def_add_procedure (plug_in_def, proc);
+      g_object_unref (proc);
+    }
+
+  g_variant_unref (procs);
+
+  if (locale_name)
+    {
+      gchar *expanded_path = NULL;
+
+      if (locale_path)
+        expanded_path = gimp_config_path_expand (locale_path, TRUE, NULL);
+
+      gimp_plug_in_def_set_locale_domain (plug_in_def,
+                                          locale_name, expanded_path);
+
+      g_free (expanded_path);
+    }
+
+  if (help_name)
+    gimp_plug_in_def_set_help_domain (plug_in_def, help_name, help_uri);
+
+  if (has_init)
+    gimp_plug_in_def_set_has_init (plug_in_def, TRUE);
+
+  return plug_in_def;
+}
+
+static GimpPlugInProcedure *
+plug_in_rc_binary_parse_proc (GVariant  *value,
+                              GFile     *file,
+                              GError   **error)
+{
+  GimpProcedure       *procedure = NULL;
+  GimpPlugInProcedure *proc;
+  GVariant            *menu_paths;
+  GVariant            *icon;
+  GVariant            *file_proc;
+  GVariant            *args;
+  GVariantIter         iter;
+  const gchar         *name;
+  const gchar         *blurb;
+  const gchar         *help;
+  const gchar         *authors;
+  const gchar         *copyright;
+  const gchar         *date;
+  const gchar         *menu_label;
+  const gchar         *image_types;
+  gchar               *menu_path;
+  gint                 proc_type;
+
+  g_variant_get (value,
+                 "(&sim&sm&sm&sm&sm&sm&s@as@" ICON_TYPE "@m" FILE_PROC_TYPE
+                 "m&s@" ARGS_TYPE ")",
+                 &name, &proc_type,
+                 &blurb, &help, &authors, &copyright, &date, &menu_label,
+                 &menu_paths, &icon, &file_proc,
+                 &image_types, &args);
+
+  if (! *name)
+    {
+      g_set_error_literal (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_PARSE,
+                           "procedure name is empty");
+      goto out;
+    }
+
+  if (proc_type != GIMP_PDB_PROC_TYPE_PLUGIN &&
+      proc_type != GIMP_PDB_PROC_TYPE_EXTENSION)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_PARSE,
+                   "procedure type %d is out of range", proc_type);
+      goto out;
+    }
+
+  procedure = gimp_plug_in_procedure_new (proc_type, file);
+  proc      = GIMP_PLUG_IN_PROCEDURE (procedure);
+
+  gimp_object_set_name (GIMP_OBJECT (procedure), name);
+
+  procedure->blurb     = g_strdup (blurb);
+  procedure->help      = g_strdup (help);
+  procedure->authors   = g_strdup (authors);
+  procedure->copyright = g_strdup (copyright);
+  procedure->date      = g_strdup (date);
+  proc->menu_label     = g_strdup (menu_label);
+
+  g_variant_iter_init (&iter, menu_paths);
+
+  while (g_variant_iter_next (&iter, "s", &menu_path))
+    proc->menu_paths = g_list_append (proc->menu_paths, menu_path);
+
+  if (! plug_in_rc_binary_parse_icon (icon, proc))
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_PARSE,
+                   "invalid icon for procedure '%s'", name);
+      g_clear_object (&procedure);
+      goto out;
+    }
+
+  plug_in_rc_binary_parse_file_proc (file_proc, proc);
+
+  gimp_plug_in_procedure_set_image_types (proc, image_types);
+
+  /*  keep the arguments in the mapped file until they are needed  */
+  proc->lazy_args = g_steal_pointer (&args);
+
+ out:
+  g_variant_unref (menu_paths);
+  g_variant_unref (icon);
+  g_variant_unref (file_proc);
+  g_clear_pointer (&args, g_variant_unref);
+
+  return procedure ? GIMP_PLUG_IN_PROCEDURE (procedure) : NULL;
+}
+
+static gboolean
+plug_in_rc_binary_parse_icon (GVariant            *value,
+                              GimpPlugInProcedure *proc)
+{
+  GVariant     *data;
+  const guint8 *icon_data;
+  gsize         icon_data_length;
+  gint          icon_type;
+  gboolean      success = TRUE;
+
+  g_variant_get (value, "(i@ay)", &icon_type, &data);
+
+  icon_data = g_variant_get_fixed_array (data, &icon_data_length,
+                                         sizeof (guint8));
+
+  switch (icon_type)
+    {
+    case GIMP_ICON_TYPE_ICON_NAME:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      gimp_plug_in_procedure_take_icon (proc, icon_type,
+                                        icon_data_length ?
+                                        (guint8 *) g_strndup ((const gchar *) icon_data,
+                                                              icon_data_length) :
+                                        NULL,
+                                        -1, NULL);
+      break;
+
+    case GIMP_ICON_TYPE_PIXBUF:
+      gimp_plug_in_procedure_take_icon (proc, icon_type,
+                                        g_memdup (icon_data, icon_data_length),
+                                        icon_data_length, NULL);
+      break;
+
+    default:
+      success = FALSE;
+      break;
+    }
+
+  g_variant_unref (data);
+
+  return success;
+}
+
+static void
+plug_in_rc_binary_parse_file_proc (GVariant            *value,
+                                   GimpPlugInProcedure *proc)
+{
+  GVariant    *child = g_variant_get_maybe (value);
+  const gchar *extensions;
+  const gchar *prefixes;
+  GVariant    *magics;
+  const gchar *mime_types;
+  const gchar *thumb_loader;
+  gint         priority;
+  gboolean     handles_remote;
+  gboolean     handles_raw;
+
+  if (! child)
+    return;
+
+  g_variant_get (child, "(m&sm&s@mayim&sbbm&s)",
+                 &extensions, &prefixes, &magics, &priority,
+                 &mime_types, &handles_remote, &handles_raw, &thumb_loader);
+
+  proc->file_proc = TRUE;
+
+  g_free (proc->extensions);
+  proc->extensions = g_strdup (extensions);
+
+  g_free (proc->prefixes);
+  proc->prefixes = g_strdup (prefixes);
+
+  /*  magics are binary strings, like "\211PNG", so they are stored
+   *  as bytestrings instead of UTF-8 strings
+   */
+  g_free (proc->magics);
+  proc->magics = NULL;
+
+  if (g_variant_n_children (magics))
+    {
+      GVariant *bytes = g_variant_get_child_value (magics, 0);
+
+      proc->magics = g_variant_dup_bytestring (bytes, NULL);
+      g_variant_unref (bytes);
+    }
+
+  g_variant_unref (magics);
+
+  gimp_plug_in_procedure_set_priority (proc, priority);
+
+  if (mime_types)
+    gimp_plug_in_procedure_set_mime_types (proc, mime_types);
+
+  if (handles_remote)
+    gimp_plug_in_procedure_set_handles_remote (proc);
+
+  if (handles_raw)
+    gimp_plug_in_procedure_set_handles_raw (proc);
+
+  if (thumb_loader)
+    gimp_plug_in_procedure_set_thumb_loader (proc, thumb_loader);
+
+  g_variant_unref (child);
+}
+
+static GParamSpec *
+plug_in_rc_binary_parse_arg (GVariant *value)
+{
+  GPParamDef  param_def = { 0, };
+  GParamSpec *pspec     = NULL;
+  GVariant   *meta;
+  guint32     param_def_type;
+  gboolean    valid     = FALSE;
+
+  g_variant_get (value, "(u&s&s&sm&sm&suv)",
+                 &param_def_type,
+                 &param_def.type_name,
+                 &param_def.value_type_name,
+                 &param_def.name,
+                 &param_def.nick,
+                 &param_def.blurb,
+                 &param_def.flags,
+                 &meta);
+
+  param_def.param_def_type = param_def_type;
+
+  switch (param_def.param_def_type)
+    {
+    case GP_PARAM_DEF_TYPE_DEFAULT:
+      valid = TRUE;
+      break;
+
+    case GP_PARAM_DEF_TYPE_INT:
+      valid = plug_in_rc_binary_get_meta (meta, "(xxx)",
+                                          &param_def.meta.m_int.min_val,
+                                          &param_def.meta.m_int.max_val,
+                                          &param_def.meta.m_int.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_UNIT:
+      valid = plug_in_rc_binary_get_meta (meta, "(iii)",
+                                          &param_def.meta.m_unit.allow_pixels,
+                                          &param_def.meta.m_unit.allow_percent,
+                                          &param_def.meta.m_unit.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_ENUM:
+      valid = plug_in_rc_binary_get_meta (meta, "i",
+                                          &param_def.meta.m_enum.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_BOOLEAN:
+      valid = plug_in_rc_binary_get_meta (meta, "i",
+                                          &param_def.meta.m_boolean.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_FLOAT:
+      valid = plug_in_rc_binary_get_meta (meta, "(ddd)",
+                                          &param_def.meta.m_float.min_val,
+                                          &param_def.meta.m_float.max_val,
+                                          &param_def.meta.m_float.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_STRING:
+      valid = plug_in_rc_binary_get_meta (meta, "ms",
+                                          &param_def.meta.m_string.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_COLOR:
+      valid = plug_in_rc_binary_get_meta (meta, "(idddd)",
+                                          &param_def.meta.m_color.has_alpha,
+                                          &param_def.meta.m_color.default_val.r,
+                                          &param_def.meta.m_color.default_val.g,
+                                          &param_def.meta.m_color.default_val.b,
+                                          &param_def.meta.m_color.default_val.a);
+      break;
+
+    case GP_PARAM_DEF_TYPE_ID:
+      valid = plug_in_rc_binary_get_meta (meta, "i",
+                                          &param_def.meta.m_id.none_ok);
+      break;
+
+    case GP_PARAM_DEF_TYPE_ID_ARRAY:
+      valid = plug_in_rc_binary_get_meta (meta, "ms",
+                                          &param_def.meta.m_id_array.type_name);
+      break;
+    }
+
+  if (valid)
+    pspec = _gimp_gp_param_def_to_param_spec (&param_def);
+
+  switch (param_def.param_def_type)
+    {
+    case GP_PARAM_DEF_TYPE_STRING:
+      g_free (param_def.meta.m_string.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_ID_ARRAY:
+      g_free (param_def.meta.m_id_array.type_name);
+      break;
+
+    default:
+      break;
+    }
+
+  g_variant_unref (meta);
+
+  return pspec;
+}
+
+/*  gets the values of @meta, if it has the type given by @format, which
+ *  must therefore not contain '&' or '@'
+ */
+static gboolean
+plug_in_rc_binary_get_meta (GVariant    *meta,
+                            const gchar *format,
+                            ...)
+{
+  va_list args;
+
+  if (! g_variant_is_of_type (meta, G_VARIANT_TYPE (format)))
+    return FALSE;
+
+  va_start (args, format);
+  g_variant_get_va (meta, format, NULL, &args);
+  va_end (args);
+
+  return TRUE;
+}
+
+static GVariant *
+plug_in_rc_binary_serialize_def (GimpPlugInDef *plug_in_def,
+                                 const gchar   *path)
+{
+  GVariantBuilder  procs;
+  GVariant        *value;
+  GSList          *list;
+  gchar           *locale_path = NULL;
+
+  g_variant_builder_init (&procs, G_VARIANT_TYPE ("a" PROC_TYPE));
+
+  for (list = plug_in_def->procedures; list; list = list->next)
+    {
+      GimpPlugInProcedure *proc = list->data;
+
+      if (proc->installed_during_init)
+        continue;
+
+      g_variant_builder_add_value (&procs,
+                                   plug_in_rc_binary_serialize_proc (proc));
+    }
+
+  if (plug_in_def->locale_domain_name && plug_in_def->locale_domain_path)
+    locale_path = gimp_config_path_unexpand (plug_in_def->locale_domain_path,
+                                             TRUE, NULL);
+
+  value = g_variant_new ("(sx@a" PROC_TYPE "msmsmsmsb)",
+                         path,
+                         plug_in_def->mtime,
+                         g_variant_builder_end (&procs),
+                         plug_in_def->locale_domain_name,
+                         locale_path,
+                         plug_in_def->help_domain_name,
+                         plug_in_def->help_domain_name ?
+                         plug_in_def->help_domain_uri : NULL,
+                         plug_in_def->has_init);
+
+  g_free (locale_path);
+
+  return value;
+}
+
+static GVariant *
+plug_in_rc_binary_serialize_proc (GimpPlugInProcedure *proc)
+{
+  GimpProcedure   *procedure = GIMP_PROCEDURE (proc);
+  GVariantBuilder  menu_paths;
+  GVariant        *icon;
+  GVariant        *file_proc = NULL;
+  const guint8    *icon_data = (const guint8 *) "";
+  gsize            icon_data_length = 0;
+  GList           *list;
+
+  g_variant_builder_init (&menu_paths, G_VARIANT_TYPE_STRING_ARRAY);
+
+  for (list = proc->menu_paths; list; list = list->next)
+    g_variant_builder_add (&menu_paths, "s", list->data);
+
+  switch (proc->icon_type)
+    {
+    case GIMP_ICON_TYPE_ICON_NAME:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      if (proc->icon_data)
+        {
+          icon_data        = proc->icon_data;
+          icon_data_length = strlen ((const gchar *) proc->icon_data);
+        }
+      break;
+
+    case GIMP_ICON_TYPE_PIXBUF:
+      if (proc->icon_data)
+        {
+          icon_data        = proc->icon_data;
+          icon_data_length = proc->icon_data_length;
+        }
+      break;
+    }
+
+  icon = g_variant_new ("(i@ay)",
+                        proc->icon_type,
+                        g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+                                                   icon_data,
+                                                   icon_data_length,
+                                                   sizeof (guint8)));
+
+  if (proc->file_proc)
+    {
+      GVariant *magics = NULL;
+
+      if (proc->magics)
+        magics = g_variant_new_bytestring (proc->magics);
+
+      file_proc = g_variant_new ("(msms@mayimsbbms)",
+                                 proc->extensions,
+                                 proc->prefixes,
+                                 g_variant_new_maybe (G_VARIANT_TYPE_BYTESTRING,
+                                                      magics),
+                                 proc->priority,
+                                 proc->mime_types,
+                                 proc->handles_remote,
+                                 proc->handles_raw && ! proc->image_types,
+                                 proc->thumb_loader);
+    }
+
+  return g_variant_new ("(simsmsmsmsmsms@as@" ICON_TYPE "@m" FILE_PROC_TYPE
+                        "ms@" ARGS_TYPE ")",
+                        gimp_object_get_name (procedure),
+                        procedure->proc_type,
+                        procedure->blurb,
+                        procedure->help,
+                        procedure->authors,
+                        procedure->copyright,
+                        procedure->date,
+                        proc->menu_label,
+                        g_variant_builder_end (&menu_paths),
+                        icon,
+                        g_variant_new_maybe (G_VARIANT_TYPE (FILE_PROC_TYPE),
+                                             file_proc),
+                        proc->image_types,
+                        plug_in_rc_binary_serialize_args (procedure));
+}
+
+static GVariant *
+plug_in_rc_binary_serialize_args (GimpProcedure *procedure)
+{
+  GimpPlugInProcedure *proc = GIMP_PLUG_IN_PROCEDURE (procedure);
+  GVariantBuilder      args;
+  GVariantBuilder      values;
+  gint                 i;
+
+  /*  arguments which were never loaded are copied as they are  */
+  if (proc->lazy_args)
+    return proc->lazy_args;
+
+  g_variant_builder_init (&args, G_VARIANT_TYPE ("a" ARG_TYPE));
+
+  for (i = 0; i < procedure->num_args; i++)
+    g_variant_builder_add_value (&args,
+                                 plug_in_rc_binary_serialize_arg (procedure->args[i]));
+
+  g_variant_builder_init (&values, G_VARIANT_TYPE ("a" ARG_TYPE));
+
+  for (i = 0; i < procedure->num_values; i++)
+    g_variant_builder_add_value (&values,
+                                 plug_in_rc_binary_serialize_arg (procedure->values[i]));
+
+  return g_variant_new ("(@a" ARG_TYPE "@a" ARG_TYPE ")",
+                        g_variant_builder_end (&args),
+                        g_variant_builder_end (&values));
+}
+
+static GVariant *
+plug_in_rc_binary_serialize_arg (GParamSpec *pspec)
+{
+  GPParamDef  param_def = { 0, };
+  GVariant   *meta;
+
+  _gimp_param_spec_to_gp_param_def (pspec, &param_def);
+
+  switch (param_def.param_def_type)
+    {
+    case GP_PARAM_DEF_TYPE_INT:
+      meta = g_variant_new ("(xxx)",
+                            param_def.meta.m_int.min_val,
+                            param_def.meta.m_int.max_val,
+                            param_def.meta.m_int.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_UNIT:
+      meta = g_variant_new ("(iii)",
+                            param_def.meta.m_unit.allow_pixels,
+                            param_def.meta.m_unit.allow_percent,
+                            param_def.meta.m_unit.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_ENUM:
+      meta = g_variant_new ("i", param_def.meta.m_enum.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_BOOLEAN:
+      meta = g_variant_new ("i", param_def.meta.m_boolean.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_FLOAT:
+      meta = g_variant_new ("(ddd)",
+                            param_def.meta.m_float.min_val,
+                            param_def.meta.m_float.max_val,
+                            param_def.meta.m_float.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_STRING:
+      meta = g_variant_new ("ms", param_def.meta.m_string.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_COLOR:
+      meta = g_variant_new ("(idddd)",
+                            param_def.meta.m_color.has_alpha,
+                            param_def.meta.m_color.default_val.r,
+                            param_def.meta.m_color.default_val.g,
+                            param_def.meta.m_color.default_val.b,
+                            param_def.meta.m_color.default_val.a);
+      break;
+
+    case GP_PARAM_DEF_TYPE_ID:
+      meta = g_variant_new ("i", param_def.meta.m_id.none_ok);
+      break;
+
+    case GP_PARAM_DEF_TYPE_ID_ARRAY:
+      meta = g_variant_new ("ms", param_def.meta.m_id_array.type_name);
+      break;
+
+    case GP_PARAM_DEF_TYPE_DEFAULT:
+    default:
+      meta = g_variant_new ("()");
+      break;
+    }
+
+  return g_variant_new ("(usssmsmsuv)",
+                        param_def.param_def_type,
+                        param_def.type_name,
+                        param_def.value_type_name,
+                        g_param_spec_get_name (pspec),
+                        g_param_spec_get_nick (pspec),
+                        g_param_spec_get_blurb (pspec),
+                        pspec->flags,
+                        meta);
+}
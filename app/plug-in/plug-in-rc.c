@@ -1158,6 +1158,8 @@ plug_in_rc_write (GSList  *plug_in_defs,
               if (proc->installed_during_init)
                 continue;
 
+              gimp_procedure_ensure_args (procedure);
+
               gimp_config_writer_open (writer, "proc-def");
               gimp_config_writer_printf (writer, "\"%s\" %d",
                                          gimp_object_get_name (procedure),
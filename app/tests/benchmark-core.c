@@ -0,0 +1,1259 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * benchmark-core.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*  Runs a fixed set of core image operations on synthetic images, and
+ *  reports their timings as JSON, optionally comparing them against a
+ *  baseline produced by an earlier run:
+ *
+ *    benchmark-core --width=4096 --height=4096 --precision=float-linear \
+ *                   --threads=8 --output=after.json --baseline=before.json
+ *
+ *  The images are generated from a fixed seed, so that runs with the
+ *  same parameters operate on the same pixels.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+#include <json-glib/json-glib.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpmath/gimpmath.h"
+
+#include "paint/paint-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "gegl/gimp-gegl-apply-operation.h"
+#include "gegl/gimp-gegl-loops.h"
+#include "gegl/gimp-gegl-nodes.h"
+
+#include "operations/layer-modes/gimp-layer-modes.h"
+
+#include "core/gimp.h"
+#include "core/gimpcontext.h"
+#include "core/gimpdrawable-transform.h"
+#include "core/gimpimage.h"
+#include "core/gimpimage-convert-indexed.h"
+#include "core/gimpimage-convert-precision.h"
+#include "core/gimpimage-duplicate.h"
+#include "core/gimpimage-undo.h"
+#include "core/gimplayer.h"
+#include "core/gimplayer-new.h"
+#include "core/gimppickable.h"
+#include "core/gimppickable-contiguous-region.h"
+#include "core/gimptempbuf.h"
+
+#include "paint/gimppaintcore-loops.h"
+
+#include "xcf/xcf.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define BENCHMARK_VERSION  1    /* bump when scenarios change meaning */
+#define SEED               0x67696d70
+#define DAB_SIZE           128
+#define DAB_SPACING        32
+#define BLOCK_SIZE         128
+
+
+typedef struct _Benchmark Benchmark;
+typedef struct _Scenario  Scenario;
+typedef struct _Result    Result;
+
+struct _Benchmark
+{
+  Gimp        *gimp;
+  GimpContext *context;
+
+  GimpImage   *image;
+  GimpLayer   *layer;
+  GeglBuffer  *top;         /*  blended onto the layer by the mode scenarios  */
+  GeglBuffer  *scratch;     /*  same extent and format as the layer           */
+
+  /*  scenario state  */
+  GeglNode    *graph;
+  GeglNode    *node;
+  GeglBuffer  *buffer;
+  GimpTempBuf *paint_buf;
+  GimpTempBuf *paint_mask;
+  GimpImage   *work_image;
+  GBytes      *xcf;
+};
+
+struct _Scenario
+{
+  const gchar *name;
+  gint         data;
+
+  /*  only run() is timed; the other functions may be NULL  */
+  void      (* setup)    (Benchmark      *bench,
+                          const Scenario *scenario);
+  void      (* prepare)  (Benchmark      *bench,
+                          const Scenario *scenario);
+  void      (* run)      (Benchmark      *bench,
+                          const Scenario *scenario);
+  void      (* cleanup)  (Benchmark      *bench,
+                          const Scenario *scenario);
+  void      (* teardown) (Benchmark      *bench,
+                          const Scenario *scenario);
+};
+
+struct _Result
+{
+  const Scenario *scenario;
+  gdouble        *samples;  /*  milliseconds, sorted  */
+  gint            n_samples;
+
+  gdouble         median;
+  gdouble         p10;
+  gdouble         p90;
+  gdouble         min;
+  gdouble         max;
+  gdouble         mean;
+  gdouble         throughput; /*  megapixels per second, at the median  */
+
+  gboolean        has_baseline;
+  gdouble         baseline;
+  gdouble         change;     /*  percent; positive is slower  */
+};
+
+
+/*  local function prototypes  */
+
+static void         benchmark_fill          (GeglBuffer      *buffer,
+                                             guint32          seed,
+                                             gboolean         vary_alpha);
+
+static void         layer_mode_setup        (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         layer_mode_run          (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         graph_teardown          (Benchmark       *bench,
+                                             const Scenario  *scenario);
+
+static void         paint_setup             (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         paint_run               (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         paint_teardown          (Benchmark       *bench,
+                                             const Scenario  *scenario);
+
+static void         scratch_prepare         (Benchmark       *bench,
+                                             const Scenario  *scenario);
+
+static void         buffer_copy_setup       (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         buffer_copy_run         (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         apply_mask_setup        (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         apply_mask_run          (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         average_color_run       (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         buffer_teardown         (Benchmark       *bench,
+                                             const Scenario  *scenario);
+
+static void         xcf_save_setup          (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         xcf_save_run            (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         xcf_save_teardown       (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         xcf_load_setup          (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         xcf_load_run            (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         xcf_load_teardown       (Benchmark       *bench,
+                                             const Scenario  *scenario);
+
+static void         transform_run           (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         flood_fill_run          (Benchmark       *bench,
+                                             const Scenario  *scenario);
+
+static void         convert_indexed_prepare (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         convert_indexed_run     (Benchmark       *bench,
+                                             const Scenario  *scenario);
+static void         work_image_cleanup      (Benchmark       *bench,
+                                             const Scenario  *scenario);
+
+static gboolean     benchmark_selected      (const Scenario  *scenario);
+static void         benchmark_run_scenario  (Benchmark       *bench,
+                                             const Scenario  *scenario,
+                                             Result          *result);
+
+static GHashTable * benchmark_load_baseline (const gchar     *filename,
+                                             GError         **error);
+static gchar      * benchmark_to_json       (const Result    *results,
+                                             gint             n_results);
+static void         benchmark_print_summary (const Result    *results,
+                                             gint             n_results);
+
+
+/*  local variables  */
+
+static gint      option_width      = 1024;
+static gint      option_height     = 1024;
+static gchar    *option_precision  = NULL;
+static gint      option_threads    = 0;
+static gint      option_iterations = 10;
+static gint      option_warmup     = 2;
+static gchar   **option_scenarios  = NULL;
+static gchar    *option_output     = NULL;
+static gchar    *option_baseline   = NULL;
+static gdouble   option_tolerance  = 10.0;
+static gboolean  option_list       = FALSE;
+
+static GimpPrecision precision     = GIMP_PRECISION_U8_NON_LINEAR;
+
+static const GOptionEntry option_entries[] =
+{
+  { "width", 'w', 0,
+    G_OPTION_ARG_INT, &option_width,
+    "Width of the synthetic image (default: 1024)", "PIXELS" },
+  { "height", 'h', 0,
+    G_OPTION_ARG_INT, &option_height,
+    "Height of the synthetic image (default: 1024)", "PIXELS" },
+  { "precision", 'p', 0,
+    G_OPTION_ARG_STRING, &option_precision,
+    "Precision of the synthetic image, e.g. u8-non-linear, u16-linear "
+    "or float-linear (default: u8-non-linear)", "PRECISION" },
+  { "threads", 't', 0,
+    G_OPTION_ARG_INT, &option_threads,
+    "Number of threads to use (default: from gimprc)", "N" },
+  { "iterations", 'n', 0,
+    G_OPTION_ARG_INT, &option_iterations,
+    "Number of timed runs of each scenario (default: 10)", "N" },
+  { "warmup", 0, 0,
+    G_OPTION_ARG_INT, &option_warmup,
+    "Number of untimed runs of each scenario (default: 2)", "N" },
+  { "scenario", 's', 0,
+    G_OPTION_ARG_STRING_ARRAY, &option_scenarios,
+    "Only run scenarios matching PATTERN; may be repeated", "PATTERN" },
+  { "output", 'o', 0,
+    G_OPTION_ARG_FILENAME, &option_output,
+    "Write the results to FILE instead of stdout", "FILE" },
+  { "baseline", 'b', 0,
+    G_OPTION_ARG_FILENAME, &option_baseline,
+    "Compare the results against those in FILE", "FILE" },
+  { "tolerance", 0, 0,
+    G_OPTION_ARG_DOUBLE, &option_tolerance,
+    "Slowdown relative to the baseline, in percent, above which a "
+    "scenario counts as a regression (default: 10)", "PERCENT" },
+  { "list", 'l', 0,
+    G_OPTION_ARG_NONE, &option_list,
+    "List the scenarios and exit", NULL },
+  { NULL }
+};
+
+static const Scenario scenarios[] =
+{
+  { "layer-mode/normal",        GIMP_LAYER_MODE_NORMAL,
+    layer_mode_setup, NULL, layer_mode_run, NULL, graph_teardown },
+  { "layer-mode/multiply",      GIMP_LAYER_MODE_MULTIPLY,
+    layer_mode_setup, NULL, layer_mode_run, NULL, graph_teardown },
+  { "layer-mode/screen",        GIMP_LAYER_MODE_SCREEN,
+    layer_mode_setup, NULL, layer_mode_run, NULL, graph_teardown },
+  { "layer-mode/overlay",       GIMP_LAYER_MODE_OVERLAY,
+    layer_mode_setup, NULL, layer_mode_run, NULL, graph_teardown },
+  { "layer-mode/soft-light",    GIMP_LAYER_MODE_SOFTLIGHT,
+    layer_mode_setup, NULL, layer_mode_run, NULL, graph_teardown },
+  { "layer-mode/dodge",         GIMP_LAYER_MODE_DODGE,
+    layer_mode_setup, NULL, layer_mode_run, NULL, graph_teardown },
+  { "layer-mode/hsv-hue",       GIMP_LAYER_MODE_HSV_HUE,
+    layer_mode_setup, NULL, layer_mode_run, NULL, graph_teardown },
+  { "layer-mode/lch-color",     GIMP_LAYER_MODE_LCH_COLOR,
+    layer_mode_setup, NULL, layer_mode_run, NULL, graph_teardown },
+
+  { "paint/dabs",               0,
+    paint_setup, scratch_prepare, paint_run, NULL, paint_teardown },
+
+  { "gegl-loops/buffer-copy",   0,
+    buffer_copy_setup, NULL, buffer_copy_run, NULL, buffer_teardown },
+  { "gegl-loops/apply-mask",    0,
+    apply_mask_setup, scratch_prepare, apply_mask_run, NULL, buffer_teardown },
+  { "gegl-loops/average-color", 0,
+    NULL, NULL, average_color_run, NULL, NULL },
+
+  { "xcf/save-rle",             FALSE,
+    xcf_save_setup, NULL, xcf_save_run, NULL, xcf_save_teardown },
+  { "xcf/save-zlib",            TRUE,
+    xcf_save_setup, NULL, xcf_save_run, NULL, xcf_save_teardown },
+  { "xcf/load",                 0,
+    xcf_load_setup, NULL, xcf_load_run, work_image_cleanup, xcf_load_teardown },
+
+  { "transform/rotate",         0,
+    NULL, NULL, transform_run, NULL, NULL },
+  { "transform/scale",          1,
+    NULL, NULL, transform_run, NULL, NULL },
+
+  { "flood-fill/contiguous",    0,
+    NULL, NULL, flood_fill_run, NULL, NULL },
+
+  { "convert/indexed",          GIMP_CONVERT_DITHER_NONE,
+    NULL, convert_indexed_prepare, convert_indexed_run, work_image_cleanup,
+    NULL },
+  { "convert/indexed-fs",       GIMP_CONVERT_DITHER_FS,
+    NULL, convert_indexed_prepare, convert_indexed_run, work_image_cleanup,
+    NULL }
+};
+
+
+/*  synthetic content  */
+
+static inline gfloat
+benchmark_noise (gint    x,
+                 gint    y,
+                 guint32 seed)
+{
+  guint32 h = seed ^ ((guint32) x * 0x27d4eb2du) ^ ((guint32) y * 0x165667b1u);
+
+  h ^= h >> 15;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+
+  return (h & 0xffff) / 65535.0f;
+}
+
+/*  fills @buffer with gradients, overlaid with flat blocks and a little
+ *  noise, so that the content is neither trivially compressible nor
+ *  random.  every pixel only depends on its coordinates and @seed.
+ */
+static void
+benchmark_fill (GeglBuffer *buffer,
+                guint32     seed,
+                gboolean    vary_alpha)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+  GeglBufferIterator  *iter;
+
+  iter = gegl_buffer_iterator_new (buffer, NULL, 0,
+                                   babl_format ("R'G'B'A float"),
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE, 1);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi  = &iter->items[0].roi;
+      gfloat              *data = iter->items[0].data;
+      gint                 x, y;
+
+      for (y = roi->y; y < roi->y + roi->height; y++)
+        {
+          for (x = roi->x; x < roi->x + roi->width; x++)
+            {
+              gint   block = (x / BLOCK_SIZE + y / BLOCK_SIZE + seed) % 4;
+              gfloat noise = (benchmark_noise (x, y, seed) - 0.5f) * 0.05f;
+
+              data[0] = (gfloat) x / extent->width;
+              data[1] = (gfloat) y / extent->height;
+              data[2] = block / 3.0f;
+              data[3] = 1.0f;
+
+              if (block == 0)
+                {
+                  data[0] = 0.8f;
+                  data[1] = 0.2f;
+                }
+
+              data[0] = CLAMP (data[0] + noise, 0.0f, 1.0f);
+              data[1] = CLAMP (data[1] + noise, 0.0f, 1.0f);
+              data[2] = CLAMP (data[2] + noise, 0.0f, 1.0f);
+
+              if (vary_alpha)
+                data[3] = 0.25f + 0.75f * benchmark_noise (x / 16, y / 16, seed);
+
+              data += 4;
+            }
+        }
+    }
+}
+
+
+/*  layer modes  */
+
+static void
+layer_mode_setup (Benchmark      *bench,
+                  const Scenario *scenario)
+{
+  GeglNode *source;
+
+  bench->graph = gegl_node_new ();
+
+  bench->node = gegl_node_new_child (bench->graph,
+                                     "operation", "gimp:normal",
+                                     NULL);
+
+  source = gegl_node_new_child (bench->graph,
+                                "operation", "gegl:buffer-source",
+                                "buffer",    bench->top,
+                                NULL);
+
+  gegl_node_connect_to (source,      "output",
+                        bench->node, "aux");
+
+  gimp_gegl_mode_node_set_mode (bench->node,
+                                scenario->data,
+                                GIMP_LAYER_COLOR_SPACE_AUTO,
+                                GIMP_LAYER_COLOR_SPACE_AUTO,
+                                GIMP_LAYER_COMPOSITE_AUTO);
+}
+
+static void
+layer_mode_run (Benchmark      *bench,
+                const Scenario *scenario)
+{
+  gimp_gegl_apply_operation (gimp_drawable_get_buffer (GIMP_DRAWABLE (bench->layer)),
+                             NULL, NULL,
+                             bench->node,
+                             bench->scratch, NULL, FALSE);
+}
+
+static void
+graph_teardown (Benchmark      *bench,
+                const Scenario *scenario)
+{
+  g_clear_object (&bench->graph);
+  bench->node = NULL;
+}
+
+
+/*  painting  */
+
+static void
+paint_setup (Benchmark      *bench,
+             const Scenario *scenario)
+{
+  GimpLayerMode  paint_mode = GIMP_LAYER_MODE_NORMAL;
+  const Babl    *format;
+  GeglBuffer    *buffer;
+  GeglColor     *color;
+  gfloat        *mask;
+  gint           x, y;
+
+  format = gimp_layer_mode_get_format (
+    paint_mode,
+    GIMP_LAYER_COLOR_SPACE_AUTO,
+    GIMP_LAYER_COLOR_SPACE_AUTO,
+    gimp_layer_mode_get_paint_composite_mode (paint_mode),
+    gimp_drawable_get_format (GIMP_DRAWABLE (bench->layer)));
+
+  bench->paint_buf = gimp_temp_buf_new (DAB_SIZE, DAB_SIZE, format);
+
+  buffer = gimp_temp_buf_create_buffer (bench->paint_buf);
+  color  = gegl_color_new ("#d04070");
+  gegl_buffer_set_color (buffer, NULL, color);
+  g_object_unref (color);
+  g_object_unref (buffer);
+
+  /*  a soft round brush  */
+  bench->paint_mask = gimp_temp_buf_new (DAB_SIZE, DAB_SIZE,
+                                         babl_format ("Y float"));
+
+  mask = (gfloat *) gimp_temp_buf_get_data (bench->paint_mask);
+
+  for (y = 0; y < DAB_SIZE; y++)
+    {
+      for (x = 0; x < DAB_SIZE; x++)
+        {
+          gdouble dx = (x + 0.5) / (DAB_SIZE / 2.0) - 1.0;
+          gdouble dy = (y + 0.5) / (DAB_SIZE / 2.0) - 1.0;
+          gdouble r  = sqrt (SQR (dx) + SQR (dy));
+
+          *mask++ = CLAMP (1.0 - r, 0.0, 1.0);
+        }
+    }
+}
+
+static void
+paint_run (Benchmark      *bench,
+           const Scenario *scenario)
+{
+  GimpPaintCoreLoopsParams params = {};
+  gint                     x, y;
+
+  params.paint_buf     = bench->paint_buf;
+  params.paint_mask    = bench->paint_mask;
+  params.src_buffer    = bench->scratch;
+  params.dest_buffer   = bench->scratch;
+  params.paint_opacity = 0.5;
+  params.image_opacity = 1.0;
+  params.paint_mode    = GIMP_LAYER_MODE_NORMAL;
+  params.affect        = GIMP_COMPONENT_MASK_ALL;
+
+  for (y = 0; y + DAB_SIZE <= option_height; y += DAB_SPACING)
+    {
+      for (x = 0; x + DAB_SIZE <= option_width; x += DAB_SPACING)
+        {
+          params.paint_buf_offset_x = x;
+          params.paint_buf_offset_y = y;
+
+          gimp_paint_core_loops_process (
+            &params,
+            GIMP_PAINT_CORE_LOOPS_ALGORITHM_PAINT_MASK_TO_COMP_MASK |
+            GIMP_PAINT_CORE_LOOPS_ALGORITHM_DO_LAYER_BLEND);
+        }
+    }
+}
+
+static void
+paint_teardown (Benchmark      *bench,
+                const Scenario *scenario)
+{
+  g_clear_pointer (&bench->paint_buf,  gimp_temp_buf_unref);
+  g_clear_pointer (&bench->paint_mask, gimp_temp_buf_unref);
+}
+
+/*  restores the scratch buffer to the layer's content, for scenarios
+ *  which modify it in place
+ */
+static void
+scratch_prepare (Benchmark      *bench,
+                 const Scenario *scenario)
+{
+  gimp_gegl_buffer_copy (gimp_drawable_get_buffer (GIMP_DRAWABLE (bench->layer)),
+                         NULL, GEGL_ABYSS_NONE,
+                         bench->scratch, NULL);
+}
+
+
+/*  gegl loops  */
+
+static void
+buffer_copy_setup (Benchmark      *bench,
+                   const Scenario *scenario)
+{
+  const Babl *format = babl_format ("RGBA float");
+
+  /*  copying between buffers of the same format only shares tiles  */
+  if (gimp_drawable_get_format (GIMP_DRAWABLE (bench->layer)) == format)
+    format = babl_format ("R'G'B'A u8");
+
+  bench->buffer = gegl_buffer_new (gegl_buffer_get_extent (bench->scratch),
+                                   format);
+}
+
+static void
+buffer_copy_run (Benchmark      *bench,
+                 const Scenario *scenario)
+{
+  gimp_gegl_buffer_copy (gimp_drawable_get_buffer (GIMP_DRAWABLE (bench->layer)),
+                         NULL, GEGL_ABYSS_NONE,
+                         bench->buffer, NULL);
+}
+
+static void
+apply_mask_setup (Benchmark      *bench,
+                  const Scenario *scenario)
+{
+  GeglBuffer *rgba;
+
+  bench->buffer = gegl_buffer_new (gegl_buffer_get_extent (bench->scratch),
+                                   babl_format ("Y float"));
+
+  rgba = gegl_buffer_new (gegl_buffer_get_extent (bench->scratch),
+                          babl_format ("R'G'B'A float"));
+  benchmark_fill (rgba, SEED + 2, FALSE);
+
+  gegl_buffer_copy (rgba, NULL, GEGL_ABYSS_NONE, bench->buffer, NULL);
+  g_object_unref (rgba);
+}
+
+static void
+apply_mask_run (Benchmark      *bench,
+                const Scenario *scenario)
+{
+  gimp_gegl_apply_mask (bench->buffer, NULL,
+                        bench->scratch, NULL,
+                        1.0);
+}
+
+static void
+average_color_run (Benchmark      *bench,
+                   const Scenario *scenario)
+{
+  gfloat color[4];
+
+  gimp_gegl_average_color (gimp_drawable_get_buffer (GIMP_DRAWABLE (bench->layer)),
+                           NULL, TRUE, GEGL_ABYSS_NONE,
+                           babl_format ("RGBA float"), color);
+}
+
+static void
+buffer_teardown (Benchmark      *bench,
+                 const Scenario *scenario)
+{
+  g_clear_object (&bench->buffer);
+}
+
+
+/*  xcf  */
+
+static void
+xcf_save_setup (Benchmark      *bench,
+                const Scenario *scenario)
+{
+  gimp_image_set_xcf_compression (bench->image, scenario->data);
+}
+
+static void
+xcf_save_run (Benchmark      *bench,
+              const Scenario *scenario)
+{
+  GOutputStream *output = g_memory_output_stream_new_resizable ();
+  GError        *error  = NULL;
+
+  xcf_save_stream (bench->gimp, bench->image, output, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  g_object_unref (output);
+}
+
+static void
+xcf_save_teardown (Benchmark      *bench,
+                   const Scenario *scenario)
+{
+  gimp_image_set_xcf_compression (bench->image, FALSE);
+}
+
+static void
+xcf_load_setup (Benchmark      *bench,
+                const Scenario *scenario)
+{
+  GOutputStream *output = g_memory_output_stream_new_resizable ();
+  GError        *error  = NULL;
+
+  xcf_save_stream (bench->gimp, bench->image, output, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  bench->xcf = g_memory_output_stream_steal_as_bytes (
+    G_MEMORY_OUTPUT_STREAM (output));
+
+  g_object_unref (output);
+}
+
+static void
+xcf_load_run (Benchmark      *bench,
+              const Scenario *scenario)
+{
+  GInputStream *input = g_memory_input_stream_new_from_bytes (bench->xcf);
+  GError       *error = NULL;
+
+  bench->work_image = xcf_load_stream (bench->gimp, input, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  g_object_unref (input);
+}
+
+static void
+xcf_load_teardown (Benchmark      *bench,
+                   const Scenario *scenario)
+{
+  g_clear_pointer (&bench->xcf, g_bytes_unref);
+}
+
+
+/*  transforms  */
+
+static void
+transform_run (Benchmark      *bench,
+               const Scenario *scenario)
+{
+  GimpDrawable     *drawable = GIMP_DRAWABLE (bench->layer);
+  GimpMatrix3       matrix;
+  GimpColorProfile *profile;
+  GeglBuffer       *buffer;
+  gint              offset_x;
+  gint              offset_y;
+
+  gimp_matrix3_identity (&matrix);
+  gimp_matrix3_translate (&matrix, -option_width / 2.0, -option_height / 2.0);
+
+  if (scenario->data == 0)
+    gimp_matrix3_rotate (&matrix, gimp_deg_to_rad (30.0));
+  else
+    gimp_matrix3_scale (&matrix, 0.6, 0.6);
+
+  gimp_matrix3_translate (&matrix, option_width / 2.0, option_height / 2.0);
+
+  buffer = gimp_drawable_transform_buffer_affine (drawable,
+                                                  bench->context,
+                                                  gimp_drawable_get_buffer (drawable),
+                                                  0, 0,
+                                                  &matrix,
+                                                  GIMP_TRANSFORM_FORWARD,
+                                                  GIMP_INTERPOLATION_CUBIC,
+                                                  GIMP_TRANSFORM_RESIZE_ADJUST,
+                                                  &profile,
+                                                  &offset_x, &offset_y,
+                                                  NULL);
+
+  g_object_unref (buffer);
+}
+
+
+/*  flood fill  */
+
+static void
+flood_fill_run (Benchmark      *bench,
+                const Scenario *scenario)
+{
+  GeglBuffer *mask;
+
+  mask = gimp_pickable_contiguous_region_by_seed (GIMP_PICKABLE (bench->layer),
+                                                  TRUE, 0.2, FALSE,
+                                                  GIMP_SELECT_CRITERION_COMPOSITE,
+                                                  FALSE,
+                                                  option_width  / 2,
+                                                  option_height / 2);
+
+  g_object_unref (mask);
+}
+
+
+/*  indexed conversion  */
+
+static void
+convert_indexed_prepare (Benchmark      *bench,
+                         const Scenario *scenario)
+{
+  bench->work_image = gimp_image_duplicate (bench->image);
+
+  gimp_image_undo_disable (bench->work_image);
+
+  /*  indexed images are always 8-bit  */
+  if (gimp_image_get_precision (bench->work_image) !=
+      GIMP_PRECISION_U8_NON_LINEAR)
+    {
+      gimp_image_convert_precision (bench->work_image,
+                                    GIMP_PRECISION_U8_NON_LINEAR,
+                                    GEGL_DITHER_NONE,
+                                    GEGL_DITHER_NONE,
+                                    GEGL_DITHER_NONE,
+                                    NULL);
+    }
+}
+
+static void
+convert_indexed_run (Benchmark      *bench,
+                     const Scenario *scenario)
+{
+  GError *error = NULL;
+
+  gimp_image_convert_indexed (bench->work_image,
+                              GIMP_CONVERT_PALETTE_GENERATE, 256,
+                              FALSE, scenario->data, FALSE, FALSE,
+                              NULL, NULL, &error);
+  g_assert_no_error (error);
+}
+
+static void
+work_image_cleanup (Benchmark      *bench,
+                    const Scenario *scenario)
+{
+  g_clear_object (&bench->work_image);
+}
+
+
+/*  running  */
+
+static gboolean
+benchmark_selected (const Scenario *scenario)
+{
+  gint i;
+
+  if (! option_scenarios)
+    return TRUE;
+
+  for (i = 0; option_scenarios[i]; i++)
+    {
+      if (g_pattern_match_simple (option_scenarios[i], scenario->name))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gint
+benchmark_compare_samples (const void *a,
+                           const void *b)
+{
+  gdouble x = *(const gdouble *) a;
+  gdouble y = *(const gdouble *) b;
+
+  return (x > y) - (x < y);
+}
+
+static void
+benchmark_run_scenario (Benchmark      *bench,
+                        const Scenario *scenario,
+                        Result         *result)
+{
+  gdouble sum = 0.0;
+  gint    i;
+
+  if (scenario->setup)
+    scenario->setup (bench, scenario);
+
+  result->scenario  = scenario;
+  result->samples   = g_new (gdouble, option_iterations);
+  result->n_samples = option_iterations;
+
+  for (i = -option_warmup; i < option_iterations; i++)
+    {
+      gint64 start;
+      gint64 end;
+
+      if (scenario->prepare)
+        scenario->prepare (bench, scenario);
+
+      start = g_get_monotonic_time ();
+
+      scenario->run (bench, scenario);
+
+      end = g_get_monotonic_time ();
+
+      if (scenario->cleanup)
+        scenario->cleanup (bench, scenario);
+
+      if (i >= 0)
+        result->samples[i] = (end - start) / 1000.0;
+    }
+
+  if (scenario->teardown)
+    scenario->teardown (bench, scenario);
+
+  qsort (result->samples, result->n_samples, sizeof (gdouble),
+         benchmark_compare_samples);
+
+  for (i = 0; i < result->n_samples; i++)
+    sum += result->samples[i];
+
+  result->median = gimp_test_utils_percentile (result->samples,
+                                               result->n_samples, 50.0);
+  result->p10    = gimp_test_utils_percentile (result->samples,
+                                               result->n_samples, 10.0);
+  result->p90    = gimp_test_utils_percentile (result->samples,
+                                               result->n_samples, 90.0);
+  result->min    = result->samples[0];
+  result->max    = result->samples[result->n_samples - 1];
+  result->mean   = sum / result->n_samples;
+
+  if (result->median > 0.0)
+    {
+      result->throughput = ((gdouble) option_width * option_height / 1e6) /
+                           (result->median / 1000.0);
+    }
+}
+
+
+/*  baseline and output  */
+
+/*  returns a table of scenario names to their median, in milliseconds  */
+static GHashTable *
+benchmark_load_baseline (const gchar  *filename,
+                         GError      **error)
+{
+  JsonParser *parser = json_parser_new ();
+  JsonObject *root;
+  JsonArray  *results;
+  GHashTable *baseline;
+  guint       i;
+
+  if (! json_parser_load_from_file (parser, filename, error))
+    {
+      g_object_unref (parser);
+
+      return NULL;
+    }
+
+  if (! JSON_NODE_HOLDS_OBJECT (json_parser_get_root (parser)) ||
+      ! json_object_has_member (
+          json_node_get_object (json_parser_get_root (parser)), "results"))
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   "'%s' is not a benchmark result file", filename);
+      g_object_unref (parser);
+
+      return NULL;
+    }
+
+  root    = json_node_get_object (json_parser_get_root (parser));
+  results = json_object_get_array_member (root, "results");
+
+  if (json_object_get_int_member (root, "width")  != option_width  ||
+      json_object_get_int_member (root, "height") != option_height ||
+      g_strcmp0 (json_object_get_string_member (root, "precision"),
+                 option_precision)                != 0             ||
+      json_object_get_int_member (root, "threads")   != option_threads)
+    {
+      g_printerr ("Warning: the baseline was recorded with different "
+                  "parameters, the comparison may be meaningless.\n");
+    }
+
+  baseline = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                    g_free, g_free);
+
+  for (i = 0; i < json_array_get_length (results); i++)
+    {
+      JsonObject *result = json_array_get_object_element (results, i);
+      gdouble     median = json_object_get_double_member (result, "median");
+
+      g_hash_table_insert (baseline,
+                           g_strdup (json_object_get_string_member (result,
+                                                                    "scenario")),
+                           g_memdup (&median, sizeof (median)));
+    }
+
+  g_object_unref (parser);
+
+  return baseline;
+}
+
+static gchar *
+benchmark_to_json (const Result *results,
+                   gint          n_results)
+{
+  JsonBuilder   *builder = json_builder_new ();
+  JsonGenerator *generator;
+  JsonNode      *root;
+  gchar         *json;
+  gint           i;
+
+  json_builder_begin_object (builder);
+
+  json_builder_set_member_name (builder, "version");
+  json_builder_add_int_value   (builder, BENCHMARK_VERSION);
+  json_builder_set_member_name (builder, "gimp-version");
+  json_builder_add_string_value (builder, GIMP_VERSION);
+  json_builder_set_member_name (builder, "width");
+  json_builder_add_int_value   (builder, option_width);
+  json_builder_set_member_name (builder, "height");
+  json_builder_add_int_value   (builder, option_height);
+  json_builder_set_member_name (builder, "precision");
+  json_builder_add_string_value (builder, option_precision);
+  json_builder_set_member_name (builder, "threads");
+  json_builder_add_int_value   (builder, option_threads);
+  json_builder_set_member_name (builder, "iterations");
+  json_builder_add_int_value   (builder, option_iterations);
+  json_builder_set_member_name (builder, "warmup");
+  json_builder_add_int_value   (builder, option_warmup);
+
+  json_builder_set_member_name (builder, "results");
+  json_builder_begin_array (builder);
+
+  for (i = 0; i < n_results; i++)
+    {
+      const Result *result = &results[i];
+      gint          j;
+
+      json_builder_begin_object (builder);
+
+      json_builder_set_member_name  (builder, "scenario");
+      json_builder_add_string_value (builder, result->scenario->name);
+      json_builder_set_member_name  (builder, "median");
+      json_builder_add_double_value (builder, result->median);
+      json_builder_set_member_name  (builder, "p10");
+      json_builder_add_double_value (builder, result->p10);
+      json_builder_set_member_name  (builder, "p90");
+      json_builder_add_double_value (builder, result->p90);
+      json_builder_set_member_name  (builder, "min");
+      json_builder_add_double_value (builder, result->min);
+      json_builder_set_member_name  (builder, "max");
+      json_builder_add_double_value (builder, result->max);
+      json_builder_set_member_name  (builder, "mean");
+      json_builder_add_double_value (builder, result->mean);
+      json_builder_set_member_name  (builder, "megapixels-per-second");
+      json_builder_add_double_value (builder, result->throughput);
+
+      if (result->has_baseline)
+        {
+          json_builder_set_member_name  (builder, "baseline-median");
+          json_builder_add_double_value (builder, result->baseline);
+          json_builder_set_member_name  (builder, "change-percent");
+          json_builder_add_double_value (builder, result->change);
+        }
+
+      json_builder_set_member_name (builder, "samples");
+      json_builder_begin_array (builder);
+
+      for (j = 0; j < result->n_samples; j++)
+        json_builder_add_double_value (builder, result->samples[j]);
+
+      json_builder_end_array (builder);
+
+      json_builder_end_object (builder);
+    }
+
+  json_builder_end_array (builder);
+
+  json_builder_end_object (builder);
+
+  root      = json_builder_get_root (builder);
+  generator = json_generator_new ();
+
+  json_generator_set_pretty (generator, TRUE);
+  json_generator_set_root (generator, root);
+
+  json = json_generator_to_data (generator, NULL);
+
+  json_node_unref (root);
+  g_object_unref (generator);
+  g_object_unref (builder);
+
+  return json;
+}
+
+static void
+benchmark_print_summary (const Result *results,
+                         gint          n_results)
+{
+  gint i;
+
+  g_printerr ("%-26s %10s %10s %10s %10s\n",
+              "scenario", "median", "p10", "p90", "Mpx/s");
+
+  for (i = 0; i < n_results; i++)
+    {
+      const Result *result = &results[i];
+
+      g_printerr ("%-26s %8.2fms %8.2fms %8.2fms %10.1f",
+                  result->scenario->name,
+                  result->median, result->p10, result->p90,
+                  result->throughput);
+
+      if (result->has_baseline)
+        {
+          g_printerr ("  %+6.1f%%%s",
+                      result->change,
+                      result->change > option_tolerance ? "  REGRESSION" : "");
+        }
+
+      g_printerr ("\n");
+    }
+}
+
+
+int
+main (int    argc,
+      char **argv)
+{
+  GOptionContext *context;
+  Benchmark       bench    = { 0, };
+  Result         *results;
+  gint            n_results = 0;
+  GHashTable     *baseline = NULL;
+  GEnumClass     *enum_class;
+  GEnumValue     *enum_value;
+  const Babl     *format;
+  GeglRectangle   extent;
+  gchar          *json;
+  GError         *error    = NULL;
+  gint            n_regressions = 0;
+  gint            i;
+
+  context = g_option_context_new (NULL);
+  g_option_context_set_summary (context,
+                                "Benchmarks core image operations of GIMP.");
+  g_option_context_add_main_entries (context, option_entries, NULL);
+
+  if (! g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+
+      return EXIT_FAILURE;
+    }
+
+  g_option_context_free (context);
+
+  if (option_list)
+    {
+      for (i = 0; i < G_N_ELEMENTS (scenarios); i++)
+        {
+          if (benchmark_selected (&scenarios[i]))
+            g_print ("%s\n", scenarios[i].name);
+        }
+
+      return EXIT_SUCCESS;
+    }
+
+  if (option_width < DAB_SIZE || option_height < DAB_SIZE ||
+      option_iterations < 1   || option_warmup < 0)
+    {
+      g_printerr ("The image must be at least %dx%d pixels, with at least "
+                  "one iteration.\n", DAB_SIZE, DAB_SIZE);
+
+      return EXIT_FAILURE;
+    }
+
+  if (! option_precision)
+    option_precision = g_strdup ("u8-non-linear");
+
+  enum_class = g_type_class_ref (GIMP_TYPE_PRECISION);
+  enum_value = g_enum_get_value_by_nick (enum_class, option_precision);
+
+  if (! enum_value)
+    {
+      g_printerr ("Unknown precision '%s'.\n", option_precision);
+
+      return EXIT_FAILURE;
+    }
+
+  precision = enum_value->value;
+  g_type_class_unref (enum_class);
+
+  gimp_test_utils_set_gimp3_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  bench.gimp = gimp_init_for_testing ();
+
+  if (option_threads > 0)
+    g_object_set (bench.gimp->config, "num-processors", option_threads, NULL);
+
+  option_threads = GIMP_GEGL_CONFIG (bench.gimp->config)->num_processors;
+
+  if (option_baseline)
+    {
+      baseline = benchmark_load_baseline (option_baseline, &error);
+
+      if (! baseline)
+        {
+          g_printerr ("Could not load the baseline: %s\n", error->message);
+
+          return EXIT_FAILURE;
+        }
+    }
+
+  /*  the synthetic image  */
+  bench.context = gimp_get_user_context (bench.gimp);
+  bench.image   = gimp_image_new (bench.gimp, option_width, option_height,
+                                  GIMP_RGB, precision);
+
+  gimp_image_undo_disable (bench.image);
+
+  format      = gimp_image_get_layer_format (bench.image, TRUE);
+  bench.layer = gimp_layer_new (bench.image, option_width, option_height,
+                                format, "Benchmark",
+                                GIMP_OPACITY_OPAQUE, GIMP_LAYER_MODE_NORMAL);
+
+  gimp_image_add_layer (bench.image, bench.layer,
+                        GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  benchmark_fill (gimp_drawable_get_buffer (GIMP_DRAWABLE (bench.layer)),
+                  SEED, FALSE);
+
+  extent = *gegl_buffer_get_extent (gimp_drawable_get_buffer (GIMP_DRAWABLE (bench.layer)));
+
+  bench.top     = gegl_buffer_new (&extent, format);
+  bench.scratch = gegl_buffer_new (&extent, format);
+
+  benchmark_fill (bench.top, SEED + 1, TRUE);
+
+  /*  run  */
+  results = g_new0 (Result, G_N_ELEMENTS (scenarios));
+
+  for (i = 0; i < G_N_ELEMENTS (scenarios); i++)
+    {
+      Result *result = &results[n_results];
+
+      if (! benchmark_selected (&scenarios[i]))
+        continue;
+
+      g_printerr ("Running %s...\n", scenarios[i].name);
+
+      benchmark_run_scenario (&bench, &scenarios[i], result);
+
+      if (baseline)
+        {
+          const gdouble *median = g_hash_table_lookup (baseline,
+                                                       scenarios[i].name);
+
+          if (median && *median > 0.0)
+            {
+              result->has_baseline = TRUE;
+              result->baseline     = *median;
+              result->change       = 100.0 * (result->median - *median) /
+                                     *median;
+
+              if (result->change > option_tolerance)
+                n_regressions++;
+            }
+        }
+
+      n_results++;
+    }
+
+  benchmark_print_summary (results, n_results);
+
+  json = benchmark_to_json (results, n_results);
+
+  if (option_output)
+    {
+      if (! g_file_set_contents (option_output, json, -1, &error))
+        {
+          g_printerr ("Could not write the results: %s\n", error->message);
+          g_clear_error (&error);
+        }
+    }
+  else
+    {
+      g_print ("%s\n", json);
+    }
+
+  g_free (json);
+
+  for (i = 0; i < n_results; i++)
+    g_free (results[i].samples);
+
+  g_free (results);
+
+  if (baseline)
+    g_hash_table_unref (baseline);
+
+  g_object_unref (bench.top);
+  g_object_unref (bench.scratch);
+  g_object_unref (bench.image);
+
+  /*  don't write files to the source dir  */
+  gimp_test_utils_set_gimp3_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (bench.gimp, TRUE);
+
+  if (n_regressions > 0)
+    {
+      g_printerr ("%d scenario(s) regressed by more than %g%%.\n",
+                  n_regressions, option_tolerance);
+
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,845 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * benchmark-paint.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*  Replays paint strokes through the paint cores of all paint methods,
+ *  and reports the latency of each input event and of each dab as JSON.
+ *
+ *  Strokes are recorded by running GIMP with GIMP_PAINT_RECORD set to
+ *  a file name, and painting normally:
+ *
+ *    GIMP_PAINT_RECORD=strokes.txt gimp
+ *    benchmark-paint --record=strokes.txt --dynamics="Pressure Size" \
+ *                    --symmetry=mandala --output=paint.json
+ *
+ *  Without --record, a few synthetic strokes covering the whole range
+ *  of pressure, tilt and velocity are replayed instead.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+#include <json-glib/json-glib.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpmath/gimpmath.h"
+
+#include "paint/paint-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "gegl/gimp-gegl-loops.h"
+
+#include "core/gimp.h"
+#include "core/gimpcontainer.h"
+#include "core/gimpcontext.h"
+#include "core/gimpdatafactory.h"
+#include "core/gimpdynamics.h"
+#include "core/gimpimage.h"
+#include "core/gimpimage-symmetry.h"
+#include "core/gimpimage-undo.h"
+#include "core/gimplayer.h"
+#include "core/gimplayer-new.h"
+#include "core/gimppaintinfo.h"
+#include "core/gimpsymmetry-mandala.h"
+#include "core/gimpsymmetry-mirror.h"
+#include "core/gimpsymmetry-tiling.h"
+
+#include "paint/gimp-paint-record.h"
+#include "paint/gimpmybrushcore.h"
+#include "paint/gimppaintcore.h"
+#include "paint/gimppaintoptions.h"
+#include "paint/gimpsourcecore.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define BENCHMARK_VERSION  1
+#define EVENT_INTERVAL     8    /* ms between synthetic events, as a 125Hz tablet */
+#define N_SYNTHETIC_EVENTS 400
+
+
+typedef struct _Method Method;
+
+struct _Method
+{
+  const gchar *paint_info;
+
+  gboolean     skipped;
+  gchar       *skip_reason;
+
+  GArray      *event_times;  /*  gint64, microseconds  */
+  GArray      *dab_times;    /*  gint64, microseconds  */
+  gint64       total_time;
+};
+
+
+/*  local function prototypes  */
+
+static GList     * benchmark_synthetic_strokes (void);
+static gboolean    benchmark_replay            (Gimp            *gimp,
+                                                GimpLayer       *layer,
+                                                GeglBuffer      *pristine,
+                                                GList           *strokes,
+                                                Method          *method,
+                                                GError         **error);
+static void        benchmark_add_stats         (JsonBuilder     *builder,
+                                                const gchar     *name,
+                                                GArray          *times);
+static gchar     * benchmark_to_json           (Method          *methods,
+                                                gint             n_methods,
+                                                gint             n_strokes);
+static void        benchmark_print_summary     (Method          *methods,
+                                                gint             n_methods);
+
+
+/*  local variables  */
+
+static gint      option_width      = 2048;
+static gint      option_height     = 2048;
+static gchar    *option_precision  = NULL;
+static gint      option_threads    = 0;
+static gint      option_iterations = 3;
+static gchar   **option_records    = NULL;
+static gchar   **option_methods    = NULL;
+static gchar    *option_dynamics   = NULL;
+static gchar    *option_symmetry   = NULL;
+static gdouble   option_brush_size = 51.0;
+static gchar    *option_output     = NULL;
+
+static const GOptionEntry option_entries[] =
+{
+  { "width", 'w', 0,
+    G_OPTION_ARG_INT, &option_width,
+    "Width of the canvas (default: 2048)", "PIXELS" },
+  { "height", 'h', 0,
+    G_OPTION_ARG_INT, &option_height,
+    "Height of the canvas (default: 2048)", "PIXELS" },
+  { "precision", 'p', 0,
+    G_OPTION_ARG_STRING, &option_precision,
+    "Precision of the canvas, e.g. u8-non-linear or float-linear "
+    "(default: u8-non-linear)", "PRECISION" },
+  { "threads", 't', 0,
+    G_OPTION_ARG_INT, &option_threads,
+    "Number of threads to use (default: from gimprc)", "N" },
+  { "iterations", 'n', 0,
+    G_OPTION_ARG_INT, &option_iterations,
+    "Number of times to replay the strokes (default: 3)", "N" },
+  { "record", 'r', 0,
+    G_OPTION_ARG_FILENAME_ARRAY, &option_records,
+    "Replay the strokes recorded in FILE; may be repeated", "FILE" },
+  { "method", 'm', 0,
+    G_OPTION_ARG_STRING_ARRAY, &option_methods,
+    "Only replay with paint methods matching PATTERN, e.g. gimp-clone; "
+    "may be repeated", "PATTERN" },
+  { "dynamics", 'd', 0,
+    G_OPTION_ARG_STRING, &option_dynamics,
+    "Name of the paint dynamics to use (default: the standard dynamics)",
+    "NAME" },
+  { "symmetry", 's', 0,
+    G_OPTION_ARG_STRING, &option_symmetry,
+    "Symmetry to paint with: none, mirror, tiling or mandala "
+    "(default: none)", "SYMMETRY" },
+  { "brush-size", 0, 0,
+    G_OPTION_ARG_DOUBLE, &option_brush_size,
+    "Brush size (default: 51)", "PIXELS" },
+  { "output", 'o', 0,
+    G_OPTION_ARG_FILENAME, &option_output,
+    "Write the results to FILE instead of stdout", "FILE" },
+  { NULL }
+};
+
+static const gchar * const paint_methods[] =
+{
+  "gimp-paintbrush",
+  "gimp-pencil",
+  "gimp-airbrush",
+  "gimp-smudge",
+  "gimp-heal",
+  "gimp-clone",
+  "gimp-mybrush",
+  "gimp-ink"
+};
+
+
+/*  strokes  */
+
+/*  a spiral, a zig-zag and a fast straight flick, with pressure, tilt
+ *  and velocity sweeping their ranges
+ */
+static GList *
+benchmark_synthetic_strokes (void)
+{
+  const GimpCoords default_coords = GIMP_COORDS_DEFAULT_VALUES;
+  GList           *strokes        = NULL;
+  gint             s;
+
+  for (s = 0; s < 3; s++)
+    {
+      GimpPaintRecordStroke *stroke = g_slice_new (GimpPaintRecordStroke);
+      gint                   i;
+
+      stroke->paint_info = g_strdup ("gimp-paintbrush");
+      stroke->events     = g_array_new (FALSE, FALSE,
+                                        sizeof (GimpPaintRecordEvent));
+
+      for (i = 0; i < N_SYNTHETIC_EVENTS; i++)
+        {
+          GimpPaintRecordEvent  event;
+          GimpCoords           *coords = &event.coords;
+          gdouble               t      = (gdouble) i / (N_SYNTHETIC_EVENTS - 1);
+
+          *coords = default_coords;
+
+          switch (s)
+            {
+            case 0:
+              coords->x = option_width  * (0.5 + 0.4 * t * cos (8 * G_PI * t));
+              coords->y = option_height * (0.5 + 0.4 * t * sin (8 * G_PI * t));
+              break;
+
+            case 1:
+              coords->x = option_width  * (0.1 + 0.8 * t);
+              coords->y = option_height * (0.2 + 0.1 * fabs (fmod (t * 20, 2.0) - 1.0));
+              break;
+
+            case 2:
+              coords->x = option_width  * (0.1 + 0.8 * t * t);
+              coords->y = option_height * (0.9 - 0.8 * t * t);
+              break;
+            }
+
+          coords->pressure  = sin (G_PI * t);
+          coords->xtilt     = cos (2 * G_PI * t);
+          coords->ytilt     = sin (2 * G_PI * t);
+          coords->velocity  = s == 2 ? t : 0.5 * (1.0 - cos (4 * G_PI * t));
+          coords->direction = t;
+
+          event.time = i * EVENT_INTERVAL;
+
+          g_array_append_val (stroke->events, event);
+        }
+
+      strokes = g_list_prepend (strokes, stroke);
+    }
+
+  return g_list_reverse (strokes);
+}
+
+
+/*  replaying  */
+
+static gboolean
+benchmark_replay (Gimp        *gimp,
+                  GimpLayer   *layer,
+                  GeglBuffer  *pristine,
+                  GList       *strokes,
+                  Method      *method,
+                  GError     **error)
+{
+  GimpDrawable     *drawable = GIMP_DRAWABLE (layer);
+  GimpPaintInfo    *paint_info;
+  GimpPaintOptions *options;
+  GimpPaintCore    *core;
+  GList            *list;
+  gint              i;
+
+  paint_info = GIMP_PAINT_INFO (
+    gimp_container_get_child_by_name (gimp->paint_info_list,
+                                      method->paint_info));
+
+  if (! paint_info)
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   "no such paint method");
+      return FALSE;
+    }
+
+  if (paint_info->paint_type == GIMP_TYPE_MYBRUSH_CORE &&
+      ! gimp_context_get_mybrush (gimp_get_user_context (gimp)))
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   "no MyPaint brushes installed");
+      return FALSE;
+    }
+
+  options = gimp_paint_options_new (paint_info);
+
+  gimp_context_define_properties (GIMP_CONTEXT (options),
+                                  GIMP_CONTEXT_PROP_MASK_PAINT,
+                                  FALSE);
+  gimp_context_set_parent (GIMP_CONTEXT (options),
+                           gimp_get_user_context (gimp));
+
+  g_object_set (options,
+                "brush-size", option_brush_size,
+                NULL);
+
+  /*  clone and heal from the canvas itself, shifted by a quarter  */
+  if (g_type_is_a (paint_info->paint_type, GIMP_TYPE_SOURCE_CORE))
+    {
+      core = g_object_new (paint_info->paint_type,
+                           "undo-desc",    paint_info->blurb,
+                           "src-drawable", drawable,
+                           "src-x",        option_width  / 4,
+                           "src-y",        option_height / 4,
+                           NULL);
+    }
+  else
+    {
+      core = g_object_new (paint_info->paint_type,
+                           "undo-desc", paint_info->blurb,
+                           NULL);
+    }
+
+  core->dab_times = method->dab_times;
+
+  for (i = 0; i < option_iterations; i++)
+    {
+      /*  start from the same pixels every time, which matters to smudge
+       *  and heal
+       */
+      gimp_gegl_buffer_copy (pristine, NULL, GEGL_ABYSS_NONE,
+                             gimp_drawable_get_buffer (drawable), NULL);
+
+      for (list = strokes; list; list = g_list_next (list))
+        {
+          GimpPaintRecordStroke *stroke = list->data;
+          GimpPaintRecordEvent  *events;
+          gint64                 stroke_start;
+          gint64                 start;
+          gint64                 duration;
+          guint                  j;
+
+          if (stroke->events->len == 0)
+            continue;
+
+          events = (GimpPaintRecordEvent *) stroke->events->data;
+
+          stroke_start = g_get_monotonic_time ();
+
+          if (! gimp_paint_core_start (core, drawable, options,
+                                       &events[0].coords, error))
+            {
+              core->dab_times = NULL;
+              g_object_unref (core);
+              g_object_unref (options);
+
+              return FALSE;
+            }
+
+          core->last_coords = events[0].coords;
+
+          gimp_paint_core_paint (core, drawable, options,
+                                 GIMP_PAINT_STATE_INIT, events[0].time);
+
+          start = g_get_monotonic_time ();
+
+          gimp_paint_core_paint (core, drawable, options,
+                                 GIMP_PAINT_STATE_MOTION, events[0].time);
+
+          duration = g_get_monotonic_time () - start;
+          g_array_append_val (method->event_times, duration);
+
+          for (j = 1; j < stroke->events->len; j++)
+            {
+              start = g_get_monotonic_time ();
+
+              gimp_paint_core_interpolate (core, drawable, options,
+                                           &events[j].coords,
+                                           events[j].time);
+
+              duration = g_get_monotonic_time () - start;
+              g_array_append_val (method->event_times, duration);
+            }
+
+          gimp_paint_core_paint (core, drawable, options,
+                                 GIMP_PAINT_STATE_FINISH,
+                                 events[stroke->events->len - 1].time);
+
+          gimp_paint_core_finish (core, drawable, FALSE);
+
+          gimp_paint_core_cleanup (core);
+
+          method->total_time += g_get_monotonic_time () - stroke_start;
+        }
+    }
+
+  core->dab_times = NULL;
+
+  g_object_unref (core);
+  g_object_unref (options);
+
+  return TRUE;
+}
+
+
+/*  output  */
+
+static gint
+benchmark_compare_times (const void *a,
+                         const void *b)
+{
+  gint64 x = *(const gint64 *) a;
+  gint64 y = *(const gint64 *) b;
+
+  return (x > y) - (x < y);
+}
+
+/*  percentile of the sorted @times, in milliseconds  */
+static gdouble
+benchmark_percentile (GArray  *times,
+                      gdouble  percentile)
+{
+  gdouble *samples = g_new (gdouble, times->len);
+  gdouble  result;
+  guint    i;
+
+  for (i = 0; i < times->len; i++)
+    samples[i] = g_array_index (times, gint64, i) / 1000.0;
+
+  result = gimp_test_utils_percentile (samples, times->len, percentile);
+
+  g_free (samples);
+
+  return result;
+}
+
+static void
+benchmark_add_stats (JsonBuilder *builder,
+                     const gchar *name,
+                     GArray      *times)
+{
+  gdouble sum = 0.0;
+  guint   i;
+
+  json_builder_set_member_name (builder, name);
+  json_builder_begin_object (builder);
+
+  json_builder_set_member_name (builder, "count");
+  json_builder_add_int_value   (builder, times->len);
+
+  if (times->len > 0)
+    {
+      for (i = 0; i < times->len; i++)
+        sum += g_array_index (times, gint64, i) / 1000.0;
+
+      json_builder_set_member_name  (builder, "mean");
+      json_builder_add_double_value (builder, sum / times->len);
+      json_builder_set_member_name  (builder, "median");
+      json_builder_add_double_value (builder, benchmark_percentile (times, 50.0));
+      json_builder_set_member_name  (builder, "p90");
+      json_builder_add_double_value (builder, benchmark_percentile (times, 90.0));
+      json_builder_set_member_name  (builder, "p99");
+      json_builder_add_double_value (builder, benchmark_percentile (times, 99.0));
+      json_builder_set_member_name  (builder, "max");
+      json_builder_add_double_value (builder, benchmark_percentile (times, 100.0));
+    }
+
+  json_builder_end_object (builder);
+}
+
+static gchar *
+benchmark_to_json (Method *methods,
+                   gint    n_methods,
+                   gint    n_strokes)
+{
+  JsonBuilder   *builder = json_builder_new ();
+  JsonGenerator *generator;
+  JsonNode      *root;
+  gchar         *json;
+  gint           i;
+
+  json_builder_begin_object (builder);
+
+  json_builder_set_member_name  (builder, "version");
+  json_builder_add_int_value    (builder, BENCHMARK_VERSION);
+  json_builder_set_member_name  (builder, "gimp-version");
+  json_builder_add_string_value (builder, GIMP_VERSION);
+  json_builder_set_member_name  (builder, "width");
+  json_builder_add_int_value    (builder, option_width);
+  json_builder_set_member_name  (builder, "height");
+  json_builder_add_int_value    (builder, option_height);
+  json_builder_set_member_name  (builder, "precision");
+  json_builder_add_string_value (builder, option_precision);
+  json_builder_set_member_name  (builder, "threads");
+  json_builder_add_int_value    (builder, option_threads);
+  json_builder_set_member_name  (builder, "iterations");
+  json_builder_add_int_value    (builder, option_iterations);
+  json_builder_set_member_name  (builder, "strokes");
+  json_builder_add_int_value    (builder, n_strokes);
+  json_builder_set_member_name  (builder, "dynamics");
+  json_builder_add_string_value (builder, option_dynamics);
+  json_builder_set_member_name  (builder, "symmetry");
+  json_builder_add_string_value (builder, option_symmetry);
+  json_builder_set_member_name  (builder, "brush-size");
+  json_builder_add_double_value (builder, option_brush_size);
+
+  json_builder_set_member_name (builder, "results");
+  json_builder_begin_array (builder);
+
+  for (i = 0; i < n_methods; i++)
+    {
+      Method *method = &methods[i];
+
+      json_builder_begin_object (builder);
+
+      json_builder_set_member_name  (builder, "method");
+      json_builder_add_string_value (builder, method->paint_info);
+
+      if (method->skipped)
+        {
+          json_builder_set_member_name  (builder, "skipped");
+          json_builder_add_string_value (builder, method->skip_reason);
+        }
+      else
+        {
+          json_builder_set_member_name  (builder, "total");
+          json_builder_add_double_value (builder,
+                                         method->total_time / 1000.0 /
+                                         option_iterations);
+
+          benchmark_add_stats (builder, "events", method->event_times);
+          benchmark_add_stats (builder, "dabs",   method->dab_times);
+        }
+
+      json_builder_end_object (builder);
+    }
+
+  json_builder_end_array (builder);
+
+  json_builder_end_object (builder);
+
+  root      = json_builder_get_root (builder);
+  generator = json_generator_new ();
+
+  json_generator_set_pretty (generator, TRUE);
+  json_generator_set_root (generator, root);
+
+  json = json_generator_to_data (generator, NULL);
+
+  json_node_unref (root);
+  g_object_unref (generator);
+  g_object_unref (builder);
+
+  return json;
+}
+
+static void
+benchmark_print_summary (Method *methods,
+                         gint    n_methods)
+{
+  gint i;
+
+  g_printerr ("%-16s %10s %10s %10s %10s %10s\n",
+              "method", "stroke", "event p50", "event p99", "dab p50",
+              "dab p99");
+
+  for (i = 0; i < n_methods; i++)
+    {
+      Method *method = &methods[i];
+
+      if (method->skipped)
+        {
+          g_printerr ("%-16s skipped: %s\n",
+                      method->paint_info, method->skip_reason);
+        }
+      else
+        {
+          g_printerr ("%-16s %8.1fms %8.3fms %8.3fms %8.3fms %8.3fms\n",
+                      method->paint_info,
+                      method->total_time / 1000.0 / option_iterations,
+                      benchmark_percentile (method->event_times, 50.0),
+                      benchmark_percentile (method->event_times, 99.0),
+                      benchmark_percentile (method->dab_times,   50.0),
+                      benchmark_percentile (method->dab_times,   99.0));
+        }
+    }
+}
+
+
+int
+main (int    argc,
+      char **argv)
+{
+  GOptionContext *context;
+  Gimp           *gimp;
+  GimpContext    *user_context;
+  GimpImage      *image;
+  GimpLayer      *layer;
+  GeglBuffer     *pristine;
+  GList          *strokes   = NULL;
+  Method         *methods;
+  gint            n_methods = 0;
+  GEnumClass     *enum_class;
+  GEnumValue     *enum_value;
+  GimpPrecision   precision;
+  GType           symmetry_type = G_TYPE_NONE;
+  gchar          *json;
+  GError         *error     = NULL;
+  gint            i;
+
+  context = g_option_context_new (NULL);
+  g_option_context_set_summary (context,
+                                "Replays paint strokes through GIMP's paint "
+                                "cores and measures their latency.");
+  g_option_context_add_main_entries (context, option_entries, NULL);
+
+  if (! g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+
+      return EXIT_FAILURE;
+    }
+
+  g_option_context_free (context);
+
+  if (option_width < 1 || option_height < 1 || option_iterations < 1)
+    {
+      g_printerr ("The canvas size and the number of iterations must be "
+                  "positive.\n");
+
+      return EXIT_FAILURE;
+    }
+
+  if (! option_precision)
+    option_precision = g_strdup ("u8-non-linear");
+
+  enum_class = g_type_class_ref (GIMP_TYPE_PRECISION);
+  enum_value = g_enum_get_value_by_nick (enum_class, option_precision);
+
+  if (! enum_value)
+    {
+      g_printerr ("Unknown precision '%s'.\n", option_precision);
+
+      return EXIT_FAILURE;
+    }
+
+  precision = enum_value->value;
+  g_type_class_unref (enum_class);
+
+  if (! option_symmetry)
+    option_symmetry = g_strdup ("none");
+
+  if (! strcmp (option_symmetry, "mirror"))
+    symmetry_type = GIMP_TYPE_MIRROR;
+  else if (! strcmp (option_symmetry, "tiling"))
+    symmetry_type = GIMP_TYPE_TILING;
+  else if (! strcmp (option_symmetry, "mandala"))
+    symmetry_type = GIMP_TYPE_MANDALA;
+  else if (strcmp (option_symmetry, "none"))
+    {
+      g_printerr ("Unknown symmetry '%s'.\n", option_symmetry);
+
+      return EXIT_FAILURE;
+    }
+
+  gimp_test_utils_set_gimp3_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  if (option_threads > 0)
+    g_object_set (gimp->config, "num-processors", option_threads, NULL);
+
+  option_threads = GIMP_GEGL_CONFIG (gimp->config)->num_processors;
+
+  user_context = gimp_get_user_context (gimp);
+
+  /*  dynamics  */
+  if (option_dynamics)
+    {
+      GimpContainer *container;
+      GimpObject    *dynamics;
+
+      container = gimp_data_factory_get_container (gimp->dynamics_factory);
+      dynamics  = gimp_container_get_child_by_name (container,
+                                                    option_dynamics);
+
+      if (! dynamics)
+        {
+          g_printerr ("Unknown dynamics '%s'.\n", option_dynamics);
+
+          return EXIT_FAILURE;
+        }
+
+      gimp_context_set_dynamics (user_context, GIMP_DYNAMICS (dynamics));
+    }
+  else
+    {
+      gimp_context_set_dynamics (user_context,
+                                 GIMP_DYNAMICS (gimp_dynamics_get_standard (user_context)));
+    }
+
+  option_dynamics = g_strdup (gimp_object_get_name (gimp_context_get_dynamics (user_context)));
+
+  /*  strokes  */
+  if (option_records)
+    {
+      for (i = 0; option_records[i]; i++)
+        {
+          GFile *file = g_file_new_for_commandline_arg (option_records[i]);
+          GList *list = gimp_paint_record_load (file, &error);
+
+          g_object_unref (file);
+
+          if (error)
+            {
+              g_printerr ("%s\n", error->message);
+
+              return EXIT_FAILURE;
+            }
+
+          strokes = g_list_concat (strokes, list);
+        }
+    }
+  else
+    {
+      strokes = benchmark_synthetic_strokes ();
+    }
+
+  /*  canvas  */
+  image = gimp_image_new (gimp, option_width, option_height,
+                          GIMP_RGB, precision);
+
+  gimp_image_undo_disable (image);
+
+  layer = gimp_layer_new (image, option_width, option_height,
+                          gimp_image_get_layer_format (image, TRUE),
+                          "Canvas",
+                          GIMP_OPACITY_OPAQUE, GIMP_LAYER_MODE_NORMAL);
+
+  gimp_image_add_layer (image, layer, GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  /*  something for smudge, heal and clone to work with  */
+  {
+    GeglBuffer *buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+    GeglNode   *node;
+
+    node = gegl_node_new_child (NULL,
+                                "operation", "gegl:checkerboard",
+                                "x",         64,
+                                "y",         64,
+                                NULL);
+
+    gegl_node_blit_buffer (node, buffer, NULL, 0, GEGL_ABYSS_NONE);
+    g_object_unref (node);
+
+    pristine = gegl_buffer_dup (buffer);
+  }
+
+  if (symmetry_type != G_TYPE_NONE)
+    {
+      gimp_image_set_active_symmetry (image, symmetry_type);
+
+      if (symmetry_type == GIMP_TYPE_MIRROR)
+        {
+          g_object_set (gimp_image_get_active_symmetry (image),
+                        "horizontal-symmetry", TRUE,
+                        "vertical-symmetry",   TRUE,
+                        NULL);
+        }
+    }
+
+  /*  replay  */
+  methods = g_new0 (Method, G_N_ELEMENTS (paint_methods));
+
+  for (i = 0; i < G_N_ELEMENTS (paint_methods); i++)
+    {
+      Method *method = &methods[n_methods];
+
+      if (option_methods)
+        {
+          gint j;
+
+          for (j = 0; option_methods[j]; j++)
+            {
+              if (g_pattern_match_simple (option_methods[j], paint_methods[i]))
+                break;
+            }
+
+          if (! option_methods[j])
+            continue;
+        }
+
+      g_printerr ("Replaying with %s...\n", paint_methods[i]);
+
+      method->paint_info  = paint_methods[i];
+      method->event_times = g_array_new (FALSE, FALSE, sizeof (gint64));
+      method->dab_times   = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+      if (! benchmark_replay (gimp, layer, pristine, strokes, method, &error))
+        {
+          method->skipped     = TRUE;
+          method->skip_reason = g_strdup (error->message);
+          g_clear_error (&error);
+        }
+
+      g_array_sort (method->event_times, benchmark_compare_times);
+      g_array_sort (method->dab_times,   benchmark_compare_times);
+
+      n_methods++;
+    }
+
+  benchmark_print_summary (methods, n_methods);
+
+  json = benchmark_to_json (methods, n_methods, g_list_length (strokes));
+
+  if (option_output)
+    {
+      if (! g_file_set_contents (option_output, json, -1, &error))
+        {
+          g_printerr ("Could not write the results: %s\n", error->message);
+          g_clear_error (&error);
+        }
+    }
+  else
+    {
+      g_print ("%s\n", json);
+    }
+
+  g_free (json);
+
+  for (i = 0; i < n_methods; i++)
+    {
+      g_array_unref (methods[i].event_times);
+      g_array_unref (methods[i].dab_times);
+      g_free (methods[i].skip_reason);
+    }
+
+  g_free (methods);
+
+  g_list_free_full (strokes, (GDestroyNotify) gimp_paint_record_stroke_free);
+
+  g_object_unref (pristine);
+  g_object_unref (image);
+
+  /*  don't write files to the source dir  */
+  gimp_test_utils_set_gimp3_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return EXIT_SUCCESS;
+}
@@ -17,6 +17,8 @@
 
 #include "config.h"
 
+#include <math.h>
+
 #include <gegl.h>
 #include <gtk/gtk.h>
 
@@ -394,3 +396,33 @@ gimp_test_utils_create_image_from_dialog (Gimp *gimp)
   return image;
 }
 
+/**
+ * gimp_test_utils_percentile:
+ * @samples:    the samples, sorted in ascending order
+ * @n_samples:  the number of samples
+ * @percentile: the percentile, between 0 and 100
+ *
+ * Linearly interpolates between the closest ranks of @samples, so
+ * that all benchmarks report their percentiles the same way.
+ *
+ * Returns: the @percentile of @samples, or 0.0 if there are none.
+ **/
+gdouble
+gimp_test_utils_percentile (const gdouble *samples,
+                            gint           n_samples,
+                            gdouble        percentile)
+{
+  gdouble rank;
+  gint    i;
+
+  if (n_samples <= 0)
+    return 0.0;
+
+  rank = CLAMP (percentile, 0.0, 100.0) / 100.0 * (n_samples - 1);
+  i    = floor (rank);
+
+  if (i >= n_samples - 1)
+    return samples[n_samples - 1];
+
+  return samples[i] + (rank - i) * (samples[i + 1] - samples[i]);
+}
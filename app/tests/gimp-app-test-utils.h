@@ -37,6 +37,9 @@ void            gimp_test_utils_synthesize_key_event (GtkWidget   *widget,
 GimpUIManager * gimp_test_utils_get_ui_manager       (Gimp        *gimp);
 GimpImage     * gimp_test_utils_create_image_from_dialog
                                                      (Gimp        *gimp);
+gdouble         gimp_test_utils_percentile           (const gdouble *samples,
+                                                      gint           n_samples,
+                                                      gdouble        percentile);
 
 
 #endif /* __GIMP_APP_TEST_UTILS_H__ */
@@ -0,0 +1,216 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+
+#include "core/core-types.h"
+
+#include "core/gimplist.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add ("/gimplist/" #function, \
+              GimpTestFixture, \
+              NULL, \
+              gimp_test_list_setup, \
+              gimp_test_list_ ## function, \
+              gimp_test_list_teardown);
+
+
+typedef struct
+{
+  GimpContainer *unique;
+  GimpContainer *plain;
+} GimpTestFixture;
+
+
+static void
+gimp_test_list_setup (GimpTestFixture *fixture,
+                      gconstpointer    data)
+{
+  fixture->unique = gimp_list_new (GIMP_TYPE_OBJECT, TRUE);
+  fixture->plain  = gimp_list_new (GIMP_TYPE_OBJECT, FALSE);
+}
+
+static void
+gimp_test_list_teardown (GimpTestFixture *fixture,
+                         gconstpointer    data)
+{
+  g_clear_object (&fixture->unique);
+  g_clear_object (&fixture->plain);
+}
+
+static GimpObject *
+gimp_test_list_add (GimpContainer *container,
+                    const gchar   *name)
+{
+  GimpObject *object = g_object_new (GIMP_TYPE_OBJECT,
+                                     "name", name,
+                                     NULL);
+
+  gimp_container_add (container, object);
+  g_object_unref (object);
+
+  return object;
+}
+
+/**
+ * gimp_test_list_add_collision:
+ *
+ * Test that children added with a name which is taken get numbered.
+ **/
+static void
+gimp_test_list_add_collision (GimpTestFixture *f,
+                              gconstpointer    data)
+{
+  GimpObject *a1 = gimp_test_list_add (f->unique, "A");
+  GimpObject *a2 = gimp_test_list_add (f->unique, "A");
+  GimpObject *a3 = gimp_test_list_add (f->unique, "A #1");
+
+  g_assert_cmpstr (gimp_object_get_name (a1), ==, "A");
+  g_assert_cmpstr (gimp_object_get_name (a2), ==, "A #1");
+  g_assert_cmpstr (gimp_object_get_name (a3), ==, "A #2");
+
+  g_assert (gimp_container_get_child_by_name (f->unique, "A")    == a1);
+  g_assert (gimp_container_get_child_by_name (f->unique, "A #1") == a2);
+  g_assert (gimp_container_get_child_by_name (f->unique, "A #2") == a3);
+}
+
+/**
+ * gimp_test_list_rename_collision:
+ *
+ * Test that renaming a child to a taken name numbers it, and that it
+ * is found by its new name and no longer by its old one.
+ **/
+static void
+gimp_test_list_rename_collision (GimpTestFixture *f,
+                                 gconstpointer    data)
+{
+  GimpObject *a = gimp_test_list_add (f->unique, "A");
+  GimpObject *b = gimp_test_list_add (f->unique, "B");
+
+  gimp_object_set_name (b, "A");
+
+  g_assert_cmpstr (gimp_object_get_name (a), ==, "A");
+  g_assert_cmpstr (gimp_object_get_name (b), ==, "A #1");
+
+  g_assert (gimp_container_get_child_by_name (f->unique, "A")    == a);
+  g_assert (gimp_container_get_child_by_name (f->unique, "A #1") == b);
+  g_assert (gimp_container_get_child_by_name (f->unique, "B")    == NULL);
+}
+
+/**
+ * gimp_test_list_rename_frees_name:
+ *
+ * Test that a name is free again once its child was renamed.
+ **/
+static void
+gimp_test_list_rename_frees_name (GimpTestFixture *f,
+                                  gconstpointer    data)
+{
+  GimpObject *a = gimp_test_list_add (f->unique, "A");
+  GimpObject *b;
+
+  gimp_object_set_name (a, "C");
+
+  b = gimp_test_list_add (f->unique, "A");
+
+  g_assert_cmpstr (gimp_object_get_name (b), ==, "A");
+
+  g_assert (gimp_container_get_child_by_name (f->unique, "A") == b);
+  g_assert (gimp_container_get_child_by_name (f->unique, "C") == a);
+}
+
+/**
+ * gimp_test_list_remove_and_readd:
+ *
+ * Test that a name is free again once its child was removed, and that
+ * numbering continues after the names which are still taken.
+ **/
+static void
+gimp_test_list_remove_and_readd (GimpTestFixture *f,
+                                 gconstpointer    data)
+{
+  GimpObject *a1 = gimp_test_list_add (f->unique, "A");
+  GimpObject *a2 = gimp_test_list_add (f->unique, "A");
+  GimpObject *a3;
+  GimpObject *a4;
+
+  gimp_container_remove (f->unique, a1);
+
+  g_assert (gimp_container_get_child_by_name (f->unique, "A")    == NULL);
+  g_assert (gimp_container_get_child_by_name (f->unique, "A #1") == a2);
+
+  a3 = gimp_test_list_add (f->unique, "A");
+  a4 = gimp_test_list_add (f->unique, "A");
+
+  g_assert_cmpstr (gimp_object_get_name (a3), ==, "A");
+  g_assert_cmpstr (gimp_object_get_name (a4), ==, "A #2");
+
+  /*  a removed child is no longer tracked  */
+  g_object_ref (a2);
+  gimp_container_remove (f->unique, a2);
+  gimp_object_set_name (a2, "A");
+
+  g_assert (gimp_container_get_child_by_name (f->unique, "A") == a3);
+  g_object_unref (a2);
+}
+
+/**
+ * gimp_test_list_shared_names:
+ *
+ * Test that a list without unique names keeps duplicate names, and
+ * that looking one up returns the first child carrying it in list
+ * order, also after renames.  New children go to the front.
+ **/
+static void
+gimp_test_list_shared_names (GimpTestFixture *f,
+                             gconstpointer    data)
+{
+  GimpObject *a1 = gimp_test_list_add (f->plain, "A");
+  GimpObject *a2 = gimp_test_list_add (f->plain, "A");
+  GimpObject *b  = gimp_test_list_add (f->plain, "B");
+
+  g_assert_cmpstr (gimp_object_get_name (a1), ==, "A");
+  g_assert_cmpstr (gimp_object_get_name (a2), ==, "A");
+
+  g_assert (gimp_container_get_child_by_name (f->plain, "A") == a2);
+
+  gimp_object_set_name (a2, "B");
+
+  g_assert (gimp_container_get_child_by_name (f->plain, "A") == a1);
+  g_assert (gimp_container_get_child_by_name (f->plain, "B") == b);
+
+  gimp_container_remove (f->plain, b);
+
+  g_assert (gimp_container_get_child_by_name (f->plain, "B") == a2);
+}
+
+int main(int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  ADD_TEST (add_collision);
+  ADD_TEST (rename_collision);
+  ADD_TEST (rename_frees_name);
+  ADD_TEST (remove_and_readd);
+  ADD_TEST (shared_names);
+
+  return g_test_run ();
+}
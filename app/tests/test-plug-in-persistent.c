@@ -0,0 +1,196 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "plug-in/plug-in-types.h"
+
+#include "core/gimp.h"
+
+#include "pdb/gimppdb.h"
+
+#include "plug-in/gimpplugin.h"
+#include "plug-in/gimppluginmanager.h"
+#include "plug-in/gimppluginmanager-persistent.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-plug-in-persistent/" #function, gimp, function);
+
+/*  file-glob is built in plug-ins/common and opts in to persistence  */
+#define PERSISTENT_PROC "file-glob"
+
+
+static gboolean
+run_persistent_proc (Gimp *gimp)
+{
+  GimpValueArray *return_vals;
+  GError         *error = NULL;
+  gchar          *pattern;
+  gboolean        success;
+
+  pattern = g_build_filename (g_get_tmp_dir (), "*.xcf", NULL);
+
+  return_vals =
+    gimp_pdb_execute_procedure_by_name (gimp->pdb,
+                                        gimp_get_user_context (gimp),
+                                        NULL, &error,
+                                        PERSISTENT_PROC,
+                                        G_TYPE_STRING,  pattern,
+                                        G_TYPE_BOOLEAN, FALSE,
+                                        G_TYPE_NONE);
+  g_free (pattern);
+
+  g_assert_no_error (error);
+
+  success = (g_value_get_enum (gimp_value_array_index (return_vals, 0)) ==
+             GIMP_PDB_SUCCESS);
+
+  gimp_value_array_unref (return_vals);
+
+  return success;
+}
+
+static GimpPlugIn *
+get_idle_plug_in (Gimp *gimp)
+{
+  GSList *list = gimp->plug_in_manager->persistent_plug_ins;
+
+  g_assert_cmpint (g_slist_length (list), <=, 1);
+
+  return list ? list->data : NULL;
+}
+
+/**
+ * reuse_idle_process:
+ *
+ * Calls a persistent plug-in twice and checks that the second call
+ * runs in the process which was kept from the first one.
+ **/
+static void
+reuse_idle_process (gconstpointer data)
+{
+  Gimp       *gimp = GIMP (data);
+  GimpPlugIn *plug_in;
+  GPid        pid;
+
+  if (! gimp_pdb_lookup_procedure (gimp->pdb, PERSISTENT_PROC))
+    {
+      g_test_skip ("the " PERSISTENT_PROC " plug-in is not installed");
+      return;
+    }
+
+  g_object_set (gimp->config,
+                "plug-in-persistent-timeout", 60,
+                NULL);
+
+  g_assert_true (run_persistent_proc (gimp));
+
+  plug_in = get_idle_plug_in (gimp);
+  g_assert_nonnull (plug_in);
+  g_assert_true (plug_in->open);
+
+  pid = plug_in->pid;
+
+  g_assert_true (run_persistent_proc (gimp));
+
+  g_assert_true (get_idle_plug_in (gimp) == plug_in);
+  g_assert_true (plug_in->pid == pid);
+
+  gimp_plug_in_manager_persistent_exit (gimp->plug_in_manager);
+
+  g_assert_null (get_idle_plug_in (gimp));
+}
+
+/**
+ * stop_idle_process:
+ *
+ * Checks that a persistent plug-in which was not called again within
+ * "plug-in-persistent-timeout" seconds is asked to exit.
+ **/
+static void
+stop_idle_process (gconstpointer data)
+{
+  Gimp       *gimp = GIMP (data);
+  GimpPlugIn *plug_in;
+
+  if (! gimp_pdb_lookup_procedure (gimp->pdb, PERSISTENT_PROC))
+    {
+      g_test_skip ("the " PERSISTENT_PROC " plug-in is not installed");
+      return;
+    }
+
+  g_object_set (gimp->config,
+                "plug-in-persistent-timeout", 1,
+                NULL);
+
+  g_assert_true (run_persistent_proc (gimp));
+
+  plug_in = get_idle_plug_in (gimp);
+  g_assert_nonnull (plug_in);
+
+  g_object_ref (plug_in);
+
+  gimp_test_run_temp_mainloop (2500);
+
+  g_assert_null (get_idle_plug_in (gimp));
+
+  /*  gimp_plug_in_close() waits for the process before it clears the
+   *  pid
+   */
+  g_assert_false (plug_in->open);
+  g_assert_true (plug_in->pid == 0);
+
+  g_object_unref (plug_in);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp3_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  ADD_TEST (reuse_idle_process);
+  ADD_TEST (stop_idle_process);
+
+  result = g_test_run ();
+
+  gimp_test_utils_set_gimp3_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  /* Exit so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
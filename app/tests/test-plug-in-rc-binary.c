@@ -0,0 +1,304 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "plug-in/plug-in-types.h"
+
+#include "core/gimp.h"
+
+#include "plug-in/gimpplugindef.h"
+#include "plug-in/gimppluginprocedure.h"
+#include "plug-in/plug-in-rc-binary.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-plug-in-rc-binary/" #function, gimp, function);
+
+
+typedef struct
+{
+  const gchar *name;
+  const gchar *extensions;
+  const gchar *magics;
+} FileProc;
+
+/*  the magics of file-png and file-jpeg, which are not valid UTF-8  */
+static const FileProc file_procs[] =
+{
+  { "file-png-load",  "png",          "0,string,\211PNG\r\n\032\n" },
+  { "file-jpeg-load", "jpg,jpeg,jpe", "0,string,\xff\xd8\xff"      }
+};
+
+
+/*  writes @plug_in_def to a binary pluginrc in a new temporary
+ *  directory, which is returned in @dir, and reads it back
+ */
+static GSList *
+write_and_read (Gimp           *gimp,
+                GimpPlugInDef  *plug_in_def,
+                GFile         **dir)
+{
+  GSList *plug_in_defs;
+  GFile  *pluginrc;
+  GFile  *binary;
+  GError *error = NULL;
+  gchar  *path;
+
+  path = g_dir_make_tmp ("gimp-test-plug-in-rc-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  *dir = g_file_new_for_path (path);
+  g_free (path);
+
+  /*  the binary pluginrc is tied to the text pluginrc it is written
+   *  along with, so there has to be one
+   */
+  pluginrc = g_file_get_child (*dir, "pluginrc");
+  g_file_replace_contents (pluginrc, "", 0, NULL, FALSE, G_FILE_CREATE_NONE,
+                           NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  binary = g_file_get_child (*dir, "pluginrc.bin");
+
+  plug_in_defs = g_slist_prepend (NULL, plug_in_def);
+
+  g_assert_true (plug_in_rc_binary_write (plug_in_defs, binary, pluginrc,
+                                          &error));
+  g_assert_no_error (error);
+
+  g_slist_free (plug_in_defs);
+
+  plug_in_defs = plug_in_rc_binary_parse (gimp, binary, pluginrc, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (g_slist_length (plug_in_defs), ==, 1);
+
+  g_object_unref (binary);
+  g_object_unref (pluginrc);
+
+  return plug_in_defs;
+}
+
+/*  frees @plug_in_defs, which keep the binary pluginrc mapped, and
+ *  removes @dir
+ */
+static void
+free_and_remove (GSList *plug_in_defs,
+                 GFile  *dir)
+{
+  GFile *file;
+
+  g_slist_free_full (plug_in_defs, (GDestroyNotify) g_object_unref);
+
+  file = g_file_get_child (dir, "pluginrc.bin");
+  g_file_delete (file, NULL, NULL);
+  g_object_unref (file);
+
+  file = g_file_get_child (dir, "pluginrc");
+  g_file_delete (file, NULL, NULL);
+  g_object_unref (file);
+
+  g_file_delete (dir, NULL, NULL);
+  g_object_unref (dir);
+}
+
+/**
+ * write_and_read_magics:
+ *
+ * Writes plug-in definitions with binary magics to a binary pluginrc,
+ * reads them back, and checks that the magics are unchanged.
+ **/
+static void
+write_and_read_magics (gconstpointer data)
+{
+  Gimp          *gimp = GIMP (data);
+  GimpPlugInDef *plug_in_def;
+  GSList        *plug_in_defs;
+  GFile         *dir;
+  GFile         *file;
+  gint           i;
+
+  file = g_file_new_build_filename (g_get_tmp_dir (), "file-formats", NULL);
+
+  plug_in_def = gimp_plug_in_def_new (file);
+
+  for (i = 0; i < G_N_ELEMENTS (file_procs); i++)
+    {
+      GimpProcedure *procedure;
+
+      procedure = gimp_plug_in_procedure_new (GIMP_PDB_PROC_TYPE_PLUGIN, file);
+      gimp_object_set_name (GIMP_OBJECT (procedure), file_procs[i].name);
+
+      gimp_plug_in_procedure_set_file_proc (GIMP_PLUG_IN_PROCEDURE (procedure),
+                                            file_procs[i].extensions,
+                                            NULL,
+                                            file_procs[i].magics);
+
+      gimp_plug_in_def_add_procedure (plug_in_def,
+                                      GIMP_PLUG_IN_PROCEDURE (procedure));
+      g_object_unref (procedure);
+    }
+
+  g_object_unref (file);
+
+  plug_in_defs = write_and_read (gimp, plug_in_def, &dir);
+  g_object_unref (plug_in_def);
+
+  plug_in_def = plug_in_defs->data;
+
+  g_assert_cmpint (g_slist_length (plug_in_def->procedures), ==,
+                   G_N_ELEMENTS (file_procs));
+
+  for (i = 0; i < G_N_ELEMENTS (file_procs); i++)
+    {
+      GimpPlugInProcedure *proc;
+
+      proc = g_slist_nth_data (plug_in_def->procedures, i);
+
+      g_assert_cmpstr (gimp_object_get_name (proc), ==, file_procs[i].name);
+      g_assert_true (proc->file_proc);
+      g_assert_cmpstr (proc->extensions, ==, file_procs[i].extensions);
+      g_assert_nonnull (proc->magics);
+      g_assert_cmpmem (proc->magics, strlen (proc->magics),
+                       file_procs[i].magics, strlen (file_procs[i].magics));
+    }
+
+  free_and_remove (plug_in_defs, dir);
+}
+
+/**
+ * lazy_args:
+ *
+ * Checks that a procedure read from a binary pluginrc only gets its
+ * arguments and return values when they are first needed, and that
+ * they are unchanged then.
+ **/
+static void
+lazy_args (gconstpointer data)
+{
+  Gimp          *gimp = GIMP (data);
+  GimpPlugInDef *plug_in_def;
+  GimpProcedure *procedure;
+  GSList        *plug_in_defs;
+  GFile         *dir;
+  GFile         *file;
+
+  file = g_file_new_build_filename (g_get_tmp_dir (), "filters", NULL);
+
+  plug_in_def = gimp_plug_in_def_new (file);
+
+  procedure = gimp_plug_in_procedure_new (GIMP_PDB_PROC_TYPE_PLUGIN, file);
+  gimp_object_set_name (GIMP_OBJECT (procedure), "plug-in-test-lazy-args");
+
+  gimp_procedure_add_argument (procedure,
+                               g_param_spec_int ("radius",
+                                                 "Radius",
+                                                 "The radius",
+                                                 1, 100, 5,
+                                                 GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               g_param_spec_string ("name",
+                                                    "Name",
+                                                    "The name",
+                                                    "test",
+                                                    GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   g_param_spec_int ("count",
+                                                     "Count",
+                                                     "The count",
+                                                     0, 10, 0,
+                                                     GIMP_PARAM_READWRITE));
+
+  gimp_plug_in_def_add_procedure (plug_in_def,
+                                  GIMP_PLUG_IN_PROCEDURE (procedure));
+  g_object_unref (procedure);
+  g_object_unref (file);
+
+  plug_in_defs = write_and_read (gimp, plug_in_def, &dir);
+  g_object_unref (plug_in_def);
+
+  plug_in_def = plug_in_defs->data;
+  procedure   = plug_in_def->procedures->data;
+
+  g_assert_cmpstr (gimp_object_get_name (procedure), ==,
+                   "plug-in-test-lazy-args");
+  g_assert_nonnull (GIMP_PLUG_IN_PROCEDURE (procedure)->lazy_args);
+  g_assert_cmpint (procedure->num_args,   ==, 0);
+  g_assert_cmpint (procedure->num_values, ==, 0);
+
+  gimp_procedure_ensure_args (procedure);
+
+  g_assert_null (GIMP_PLUG_IN_PROCEDURE (procedure)->lazy_args);
+  g_assert_cmpint (procedure->num_args,   ==, 2);
+  g_assert_cmpint (procedure->num_values, ==, 1);
+
+  g_assert_true (G_IS_PARAM_SPEC_INT (procedure->args[0]));
+  g_assert_cmpstr (procedure->args[0]->name, ==, "radius");
+  g_assert_cmpint (G_PARAM_SPEC_INT (procedure->args[0])->default_value,
+                   ==, 5);
+
+  g_assert_true (G_IS_PARAM_SPEC_STRING (procedure->args[1]));
+  g_assert_cmpstr (procedure->args[1]->name, ==, "name");
+
+  g_assert_true (G_IS_PARAM_SPEC_INT (procedure->values[0]));
+  g_assert_cmpstr (procedure->values[0]->name, ==, "count");
+
+  /*  a second call doesn't add them again  */
+  gimp_procedure_ensure_args (procedure);
+
+  g_assert_cmpint (procedure->num_args,   ==, 2);
+  g_assert_cmpint (procedure->num_values, ==, 1);
+
+  free_and_remove (plug_in_defs, dir);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp3_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  ADD_TEST (write_and_read_magics);
+  ADD_TEST (lazy_args);
+
+  result = g_test_run ();
+
+  gimp_test_utils_set_gimp3_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  /* Exit so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
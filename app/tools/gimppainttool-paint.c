@@ -28,6 +28,8 @@
 #include "core/gimpimage.h"
 #include "core/gimpprojection.h"
 
+#include "paint/gimp-paint.h"
+#include "paint/gimp-paint-record.h"
 #include "paint/gimppaintcore.h"
 #include "paint/gimppaintoptions.h"
 
@@ -54,6 +56,7 @@ typedef struct
       gpointer            data;
       gboolean           *finished;
     };
+  gint64                  time;
 } PaintItem;
 
 typedef struct
@@ -67,11 +70,15 @@ typedef struct
 
 static gboolean   gimp_paint_tool_paint_use_thread  (GimpPaintTool   *paint_tool);
 static gpointer   gimp_paint_tool_paint_thread      (gpointer         data);
+static void       gimp_paint_tool_paint_item        (PaintItem       *item);
+static void       gimp_paint_tool_paint_yield       (void);
 
 static gboolean   gimp_paint_tool_paint_timeout     (GimpPaintTool   *paint_tool);
 
 static void       gimp_paint_tool_paint_interpolate (GimpPaintTool   *paint_tool,
-                                                     InterpolateData *data);
+                                                     GArray          *events);
+static gboolean   gimp_paint_tool_paint_coalesce    (GimpPaintTool   *paint_tool,
+                                                     InterpolateData *event);
 
 
 /*  static variables  */
@@ -86,7 +93,9 @@ static GMutex             paint_queue_mutex;
 static GCond              paint_queue_cond;
 
 static guint              paint_timeout_id;
-static volatile gboolean  paint_timeout_pending;
+static gint               paint_timeout_pending;
+
+static gint64             paint_unflushed_time;
 
 
 /*  private functions  */
@@ -133,22 +142,39 @@ gimp_paint_tool_paint_thread (gpointer data)
         {
           *item->finished = TRUE;
           g_cond_signal (&paint_queue_cond);
+
+          g_slice_free (PaintItem, item);
         }
       else
         {
           g_mutex_unlock (&paint_queue_mutex);
           g_mutex_lock (&paint_mutex);
 
-          while (paint_timeout_pending)
-            g_cond_wait (&paint_cond, &paint_mutex);
+          gimp_paint_tool_paint_yield ();
 
-          item->func (item->paint_tool, item->data);
+          gimp_paint_tool_paint_item (item);
 
-          g_mutex_unlock (&paint_mutex);
           g_mutex_lock (&paint_queue_mutex);
-        }
 
-      g_slice_free (PaintItem, item);
+          /*  process the items queued in the meantime as a single batch,
+           *  without handing the paint mutex back and forth, until the
+           *  display update timeout wants to flush the painted pixels.
+           */
+          while (! g_atomic_int_get (&paint_timeout_pending) &&
+                 (item = g_queue_peek_head (&paint_queue))    &&
+                 item->func != PAINT_FINISH)
+            {
+              g_queue_pop_head (&paint_queue);
+
+              g_mutex_unlock (&paint_queue_mutex);
+
+              gimp_paint_tool_paint_item (item);
+
+              g_mutex_lock (&paint_queue_mutex);
+            }
+
+          g_mutex_unlock (&paint_mutex);
+        }
     }
 
   g_mutex_unlock (&paint_queue_mutex);
@@ -156,26 +182,56 @@ gimp_paint_tool_paint_thread (gpointer data)
   return NULL;
 }
 
+/*  called with the paint mutex held  */
+static void
+gimp_paint_tool_paint_item (PaintItem *item)
+{
+  item->func (item->paint_tool, item->data);
+
+  if (! paint_unflushed_time)
+    paint_unflushed_time = item->time;
+
+  g_slice_free (PaintItem, item);
+}
+
+/*  called with the paint mutex held.  lets a pending display update
+ *  take its snapshot of the painted pixels.
+ */
+static void
+gimp_paint_tool_paint_yield (void)
+{
+  while (g_atomic_int_get (&paint_timeout_pending))
+    g_cond_wait (&paint_cond, &paint_mutex);
+}
+
 static gboolean
 gimp_paint_tool_paint_timeout (GimpPaintTool *paint_tool)
 {
   GimpPaintCore *core     = paint_tool->core;
   GimpDrawable  *drawable = paint_tool->drawable;
   gboolean       update;
+  gint64         time;
 
-  paint_timeout_pending = TRUE;
+  g_atomic_int_set (&paint_timeout_pending, TRUE);
 
   g_mutex_lock (&paint_mutex);
 
   paint_tool->paint_x = core->last_paint.x;
   paint_tool->paint_y = core->last_paint.y;
 
-  update = gimp_drawable_flush_paint (drawable);
+  /*  the oldest event whose pixels are about to be flushed  */
+  time                 = paint_unflushed_time;
+  paint_unflushed_time = 0;
+
+  /*  only take a snapshot of the painted regions while the paint thread
+   *  is stopped; they are copied to the drawable once it resumes
+   */
+  update = gimp_drawable_snapshot_paint (drawable);
 
   if (update && GIMP_PAINT_TOOL_GET_CLASS (paint_tool)->paint_flush)
     GIMP_PAINT_TOOL_GET_CLASS (paint_tool)->paint_flush (paint_tool);
 
-  paint_timeout_pending = FALSE;
+  g_atomic_int_set (&paint_timeout_pending, FALSE);
   g_cond_signal (&paint_cond);
 
   g_mutex_unlock (&paint_mutex);
@@ -186,6 +242,8 @@ gimp_paint_tool_paint_timeout (GimpPaintTool *paint_tool)
       GimpDisplay  *display   = paint_tool->display;
       GimpImage    *image     = gimp_display_get_image (display);
 
+      gimp_drawable_flush_paint_snapshot (drawable);
+
       if (paint_tool->snap_brush)
         gimp_draw_tool_pause (draw_tool);
 
@@ -194,23 +252,66 @@ gimp_paint_tool_paint_timeout (GimpPaintTool *paint_tool)
 
       if (paint_tool->snap_brush)
         gimp_draw_tool_resume (draw_tool);
+
+      if (time)
+        gimp_paint_set_latency (g_get_monotonic_time () - time);
     }
 
   return G_SOURCE_CONTINUE;
 }
 
 static void
-gimp_paint_tool_paint_interpolate (GimpPaintTool   *paint_tool,
-                                   InterpolateData *data)
+gimp_paint_tool_paint_interpolate (GimpPaintTool *paint_tool,
+                                   GArray        *events)
 {
   GimpPaintOptions *paint_options = GIMP_PAINT_TOOL_GET_OPTIONS (paint_tool);
   GimpPaintCore    *core          = paint_tool->core;
   GimpDrawable     *drawable      = paint_tool->drawable;
+  gint              i;
+
+  for (i = 0; i < events->len; i++)
+    {
+      InterpolateData *event = &g_array_index (events, InterpolateData, i);
 
-  gimp_paint_core_interpolate (core, drawable, paint_options,
-                               &data->coords, data->time);
+      if (i > 0)
+        gimp_paint_tool_paint_yield ();
 
-  g_slice_free (InterpolateData, data);
+      gimp_paint_core_interpolate (core, drawable, paint_options,
+                                   &event->coords, event->time);
+    }
+
+  g_array_free (events, TRUE);
+}
+
+/*  appends the event to the last queued item, if that is a batch of
+ *  motion events of the same tool which the paint thread hasn't picked
+ *  up yet, so that events which queue up while the thread is busy are
+ *  interpolated in one go.  the item keeps the time of its oldest event.
+ */
+static gboolean
+gimp_paint_tool_paint_coalesce (GimpPaintTool   *paint_tool,
+                                InterpolateData *event)
+{
+  PaintItem *item;
+  gboolean   coalesced = FALSE;
+
+  g_mutex_lock (&paint_queue_mutex);
+
+  item = g_queue_peek_tail (&paint_queue);
+
+  if (item                           &&
+      item->paint_tool == paint_tool &&
+      item->func       == (GimpPaintToolPaintFunc)
+                          gimp_paint_tool_paint_interpolate)
+    {
+      g_array_append_vals (item->data, event, 1);
+
+      coalesced = TRUE;
+    }
+
+  g_mutex_unlock (&paint_queue_mutex);
+
+  return coalesced;
 }
 
 
@@ -286,6 +387,9 @@ gimp_paint_tool_paint_start (GimpPaintTool     *paint_tool,
   paint_tool->display  = display;
   paint_tool->drawable = drawable;
 
+  gimp_paint_record_stroke_start (gimp_object_get_name (paint_options->paint_info),
+                                  &curr_coords, time);
+
   if ((display != tool->display) || ! paint_tool->draw_line)
     {
       /*  If this is a new display, reset the "last stroke's endpoint"
@@ -411,6 +515,11 @@ gimp_paint_tool_paint_end (GimpPaintTool *paint_tool,
         }
 
       g_mutex_unlock (&paint_queue_mutex);
+
+      /*  the items drained above are not flushed by the timeout, don't
+       *  count the time until the next stroke as their latency
+       */
+      paint_unflushed_time = 0;
     }
 
   /*  Let the specific painting function finish up  */
@@ -422,6 +531,8 @@ gimp_paint_tool_paint_end (GimpPaintTool *paint_tool,
   else
     gimp_paint_core_finish (core, drawable, TRUE);
 
+  gimp_paint_record_stroke_end (cancel);
+
   /*  Notify subclasses  */
   if (gimp_paint_tool_paint_use_thread (paint_tool) &&
       GIMP_PAINT_TOOL_GET_CLASS (paint_tool)->paint_end)
@@ -467,6 +578,7 @@ gimp_paint_tool_paint_push (GimpPaintTool          *paint_tool,
       item->paint_tool = paint_tool;
       item->func       = func;
       item->data       = data;
+      item->time       = g_get_monotonic_time ();
 
       g_mutex_lock (&paint_queue_mutex);
 
@@ -480,6 +592,7 @@ gimp_paint_tool_paint_push (GimpPaintTool          *paint_tool,
       GimpDrawTool *draw_tool = GIMP_DRAW_TOOL (paint_tool);
       GimpDisplay  *display   = paint_tool->display;
       GimpImage    *image     = gimp_display_get_image (display);
+      gint64        time      = g_get_monotonic_time ();
 
       /*  Paint directly  */
 
@@ -491,6 +604,8 @@ gimp_paint_tool_paint_push (GimpPaintTool          *paint_tool,
       gimp_display_flush_now (display);
 
       gimp_draw_tool_resume (draw_tool);
+
+      gimp_paint_set_latency (g_get_monotonic_time () - time);
     }
 }
 
@@ -502,7 +617,8 @@ gimp_paint_tool_paint_motion (GimpPaintTool    *paint_tool,
   GimpPaintOptions *paint_options;
   GimpPaintCore    *core;
   GimpDrawable     *drawable;
-  InterpolateData  *data;
+  InterpolateData   event;
+  GArray           *events;
   gint              off_x, off_y;
 
   g_return_if_fail (GIMP_IS_PAINT_TOOL (paint_tool));
@@ -513,33 +629,40 @@ gimp_paint_tool_paint_motion (GimpPaintTool    *paint_tool,
   core          = paint_tool->core;
   drawable      = paint_tool->drawable;
 
-  data = g_slice_new (InterpolateData);
-
-  data->coords = *coords;
-  data->time   = time;
+  event.coords = *coords;
+  event.time   = time;
 
   gimp_item_get_offset (GIMP_ITEM (drawable), &off_x, &off_y);
 
-  data->coords.x -= off_x;
-  data->coords.y -= off_y;
+  event.coords.x -= off_x;
+  event.coords.y -= off_y;
 
-  paint_tool->cursor_x = data->coords.x;
-  paint_tool->cursor_y = data->coords.y;
+  paint_tool->cursor_x = event.coords.x;
+  paint_tool->cursor_y = event.coords.y;
 
-  gimp_paint_core_smooth_coords (core, paint_options, &data->coords);
+  gimp_paint_core_smooth_coords (core, paint_options, &event.coords);
 
   /*  Don't paint while the Shift key is pressed for line drawing  */
   if (paint_tool->draw_line)
     {
-      gimp_paint_core_set_current_coords (core, &data->coords);
+      gimp_paint_core_set_current_coords (core, &event.coords);
+
+      return;
+    }
 
-      g_slice_free (InterpolateData, data);
+  gimp_paint_record_stroke_motion (&event.coords, time);
 
+  if (gimp_paint_tool_paint_use_thread (paint_tool) &&
+      gimp_paint_tool_paint_coalesce (paint_tool, &event))
+    {
       return;
     }
 
+  events = g_array_sized_new (FALSE, FALSE, sizeof (InterpolateData), 1);
+  g_array_append_val (events, event);
+
   gimp_paint_tool_paint_push (
     paint_tool,
     (GimpPaintToolPaintFunc) gimp_paint_tool_paint_interpolate,
-    data);
+    events);
 }
@@ -61,11 +61,11 @@
 #include "core/gimp.h"
 #include "core/gimp-gui.h"
 #include "core/gimp-utils.h"
-#include "core/gimp-parallel.h"
 #include "core/gimpasync.h"
-#include "core/gimpbacktrace.h"
+#include "core/gimpperformancelog.h"
 #include "core/gimptempbuf.h"
-#include "core/gimpwaitable.h"
+
+#include "paint/gimp-paint.h"
 
 #include "gimpactiongroup.h"
 #include "gimpdocked.h"
@@ -80,8 +80,6 @@
 #include "gimpwindowstrategy.h"
 
 #include "gimp-intl.h"
-#include "gimp-log.h"
-#include "gimp-version.h"
 
 
 #define DEFAULT_UPDATE_INTERVAL        GIMP_DASHBOARD_UPDATE_INTERVAL_0_25_SEC
@@ -94,14 +92,6 @@
 #define CPU_ACTIVE_ON                  /* individual cpu usage is above */ 0.75
 #define CPU_ACTIVE_OFF                 /* individual cpu usage is below */ 0.25
 
-#define LOG_VERSION                    1
-#define LOG_SAMPLE_FREQUENCY_MIN       1 /* samples per second */
-#define LOG_SAMPLE_FREQUENCY_MAX       1000 /* samples per second */
-#define LOG_DEFAULT_SAMPLE_FREQUENCY   10 /* samples per second */
-#define LOG_DEFAULT_BACKTRACE          TRUE
-#define LOG_DEFAULT_MESSAGES           TRUE
-#define LOG_DEFAULT_PROGRESSIVE        FALSE
-
 
 typedef enum
 {
@@ -155,6 +145,7 @@ typedef enum
   VARIABLE_TILE_ALLOC_TOTAL,
   VARIABLE_SCRATCH_TOTAL,
   VARIABLE_TEMP_BUF_TOTAL,
+  VARIABLE_PAINT_LATENCY,
 
 
   N_VARIABLES,
@@ -315,16 +306,9 @@ struct _GimpDashboardPrivate
   GimpDashboardHistoryDuration  history_duration;
   gboolean                      low_swap_space_warning;
 
-  GOutputStream                *log_output;
-  GError                       *log_error;
-  GimpDashboardLogParams        log_params;
-  gint64                        log_start_time;
-  gint                          log_n_samples;
+  GimpPerformanceLog           *log;
+  GimpPerformanceLogParams      log_params;
   gint                          log_n_markers;
-  VariableData                  log_variables[N_VARIABLES];
-  GimpBacktrace                *log_backtrace;
-  GHashTable                   *log_addresses;
-  GimpLogHandler                log_log_handler;
 
   GtkWidget                    *log_record_button;
   GtkLabel                     *log_add_marker_label;
@@ -426,31 +410,13 @@ static gchar    * gimp_dashboard_field_to_string                (GimpDashboard
                                                                  gint                 field,
                                                                  gboolean             full);
 
-static gboolean   gimp_dashboard_log_printf                     (GimpDashboard       *dashboard,
-                                                                 const gchar         *format,
-                                                                 ...) G_GNUC_PRINTF (2, 3);
-static gboolean   gimp_dashboard_log_print_escaped              (GimpDashboard       *dashboard,
-                                                                 const gchar         *string);
-static gint64     gimp_dashboard_log_time                       (GimpDashboard       *dashboard);
+static gchar    * gimp_dashboard_log_variable_to_string         (GimpDashboard       *dashboard,
+                                                                 Variable             variable);
 static void       gimp_dashboard_log_sample                     (GimpDashboard       *dashboard,
-                                                                 gboolean             variables_changed,
-                                                                 gboolean             include_current_thread);
-static void       gimp_dashboard_log_add_marker_unlocked        (GimpDashboard       *dashboard,
-                                                                 const gchar         *description);
+                                                                 gboolean             variables_changed);
 static void       gimp_dashboard_log_update_highlight           (GimpDashboard       *dashboard);
 static void       gimp_dashboard_log_update_n_markers           (GimpDashboard       *dashboard);
 
-static void       gimp_dashboard_log_write_address_map          (GimpDashboard       *dashboard,
-                                                                 guintptr            *addresses,
-                                                                 gint                 n_addresses,
-                                                                 GimpAsync           *async);
-static void       gimp_dashboard_log_write_global_address_map   (GimpAsync           *async,
-                                                                 GimpDashboard       *dashboard);
-static void       gimp_dashboard_log_log_func                   (const gchar         *log_domain,
-                                                                 GLogLevelFlags       log_levels,
-                                                                 const gchar         *message,
-                                                                 GimpDashboard       *dashboard);
-
 static gboolean   gimp_dashboard_field_use_meter_underlay       (Group                group,
                                                                  gint                 field);
 
@@ -764,6 +730,16 @@ static const VariableInfo variables[] =
     .type             = VARIABLE_TYPE_SIZE,
     .sample_func      = gimp_dashboard_sample_function,
     .data             = gimp_temp_buf_get_total_memsize
+  },
+
+  [VARIABLE_PAINT_LATENCY] =
+  { .name             = "paint-latency",
+    .title            = NC_("dashboard-variable", "Paint latency"),
+    .description      = N_("Time between an input event and the display "
+                           "of the pixels it painted, in milliseconds"),
+    .type             = VARIABLE_TYPE_INTEGER,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = gimp_paint_get_latency
   }
 };
 
@@ -981,6 +957,9 @@ static const GroupInfo groups[] =
                           { .variable       = VARIABLE_TEMP_BUF_TOTAL,
                             .default_active = TRUE
                           },
+                          { .variable       = VARIABLE_PAINT_LATENCY,
+                            .default_active = TRUE
+                          },
 
                           {}
                         }
@@ -1773,7 +1752,7 @@ gimp_dashboard_sample (GimpDashboard *dashboard)
 
       update_interval = priv->update_interval * G_TIME_SPAN_SECOND / 1000;
 
-      if (priv->log_output)
+      if (priv->log)
         {
           sample_interval = G_TIME_SPAN_SECOND /
                             priv->log_params.sample_frequency;
@@ -1811,12 +1790,12 @@ gimp_dashboard_sample (GimpDashboard *dashboard)
             }
 
           /* log sample */
-          if (priv->log_output)
-            gimp_dashboard_log_sample (dashboard, variables_changed, FALSE);
+          if (priv->log)
+            gimp_dashboard_log_sample (dashboard, variables_changed);
 
           /* update gui */
-          if (priv->update_now   ||
-              ! priv->log_output ||
+          if (priv->update_now ||
+              ! priv->log      ||
               time - last_update_time >= update_interval)
             {
               /* add samples to meters */
@@ -2017,6 +1996,7 @@ gimp_dashboard_sample_function (GimpDashboard *dashboard,
 
     case VARIABLE_TYPE_INTEGER:
       variable_data->value.integer = CALL_FUNC (gint);
+      break;
 
     case VARIABLE_TYPE_SIZE:
       variable_data->value.size = CALL_FUNC (guint64);
@@ -3433,536 +3413,93 @@ gimp_dashboard_field_to_string (GimpDashboard *dashboard,
     return (gpointer) str;
 }
 
-static gboolean
-gimp_dashboard_log_printf (GimpDashboard *dashboard,
-                           const gchar   *format,
-                           ...)
+static gchar *
+gimp_dashboard_log_variable_to_string (GimpDashboard *dashboard,
+                                       Variable       variable)
 {
-  GimpDashboardPrivate *priv = dashboard->priv;
-  va_list               args;
-  gboolean              result;
+  GimpDashboardPrivate *priv          = dashboard->priv;
+  const VariableInfo   *variable_info = &variables[variable];
+  const VariableData   *variable_data = &priv->variables[variable];
+  gchar                 buffer[G_ASCII_DTOSTR_BUF_SIZE];
 
-  if (priv->log_error)
-    return FALSE;
+  if (! variable_data->available)
+    return NULL;
 
-  va_start (args, format);
+  switch (variable_info->type)
+    {
+    case VARIABLE_TYPE_BOOLEAN:
+      return g_strdup_printf (
+        "%d",
+        variable_data->value.boolean);
 
-  result = g_output_stream_vprintf (priv->log_output,
-                                    NULL, NULL,
-                                    &priv->log_error,
-                                    format, args);
+    case VARIABLE_TYPE_INTEGER:
+      return g_strdup_printf (
+        "%d",
+        variable_data->value.integer);
 
-  va_end (args);
+    case VARIABLE_TYPE_SIZE:
+      return g_strdup_printf (
+        "%llu",
+        (unsigned long long) variable_data->value.size);
 
-  return result;
-}
+    case VARIABLE_TYPE_SIZE_RATIO:
+      return g_strdup_printf (
+        "%llu/%llu",
+        (unsigned long long) variable_data->value.size_ratio.antecedent,
+        (unsigned long long) variable_data->value.size_ratio.consequent);
 
-static gboolean
-gimp_dashboard_log_print_escaped (GimpDashboard *dashboard,
-                                  const gchar   *string)
-{
-  GimpDashboardPrivate *priv = dashboard->priv;
-  gchar                 buffer[1024];
-  const gchar          *s;
-  gint                  i;
+    case VARIABLE_TYPE_INT_RATIO:
+      return g_strdup_printf (
+        "%d:%d",
+        variable_data->value.int_ratio.antecedent,
+        variable_data->value.int_ratio.consequent);
 
-  if (priv->log_error)
-    return FALSE;
-
-  i = 0;
-
-  #define FLUSH()                                                 \
-    G_STMT_START                                                  \
-      {                                                           \
-        if (! g_output_stream_write_all (priv->log_output,        \
-                                         buffer, i, NULL,         \
-                                         NULL, &priv->log_error)) \
-          {                                                       \
-            return FALSE;                                         \
-          }                                                       \
-                                                                  \
-        i = 0;                                                    \
-      }                                                           \
-    G_STMT_END
-
-  #define RESERVE(n)                   \
-    G_STMT_START                       \
-      {                                \
-        if (i + (n) > sizeof (buffer)) \
-          FLUSH ();                    \
-      }                                \
-    G_STMT_END
-
-  for (s = string; *s; s++)
-    {
-      #define ESCAPE(from, to)                      \
-        case from:                                  \
-          RESERVE (sizeof (to) - 1);                \
-          memcpy (&buffer[i], to, sizeof (to) - 1); \
-          i += sizeof (to) - 1;                     \
-          break;
+    case VARIABLE_TYPE_PERCENTAGE:
+      return g_strdup (g_ascii_dtostr (buffer, sizeof (buffer),
+                                       variable_data->value.percentage));
 
-      switch (*s)
-        {
-        ESCAPE ('"',  "&quot;")
-        ESCAPE ('\'', "&apos;")
-        ESCAPE ('<',  "&lt;")
-        ESCAPE ('>',  "&gt;")
-        ESCAPE ('&',  "&amp;")
-
-        default:
-          RESERVE (1);
-          buffer[i++] = *s;
-          break;
-        }
+    case VARIABLE_TYPE_DURATION:
+      return g_strdup (g_ascii_dtostr (buffer, sizeof (buffer),
+                                       variable_data->value.duration));
 
-      #undef ESCAPE
+    case VARIABLE_TYPE_RATE_OF_CHANGE:
+      return g_strdup (g_ascii_dtostr (buffer, sizeof (buffer),
+                                       variable_data->value.rate_of_change));
     }
 
-  FLUSH ();
-
-  #undef FLUSH
-  #undef RESERVE
-
-  return TRUE;
-}
-
-static gint64
-gimp_dashboard_log_time (GimpDashboard *dashboard)
-{
-  GimpDashboardPrivate *priv = dashboard->priv;
-
-  return g_get_monotonic_time () - priv->log_start_time;
+  g_return_val_if_reached (NULL);
 }
 
 static void
 gimp_dashboard_log_sample (GimpDashboard *dashboard,
-                           gboolean       variables_changed,
-                           gboolean       include_current_thread)
+                           gboolean       variables_changed)
 {
-  GimpDashboardPrivate *priv      = dashboard->priv;
-  GimpBacktrace        *backtrace = NULL;
-  GArray               *addresses = NULL;
-  gboolean              empty     = TRUE;
+  GimpDashboardPrivate *priv = dashboard->priv;
+  gchar                *values[N_VARIABLES];
+  gint                  n_values = 0;
   Variable              variable;
 
-  #define NONEMPTY()                              \
-    G_STMT_START                                  \
-      {                                           \
-        if (empty)                                \
-          {                                       \
-            gimp_dashboard_log_printf (dashboard, \
-                                       ">\n");    \
-                                                  \
-            empty = FALSE;                        \
-          }                                       \
-      }                                           \
-    G_STMT_END
-
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "<sample id=\"%d\" t=\"%lld\"",
-                             priv->log_n_samples,
-                             (long long) gimp_dashboard_log_time (dashboard));
-
-  if (priv->log_n_samples == 0 || variables_changed)
+  if (! variables_changed)
     {
-      NONEMPTY ();
-
-      gimp_dashboard_log_printf (dashboard,
-                                 "<vars>\n");
-
-      for (variable = FIRST_VARIABLE; variable < N_VARIABLES; variable++)
-        {
-          const VariableInfo *variable_info     = &variables[variable];
-          const VariableData *variable_data     = &priv->variables[variable];
-          VariableData       *log_variable_data = &priv->log_variables[variable];
-
-          if (variable_info->exclude_from_log)
-            continue;
-
-          if (priv->log_n_samples > 0 &&
-              ! memcmp (variable_data, log_variable_data,
-                        sizeof (VariableData)))
-            {
-              continue;
-            }
-
-          *log_variable_data = *variable_data;
-
-          if (variable_data->available)
-            {
-              #define LOG_VAR(format, ...)                          \
-                gimp_dashboard_log_printf (dashboard,               \
-                                           "<%s>" format "</%s>\n", \
-                                           variable_info->name,     \
-                                           __VA_ARGS__,             \
-                                           variable_info->name)
-
-              #define LOG_VAR_FLOAT(value)                                  \
-                G_STMT_START                                                \
-                  {                                                         \
-                    gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];                  \
-                                                                            \
-                    LOG_VAR ("%s", g_ascii_dtostr (buffer, sizeof (buffer), \
-                                                   value));                 \
-                  }                                                         \
-                G_STMT_END
-
-              switch (variable_info->type)
-                {
-                case VARIABLE_TYPE_BOOLEAN:
-                  LOG_VAR (
-                    "%d",
-                    variable_data->value.boolean);
-                  break;
-
-                case VARIABLE_TYPE_INTEGER:
-                  LOG_VAR (
-                    "%d",
-                    variable_data->value.integer);
-                  break;
-
-                case VARIABLE_TYPE_SIZE:
-                  LOG_VAR (
-                    "%llu",
-                    (unsigned long long) variable_data->value.size);
-                  break;
-
-                case VARIABLE_TYPE_SIZE_RATIO:
-                  LOG_VAR (
-                    "%llu/%llu",
-                    (unsigned long long) variable_data->value.size_ratio.antecedent,
-                    (unsigned long long) variable_data->value.size_ratio.consequent);
-                  break;
-
-                case VARIABLE_TYPE_INT_RATIO:
-                  LOG_VAR (
-                    "%d:%d",
-                    variable_data->value.int_ratio.antecedent,
-                    variable_data->value.int_ratio.consequent);
-                  break;
-
-                case VARIABLE_TYPE_PERCENTAGE:
-                  LOG_VAR_FLOAT (
-                    variable_data->value.percentage);
-                  break;
-
-                case VARIABLE_TYPE_DURATION:
-                  LOG_VAR_FLOAT (
-                    variable_data->value.duration);
-                  break;
-
-                case VARIABLE_TYPE_RATE_OF_CHANGE:
-                  LOG_VAR_FLOAT (
-                    variable_data->value.rate_of_change);
-                  break;
-                }
-
-              #undef LOG_VAR
-              #undef LOG_VAR_FLOAT
-            }
-          else
-            {
-              gimp_dashboard_log_printf (dashboard,
-                                         "<%s />\n",
-                                         variable_info->name);
-            }
-        }
-
-      gimp_dashboard_log_printf (dashboard,
-                                 "</vars>\n");
-    }
-
-  if (priv->log_params.backtrace)
-    backtrace = gimp_backtrace_new (include_current_thread);
-
-  if (backtrace)
-    {
-      gboolean backtrace_empty = TRUE;
-      gint     n_threads;
-      gint     thread;
-
-      #define BACKTRACE_NONEMPTY()                           \
-        G_STMT_START                                         \
-          {                                                  \
-            if (backtrace_empty)                             \
-              {                                              \
-                NONEMPTY ();                                 \
-                                                             \
-                gimp_dashboard_log_printf (dashboard,        \
-                                           "<backtrace>\n"); \
-                                                             \
-                backtrace_empty = FALSE;                     \
-              }                                              \
-          }                                                  \
-        G_STMT_END
-
-      if (priv->log_backtrace)
-        {
-          n_threads = gimp_backtrace_get_n_threads (priv->log_backtrace);
-
-          for (thread = 0; thread < n_threads; thread++)
-            {
-              guintptr thread_id;
-
-              thread_id = gimp_backtrace_get_thread_id (priv->log_backtrace,
-                                                        thread);
-
-              if (gimp_backtrace_find_thread_by_id (backtrace,
-                                                    thread_id, thread) < 0)
-                {
-                  const gchar *thread_name;
-
-                  BACKTRACE_NONEMPTY ();
-
-                  thread_name =
-                    gimp_backtrace_get_thread_name (priv->log_backtrace,
-                                                    thread);
-
-                  gimp_dashboard_log_printf (dashboard,
-                                             "<thread id=\"%llu\"",
-                                             (unsigned long long) thread_id);
-
-                  if (thread_name)
-                    {
-                      gimp_dashboard_log_printf (dashboard,
-                                                 " name=\"");
-                      gimp_dashboard_log_print_escaped (dashboard, thread_name);
-                      gimp_dashboard_log_printf (dashboard,
-                                                 "\"");
-                    }
-
-                  gimp_dashboard_log_printf (dashboard,
-                                             " />\n");
-                }
-            }
-        }
-
-      n_threads = gimp_backtrace_get_n_threads (backtrace);
-
-      for (thread = 0; thread < n_threads; thread++)
-        {
-          guintptr     thread_id;
-          const gchar *thread_name;
-          gint         last_running  = -1;
-          gint         running;
-          gint         last_n_frames = -1;
-          gint         n_frames;
-          gint         n_head        = 0;
-          gint         n_tail        = 0;
-          gint         frame;
-
-          thread_id   = gimp_backtrace_get_thread_id     (backtrace, thread);
-          thread_name = gimp_backtrace_get_thread_name   (backtrace, thread);
-
-          running     = gimp_backtrace_is_thread_running (backtrace, thread);
-          n_frames    = gimp_backtrace_get_n_frames      (backtrace, thread);
-
-          if (priv->log_backtrace)
-            {
-              gint other_thread = gimp_backtrace_find_thread_by_id (
-                priv->log_backtrace, thread_id, thread);
-
-              if (other_thread >= 0)
-                {
-                  gint n;
-                  gint i;
-
-                  last_running  = gimp_backtrace_is_thread_running (
-                    priv->log_backtrace, other_thread);
-                  last_n_frames = gimp_backtrace_get_n_frames (
-                    priv->log_backtrace, other_thread);
+      gimp_performance_log_sample (priv->log, NULL, FALSE);
 
-                  n = MIN (n_frames, last_n_frames);
-
-                  for (i = 0; i < n; i++)
-                    {
-                      if (gimp_backtrace_get_frame_address (backtrace,
-                                                            thread, i) !=
-                          gimp_backtrace_get_frame_address (priv->log_backtrace,
-                                                            other_thread, i))
-                        {
-                          break;
-                        }
-                    }
-
-                  n_head  = i;
-                  n      -= i;
-
-                  for (i = 0; i < n; i++)
-                    {
-                      if (gimp_backtrace_get_frame_address (backtrace,
-                                                            thread, -i - 1) !=
-                          gimp_backtrace_get_frame_address (priv->log_backtrace,
-                                                            other_thread, -i - 1))
-                        {
-                          break;
-                        }
-                    }
-
-                  n_tail = i;
-                }
-            }
-
-          if (running         == last_running  &&
-              n_frames        == last_n_frames &&
-              n_head + n_tail == n_frames)
-            {
-              continue;
-            }
-
-          BACKTRACE_NONEMPTY ();
-
-          gimp_dashboard_log_printf (dashboard,
-                                     "<thread id=\"%llu\"",
-                                     (unsigned long long) thread_id);
-
-          if (thread_name)
-            {
-              gimp_dashboard_log_printf (dashboard,
-                                         " name=\"");
-              gimp_dashboard_log_print_escaped (dashboard, thread_name);
-              gimp_dashboard_log_printf (dashboard,
-                                         "\"");
-            }
-
-          gimp_dashboard_log_printf (dashboard,
-                                     " running=\"%d\"",
-                                     running);
-
-          if (n_head > 0)
-            {
-              gimp_dashboard_log_printf (dashboard,
-                                         " head=\"%d\"",
-                                         n_head);
-            }
-
-          if (n_tail > 0)
-            {
-              gimp_dashboard_log_printf (dashboard,
-                                         " tail=\"%d\"",
-                                         n_tail);
-            }
-
-          if (n_frames == 0 || n_head + n_tail < n_frames)
-            {
-              gimp_dashboard_log_printf (dashboard,
-                                          ">\n");
-
-              for (frame = n_head; frame < n_frames - n_tail; frame++)
-                {
-                  guintptr address;
-
-                  address = gimp_backtrace_get_frame_address (backtrace,
-                                                              thread, frame);
-
-                  gimp_dashboard_log_printf (dashboard,
-                                             "<frame address=\"0x%llx\" />\n",
-                                             (unsigned long long) address);
-
-                  if (g_hash_table_add (priv->log_addresses,
-                                        (gpointer) address) &&
-                      priv->log_params.progressive)
-                    {
-                      if (! addresses)
-                        {
-                          addresses = g_array_new (FALSE, FALSE,
-                                                   sizeof (guintptr));
-                        }
-
-                      g_array_append_val (addresses, address);
-                    }
-                }
-
-              gimp_dashboard_log_printf (dashboard,
-                                         "</thread>\n");
-            }
-          else
-            {
-              gimp_dashboard_log_printf (dashboard,
-                                         " />\n");
-            }
-        }
-
-      if (! backtrace_empty)
-        {
-          gimp_dashboard_log_printf (dashboard,
-                                     "</backtrace>\n");
-        }
-
-      #undef BACKTRACE_NONEMPTY
-    }
-  else if (priv->log_backtrace)
-    {
-      NONEMPTY ();
-
-      gimp_dashboard_log_printf (dashboard,
-                                 "<backtrace />\n");
-    }
-
-  gimp_backtrace_free (priv->log_backtrace);
-  priv->log_backtrace = backtrace;
-
-  if (empty)
-    {
-      gimp_dashboard_log_printf (dashboard,
-                                 " />\n");
-    }
-  else
-    {
-      gimp_dashboard_log_printf (dashboard,
-                                 "</sample>\n");
+      return;
     }
 
-  if (addresses)
+  for (variable = FIRST_VARIABLE; variable < N_VARIABLES; variable++)
     {
-      gimp_dashboard_log_write_address_map (dashboard,
-                                            (guintptr *) addresses->data,
-                                            addresses->len,
-                                            NULL);
+      if (variables[variable].exclude_from_log)
+        continue;
 
-      g_array_free (addresses, TRUE);
+      values[n_values++] = gimp_dashboard_log_variable_to_string (dashboard,
+                                                                  variable);
     }
 
-  if (priv->log_params.progressive)
-    g_output_stream_flush (priv->log_output, NULL, NULL);
-
-  #undef NONEMPTY
-
-  priv->log_n_samples++;
-}
-
-static void
-gimp_dashboard_log_add_marker_unlocked (GimpDashboard *dashboard,
-                                        const gchar   *description)
-{
-  GimpDashboardPrivate *priv = dashboard->priv;
-
-  priv->log_n_markers++;
+  gimp_performance_log_sample (priv->log, (const gchar * const *) values,
+                               FALSE);
 
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "<marker id=\"%d\" t=\"%lld\"",
-                             priv->log_n_markers,
-                             (long long) gimp_dashboard_log_time (dashboard));
-
-  if (description && description[0])
-    {
-      gimp_dashboard_log_printf (dashboard,
-                                 ">\n");
-      gimp_dashboard_log_print_escaped (dashboard, description);
-      gimp_dashboard_log_printf (dashboard,
-                                 "\n"
-                                 "</marker>\n");
-    }
-  else
-    {
-      gimp_dashboard_log_printf (dashboard,
-                                 " />\n");
-    }
-
-  gimp_dashboard_log_update_n_markers (dashboard);
+  while (n_values--)
+    g_free (values[n_values]);
 }
 
 static void
@@ -3991,258 +3528,6 @@ gimp_dashboard_log_update_n_markers (GimpDashboard *dashboard)
   gtk_label_set_text (priv->log_add_marker_label, buffer);
 }
 
-static gint
-gimp_dashboard_log_compare_addresses (gconstpointer a1,
-                                      gconstpointer a2)
-{
-  guintptr address1 = *(const guintptr *) a1;
-  guintptr address2 = *(const guintptr *) a2;
-
-  if (address1 < address2)
-    return -1;
-  else if (address1 > address2)
-    return +1;
-  else
-    return 0;
-}
-
-static void
-gimp_dashboard_log_write_address_map (GimpDashboard *dashboard,
-                                      guintptr      *addresses,
-                                      gint           n_addresses,
-                                      GimpAsync     *async)
-{
-  GimpBacktraceAddressInfo infos[2];
-  gint                     i;
-  gint                     n;
-
-  if (n_addresses == 0)
-    return;
-
-  qsort (addresses, n_addresses, sizeof (guintptr),
-         gimp_dashboard_log_compare_addresses);
-
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "<address-map>\n");
-
-  n = 0;
-
-  for (i = 0; i < n_addresses; i++)
-    {
-      GimpBacktraceAddressInfo       *info      = &infos[n       % 2];
-      const GimpBacktraceAddressInfo *prev_info = &infos[(n + 1) % 2];
-
-      if (async && gimp_async_is_canceled (async))
-        break;
-
-      if (gimp_backtrace_get_address_info (addresses[i], info))
-        {
-          gboolean empty = TRUE;
-
-          #define NONEMPTY()                              \
-            G_STMT_START                                  \
-              {                                           \
-                if (empty)                                \
-                  {                                       \
-                    gimp_dashboard_log_printf (dashboard, \
-                                               ">\n");    \
-                                                          \
-                    empty = FALSE;                        \
-                  }                                       \
-              }                                           \
-            G_STMT_END
-
-          gimp_dashboard_log_printf (dashboard,
-                                     "\n"
-                                     "<address value=\"0x%llx\"",
-                                     (unsigned long long) addresses[i]);
-
-          if (n == 0 || strcmp (info->object_name, prev_info->object_name))
-            {
-              NONEMPTY ();
-
-              if (info->object_name[0])
-                {
-                  gimp_dashboard_log_printf (dashboard,
-                                             "<object>");
-                  gimp_dashboard_log_print_escaped (dashboard,
-                                                    info->object_name);
-                  gimp_dashboard_log_printf (dashboard,
-                                             "</object>\n");
-                }
-              else
-                {
-                  gimp_dashboard_log_printf (dashboard,
-                                             "<object />\n");
-                }
-            }
-
-          if (n == 0 || strcmp (info->symbol_name, prev_info->symbol_name))
-            {
-              NONEMPTY ();
-
-              if (info->symbol_name[0])
-                {
-                  gimp_dashboard_log_printf (dashboard,
-                                             "<symbol>");
-                  gimp_dashboard_log_print_escaped (dashboard,
-                                                    info->symbol_name);
-                  gimp_dashboard_log_printf (dashboard,
-                                             "</symbol>\n");
-                }
-              else
-                {
-                  gimp_dashboard_log_printf (dashboard,
-                                             "<symbol />\n");
-                }
-            }
-
-          if (n == 0 || info->symbol_address != prev_info->symbol_address)
-            {
-              NONEMPTY ();
-
-              if (info->symbol_address)
-                {
-                  gimp_dashboard_log_printf (dashboard,
-                                             "<base>0x%llx</base>\n",
-                                             (unsigned long long)
-                                               info->symbol_address);
-                }
-              else
-                {
-                  gimp_dashboard_log_printf (dashboard,
-                                             "<base />\n");
-                }
-            }
-
-          if (n == 0 || strcmp (info->source_file, prev_info->source_file))
-            {
-              NONEMPTY ();
-
-              if (info->source_file[0])
-                {
-                  gimp_dashboard_log_printf (dashboard,
-                                             "<source>");
-                  gimp_dashboard_log_print_escaped (dashboard,
-                                                    info->source_file);
-                  gimp_dashboard_log_printf (dashboard,
-                                             "</source>\n");
-                }
-              else
-                {
-                  gimp_dashboard_log_printf (dashboard,
-                                             "<source />\n");
-                }
-            }
-
-          if (n == 0 || info->source_line != prev_info->source_line)
-            {
-              NONEMPTY ();
-
-              if (info->source_line)
-                {
-                  gimp_dashboard_log_printf (dashboard,
-                                             "<line>%d</line>\n",
-                                             info->source_line);
-                }
-              else
-                {
-                  gimp_dashboard_log_printf (dashboard,
-                                             "<line />\n");
-                }
-            }
-
-          if (empty)
-            {
-              gimp_dashboard_log_printf (dashboard,
-                                         " />\n");
-            }
-          else
-            {
-              gimp_dashboard_log_printf (dashboard,
-                                         "</address>\n");
-            }
-
-          #undef NONEMPTY
-
-          n++;
-        }
-    }
-
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "</address-map>\n");
-}
-
-static void
-gimp_dashboard_log_write_global_address_map (GimpAsync     *async,
-                                             GimpDashboard *dashboard)
-{
-  GimpDashboardPrivate *priv = dashboard->priv;
-  gint                  n_addresses;
-
-  n_addresses = g_hash_table_size (priv->log_addresses);
-
-  if (n_addresses > 0)
-    {
-      guintptr *addresses;
-      GList    *iter;
-      gint      i;
-
-      addresses = g_new (guintptr, n_addresses);
-
-      for (iter = g_hash_table_get_keys (priv->log_addresses), i = 0;
-           iter;
-           iter = g_list_next (iter), i++)
-        {
-          addresses[i] = (guintptr) iter->data;
-        }
-
-      gimp_dashboard_log_write_address_map (dashboard,
-                                            addresses, n_addresses,
-                                            async);
-
-      g_free (addresses);
-    }
-
-  gimp_async_finish (async, NULL);
-}
-
-static void
-gimp_dashboard_log_log_func (const gchar    *log_domain,
-                             GLogLevelFlags  log_levels,
-                             const gchar    *message,
-                             GimpDashboard  *dashboard)
-{
-  GimpDashboardPrivate *priv      = dashboard->priv;
-  const gchar          *log_level = NULL;
-  gchar                *description;
-
-  g_mutex_lock (&priv->mutex);
-
-  switch (log_levels & G_LOG_LEVEL_MASK)
-    {
-    case G_LOG_LEVEL_ERROR:    log_level = "ERROR";    break;
-    case G_LOG_LEVEL_CRITICAL: log_level = "CRITICAL"; break;
-    case G_LOG_LEVEL_WARNING:  log_level = "WARNING";  break;
-    case G_LOG_LEVEL_MESSAGE:  log_level = "MESSAGE";  break;
-    case G_LOG_LEVEL_INFO:     log_level = "INFO";     break;
-    case G_LOG_LEVEL_DEBUG:    log_level = "DEBUG";    break;
-    default:                   log_level = "UNKNOWN";  break;
-    }
-
-  description = g_strdup_printf ("[%s] %s: %s", log_domain, log_level, message);
-
-  gimp_dashboard_log_add_marker_unlocked (dashboard, description);
-
-  gimp_dashboard_log_sample (dashboard, FALSE, TRUE);
-
-  g_free (description);
-
-  g_mutex_unlock (&priv->mutex);
-}
-
 static gboolean
 gimp_dashboard_field_use_meter_underlay (Group group,
                                          gint  field)
@@ -4384,22 +3669,17 @@ gimp_dashboard_new (Gimp            *gimp,
 }
 
 gboolean
-gimp_dashboard_log_start_recording (GimpDashboard                 *dashboard,
-                                    GFile                         *file,
-                                    const GimpDashboardLogParams  *params,
-                                    GError                       **error)
+gimp_dashboard_log_start_recording (GimpDashboard                   *dashboard,
+                                    GFile                           *file,
+                                    const GimpPerformanceLogParams  *params,
+                                    GError                         **error)
 {
   GimpDashboardPrivate  *priv;
   GimpUIManager         *ui_manager;
   GimpActionGroup       *action_group;
-  gchar                 *version;
-  gchar                **envp;
-  gchar                **env;
-  GParamSpec           **pspecs;
-  guint                  n_pspecs;
-  gboolean               has_backtrace;
+  GimpPerformanceLogVar  vars[N_VARIABLES];
+  gint                   n_vars = 0;
   Variable               variable;
-  guint                  i;
 
   g_return_val_if_fail (GIMP_IS_DASHBOARD (dashboard), FALSE);
   g_return_val_if_fail (G_IS_FILE (file), FALSE);
@@ -4409,264 +3689,48 @@ gimp_dashboard_log_start_recording (GimpDashboard                 *dashboard,
 
   g_return_val_if_fail (! gimp_dashboard_log_is_recording (dashboard), FALSE);
 
-  if (! params)
-    params = gimp_dashboard_log_get_default_params (dashboard);
-
-  priv->log_params = *params;
-
-  if (g_getenv ("GIMP_PERFORMANCE_LOG_SAMPLE_FREQUENCY"))
-    {
-      priv->log_params.sample_frequency =
-        atoi (g_getenv ("GIMP_PERFORMANCE_LOG_SAMPLE_FREQUENCY"));
-    }
-
-  if (g_getenv ("GIMP_PERFORMANCE_LOG_BACKTRACE"))
-    {
-      priv->log_params.backtrace =
-        atoi (g_getenv ("GIMP_PERFORMANCE_LOG_BACKTRACE")) ? 1 : 0;
-    }
-
-  if (g_getenv ("GIMP_PERFORMANCE_LOG_MESSAGES"))
-    {
-      priv->log_params.messages =
-        atoi (g_getenv ("GIMP_PERFORMANCE_LOG_MESSAGES")) ? 1 : 0;
-    }
-
-  if (g_getenv ("GIMP_PERFORMANCE_LOG_PROGRESSIVE"))
-    {
-      priv->log_params.progressive =
-        atoi (g_getenv ("GIMP_PERFORMANCE_LOG_PROGRESSIVE")) ? 1 : 0;
-    }
-
-  priv->log_params.sample_frequency = CLAMP (priv->log_params.sample_frequency,
-                                             LOG_SAMPLE_FREQUENCY_MIN,
-                                             LOG_SAMPLE_FREQUENCY_MAX);
-
-  g_mutex_lock (&priv->mutex);
-
-  if (priv->log_params.progressive     &&
-      g_file_query_exists (file, NULL) &&
-      ! g_file_delete (file, NULL, error))
-    {
-      g_mutex_unlock (&priv->mutex);
-
-      return FALSE;
-    }
-
-  priv->log_output = G_OUTPUT_STREAM (g_file_replace (file,
-                                      NULL, FALSE, G_FILE_CREATE_NONE, NULL,
-                                      error));
-
-  if (! priv->log_output)
-    {
-      g_mutex_unlock (&priv->mutex);
-
-      return FALSE;
-    }
-
-  priv->log_error      = NULL;
-  priv->log_start_time = g_get_monotonic_time ();
-  priv->log_n_samples  = 0;
-  priv->log_n_markers  = 0;
-  priv->log_backtrace  = NULL;
-  priv->log_addresses  = g_hash_table_new (NULL, NULL);
-
-  if (priv->log_params.backtrace)
-    has_backtrace = gimp_backtrace_start ();
-  else
-    has_backtrace = FALSE;
-
-  gimp_dashboard_log_printf (dashboard,
-                             "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
-                             "<gimp-performance-log version=\"%d\">\n",
-                             LOG_VERSION);
-
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "<params>\n"
-                             "<sample-frequency>%d</sample-frequency>\n"
-                             "<backtrace>%d</backtrace>\n"
-                             "<messages>%d</messages>\n"
-                             "<progressive>%d</progressive>\n"
-                             "</params>\n",
-                             priv->log_params.sample_frequency,
-                             has_backtrace,
-                             priv->log_params.messages,
-                             priv->log_params.progressive);
-
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "<info>\n");
-
-  version = gimp_version (TRUE, FALSE);
-
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "<gimp-version>\n");
-  gimp_dashboard_log_print_escaped (dashboard, version);
-  gimp_dashboard_log_printf (dashboard,
-                             "</gimp-version>\n");
-
-  g_free (version);
-
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "<env>\n");
-
-  envp = g_get_environ ();
-
-  for (env = envp; *env; env++)
-    {
-      if (g_str_has_prefix (*env, "BABL_") ||
-          g_str_has_prefix (*env, "GEGL_") ||
-          g_str_has_prefix (*env, "GIMP_"))
-        {
-          gchar       *delim = strchr (*env, '=');
-          const gchar *s;
-
-          if (! delim)
-            continue;
-
-          for (s = *env;
-               s != delim && (g_ascii_isalnum (*s) || *s == '_' || *s == '-');
-               s++);
-
-          if (s != delim)
-            continue;
-
-          *delim = '\0';
-
-          gimp_dashboard_log_printf (dashboard,
-                                     "<%s>",
-                                     *env);
-          gimp_dashboard_log_print_escaped (dashboard, delim + 1);
-          gimp_dashboard_log_printf (dashboard,
-                                     "</%s>\n",
-                                     *env);
-        }
-    }
-
-  g_strfreev (envp);
-
-  gimp_dashboard_log_printf (dashboard,
-                             "</env>\n");
-
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "<gegl-config>\n");
-
-  pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (gegl_config ()),
-                                           &n_pspecs);
-
-  for (i = 0; i < n_pspecs; i++)
-    {
-      const GParamSpec *pspec     = pspecs[i];
-      GValue            value     = {};
-      GValue            str_value = {};
-
-      g_value_init (&value,     pspec->value_type);
-      g_value_init (&str_value, G_TYPE_STRING);
-
-      g_object_get_property (G_OBJECT (gegl_config ()), pspec->name, &value);
-
-      if (g_value_transform (&value, &str_value))
-        {
-          gimp_dashboard_log_printf (dashboard,
-                                     "<%s>",
-                                     pspec->name);
-          gimp_dashboard_log_print_escaped (dashboard,
-                                            g_value_get_string (&str_value));
-          gimp_dashboard_log_printf (dashboard,
-                                     "</%s>\n",
-                                     pspec->name);
-        }
-
-      g_value_unset (&str_value);
-      g_value_unset (&value);
-    }
-
-  g_free (pspecs);
-
-  gimp_dashboard_log_printf (dashboard,
-                             "</gegl-config>\n");
-
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "</info>\n");
-
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "<var-defs>\n");
-
   for (variable = FIRST_VARIABLE; variable < N_VARIABLES; variable++)
     {
-      const VariableInfo *variable_info = &variables[variable];
-      const gchar        *type          = "";
+      const VariableInfo    *variable_info = &variables[variable];
+      GimpPerformanceLogVar *var;
 
       if (variable_info->exclude_from_log)
         continue;
 
+      var = &vars[n_vars++];
+
+      var->name        = variable_info->name;
+      /* intentionally untranslated */
+      var->description = variable_info->description;
+
       switch (variable_info->type)
         {
-        case VARIABLE_TYPE_BOOLEAN:        type = "boolean";        break;
-        case VARIABLE_TYPE_INTEGER:        type = "integer";        break;
-        case VARIABLE_TYPE_SIZE:           type = "size";           break;
-        case VARIABLE_TYPE_SIZE_RATIO:     type = "size-ratio";     break;
-        case VARIABLE_TYPE_INT_RATIO:      type = "int-ratio";      break;
-        case VARIABLE_TYPE_PERCENTAGE:     type = "percentage";     break;
-        case VARIABLE_TYPE_DURATION:       type = "duration";       break;
-        case VARIABLE_TYPE_RATE_OF_CHANGE: type = "rate-of-change"; break;
+        case VARIABLE_TYPE_BOOLEAN:        var->type = "boolean";        break;
+        case VARIABLE_TYPE_INTEGER:        var->type = "integer";        break;
+        case VARIABLE_TYPE_SIZE:           var->type = "size";           break;
+        case VARIABLE_TYPE_SIZE_RATIO:     var->type = "size-ratio";     break;
+        case VARIABLE_TYPE_INT_RATIO:      var->type = "int-ratio";      break;
+        case VARIABLE_TYPE_PERCENTAGE:     var->type = "percentage";     break;
+        case VARIABLE_TYPE_DURATION:       var->type = "duration";       break;
+        case VARIABLE_TYPE_RATE_OF_CHANGE: var->type = "rate-of-change"; break;
         }
-
-      gimp_dashboard_log_printf (dashboard,
-                                 "<var name=\"%s\" type=\"%s\" desc=\"",
-                                 variable_info->name,
-                                 type);
-      gimp_dashboard_log_print_escaped (dashboard,
-                                        /* intentionally untranslated */
-                                        variable_info->description);
-      gimp_dashboard_log_printf (dashboard,
-                                 "\" />\n");
     }
 
-  gimp_dashboard_log_printf (dashboard,
-                             "</var-defs>\n");
+  g_mutex_lock (&priv->mutex);
 
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "<samples>\n");
+  priv->log = gimp_performance_log_new (file, params, vars, n_vars, error);
 
-  if (priv->log_error)
+  if (! priv->log)
     {
-      GCancellable *cancellable = g_cancellable_new ();
-
-      gimp_backtrace_stop ();
-
-      /* Cancel the overwrite initiated by g_file_replace(). */
-      g_cancellable_cancel (cancellable);
-      g_output_stream_close (priv->log_output, cancellable, NULL);
-      g_object_unref (cancellable);
-
-      g_clear_object (&priv->log_output);
-
-      g_propagate_error (error, priv->log_error);
-      priv->log_error = NULL;
-
       g_mutex_unlock (&priv->mutex);
 
       return FALSE;
     }
 
-  gimp_dashboard_reset_unlocked (dashboard);
+  priv->log_params    = *gimp_performance_log_get_params (priv->log);
+  priv->log_n_markers = 0;
 
-  if (priv->log_params.messages)
-    {
-      priv->log_log_handler = gimp_log_set_handler (
-        TRUE,
-        G_LOG_LEVEL_MASK | G_LOG_FLAG_FATAL | G_LOG_FLAG_RECURSION,
-        (GLogFunc) gimp_dashboard_log_log_func,
-        dashboard);
-    }
+  gimp_dashboard_reset_unlocked (dashboard);
 
   priv->update_now = TRUE;
   g_cond_signal (&priv->cond);
@@ -4692,7 +3756,8 @@ gimp_dashboard_log_stop_recording (GimpDashboard  *dashboard,
   GimpDashboardPrivate *priv;
   GimpUIManager        *ui_manager;
   GimpActionGroup      *action_group;
-  gboolean              result = TRUE;
+  GimpPerformanceLog   *log;
+  gboolean              result;
 
   g_return_val_if_fail (GIMP_IS_DASHBOARD (dashboard), FALSE);
   g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
@@ -4702,71 +3767,18 @@ gimp_dashboard_log_stop_recording (GimpDashboard  *dashboard,
   if (! gimp_dashboard_log_is_recording (dashboard))
     return TRUE;
 
+  /*  detach the log first, so that the sampler thread doesn't touch it
+   *  while it's being finalized
+   */
   g_mutex_lock (&priv->mutex);
 
-  if (priv->log_log_handler)
-    {
-      gimp_log_remove_handler (priv->log_log_handler);
-
-      priv->log_log_handler = 0;
-    }
-
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "</samples>\n");
-
-
-  if (! priv->log_params.progressive &&
-      g_hash_table_size (priv->log_addresses) > 0)
-    {
-      GimpAsync *async;
-
-      async = gimp_parallel_run_async_independent (
-        (GimpRunAsyncFunc) gimp_dashboard_log_write_global_address_map,
-        dashboard);
-
-      gimp_wait (priv->gimp, GIMP_WAITABLE (async),
-                 _("Resolving symbol information..."));
-
-      g_object_unref (async);
-    }
-
-  gimp_dashboard_log_printf (dashboard,
-                             "\n"
-                             "</gimp-performance-log>\n");
-
-  if (priv->log_params.backtrace)
-    gimp_backtrace_stop ();
-
-  if (! priv->log_error)
-    {
-      g_output_stream_close (priv->log_output, NULL, &priv->log_error);
-    }
-  else
-    {
-      GCancellable *cancellable = g_cancellable_new ();
-
-      /* Cancel the overwrite initiated by g_file_replace(). */
-      g_cancellable_cancel (cancellable);
-      g_output_stream_close (priv->log_output, cancellable, NULL);
-      g_object_unref (cancellable);
-    }
-
-  g_clear_object (&priv->log_output);
-
-  if (priv->log_error)
-    {
-      g_propagate_error (error, priv->log_error);
-      priv->log_error = NULL;
-
-      result = FALSE;
-    }
-
-  g_clear_pointer (&priv->log_backtrace, gimp_backtrace_free);
-  g_clear_pointer (&priv->log_addresses, g_hash_table_unref);
+  log       = priv->log;
+  priv->log = NULL;
 
   g_mutex_unlock (&priv->mutex);
 
+  result = gimp_performance_log_close (log, priv->gimp, error);
+
   ui_manager   = gimp_editor_get_ui_manager (GIMP_EDITOR (dashboard));
   action_group = gimp_ui_manager_get_action_group (ui_manager, "dashboard");
 
@@ -4786,23 +3798,15 @@ gimp_dashboard_log_is_recording (GimpDashboard *dashboard)
 
   priv = dashboard->priv;
 
-  return priv->log_output != NULL;
+  return priv->log != NULL;
 }
 
-const GimpDashboardLogParams *
+const GimpPerformanceLogParams *
 gimp_dashboard_log_get_default_params (GimpDashboard *dashboard)
 {
-  static const GimpDashboardLogParams default_params =
-  {
-    .sample_frequency = LOG_DEFAULT_SAMPLE_FREQUENCY,
-    .backtrace        = LOG_DEFAULT_BACKTRACE,
-    .messages         = LOG_DEFAULT_MESSAGES,
-    .progressive      = LOG_DEFAULT_PROGRESSIVE
-  };
-
   g_return_val_if_fail (GIMP_IS_DASHBOARD (dashboard), NULL);
 
-  return &default_params;
+  return gimp_performance_log_get_default_params ();
 }
 
 void
@@ -4816,11 +3820,10 @@ gimp_dashboard_log_add_marker (GimpDashboard *dashboard,
 
   priv = dashboard->priv;
 
-  g_mutex_lock (&priv->mutex);
-
-  gimp_dashboard_log_add_marker_unlocked (dashboard, description);
+  priv->log_n_markers = gimp_performance_log_add_marker (priv->log,
+                                                         description);
 
-  g_mutex_unlock (&priv->mutex);
+  gimp_dashboard_log_update_n_markers (dashboard);
 }
 
 void
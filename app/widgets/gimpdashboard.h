@@ -25,15 +25,6 @@
 #include "gimpeditor.h"
 
 
-struct _GimpDashboardLogParams
-{
-  gint     sample_frequency;
-  gboolean backtrace;
-  gboolean messages;
-  gboolean progressive;
-};
-
-
 #define GIMP_TYPE_DASHBOARD            (gimp_dashboard_get_type ())
 #define GIMP_DASHBOARD(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIMP_TYPE_DASHBOARD, GimpDashboard))
 #define GIMP_DASHBOARD_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GIMP_TYPE_DASHBOARD, GimpDashboardClass))
@@ -58,38 +49,38 @@ struct _GimpDashboardClass
 };
 
 
-GType                          gimp_dashboard_get_type                   (void) G_GNUC_CONST;
+GType                            gimp_dashboard_get_type                   (void) G_GNUC_CONST;
 
-GtkWidget                    * gimp_dashboard_new                        (Gimp                          *gimp,
-                                                                          GimpMenuFactory               *menu_factory);
+GtkWidget                      * gimp_dashboard_new                        (Gimp                            *gimp,
+                                                                            GimpMenuFactory                 *menu_factory);
 
-gboolean                       gimp_dashboard_log_start_recording        (GimpDashboard                 *dashboard,
-                                                                          GFile                         *file,
-                                                                          const GimpDashboardLogParams  *params,
-                                                                          GError                       **error);
-gboolean                       gimp_dashboard_log_stop_recording         (GimpDashboard                 *dashboard,
-                                                                          GError                       **error);
-gboolean                       gimp_dashboard_log_is_recording           (GimpDashboard                 *dashboard);
-const GimpDashboardLogParams * gimp_dashboard_log_get_default_params     (GimpDashboard                 *dashboard);
-void                           gimp_dashboard_log_add_marker             (GimpDashboard                 *dashboard,
-                                                                          const gchar                   *description);
+gboolean                         gimp_dashboard_log_start_recording        (GimpDashboard                   *dashboard,
+                                                                            GFile                           *file,
+                                                                            const GimpPerformanceLogParams  *params,
+                                                                            GError                         **error);
+gboolean                         gimp_dashboard_log_stop_recording         (GimpDashboard                   *dashboard,
+                                                                            GError                         **error);
+gboolean                         gimp_dashboard_log_is_recording           (GimpDashboard                   *dashboard);
+const GimpPerformanceLogParams * gimp_dashboard_log_get_default_params     (GimpDashboard                   *dashboard);
+void                             gimp_dashboard_log_add_marker             (GimpDashboard                   *dashboard,
+                                                                            const gchar                     *description);
 
-void                           gimp_dashboard_reset                      (GimpDashboard                 *dashboard);
+void                             gimp_dashboard_reset                      (GimpDashboard                   *dashboard);
 
-void                           gimp_dashboard_set_update_interval        (GimpDashboard                 *dashboard,
-                                                                          GimpDashboardUpdateInteval     update_interval);
-GimpDashboardUpdateInteval     gimp_dashboard_get_update_interval        (GimpDashboard                 *dashboard);
+void                             gimp_dashboard_set_update_interval        (GimpDashboard                   *dashboard,
+                                                                            GimpDashboardUpdateInteval       update_interval);
+GimpDashboardUpdateInteval       gimp_dashboard_get_update_interval        (GimpDashboard                   *dashboard);
 
-void                           gimp_dashboard_set_history_duration       (GimpDashboard                 *dashboard,
-                                                                          GimpDashboardHistoryDuration   history_duration);
-GimpDashboardHistoryDuration   gimp_dashboard_get_history_duration       (GimpDashboard                 *dashboard);
+void                             gimp_dashboard_set_history_duration       (GimpDashboard                   *dashboard,
+                                                                            GimpDashboardHistoryDuration     history_duration);
+GimpDashboardHistoryDuration     gimp_dashboard_get_history_duration       (GimpDashboard                   *dashboard);
 
-void                           gimp_dashboard_set_low_swap_space_warning (GimpDashboard                 *dashboard,
-                                                                          gboolean                       low_swap_space_warning);
-gboolean                       gimp_dashboard_get_low_swap_space_warning (GimpDashboard                 *dashboard);
+void                             gimp_dashboard_set_low_swap_space_warning (GimpDashboard                   *dashboard,
+                                                                            gboolean                         low_swap_space_warning);
+gboolean                         gimp_dashboard_get_low_swap_space_warning (GimpDashboard                   *dashboard);
 
-void                           gimp_dashboard_menu_setup                 (GimpUIManager                 *manager,
-                                                                          const gchar                   *ui_path);
+void                             gimp_dashboard_menu_setup                 (GimpUIManager                   *manager,
+                                                                            const gchar                     *ui_path);
 
 
 #endif  /*  __GIMP_DASHBOARD_H__  */
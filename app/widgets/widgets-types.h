@@ -292,8 +292,6 @@ typedef struct _GimpToggleActionEntry        GimpToggleActionEntry;
 
 typedef struct _GimpDialogFactoryEntry       GimpDialogFactoryEntry;
 
-typedef struct _GimpDashboardLogParams       GimpDashboardLogParams;
-
 
 /*  function types  */
 
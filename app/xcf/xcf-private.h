@@ -92,7 +92,20 @@ typedef enum
   XCF_GROUP_ITEM_EXPANDED      = 1
 } XcfGroupItemFlagsType;
 
-typedef struct _XcfInfo  XcfInfo;
+typedef struct _XcfConstantTile XcfConstantTile;
+typedef struct _XcfInfo         XcfInfo;
+
+/* the encoding of the last constant-color tile, reused for all following
+ * tiles of the same color and size when saving
+ */
+struct _XcfConstantTile
+{
+  gint     bpp;
+  gint     n_pixels;
+  guint8   pixel[32];
+  guint8  *data;
+  gsize    length;
+};
 
 struct _XcfInfo
 {
@@ -112,6 +125,11 @@ struct _XcfInfo
   goffset             floating_sel_offset;
   XcfCompressionType  compression;
   gint                file_version;
+
+  /* tile statistics, used when saving */
+  gint                n_tiles;
+  gint                n_constant_tiles;
+  XcfConstantTile     constant_tile;
 };
 
 
@@ -36,6 +36,7 @@
 #include "core/gimpcontainer.h"
 #include "core/gimpchannel.h"
 #include "core/gimpdrawable.h"
+#include "core/gimpdrawable-content-bounds.h"
 #include "core/gimpgrid.h"
 #include "core/gimpguide.h"
 #include "core/gimpimage.h"
@@ -68,8 +69,11 @@
 #include "xcf-read.h"
 #include "xcf-save.h"
 #include "xcf-seek.h"
+#include "xcf-utils.h"
 #include "xcf-write.h"
 
+#include "gimp-log.h"
+
 #include "gimp-intl.h"
 
 
@@ -99,25 +103,35 @@ static gboolean xcf_save_channel       (XcfInfo           *info,
                                         GError           **error);
 static gboolean xcf_save_buffer        (XcfInfo           *info,
                                         GeglBuffer        *buffer,
+                                        GeglRectangle     *content_bounds,
                                         GError           **error);
 static gboolean xcf_save_level         (XcfInfo           *info,
                                         GeglBuffer        *buffer,
+                                        GeglRectangle     *content_bounds,
                                         GError           **error);
+static void     xcf_save_tile_get_data (GeglBuffer        *buffer,
+                                        GeglRectangle     *tile_rect,
+                                        const Babl        *format,
+                                        gboolean           empty,
+                                        guchar            *tile_data);
 static gboolean xcf_save_tile          (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GeglRectangle     *tile_rect,
                                         const Babl        *format,
+                                        gboolean           empty,
                                         GError           **error);
 static gboolean xcf_save_tile_rle      (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GeglRectangle     *tile_rect,
                                         const Babl        *format,
+                                        gboolean           empty,
                                         guchar            *rlebuf,
                                         GError           **error);
 static gboolean xcf_save_tile_zlib     (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GeglRectangle     *tile_rect,
                                         const Babl        *format,
+                                        gboolean           empty,
                                         GError           **error);
 static gboolean xcf_save_parasite      (XcfInfo           *info,
                                         GimpParasite      *parasite,
@@ -350,6 +364,9 @@ xcf_save_image (XcfInfo    *info,
   g_list_free (all_layers);
   g_list_free (all_channels);
 
+  GIMP_LOG (XCF, "saved %d tiles, %d of them constant",
+            info->n_tiles, info->n_constant_tiles);
+
   return ! g_output_stream_is_closed (info->output);
 }
 
@@ -1402,7 +1419,7 @@ xcf_save_layer (XcfInfo    *info,
 
   xcf_check_error (xcf_save_buffer (info,
                                     gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                    error));
+                                    NULL, error));
 
   offset = info->cp;
 
@@ -1428,11 +1445,12 @@ xcf_save_channel (XcfInfo      *info,
                   GimpChannel  *channel,
                   GError      **error)
 {
-  goffset      saved_pos;
-  goffset      offset;
-  guint32      value;
-  const gchar *string;
-  GError      *tmp_error = NULL;
+  goffset        saved_pos;
+  goffset        offset;
+  guint32        value;
+  const gchar   *string;
+  GeglRectangle  content_bounds;
+  GError        *tmp_error = NULL;
 
   /* check and see if this is the drawable that the floating
    *  selection is attached to.
@@ -1463,9 +1481,15 @@ xcf_save_channel (XcfInfo      *info,
   offset = info->cp + info->bytes_per_offset;
   xcf_write_offset_check_error (info, &offset, 1);
 
+  /* a channel is zero outside of its content bounds, so the tiles there
+   * don't need to be read
+   */
+  gimp_drawable_get_content_bounds (GIMP_DRAWABLE (channel), FALSE,
+                                    &content_bounds);
+
   xcf_check_error (xcf_save_buffer (info,
                                     gimp_drawable_get_buffer (GIMP_DRAWABLE (channel)),
-                                    error));
+                                    &content_bounds, error));
 
   return TRUE;
 }
@@ -1488,9 +1512,10 @@ xcf_calc_levels (gint size,
 
 
 static gboolean
-xcf_save_buffer (XcfInfo     *info,
-                 GeglBuffer  *buffer,
-                 GError     **error)
+xcf_save_buffer (XcfInfo        *info,
+                 GeglBuffer     *buffer,
+                 GeglRectangle  *content_bounds,
+                 GError        **error)
 {
   const Babl *format;
   goffset     saved_pos;
@@ -1543,7 +1568,8 @@ xcf_save_buffer (XcfInfo     *info,
       if (i == 0)
         {
           /* write out the level. */
-          xcf_check_error (xcf_save_level (info, buffer, error));
+          xcf_check_error (xcf_save_level (info, buffer, content_bounds,
+                                           error));
         }
       else
         {
@@ -1577,9 +1603,10 @@ xcf_save_buffer (XcfInfo     *info,
 }
 
 static gboolean
-xcf_save_level (XcfInfo     *info,
-                GeglBuffer  *buffer,
-                GError     **error)
+xcf_save_level (XcfInfo        *info,
+                GeglBuffer     *buffer,
+                GeglRectangle  *content_bounds,
+                GError        **error)
 {
   const Babl *format;
   goffset    *offset_table;
@@ -1646,28 +1673,35 @@ xcf_save_level (XcfInfo     *info,
   for (i = 0; i < ntiles; i++)
     {
       GeglRectangle rect;
+      gboolean      empty;
 
       /* store the offset in the table and increment the next pointer */
       *next_offset++ = offset;
 
+      info->n_tiles++;
+
       gimp_gegl_buffer_get_tile_rect (buffer,
                                       XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
                                       i, &rect);
 
+      /* tiles outside of the content bounds are known to be zero */
+      empty = content_bounds &&
+              ! gegl_rectangle_intersect (NULL, &rect, content_bounds);
+
       /* write out the tile. */
       switch (info->compression)
         {
         case COMPRESS_NONE:
           xcf_check_error (xcf_save_tile (info, buffer, &rect, format,
-                                          error));
+                                          empty, error));
           break;
         case COMPRESS_RLE:
           xcf_check_error (xcf_save_tile_rle (info, buffer, &rect, format,
-                                              rlebuf, error));
+                                              empty, rlebuf, error));
           break;
         case COMPRESS_ZLIB:
           xcf_check_error (xcf_save_tile_zlib (info, buffer, &rect, format,
-                                               error));
+                                               empty, error));
           break;
         case COMPRESS_FRACTAL:
           g_warning ("xcf: fractal compression unimplemented");
@@ -1698,11 +1732,32 @@ xcf_save_level (XcfInfo     *info,
   return TRUE;
 }
 
+static void
+xcf_save_tile_get_data (GeglBuffer    *buffer,
+                        GeglRectangle *tile_rect,
+                        const Babl    *format,
+                        gboolean       empty,
+                        guchar        *tile_data)
+{
+  if (empty)
+    {
+      memset (tile_data, 0,
+              babl_format_get_bytes_per_pixel (format) *
+              tile_rect->width * tile_rect->height);
+    }
+  else
+    {
+      gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+    }
+}
+
 static gboolean
 xcf_save_tile (XcfInfo        *info,
                GeglBuffer     *buffer,
                GeglRectangle  *tile_rect,
                const Babl     *format,
+               gboolean        empty,
                GError        **error)
 {
   gint    bpp       = babl_format_get_bytes_per_pixel (format);
@@ -1710,8 +1765,7 @@ xcf_save_tile (XcfInfo        *info,
   guchar *tile_data = g_alloca (tile_size);
   GError *tmp_error = NULL;
 
-  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  xcf_save_tile_get_data (buffer, tile_rect, format, empty, tile_data);
 
   if (info->file_version <= 11)
     {
@@ -1733,18 +1787,19 @@ xcf_save_tile_rle (XcfInfo        *info,
                    GeglBuffer     *buffer,
                    GeglRectangle  *tile_rect,
                    const Babl     *format,
+                   gboolean        empty,
                    guchar         *rlebuf,
                    GError        **error)
 {
   gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
+  gint    n_pixels  = tile_rect->width * tile_rect->height;
+  gint    tile_size = bpp * n_pixels;
   guchar *tile_data = g_alloca (tile_size);
   gint    len       = 0;
   gint    i, j;
   GError *tmp_error  = NULL;
 
-  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  xcf_save_tile_get_data (buffer, tile_rect, format, empty, tile_data);
 
   if (info->file_version >= 12)
     {
@@ -1754,6 +1809,35 @@ xcf_save_tile_rle (XcfInfo        *info,
                        tile_size / bpp * n_components);
     }
 
+  /* constant tiles (in particular, fully transparent ones) encode as a
+   * single run per byte plane.  emit it directly; the result is identical
+   * to what the general encoder below produces.
+   */
+  if (xcf_data_is_constant (tile_data, n_pixels, bpp))
+    {
+      info->n_constant_tiles++;
+
+      for (i = 0; i < bpp; i++)
+        {
+          if (n_pixels >= 128)
+            {
+              rlebuf[len++] = 127;
+              rlebuf[len++] = (n_pixels >> 8);
+              rlebuf[len++] = n_pixels & 0x00FF;
+              rlebuf[len++] = tile_data[i];
+            }
+          else
+            {
+              rlebuf[len++] = n_pixels - 1;
+              rlebuf[len++] = tile_data[i];
+            }
+        }
+
+      xcf_write_int8_check_error (info, rlebuf, len);
+
+      return TRUE;
+    }
+
   for (i = 0; i < bpp; i++)
     {
       const guchar *data   = tile_data + i;
@@ -1867,10 +1951,12 @@ xcf_save_tile_zlib (XcfInfo        *info,
                     GeglBuffer     *buffer,
                     GeglRectangle  *tile_rect,
                     const Babl     *format,
+                    gboolean        empty,
                     GError        **error)
 {
   gint      bpp       = babl_format_get_bytes_per_pixel (format);
-  gint      tile_size = bpp * tile_rect->width * tile_rect->height;
+  gint      n_pixels  = tile_rect->width * tile_rect->height;
+  gint      tile_size = bpp * n_pixels;
   guchar   *tile_data = g_alloca (tile_size);
   /* The buffer for compressed data. */
   guchar   *buf       = g_alloca (tile_size);
@@ -1879,8 +1965,7 @@ xcf_save_tile_zlib (XcfInfo        *info,
   int       action;
   int       status;
 
-  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  xcf_save_tile_get_data (buffer, tile_rect, format, empty, tile_data);
 
   if (info->file_version >= 12)
     {
@@ -1890,6 +1975,51 @@ xcf_save_tile_zlib (XcfInfo        *info,
                        tile_size / bpp * n_components);
     }
 
+  /* constant tiles (in particular, fully transparent ones) usually come in
+   * large numbers.  compress such a tile once, and write out the cached
+   * data for all following tiles of the same color and size.
+   */
+  if (bpp <= (gint) sizeof (info->constant_tile.pixel) &&
+      xcf_data_is_constant (tile_data, n_pixels, bpp))
+    {
+      XcfConstantTile *constant_tile = &info->constant_tile;
+
+      info->n_constant_tiles++;
+
+      if (! constant_tile->data            ||
+          constant_tile->bpp      != bpp      ||
+          constant_tile->n_pixels != n_pixels ||
+          memcmp (constant_tile->pixel, tile_data, bpp))
+        {
+          uLongf length = compressBound (tile_size);
+
+          g_free (constant_tile->data);
+          constant_tile->data = g_malloc (length);
+
+          status = compress2 (constant_tile->data, &length,
+                              tile_data, tile_size,
+                              Z_DEFAULT_COMPRESSION);
+
+          if (status != Z_OK)
+            {
+              g_printerr ("xcf: tile compression failed: %s",
+                          zError (status));
+              g_clear_pointer (&constant_tile->data, g_free);
+              return FALSE;
+            }
+
+          constant_tile->bpp      = bpp;
+          constant_tile->n_pixels = n_pixels;
+          constant_tile->length   = length;
+          memcpy (constant_tile->pixel, tile_data, bpp);
+        }
+
+      xcf_write_int8_check_error (info, constant_tile->data,
+                                  constant_tile->length);
+
+      return TRUE;
+    }
+
   /* allocate deflate state */
   strm.zalloc = Z_NULL;
   strm.zfree  = Z_NULL;
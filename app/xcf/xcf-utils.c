@@ -17,6 +17,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <cairo.h>
 #include <gegl.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -51,3 +53,20 @@ xcf_data_is_zero (const void *data,
 
   return TRUE;
 }
+
+gboolean
+xcf_data_is_constant (const void *data,
+                      gint        n_pixels,
+                      gint        bpp)
+{
+  const guint8 *data8 = data;
+  gint          size  = n_pixels * bpp;
+
+  if (size <= bpp)
+    return TRUE;
+
+  /* every pixel is equal to the first one iff the data is equal to
+   * itself shifted by one pixel
+   */
+  return ! memcmp (data8, data8 + bpp, size - bpp);
+}
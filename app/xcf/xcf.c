@@ -45,6 +45,7 @@
 #include "xcf-save.h"
 
 #include "gimp-intl.h"
+#include "gimp-trace.h"
 
 
 typedef GimpImage * GimpXcfLoaderFunc (Gimp     *gimp,
@@ -243,11 +244,12 @@ xcf_load_stream (Gimp          *gimp,
                  GimpProgress  *progress,
                  GError       **error)
 {
-  XcfInfo      info  = { 0, };
-  const gchar *filename;
-  GimpImage   *image = NULL;
-  gchar        id[14];
-  gboolean     success;
+  XcfInfo        info  = { 0, };
+  const gchar   *filename;
+  GimpImage     *image = NULL;
+  gchar          id[14];
+  gboolean       success;
+  GimpTraceSpan  span  = GIMP_TRACE_BEGIN ();
 
   g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
   g_return_val_if_fail (G_IS_INPUT_STREAM (input), NULL);
@@ -320,6 +322,9 @@ xcf_load_stream (Gimp          *gimp,
   if (progress)
     gimp_progress_end (progress);
 
+  GIMP_TRACE_END (span, "xcf", "load", "%s, version %d%s",
+                  filename, info.file_version, success ? "" : ", failed");
+
   return image;
 }
 
@@ -336,6 +341,7 @@ xcf_save_stream (Gimp           *gimp,
   gboolean      success  = FALSE;
   GError       *my_error = NULL;
   GCancellable *cancellable;
+  GimpTraceSpan span     = GIMP_TRACE_BEGIN ();
 
   g_return_val_if_fail (GIMP_IS_GIMP (gimp), FALSE);
   g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
@@ -374,6 +380,8 @@ xcf_save_stream (Gimp           *gimp,
 
   success = xcf_save_image (&info, image, &my_error);
 
+  g_free (info.constant_tile.data);
+
   cancellable = g_cancellable_new ();
   if (success)
     {
@@ -401,6 +409,9 @@ xcf_save_stream (Gimp           *gimp,
   if (progress)
     gimp_progress_end (progress);
 
+  GIMP_TRACE_END (span, "xcf", "save", "%s, version %d%s",
+                  filename, info.file_version, success ? "" : ", failed");
+
   return success;
 }
 
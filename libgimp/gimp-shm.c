@@ -87,6 +87,10 @@ _gimp_shm_addr (void)
 void
 _gimp_shm_open (gint shm_ID)
 {
+  /*  already attached by a previous run of a persistent plug-in  */
+  if (_shm_addr && shm_ID == _shm_ID)
+    return;
+
   _shm_ID = shm_ID;
 
   if (_shm_ID != -1)
@@ -146,6 +146,7 @@ static gchar              *_display_name         = NULL;
 static gint                _monitor_number       = 0;
 static guint32             _timestamp            = 0;
 static gchar              *_icon_theme_dir       = NULL;
+static gboolean            _app_name_set         = FALSE;
 static const gchar        *progname              = NULL;
 
 static GimpStackTraceMode  stack_trace_mode      = GIMP_STACK_TRACE_NEVER;
@@ -421,7 +422,10 @@ gimp_main (GType  plug_in_type,
   g_io_channel_set_encoding (read_channel, NULL, NULL);
   g_io_channel_set_encoding (write_channel, NULL, NULL);
 
-  g_io_channel_set_buffered (read_channel, FALSE);
+  /*  read ahead, so that a message doesn't take several read() calls,
+   *  see gimp_plug_in_extension_process() for polling the channel
+   */
+  g_io_channel_set_buffer_size (read_channel, 65536);
   g_io_channel_set_buffered (write_channel, FALSE);
 
   g_io_channel_set_close_on_unref (read_channel, TRUE);
@@ -1029,14 +1033,27 @@ _gimp_config (GPConfig *config)
   _export_comment       = config->export_comment;
   _num_processors       = config->num_processors;
   _default_display_id   = config->default_display_id;
-  _wm_class             = g_strdup (config->wm_class);
-  _display_name         = g_strdup (config->display_name);
   _monitor_number       = config->monitor_number;
   _timestamp            = config->timestamp;
+
+  /*  a persistent plug-in gets a config for each procedure call  */
+  g_free (_wm_class);
+  g_free (_display_name);
+  g_free (_icon_theme_dir);
+
+  _wm_class             = g_strdup (config->wm_class);
+  _display_name         = g_strdup (config->display_name);
   _icon_theme_dir       = g_strdup (config->icon_theme_dir);
 
-  if (config->app_name)
-    g_set_application_name (config->app_name);
+  /*  GLib warns when the name is set more than once, and
+   *  g_get_application_name() falls back to the prgname, so it can't
+   *  tell whether the name was set
+   */
+  if (config->app_name && ! _app_name_set)
+    {
+      g_set_application_name (config->app_name);
+      _app_name_set = TRUE;
+    }
 
   gimp_cpu_accel_set_use (config->use_cpu_accel);
 
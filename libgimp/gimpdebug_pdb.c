@@ -111,3 +111,46 @@ gimp_debug_timer_end (void)
 
   return elapsed;
 }
+
+/**
+ * gimp_debug_performance_log_add_marker:
+ * @description: (nullable): The marker description.
+ *
+ * Adds a marker to the active performance log.
+ *
+ * This procedure adds an event marker with the given description to
+ * the performance log that is currently being recorded, either from
+ * the Dashboard, or using the --performance-log command-line option.
+ * Markers can be used to delimit the parts of a script whose
+ * performance is of interest, when viewing the log.
+ * The procedure fails if no performance log is being recorded.
+ *
+ * This is a debug utility procedure. It is subject to change at any
+ * point, and should not be used in production.
+ *
+ * Returns: TRUE on success.
+ *
+ * Since: 3.0
+ **/
+gboolean
+gimp_debug_performance_log_add_marker (const gchar *description)
+{
+  GimpValueArray *args;
+  GimpValueArray *return_vals;
+  gboolean success = TRUE;
+
+  args = gimp_value_array_new_from_types (NULL,
+                                          G_TYPE_STRING, description,
+                                          G_TYPE_NONE);
+
+  return_vals = gimp_pdb_run_procedure_array (gimp_get_pdb (),
+                                              "gimp-debug-performance-log-add-marker",
+                                              args);
+  gimp_value_array_unref (args);
+
+  success = GIMP_VALUES_GET_ENUM (return_vals, 0) == GIMP_PDB_SUCCESS;
+
+  gimp_value_array_unref (return_vals);
+
+  return success;
+}
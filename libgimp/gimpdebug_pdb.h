@@ -32,8 +32,9 @@ G_BEGIN_DECLS
 /* For information look into the C source or the html documentation */
 
 
-gboolean gimp_debug_timer_start (void);
-gdouble  gimp_debug_timer_end   (void);
+gboolean gimp_debug_timer_start                (void);
+gdouble  gimp_debug_timer_end                  (void);
+gboolean gimp_debug_performance_log_add_marker (const gchar *description);
 
 
 G_END_DECLS
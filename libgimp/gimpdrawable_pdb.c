@@ -590,6 +590,67 @@ gimp_drawable_mask_intersect (GimpDrawable *drawable,
   return non_empty;
 }
 
+/**
+ * gimp_drawable_get_content_bounds:
+ * @drawable: The drawable.
+ * @exact: Whether to return the exact content bounds.
+ * @x: (out): x coordinate of the upper left corner of the content bounds.
+ * @y: (out): y coordinate of the upper left corner of the content bounds.
+ * @width: (out): width of the content bounds.
+ * @height: (out): height of the content bounds.
+ *
+ * Find the bounding box of the non-transparent content of a drawable.
+ *
+ * This procedure returns whether the drawable has any content, i.e.,
+ * non-transparent pixels (nonzero pixels for channels). If it does,
+ * the bounds of the content are returned as x, y, width, height,
+ * relative to the drawable's origin. Drawables without an alpha
+ * channel are always considered to be completely filled.
+ * The content bounds are tracked by GIMP as the drawable is modified,
+ * so this procedure is cheap to call repeatedly. Unless exact bounds
+ * are requested, the returned bounds may be larger than the exact
+ * bounds, but they always contain all of the drawable's content.
+ *
+ * Returns: TRUE if the drawable has any content.
+ *
+ * Since: 3.0
+ **/
+gboolean
+gimp_drawable_get_content_bounds (GimpDrawable *drawable,
+                                  gboolean      exact,
+                                  gint         *x,
+                                  gint         *y,
+                                  gint         *width,
+                                  gint         *height)
+{
+  GimpValueArray *args;
+  GimpValueArray *return_vals;
+  gboolean non_empty = FALSE;
+
+  args = gimp_value_array_new_from_types (NULL,
+                                          GIMP_TYPE_DRAWABLE, drawable,
+                                          G_TYPE_BOOLEAN, exact,
+                                          G_TYPE_NONE);
+
+  return_vals = gimp_pdb_run_procedure_array (gimp_get_pdb (),
+                                              "gimp-drawable-get-content-bounds",
+                                              args);
+  gimp_value_array_unref (args);
+
+  if (GIMP_VALUES_GET_ENUM (return_vals, 0) == GIMP_PDB_SUCCESS)
+    {
+      non_empty = GIMP_VALUES_GET_BOOLEAN (return_vals, 1);
+      *x = GIMP_VALUES_GET_INT (return_vals, 2);
+      *y = GIMP_VALUES_GET_INT (return_vals, 3);
+      *width = GIMP_VALUES_GET_INT (return_vals, 4);
+      *height = GIMP_VALUES_GET_INT (return_vals, 5);
+    }
+
+  gimp_value_array_unref (return_vals);
+
+  return non_empty;
+}
+
 /**
  * gimp_drawable_merge_shadow:
  * @drawable: The drawable.
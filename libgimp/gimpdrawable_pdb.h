@@ -56,6 +56,12 @@ gboolean                 gimp_drawable_mask_intersect        (GimpDrawable
                                                               gint                       *y,
                                                               gint                       *width,
                                                               gint                       *height);
+gboolean                 gimp_drawable_get_content_bounds    (GimpDrawable               *drawable,
+                                                              gboolean                    exact,
+                                                              gint                       *x,
+                                                              gint                       *y,
+                                                              gint                       *width,
+                                                              gint                       *height);
 gboolean                 gimp_drawable_merge_shadow          (GimpDrawable               *drawable,
                                                               gboolean                    undo);
 gboolean                 gimp_drawable_free_shadow           (GimpDrawable               *drawable);
@@ -104,7 +104,7 @@
  **/
 
 
-#define WRITE_BUFFER_SIZE 1024
+#define WRITE_BUFFER_SIZE 4096 /*  larger writes bypass the buffer  */
 
 
 enum
@@ -133,6 +133,7 @@ struct _GimpPlugInPrivate
   gulong      write_buffer_index;
 
   guint       extension_source_id;
+  gboolean    persistent;
 
   gchar      *translation_domain_name;
   GFile      *translation_domain_path;
@@ -172,6 +173,12 @@ static gboolean   gimp_plug_in_write             (GIOChannel      *channel,
                                                   gpointer         user_data);
 static gboolean   gimp_plug_in_flush             (GIOChannel      *channel,
                                                   gpointer         user_data);
+#ifdef G_OS_UNIX
+static gboolean   gimp_plug_in_write_vectored    (GIOChannel      *channel,
+                                                  GimpPlugIn      *plug_in,
+                                                  const guint8    *buf,
+                                                  gulong           count);
+#endif
 static gboolean   gimp_plug_in_io_error_handler  (GIOChannel      *channel,
                                                   GIOCondition     cond,
                                                   gpointer         data);
@@ -180,7 +187,7 @@ static void       gimp_plug_in_loop              (GimpPlugIn      *plug_in);
 static void       gimp_plug_in_single_message    (GimpPlugIn      *plug_in);
 static void       gimp_plug_in_process_message   (GimpPlugIn      *plug_in,
                                                   GimpWireMessage *msg);
-static void       gimp_plug_in_proc_run          (GimpPlugIn      *plug_in,
+static gboolean   gimp_plug_in_proc_run          (GimpPlugIn      *plug_in,
                                                   GPProcRun       *proc_run);
 static void       gimp_plug_in_temp_proc_run     (GimpPlugIn      *plug_in,
                                                   GPProcRun       *proc_run);
@@ -668,6 +675,14 @@ gimp_plug_in_extension_process (GimpPlugIn *plug_in,
 
   g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
 
+  /*  a message which is already read ahead doesn't wake up select()  */
+  if (g_io_channel_get_buffer_condition (plug_in->priv->read_channel) &
+      G_IO_IN)
+    {
+      gimp_plug_in_single_message (plug_in);
+      return;
+    }
+
   do
     {
       fd_set readfds;
@@ -709,6 +724,13 @@ gimp_plug_in_extension_process (GimpPlugIn *plug_in,
 
   g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
 
+  if (g_io_channel_get_buffer_condition (plug_in->priv->read_channel) &
+      G_IO_IN)
+    {
+      gimp_plug_in_single_message (plug_in);
+      return;
+    }
+
   if (timeout == 0)
     timeout = -1;
 
@@ -723,6 +745,56 @@ gimp_plug_in_extension_process (GimpPlugIn *plug_in,
 #endif
 }
 
+/**
+ * gimp_plug_in_set_persistent:
+ * @plug_in:    A #GimpPlugIn
+ * @persistent: Whether the plug-in process can run more than one
+ *              procedure call
+ *
+ * Declares that the plug-in's process can be reused for further
+ * calls of its procedures.
+ *
+ * Normally, GIMP starts a new plug-in process for each call of one
+ * of the plug-in's procedures. If the "plug-in-persistent-timeout"
+ * gimprc option is set, GIMP keeps the process of a persistent
+ * plug-in running after a procedure returned, and sends the next
+ * call of any of its procedures to the same process, which saves
+ * the cost of starting the plug-in again.
+ *
+ * Only enable this if the plug-in doesn't depend on being in a fresh
+ * process for each call, for example on static variables being
+ * initialized. #GimpPlugInClass.quit() is only called when the
+ * process finally exits. A plug-in which installed temporary
+ * procedures is not reused.
+ *
+ * Since: 3.0
+ **/
+void
+gimp_plug_in_set_persistent (GimpPlugIn *plug_in,
+                             gboolean    persistent)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+
+  plug_in->priv->persistent = persistent ? TRUE : FALSE;
+}
+
+/**
+ * gimp_plug_in_get_persistent:
+ * @plug_in: A #GimpPlugIn
+ *
+ * Returns: Whether the plug-in process can be reused, see
+ *          gimp_plug_in_set_persistent().
+ *
+ * Since: 3.0
+ **/
+gboolean
+gimp_plug_in_get_persistent (GimpPlugIn *plug_in)
+{
+  g_return_val_if_fail (GIMP_IS_PLUG_IN (plug_in), FALSE);
+
+  return plug_in->priv->persistent;
+}
+
 /**
  * gimp_plug_in_set_pdb_error_handler:
  * @plug_in: A #GimpPlugIn
@@ -948,6 +1020,11 @@ gimp_plug_in_write (GIOChannel   *channel,
 {
   GimpPlugIn *plug_in = user_data;
 
+#ifdef G_OS_UNIX
+  if (count >= WRITE_BUFFER_SIZE)
+    return gimp_plug_in_write_vectored (channel, plug_in, buf, count);
+#endif
+
   while (count > 0)
     {
       gulong bytes;
@@ -1029,6 +1106,34 @@ gimp_plug_in_flush (GIOChannel *channel,
   return TRUE;
 }
 
+#ifdef G_OS_UNIX
+/*  writes the buffered data, followed by @count bytes of @buf, with a
+ *  single writev() if possible, instead of copying @buf through the
+ *  write buffer
+ */
+static gboolean
+gimp_plug_in_write_vectored (GIOChannel   *channel,
+                             GimpPlugIn   *plug_in,
+                             const guint8 *buf,
+                             gulong        count)
+{
+  if (! gimp_wire_write_vectored (g_io_channel_unix_get_fd (channel),
+                                  plug_in->priv->write_buffer,
+                                  plug_in->priv->write_buffer_index,
+                                  buf, count))
+    {
+      g_warning ("%s: gimp_flush(): error: %s",
+                 g_get_prgname (), g_strerror (errno));
+
+      return FALSE;
+    }
+
+  plug_in->priv->write_buffer_index = 0;
+
+  return TRUE;
+}
+#endif
+
 static gboolean
 gimp_plug_in_io_error_handler (GIOChannel   *channel,
                                GIOCondition  cond,
@@ -1068,9 +1173,12 @@ gimp_plug_in_loop (GimpPlugIn *plug_in)
           break;
 
         case GP_PROC_RUN:
-          gimp_plug_in_proc_run (plug_in, msg.data);
-          gimp_wire_destroy (&msg);
-          return;
+          if (! gimp_plug_in_proc_run (plug_in, msg.data))
+            {
+              gimp_wire_destroy (&msg);
+              return;
+            }
+          break;
 
         case GP_PROC_RETURN:
           g_warning ("unexpected proc return message received (should not happen)");
@@ -1091,6 +1199,10 @@ gimp_plug_in_loop (GimpPlugIn *plug_in)
         case GP_HAS_INIT:
           g_warning ("unexpected has init message received (should not happen)");
           break;
+
+        case GP_PERSIST:
+          g_warning ("unexpected persist message received (should not happen)");
+          break;
         }
 
       gimp_wire_destroy (&msg);
@@ -1146,15 +1258,20 @@ gimp_plug_in_process_message (GimpPlugIn      *plug_in,
     case GP_HAS_INIT:
       g_warning ("unexpected has init message received (should not happen)");
       break;
+    case GP_PERSIST:
+      g_warning ("unexpected persist message received (should not happen)");
+      break;
     }
 }
 
-static void
+/*  returns whether the plug-in stays around for the next GP_PROC_RUN  */
+static gboolean
 gimp_plug_in_proc_run (GimpPlugIn *plug_in,
                        GPProcRun  *proc_run)
 {
   GPProcReturn   proc_return;
   GimpProcedure *procedure;
+  gboolean       persist;
 
   procedure = _gimp_plug_in_create_procedure (plug_in, proc_run->name);
 
@@ -1166,11 +1283,23 @@ gimp_plug_in_proc_run (GimpPlugIn *plug_in,
       g_object_unref (procedure);
     }
 
+  persist = (plug_in->priv->persistent        &&
+             ! plug_in->priv->temp_procedures &&
+             ! plug_in->priv->extension_source_id);
+
+  /*  announce that we wait for the next call before returning, GIMP
+   *  will send either another GP_PROC_RUN or GP_QUIT
+   */
+  if (persist && ! gp_persist_write (plug_in->priv->write_channel, plug_in))
+    gimp_quit ();
+
   if (! gp_proc_return_write (plug_in->priv->write_channel,
                               &proc_return, plug_in))
     gimp_quit ();
 
   _gimp_gp_params_free (proc_return.params, proc_return.n_params, TRUE);
+
+  return persist;
 }
 
 static void
@@ -167,6 +167,10 @@ void            gimp_plug_in_extension_enable       (GimpPlugIn    *plug_in);
 void            gimp_plug_in_extension_process      (GimpPlugIn    *plug_in,
                                                      guint          timeout);
 
+void            gimp_plug_in_set_persistent         (GimpPlugIn    *plug_in,
+                                                     gboolean       persistent);
+gboolean        gimp_plug_in_get_persistent         (GimpPlugIn    *plug_in);
+
 void            gimp_plug_in_set_pdb_error_handler  (GimpPlugIn    *plug_in,
                                                      GimpPDBErrorHandler  handler);
 GimpPDBErrorHandler
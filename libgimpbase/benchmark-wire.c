@@ -0,0 +1,319 @@
+/* A small benchmark for the plug-in wire protocol
+ *
+ * Sends a number of typical messages through a pipe, from a writer
+ * thread to a reader in the main thread, and prints the throughput
+ * for each kind of message.  The writer buffers like the plug-in
+ * writers in app/ and libgimp/ do, and the buffer sizes can be
+ * changed to compare the different I/O strategies.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib-unix.h>
+
+#include <unistd.h>
+
+#include "gimpbasetypes.h"
+#include "gimpparasite.h"
+#include "gimpprotocol.h"
+#include "gimpwire.h"
+
+
+typedef struct _Writer Writer;
+
+struct _Writer
+{
+  gint             fd;
+  guint8          *buffer;
+  gsize            buffer_size;
+  gsize            buffer_index;
+  gboolean         vectored;
+
+  GimpWireMessage  msg;
+  gint             n_messages;
+  guint64          n_bytes;
+};
+
+
+static gint     iterations   = 1000;
+static gint     write_buffer = 4096;
+static gint     read_buffer  = 65536;
+static gboolean no_vectored  = FALSE;
+
+static const GOptionEntry entries[] =
+{
+  { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+    "Number of messages of each kind", "N" },
+  { "write-buffer", 'w', 0, G_OPTION_ARG_INT, &write_buffer,
+    "Size of the write buffer", "BYTES" },
+  { "read-buffer", 'r', 0, G_OPTION_ARG_INT, &read_buffer,
+    "Size of the read-ahead buffer, 0 for unbuffered reads", "BYTES" },
+  { "no-vectored", 0, 0, G_OPTION_ARG_NONE, &no_vectored,
+    "Copy large writes through the write buffer", NULL },
+  { NULL }
+};
+
+
+static gboolean
+writer_flush_buffer (Writer       *writer,
+                     const guint8 *buf,
+                     gsize         count)
+{
+  if (! gimp_wire_write_vectored (writer->fd,
+                                  writer->buffer, writer->buffer_index,
+                                  buf, count))
+    return FALSE;
+
+  writer->buffer_index = 0;
+
+  return TRUE;
+}
+
+static gboolean
+writer_write (GIOChannel   *channel,
+              const guint8 *buf,
+              gulong        count,
+              gpointer      user_data)
+{
+  Writer *writer = user_data;
+
+  writer->n_bytes += count;
+
+  if (writer->vectored && count >= writer->buffer_size)
+    return writer_flush_buffer (writer, buf, count);
+
+  while (count > 0)
+    {
+      gsize bytes;
+
+      if (writer->buffer_index == writer->buffer_size)
+        {
+          if (! writer_flush_buffer (writer, NULL, 0))
+            return FALSE;
+        }
+
+      bytes = MIN (count, writer->buffer_size - writer->buffer_index);
+
+      memcpy (writer->buffer + writer->buffer_index, buf, bytes);
+
+      writer->buffer_index += bytes;
+      buf                  += bytes;
+      count                -= bytes;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+writer_flush (GIOChannel *channel,
+              gpointer    user_data)
+{
+  return writer_flush_buffer (user_data, NULL, 0);
+}
+
+static gpointer
+writer_thread (Writer *writer)
+{
+  gint i;
+
+  for (i = 0; i < writer->n_messages; i++)
+    {
+      if (! gimp_wire_write_msg (NULL, &writer->msg, writer) ||
+          ! gimp_wire_flush (NULL, writer))
+        {
+          g_printerr ("write error: %s\n", g_strerror (errno));
+          break;
+        }
+    }
+
+  close (writer->fd);
+
+  return NULL;
+}
+
+static void
+run (const gchar *name,
+     guint32      type,
+     gpointer     data)
+{
+  Writer      writer = { 0, };
+  GThread    *thread;
+  GIOChannel *channel;
+  GTimer     *timer;
+  gint        fds[2];
+  gint        n_read = 0;
+  gdouble     elapsed;
+
+  if (! g_unix_open_pipe (fds, FD_CLOEXEC, NULL))
+    {
+      g_printerr ("could not create a pipe\n");
+      exit (EXIT_FAILURE);
+    }
+
+  writer.fd          = fds[1];
+  writer.buffer      = g_malloc (write_buffer);
+  writer.buffer_size = write_buffer;
+  writer.vectored    = ! no_vectored;
+  writer.msg.type    = type;
+  writer.msg.data    = data;
+  writer.n_messages  = iterations;
+
+  channel = g_io_channel_unix_new (fds[0]);
+  g_io_channel_set_encoding (channel, NULL, NULL);
+
+  if (read_buffer > 0)
+    g_io_channel_set_buffer_size (channel, read_buffer);
+  else
+    g_io_channel_set_buffered (channel, FALSE);
+
+  g_io_channel_set_close_on_unref (channel, TRUE);
+
+  timer = g_timer_new ();
+
+  thread = g_thread_new ("writer", (GThreadFunc) writer_thread, &writer);
+
+  while (n_read < iterations)
+    {
+      GimpWireMessage msg;
+
+      if (! gimp_wire_read_msg (channel, &msg, NULL))
+        break;
+
+      gimp_wire_destroy (&msg);
+      n_read++;
+    }
+
+  g_thread_join (thread);
+
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  if (n_read < iterations)
+    g_printerr ("%-14s read error after %d messages\n", name, n_read);
+  else
+    g_print ("%-14s %10.0f msgs/s %10.1f MB/s\n",
+             name,
+             n_read / elapsed,
+             writer.n_bytes / elapsed / (1024.0 * 1024.0));
+
+  g_timer_destroy (timer);
+  g_io_channel_unref (channel);
+  g_free (writer.buffer);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GOptionContext  *context;
+  GError          *error = NULL;
+  GPTileData       tile_data;
+  GPProcRun        proc_run;
+  GPParam          param;
+  GimpParasite     parasite;
+  gchar          **strings;
+  gint32          *ids;
+  gint             i;
+
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (! g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  g_option_context_free (context);
+
+  write_buffer = MAX (write_buffer, 1);
+
+  gp_init ();
+  gimp_wire_set_writer (writer_write);
+  gimp_wire_set_flusher (writer_flush);
+
+  g_print ("write buffer %d, read buffer %d, %s\n\n",
+           write_buffer, read_buffer,
+           no_vectored ? "not vectored" : "vectored");
+
+  /*  a 64x64 RGBA tile, sent through the pipe when shm is not available  */
+  tile_data.drawable_id = 1;
+  tile_data.tile_num    = 0;
+  tile_data.shadow      = FALSE;
+  tile_data.bpp         = 4;
+  tile_data.width       = 64;
+  tile_data.height      = 64;
+  tile_data.use_shm     = FALSE;
+  tile_data.data        = g_malloc0 (64 * 64 * 4);
+
+  run ("tile data", GP_TILE_DATA, &tile_data);
+
+  g_free (tile_data.data);
+
+  proc_run.name     = "benchmark-procedure";
+  proc_run.n_params = 1;
+  proc_run.params   = &param;
+
+  /*  a 1 MB byte array, like image data or an ICC profile  */
+  param.param_type        = GP_PARAM_TYPE_ARRAY;
+  param.type_name         = "GimpUint8Array";
+  param.data.d_array.size = 1024 * 1024;
+  param.data.d_array.data = g_malloc0 (param.data.d_array.size);
+
+  run ("byte array", GP_PROC_RUN, &proc_run);
+
+  g_free (param.data.d_array.data);
+
+  /*  a 64 KB parasite, like metadata  */
+  parasite.name  = "gimp-metadata";
+  parasite.flags = 0;
+  parasite.size  = 64 * 1024;
+  parasite.data  = g_malloc0 (parasite.size);
+
+  param.param_type      = GP_PARAM_TYPE_PARASITE;
+  param.type_name       = "GimpParasite";
+  param.data.d_parasite = parasite;
+
+  run ("parasite", GP_PROC_RUN, &proc_run);
+
+  g_free (parasite.data);
+
+  /*  10000 item IDs  */
+  ids = g_new (gint32, 10000);
+
+  for (i = 0; i < 10000; i++)
+    ids[i] = i;
+
+  param.param_type                = GP_PARAM_TYPE_ID_ARRAY;
+  param.type_name                 = "GimpObjectArray";
+  param.data.d_id_array.type_name = "GimpLayer";
+  param.data.d_id_array.size      = 10000;
+  param.data.d_id_array.data      = ids;
+
+  run ("id array", GP_PROC_RUN, &proc_run);
+
+  g_free (ids);
+
+  /*  1000 short strings, like a list of file names  */
+  strings = g_new (gchar *, 1001);
+
+  for (i = 0; i < 1000; i++)
+    strings[i] = g_strdup_printf ("/home/user/Pictures/image-%04d.png", i);
+
+  strings[i] = NULL;
+
+  param.param_type               = GP_PARAM_TYPE_STRING_ARRAY;
+  param.type_name                = "GimpStringArray";
+  param.data.d_string_array.size = 1000;
+  param.data.d_string_array.data = strings;
+
+  run ("string array", GP_PROC_RUN, &proc_run);
+
+  g_strfreev (strings);
+
+  return EXIT_SUCCESS;
+}
@@ -144,6 +144,14 @@ static void _gp_has_init_write           (GIOChannel       *channel,
                                           gpointer          user_data);
 static void _gp_has_init_destroy         (GimpWireMessage  *msg);
 
+static void _gp_persist_read             (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_persist_write            (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_persist_destroy          (GimpWireMessage  *msg);
+
 
 
 void
@@ -201,6 +209,10 @@ gp_init (void)
                       _gp_has_init_read,
                       _gp_has_init_write,
                       _gp_has_init_destroy);
+  gimp_wire_register (GP_PERSIST,
+                      _gp_persist_read,
+                      _gp_persist_write,
+                      _gp_persist_destroy);
 }
 
 /* public writing API */
@@ -448,6 +460,24 @@ gp_has_init_write (GIOChannel *channel,
   return TRUE;
 }
 
+gboolean
+gp_persist_write (GIOChannel *channel,
+                  gpointer    user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_PERSIST;
+  msg.data = NULL;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
 /*  quit  */
 
 static void
@@ -1937,3 +1967,24 @@ static void
 _gp_has_init_destroy (GimpWireMessage *msg)
 {
 }
+
+/* persist */
+
+static void
+_gp_persist_read (GIOChannel      *channel,
+                  GimpWireMessage *msg,
+                  gpointer         user_data)
+{
+}
+
+static void
+_gp_persist_write (GIOChannel      *channel,
+                   GimpWireMessage *msg,
+                   gpointer         user_data)
+{
+}
+
+static void
+_gp_persist_destroy (GimpWireMessage *msg)
+{
+}
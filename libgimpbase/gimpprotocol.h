@@ -26,7 +26,7 @@ G_BEGIN_DECLS
 
 /* Increment every time the protocol changes
  */
-#define GIMP_PROTOCOL_VERSION  0x010E
+#define GIMP_PROTOCOL_VERSION  0x010F
 
 
 enum
@@ -43,7 +43,8 @@ enum
   GP_PROC_INSTALL,
   GP_PROC_UNINSTALL,
   GP_EXTENSION_ACK,
-  GP_HAS_INIT
+  GP_HAS_INIT,
+  GP_PERSIST
 };
 
 typedef enum
@@ -327,6 +328,8 @@ gboolean  gp_extension_ack_write    (GIOChannel      *channel,
                                      gpointer         user_data);
 gboolean  gp_has_init_write         (GIOChannel      *channel,
                                      gpointer         user_data);
+gboolean  gp_persist_write          (GIOChannel      *channel,
+                                     gpointer         user_data);
 
 
 G_END_DECLS
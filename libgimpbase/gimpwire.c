@@ -18,15 +18,32 @@
 
 #include "config.h"
 
+#include <errno.h>
 #include <string.h>
 
 #include <glib-object.h>
 
+#ifdef G_OS_UNIX
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#ifdef G_OS_WIN32
+#include <io.h>
+#endif
+
 #include <libgimpcolor/gimpcolortypes.h>
 
 #include "gimpwire.h"
 
 
+/*  arrays are converted to and from network byte order in chunks of
+ *  this many bytes, so that they go through the I/O functions in a few
+ *  large pieces instead of one small piece per element
+ */
+#define CHUNK_SIZE 4096
+
+
 typedef struct _GimpWireHandler  GimpWireHandler;
 
 struct _GimpWireHandler
@@ -228,6 +245,86 @@ gimp_wire_flush (GIOChannel *channel,
   return FALSE;
 }
 
+/*  writes @buffer_count bytes of @buffer followed by @count bytes of
+ *  @buf to @fd, with a single writev() if possible, retrying writes
+ *  that were interrupted or only partially done.  This lets a
+ *  GimpWireIOFunc send a large write together with the data it has
+ *  buffered so far, instead of copying it through its buffer.  On
+ *  failure, errno tells why.
+ */
+gboolean
+gimp_wire_write_vectored (gint          fd,
+                          const guint8 *buffer,
+                          gsize         buffer_count,
+                          const guint8 *buf,
+                          gsize         count)
+{
+#ifdef G_OS_UNIX
+  struct iovec iov[2];
+  gint         i = 0;
+
+  iov[0].iov_base = (guint8 *) buffer;
+  iov[0].iov_len  = buffer_count;
+  iov[1].iov_base = (guint8 *) buf;
+  iov[1].iov_len  = count;
+
+  while (i < 2)
+    {
+      gssize bytes;
+
+      if (iov[i].iov_len == 0)
+        {
+          i++;
+          continue;
+        }
+
+      bytes = writev (fd, &iov[i], 2 - i);
+
+      if (bytes < 0)
+        {
+          if (errno == EINTR || errno == EAGAIN)
+            continue;
+
+          return FALSE;
+        }
+
+      for (; i < 2 && (gsize) bytes >= iov[i].iov_len; i++)
+        bytes -= iov[i].iov_len;
+
+      if (i < 2)
+        {
+          iov[i].iov_base  = (guint8 *) iov[i].iov_base + bytes;
+          iov[i].iov_len  -= bytes;
+        }
+    }
+#else
+  const guint8 *bufs[2]   = { buffer, buf };
+  gsize         counts[2] = { buffer_count, count };
+  gint          i;
+
+  for (i = 0; i < 2; i++)
+    {
+      while (counts[i] > 0)
+        {
+          gint bytes = write (fd, bufs[i], MIN (counts[i], G_MAXINT));
+
+          if (bytes < 0)
+            {
+              if (errno == EINTR || errno == EAGAIN)
+                continue;
+
+              return FALSE;
+            }
+
+          bufs[i]   += bytes;
+          counts[i] -= bytes;
+        }
+    }
+#endif
+
+  return TRUE;
+}
+
 gboolean
 gimp_wire_error (void)
 {
@@ -400,35 +497,22 @@ _gimp_wire_read_double (GIOChannel *channel,
                         gint        count,
                         gpointer    user_data)
 {
-  gdouble *t;
-  guint8   tmp[8];
-  gint     i;
+  gint i;
 
   g_return_val_if_fail (count >= 0, FALSE);
 
-  t = (gdouble *) tmp;
+  /*  doubles are sent as big-endian 64 bit values  */
+  if (! _gimp_wire_read_int8 (channel,
+                              (guint8 *) data, count * 8, user_data))
+    return FALSE;
 
   for (i = 0; i < count; i++)
     {
-#if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-      gint j;
-#endif
-
-      if (! _gimp_wire_read_int8 (channel, tmp, 8, user_data))
-        return FALSE;
-
-#if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-      for (j = 0; j < 4; j++)
-        {
-          guint8 swap;
+      guint64 tmp;
 
-          swap       = tmp[j];
-          tmp[j]     = tmp[7 - j];
-          tmp[7 - j] = swap;
-        }
-#endif
-
-      data[i] = *t;
+      memcpy (&tmp, &data[i], 8);
+      tmp = GUINT64_FROM_BE (tmp);
+      memcpy (&data[i], &tmp, 8);
     }
 
   return TRUE;
@@ -500,18 +584,21 @@ _gimp_wire_write_int64 (GIOChannel    *channel,
 {
   g_return_val_if_fail (count >= 0, FALSE);
 
-  if (count > 0)
+  while (count > 0)
     {
-      gint i;
+      guint64 tmp[CHUNK_SIZE / sizeof (guint64)];
+      gint    n = MIN (count, (gint) G_N_ELEMENTS (tmp));
+      gint    i;
 
-      for (i = 0; i < count; i++)
-        {
-          guint64 tmp = GUINT64_TO_BE (data[i]);
+      for (i = 0; i < n; i++)
+        tmp[i] = GUINT64_TO_BE (data[i]);
 
-          if (! _gimp_wire_write_int8 (channel,
-                                       (const guint8 *) &tmp, 8, user_data))
-            return FALSE;
-        }
+      if (! _gimp_wire_write_int8 (channel,
+                                   (const guint8 *) tmp, n * 8, user_data))
+        return FALSE;
+
+      data  += n;
+      count -= n;
     }
 
   return TRUE;
@@ -525,18 +612,21 @@ _gimp_wire_write_int32 (GIOChannel    *channel,
 {
   g_return_val_if_fail (count >= 0, FALSE);
 
-  if (count > 0)
+  while (count > 0)
     {
-      gint i;
+      guint32 tmp[CHUNK_SIZE / sizeof (guint32)];
+      gint    n = MIN (count, (gint) G_N_ELEMENTS (tmp));
+      gint    i;
 
-      for (i = 0; i < count; i++)
-        {
-          guint32 tmp = g_htonl (data[i]);
+      for (i = 0; i < n; i++)
+        tmp[i] = g_htonl (data[i]);
 
-          if (! _gimp_wire_write_int8 (channel,
-                                       (const guint8 *) &tmp, 4, user_data))
-            return FALSE;
-        }
+      if (! _gimp_wire_write_int8 (channel,
+                                   (const guint8 *) tmp, n * 4, user_data))
+        return FALSE;
+
+      data  += n;
+      count -= n;
     }
 
   return TRUE;
@@ -550,18 +640,21 @@ _gimp_wire_write_int16 (GIOChannel    *channel,
 {
   g_return_val_if_fail (count >= 0, FALSE);
 
-  if (count > 0)
+  while (count > 0)
     {
-      gint i;
+      guint16 tmp[CHUNK_SIZE / sizeof (guint16)];
+      gint    n = MIN (count, (gint) G_N_ELEMENTS (tmp));
+      gint    i;
 
-      for (i = 0; i < count; i++)
-        {
-          guint16 tmp = g_htons (data[i]);
+      for (i = 0; i < n; i++)
+        tmp[i] = g_htons (data[i]);
 
-          if (! _gimp_wire_write_int8 (channel,
-                                       (const guint8 *) &tmp, 2, user_data))
-            return FALSE;
-        }
+      if (! _gimp_wire_write_int8 (channel,
+                                   (const guint8 *) tmp, n * 2, user_data))
+        return FALSE;
+
+      data  += n;
+      count -= n;
     }
 
   return TRUE;
@@ -584,47 +677,26 @@ _gimp_wire_write_double (GIOChannel    *channel,
                          gint           count,
                          gpointer       user_data)
 {
-  gdouble *t;
-  guint8   tmp[8];
-  gint     i;
-#if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-  gint     j;
-#endif
-
   g_return_val_if_fail (count >= 0, FALSE);
 
-  t = (gdouble *) tmp;
-
-  for (i = 0; i < count; i++)
+  /*  doubles are sent as big-endian 64 bit values  */
+  while (count > 0)
     {
-      *t = data[i];
+      guint64 tmp[CHUNK_SIZE / sizeof (guint64)];
+      gint    n = MIN (count, (gint) G_N_ELEMENTS (tmp));
+      gint    i;
 
-#if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-      for (j = 0; j < 4; j++)
-        {
-          guint8 swap;
+      memcpy (tmp, data, n * 8);
 
-          swap       = tmp[j];
-          tmp[j]     = tmp[7 - j];
-          tmp[7 - j] = swap;
-        }
-#endif
+      for (i = 0; i < n; i++)
+        tmp[i] = GUINT64_TO_BE (tmp[i]);
 
-      if (! _gimp_wire_write_int8 (channel, tmp, 8, user_data))
+      if (! _gimp_wire_write_int8 (channel,
+                                   (const guint8 *) tmp, n * 8, user_data))
         return FALSE;
 
-#if 0
-      {
-        gint k;
-
-        g_print ("Wire representation of %f:\t", data[i]);
-
-        for (k = 0; k < 8; k++)
-          g_print ("%02x ", tmp[k]);
-
-        g_print ("\n");
-      }
-#endif
+      data  += n;
+      count -= n;
     }
 
   return TRUE;
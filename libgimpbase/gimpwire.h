@@ -48,37 +48,42 @@ struct _GimpWireMessage
 };
 
 
-void      gimp_wire_register      (guint32              type,
-                                   GimpWireReadFunc     read_func,
-                                   GimpWireWriteFunc    write_func,
-                                   GimpWireDestroyFunc  destroy_func);
-
-void      gimp_wire_set_reader    (GimpWireIOFunc       read_func);
-void      gimp_wire_set_writer    (GimpWireIOFunc       write_func);
-void      gimp_wire_set_flusher   (GimpWireFlushFunc    flush_func);
-
-gboolean  gimp_wire_read          (GIOChannel          *channel,
-                                   guint8              *buf,
-                                   gsize                count,
-                                   gpointer             user_data);
-gboolean  gimp_wire_write         (GIOChannel          *channel,
-                                   const guint8        *buf,
-                                   gsize                count,
-                                   gpointer             user_data);
-gboolean  gimp_wire_flush         (GIOChannel          *channel,
-                                   gpointer             user_data);
-
-gboolean  gimp_wire_error         (void);
-void      gimp_wire_clear_error   (void);
-
-gboolean  gimp_wire_read_msg      (GIOChannel          *channel,
-                                   GimpWireMessage     *msg,
-                                   gpointer             user_data);
-gboolean  gimp_wire_write_msg     (GIOChannel          *channel,
-                                   GimpWireMessage     *msg,
-                                   gpointer             user_data);
-
-void      gimp_wire_destroy       (GimpWireMessage     *msg);
+void      gimp_wire_register       (guint32              type,
+                                    GimpWireReadFunc     read_func,
+                                    GimpWireWriteFunc    write_func,
+                                    GimpWireDestroyFunc  destroy_func);
+
+void      gimp_wire_set_reader     (GimpWireIOFunc       read_func);
+void      gimp_wire_set_writer     (GimpWireIOFunc       write_func);
+void      gimp_wire_set_flusher    (GimpWireFlushFunc    flush_func);
+
+gboolean  gimp_wire_read           (GIOChannel          *channel,
+                                    guint8              *buf,
+                                    gsize                count,
+                                    gpointer             user_data);
+gboolean  gimp_wire_write          (GIOChannel          *channel,
+                                    const guint8        *buf,
+                                    gsize                count,
+                                    gpointer             user_data);
+gboolean  gimp_wire_flush          (GIOChannel          *channel,
+                                    gpointer             user_data);
+gboolean  gimp_wire_write_vectored (gint                 fd,
+                                    const guint8        *buffer,
+                                    gsize                buffer_count,
+                                    const guint8        *buf,
+                                    gsize                count);
+
+gboolean  gimp_wire_error          (void);
+void      gimp_wire_clear_error    (void);
+
+gboolean  gimp_wire_read_msg       (GIOChannel          *channel,
+                                    GimpWireMessage     *msg,
+                                    gpointer             user_data);
+gboolean  gimp_wire_write_msg      (GIOChannel          *channel,
+                                    GimpWireMessage     *msg,
+                                    gpointer             user_data);
+
+void      gimp_wire_destroy        (GimpWireMessage     *msg);
 
 
 /*  for internal use in libgimpbase  */
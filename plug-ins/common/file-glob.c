@@ -80,6 +80,10 @@ glob_class_init (GlobClass *klass)
 static void
 glob_init (Glob *glob)
 {
+  /*  scripts call file-glob over and over, and it keeps no state
+   *  between calls, so let GIMP reuse the process
+   */
+  gimp_plug_in_set_persistent (GIMP_PLUG_IN (glob), TRUE);
 }
 
 static GList *
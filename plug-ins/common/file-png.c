@@ -25,6 +25,7 @@
 
 #include <stdlib.h>
 #include <errno.h>
+#include <string.h>
 
 #include <glib/gstdio.h>
 
@@ -32,6 +33,7 @@
 #include <libgimp/gimpui.h>
 
 #include <png.h>
+#include <zlib.h>
 
 #include "libgimp/stdplugins-intl.h"
 
@@ -78,6 +80,48 @@ struct _PngClass
 #define PNG_TYPE  (png_get_type ())
 #define PNG (obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), PNG_TYPE, Png))
 
+/* Rows are filtered and deflated in blocks of at least this many
+ * bytes, each block by a thread of its own.  Every block but the first
+ * is primed with the 32 KiB of data before it, like pigz does, so the
+ * result is a single zlib stream compressing almost as well as one
+ * written in one go.
+ */
+#define DEFLATE_BLOCK_SIZE  (128 * 1024)
+#define DEFLATE_WINDOW_SIZE (32 * 1024)
+
+typedef struct
+{
+  guchar *data;
+  gsize   size;
+  gsize   in_size;
+  uLong   adler;
+} PngDeflateBlock;
+
+typedef struct
+{
+  GeglBuffer      *buffer;
+  const Babl      *file_format;
+  gint             width;
+  gint             height;
+  gint             bpp;
+  gint             channels;
+  gint             bit_depth;
+  gboolean         save_transp_pixels;
+  const guchar    *inverse_remap;
+  gboolean         drop_alpha;
+  gboolean         adaptive_filter;
+  gint             level;
+  gsize            rowbytes;
+  gint             block_rows;
+  gint             n_blocks;
+  gint             first_block;
+  guchar          *filtered;
+  const guchar    *window;
+  gsize            window_size;
+  PngDeflateBlock *blocks;
+} PngDeflateData;
+
+
 GType                   png_get_type         (void) G_GNUC_CONST;
 
 static GList          * png_query_procedures (GimpPlugIn           *plug_in);
@@ -125,6 +169,29 @@ static gboolean    save_dialog               (GimpImage        *image,
 static gboolean    offsets_dialog            (gint              offset_x,
                                               gint              offset_y);
 
+static void        fix_rows                  (guchar           *pixel,
+                                              gint              num,
+                                              gint              width,
+                                              gint              bpp,
+                                              gboolean          save_transp_pixels,
+                                              const guchar     *inverse_remap,
+                                              gboolean          drop_alpha);
+static void        pack_row                  (const PngDeflateData *data,
+                                              const guchar     *src,
+                                              guchar           *dest);
+static void        filter_row                (const PngDeflateData *data,
+                                              const guchar     *prev,
+                                              const guchar     *row,
+                                              guchar           *dest);
+static void        filter_blocks             (gsize             offset,
+                                              gsize             size,
+                                              PngDeflateData   *data);
+static void        deflate_blocks            (gsize             offset,
+                                              gsize             size,
+                                              PngDeflateData   *data);
+static void        save_rows_parallel        (png_structp       pp,
+                                              PngDeflateData   *data);
+
 static gboolean    ia_has_transparent_pixels (GeglBuffer       *buffer);
 
 static gint        find_unused_ia_color      (GeglBuffer       *buffer,
@@ -1195,7 +1262,7 @@ save_image (GFile        *file,
             gint         *bits_per_sample,
             GError      **error)
 {
-  gint              i, k;             /* Looping vars */
+  gint              i;                /* Looping var */
   gint              bpp = 0;          /* Bytes per pixel */
   gint              type;             /* Type of drawable/layer */
   gint              num_passes;       /* Number of interlace passes in file */
@@ -1218,7 +1285,6 @@ save_image (GFile        *file,
   png_infop         info;             /* PNG info pointer */
   gint              offx, offy;       /* Drawable offsets from origin */
   guchar          **pixels;           /* Pixel rows */
-  guchar           *fixed;            /* Fixed-up pixel data */
   guchar           *pixel;            /* Pixel data */
   gdouble           xres, yres;       /* GIMP resolution (dpi) */
   png_color_16      background;       /* Background color */
@@ -1229,6 +1295,7 @@ save_image (GFile        *file,
   gint              bit_depth;        /* Default to bit depth 16 */
 
   guchar            remap[256];       /* Re-mapping for the palette */
+  guchar            inverse_remap[256];
 
   png_textp         text = NULL;
 
@@ -1806,139 +1873,123 @@ save_image (GFile        *file,
     png_set_text (pp, info, text, 1);
 
   png_write_info (pp, info);
-  if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-    png_set_swap (pp);
 
-  /*
-   * Turn on interlace handling...
+  /* If we're dealing with a paletted image with transparency set,
+   * pixels are written out through the remapped palette.
    */
-
-  if (save_interlaced)
-    num_passes = png_set_interlace_handling (pp);
-  else
-    num_passes = 1;
+  if (png_get_valid (pp, info, PNG_INFO_tRNS))
+    {
+      for (i = 0; i < 256; i++)
+        inverse_remap[ remap[i] ] = i;
+    }
 
   /*
-   * Convert unpacked pixels to packed if necessary
+   * Non-interlaced images are filtered and deflated in parallel,
+   * unless GIMP_PNG_SERIAL_DEFLATE asks for libpng to do it (which
+   * comes in handy when comparing the two).
    */
 
-  if (color_type == PNG_COLOR_TYPE_PALETTE &&
-      bit_depth < 8)
-    png_set_packing (pp);
+  if (! save_interlaced                  &&
+      gimp_get_num_processors () > 1     &&
+      ! g_getenv ("GIMP_PNG_SERIAL_DEFLATE"))
+    {
+      PngDeflateData data = { 0, };
+
+      data.buffer             = buffer;
+      data.file_format        = file_format;
+      data.width              = width;
+      data.height             = height;
+      data.bpp                = bpp;
+      data.channels           = png_get_channels (pp, info);
+      data.bit_depth          = bit_depth;
+      data.save_transp_pixels = save_transp_pixels;
+      data.inverse_remap      = png_get_valid (pp, info, PNG_INFO_tRNS) ?
+                                inverse_remap : NULL;
+      data.drop_alpha         = (! data.inverse_remap &&
+                                 png_get_valid (pp, info, PNG_INFO_PLTE) &&
+                                 bpp == 2);
+      data.adaptive_filter    = (color_type != PNG_COLOR_TYPE_PALETTE &&
+                                 bit_depth >= 8);
+      data.level              = compression_level;
+      data.rowbytes           = png_get_rowbytes (pp, info);
+
+      save_rows_parallel (pp, &data);
+    }
+  else
+    {
+      if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
+        png_set_swap (pp);
 
-  /*
-   * Allocate memory for "tile_height" rows and export the image...
-   */
+      /*
+       * Turn on interlace handling...
+       */
 
-  tile_height = gimp_tile_height ();
-  pixel = g_new (guchar, tile_height * width * bpp);
-  pixels = g_new (guchar *, tile_height);
+      if (save_interlaced)
+        num_passes = png_set_interlace_handling (pp);
+      else
+        num_passes = 1;
 
-  for (i = 0; i < tile_height; i++)
-    pixels[i] = pixel + width * bpp * i;
+      /*
+       * Convert unpacked pixels to packed if necessary
+       */
 
-  for (pass = 0; pass < num_passes; pass++)
-    {
-      /* This works if you are only writing one row at a time... */
-      for (begin = 0, end = tile_height;
-           begin < height; begin += tile_height, end += tile_height)
-        {
-          if (end > height)
-            end = height;
+      if (color_type == PNG_COLOR_TYPE_PALETTE &&
+          bit_depth < 8)
+        png_set_packing (pp);
 
-          num = end - begin;
+      /*
+       * Allocate memory for "tile_height" rows and export the image...
+       */
 
-          gegl_buffer_get (buffer,
-                           GEGL_RECTANGLE (0, begin, width, num),
-                           1.0,
-                           file_format,
-                           pixel,
-                           GEGL_AUTO_ROWSTRIDE,
-                           GEGL_ABYSS_NONE);
+      tile_height = gimp_tile_height ();
+      pixel = g_new (guchar, tile_height * width * bpp);
+      pixels = g_new (guchar *, tile_height);
 
-          /* If we are with a RGBA image and have to pre-multiply the
-             alpha channel */
-          if (bpp == 4 && ! save_transp_pixels)
-            {
-              for (i = 0; i < num; ++i)
-                {
-                  fixed = pixels[i];
-                  for (k = 0; k < width; ++k)
-                    {
-                      if (!fixed[3])
-                        fixed[0] = fixed[1] = fixed[2] = 0;
-                      fixed += bpp;
-                    }
-                }
-            }
+      for (i = 0; i < tile_height; i++)
+        pixels[i] = pixel + width * bpp * i;
 
-          if (bpp == 8 && ! save_transp_pixels)
+      for (pass = 0; pass < num_passes; pass++)
+        {
+          /* This works if you are only writing one row at a time... */
+          for (begin = 0, end = tile_height;
+               begin < height; begin += tile_height, end += tile_height)
             {
-              for (i = 0; i < num; ++i)
-                {
-                  fixed = pixels[i];
-                  for (k = 0; k < width; ++k)
-                    {
-                      if (!fixed[6] && !fixed[7])
-                        fixed[0] = fixed[1] = fixed[2] =
-                            fixed[3] = fixed[4] = fixed[5] = 0;
-                      fixed += bpp;
-                    }
-                }
-            }
+              if (end > height)
+                end = height;
 
-          /* If we're dealing with a paletted image with
-           * transparency set, write out the remapped palette */
-          if (png_get_valid (pp, info, PNG_INFO_tRNS))
-            {
-              guchar inverse_remap[256];
+              num = end - begin;
 
-              for (i = 0; i < 256; i++)
-                inverse_remap[ remap[i] ] = i;
+              gegl_buffer_get (buffer,
+                               GEGL_RECTANGLE (0, begin, width, num),
+                               1.0,
+                               file_format,
+                               pixel,
+                               GEGL_AUTO_ROWSTRIDE,
+                               GEGL_ABYSS_NONE);
 
-              for (i = 0; i < num; ++i)
-                {
-                  fixed = pixels[i];
-                  for (k = 0; k < width; ++k)
-                    {
-                      fixed[k] = (fixed[k*2+1] > 127) ?
-                                 inverse_remap[ fixed[k*2] ] :
-                                 0;
-                    }
-                }
-            }
+              fix_rows (pixel, num, width, bpp, save_transp_pixels,
+                        png_get_valid (pp, info, PNG_INFO_tRNS) ?
+                        inverse_remap : NULL,
+                        png_get_valid (pp, info, PNG_INFO_PLTE) && bpp == 2);
 
-          /* Otherwise if we have a paletted image and transparency
-           * couldn't be set, we ignore the alpha channel */
-          else if (png_get_valid (pp, info, PNG_INFO_PLTE) &&
-                   bpp == 2)
-            {
-              for (i = 0; i < num; ++i)
-                {
-                  fixed = pixels[i];
-                  for (k = 0; k < width; ++k)
-                    {
-                      fixed[k] = fixed[k * 2];
-                    }
-                }
+              png_write_rows (pp, pixels, num);
+
+              gimp_progress_update (((double) pass + (double) end /
+                                     (double) height) /
+                                    (double) num_passes);
             }
+        }
 
-          png_write_rows (pp, pixels, num);
+      png_write_end (pp, info);
 
-          gimp_progress_update (((double) pass + (double) end /
-                                 (double) height) /
-                                (double) num_passes);
-        }
+      g_free (pixel);
+      g_free (pixels);
     }
 
   gimp_progress_update (1.0);
 
-  png_write_end (pp, info);
   png_destroy_write_struct (&pp, &info);
 
-  g_free (pixel);
-  g_free (pixels);
-
   /*
    * Done with the file...
    */
@@ -1959,6 +2010,440 @@ save_image (GFile        *file,
   return TRUE;
 }
 
+/* Prepares "num" rows of "width" pixels for writing: clears the color of
+ * fully transparent pixels unless they are to be kept, and collapses
+ * indexed pixels with alpha to one byte each, either through the
+ * remapped palette or by dropping the alpha channel.
+ */
+static void
+fix_rows (guchar       *pixel,
+          gint          num,
+          gint          width,
+          gint          bpp,
+          gboolean      save_transp_pixels,
+          const guchar *inverse_remap,
+          gboolean      drop_alpha)
+{
+  guchar *fixed;
+  gint    i, k;
+
+  /* If we are with a RGBA image and have to pre-multiply the
+     alpha channel */
+  if (bpp == 4 && ! save_transp_pixels)
+    {
+      for (i = 0; i < num; ++i)
+        {
+          fixed = pixel + (gsize) i * width * bpp;
+          for (k = 0; k < width; ++k)
+            {
+              if (!fixed[3])
+                fixed[0] = fixed[1] = fixed[2] = 0;
+              fixed += bpp;
+            }
+        }
+    }
+
+  if (bpp == 8 && ! save_transp_pixels)
+    {
+      for (i = 0; i < num; ++i)
+        {
+          fixed = pixel + (gsize) i * width * bpp;
+          for (k = 0; k < width; ++k)
+            {
+              if (!fixed[6] && !fixed[7])
+                fixed[0] = fixed[1] = fixed[2] =
+                    fixed[3] = fixed[4] = fixed[5] = 0;
+              fixed += bpp;
+            }
+        }
+    }
+
+  /* If we're dealing with a paletted image with
+   * transparency set, write out the remapped palette */
+  if (inverse_remap)
+    {
+      for (i = 0; i < num; ++i)
+        {
+          fixed = pixel + (gsize) i * width * bpp;
+          for (k = 0; k < width; ++k)
+            {
+              fixed[k] = (fixed[k*2+1] > 127) ?
+                         inverse_remap[ fixed[k*2] ] :
+                         0;
+            }
+        }
+    }
+
+  /* Otherwise if we have a paletted image and transparency
+   * couldn't be set, we ignore the alpha channel */
+  else if (drop_alpha)
+    {
+      for (i = 0; i < num; ++i)
+        {
+          fixed = pixel + (gsize) i * width * bpp;
+          for (k = 0; k < width; ++k)
+            {
+              fixed[k] = fixed[k * 2];
+            }
+        }
+    }
+}
+
+/* Converts a fixed-up row to the layout PNG stores: packed indices for
+ * palettes of less than 8 bits, big-endian samples for 16 bits.
+ */
+static void
+pack_row (const PngDeflateData *data,
+          const guchar         *src,
+          guchar               *dest)
+{
+  gsize i;
+
+  if (data->bit_depth < 8)
+    {
+      gint per_byte = 8 / data->bit_depth;
+      gint x;
+
+      memset (dest, 0, data->rowbytes);
+
+      for (x = 0; x < data->width; x++)
+        {
+          gint shift = 8 - data->bit_depth * (x % per_byte + 1);
+
+          dest[x / per_byte] |= src[x] << shift;
+        }
+    }
+  else if (data->bit_depth == 16)
+    {
+      for (i = 0; i < data->rowbytes; i += 2)
+        {
+          guint16 value;
+
+          memcpy (&value, src + i, sizeof (value));
+
+          dest[i]     = value >> 8;
+          dest[i + 1] = value & 0xff;
+        }
+    }
+  else
+    {
+      memcpy (dest, src, data->rowbytes);
+    }
+}
+
+static inline gint
+paeth_predictor (gint a,
+                 gint b,
+                 gint c)
+{
+  gint p  = a + b - c;
+  gint pa = ABS (p - a);
+  gint pb = ABS (p - b);
+  gint pc = ABS (p - c);
+
+  if (pa <= pb && pa <= pc)
+    return a;
+  else if (pb <= pc)
+    return b;
+  else
+    return c;
+}
+
+/* Writes the filter type byte and the filtered bytes of "row" to "dest".
+ * Like libpng does by default, palette and low bit depth rows are left
+ * unfiltered, and all others get whichever filter yields the smallest
+ * sum of absolute (signed) differences.
+ */
+static void
+filter_row (const PngDeflateData *data,
+            const guchar         *prev,
+            const guchar         *row,
+            guchar               *dest)
+{
+  gsize  rowbytes = data->rowbytes;
+  gsize  offset   = MAX (1, data->channels * data->bit_depth / 8);
+  gulong sums[5]  = { 0, };
+  gint   filter   = PNG_FILTER_VALUE_NONE;
+  gsize  i;
+  gint   f;
+
+  if (data->adaptive_filter)
+    {
+      for (i = 0; i < rowbytes; i++)
+        {
+          gint   a = i >= offset ? row[i - offset]  : 0;
+          gint   b = prev[i];
+          gint   c = i >= offset ? prev[i - offset] : 0;
+          guchar v[5];
+
+          v[PNG_FILTER_VALUE_NONE]  = row[i];
+          v[PNG_FILTER_VALUE_SUB]   = row[i] - a;
+          v[PNG_FILTER_VALUE_UP]    = row[i] - b;
+          v[PNG_FILTER_VALUE_AVG]   = row[i] - ((a + b) >> 1);
+          v[PNG_FILTER_VALUE_PAETH] = row[i] - paeth_predictor (a, b, c);
+
+          for (f = 0; f < 5; f++)
+            sums[f] += v[f] < 128 ? v[f] : 256 - v[f];
+        }
+
+      for (f = 1; f < 5; f++)
+        {
+          if (sums[f] < sums[filter])
+            filter = f;
+        }
+    }
+
+  dest[0] = filter;
+  dest++;
+
+  for (i = 0; i < rowbytes; i++)
+    {
+      gint a = i >= offset ? row[i - offset]  : 0;
+      gint b = prev[i];
+      gint c = i >= offset ? prev[i - offset] : 0;
+
+      switch (filter)
+        {
+        case PNG_FILTER_VALUE_NONE:
+          dest[i] = row[i];
+          break;
+        case PNG_FILTER_VALUE_SUB:
+          dest[i] = row[i] - a;
+          break;
+        case PNG_FILTER_VALUE_UP:
+          dest[i] = row[i] - b;
+          break;
+        case PNG_FILTER_VALUE_AVG:
+          dest[i] = row[i] - ((a + b) >> 1);
+          break;
+        case PNG_FILTER_VALUE_PAETH:
+          dest[i] = row[i] - paeth_predictor (a, b, c);
+          break;
+        }
+    }
+}
+
+static void
+filter_blocks (gsize           offset,
+               gsize           size,
+               PngDeflateData *data)
+{
+  gsize   pixel_stride = (gsize) data->width * data->bpp;
+  guchar *pixel        = g_new (guchar, (data->block_rows + 1) * pixel_stride);
+  guchar *rows         = g_new (guchar, (data->block_rows + 1) * data->rowbytes);
+  guchar *zero         = g_new0 (guchar, data->rowbytes);
+  gsize   b;
+
+  for (b = offset; b < offset + size; b++)
+    {
+      gint          y     = (data->first_block + b) * data->block_rows;
+      gint          num   = MIN (data->block_rows, data->height - y);
+      gint          above = y > 0 ? 1 : 0;
+      const guchar *prev;
+      const guchar *row;
+      guchar       *dest;
+      gint          i;
+
+      /* The row above the block is needed to filter its first row */
+      gegl_buffer_get (data->buffer,
+                       GEGL_RECTANGLE (0, y - above, data->width, num + above),
+                       1.0,
+                       data->file_format,
+                       pixel,
+                       GEGL_AUTO_ROWSTRIDE,
+                       GEGL_ABYSS_NONE);
+
+      fix_rows (pixel, num + above, data->width, data->bpp,
+                data->save_transp_pixels,
+                data->inverse_remap,
+                data->drop_alpha);
+
+      for (i = 0; i < num + above; i++)
+        pack_row (data, pixel + i * pixel_stride, rows + i * data->rowbytes);
+
+      prev = above ? rows : zero;
+      row  = rows + above * data->rowbytes;
+      dest = data->filtered + b * data->block_rows * (data->rowbytes + 1);
+
+      for (i = 0; i < num; i++)
+        {
+          filter_row (data, prev, row, dest);
+
+          prev  = row;
+          row  += data->rowbytes;
+          dest += data->rowbytes + 1;
+        }
+
+      data->blocks[b].in_size = num * (data->rowbytes + 1);
+    }
+
+  g_free (zero);
+  g_free (rows);
+  g_free (pixel);
+}
+
+static void
+deflate_blocks (gsize           offset,
+                gsize           size,
+                PngDeflateData *data)
+{
+  gsize block_size = data->block_rows * (data->rowbytes + 1);
+  gsize b;
+
+  for (b = offset; b < offset + size; b++)
+    {
+      PngDeflateBlock *block = &data->blocks[b];
+      const guchar    *in    = data->filtered + b * block_size;
+      gboolean         last;
+      z_stream         zs    = { 0, };
+      gsize            capacity;
+
+      last = (data->first_block + b == data->n_blocks - 1);
+
+      /* Raw deflate, the zlib header and checksum are written by the
+       * main thread around the blocks.
+       */
+      deflateInit2 (&zs, data->level, Z_DEFLATED, -15, 8,
+                    data->adaptive_filter ? Z_FILTERED : Z_DEFAULT_STRATEGY);
+
+      if (b > 0)
+        deflateSetDictionary (&zs, in - MIN (DEFLATE_WINDOW_SIZE, b * block_size),
+                              MIN (DEFLATE_WINDOW_SIZE, b * block_size));
+      else if (data->window_size > 0)
+        deflateSetDictionary (&zs, data->window, data->window_size);
+
+      capacity    = deflateBound (&zs, block->in_size) + 16;
+      block->data = g_malloc (capacity);
+
+      zs.next_in   = (Bytef *) in;
+      zs.avail_in  = block->in_size;
+      zs.next_out  = block->data;
+      zs.avail_out = capacity;
+
+      while (TRUE)
+        {
+          gint ret = deflate (&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+
+          if (last ? ret == Z_STREAM_END : zs.avail_out > 0)
+            break;
+
+          capacity *= 2;
+          block->data  = g_realloc (block->data, capacity);
+          zs.next_out  = block->data + zs.total_out;
+          zs.avail_out = capacity - zs.total_out;
+        }
+
+      block->size  = zs.total_out;
+      block->adler = adler32 (adler32 (0L, Z_NULL, 0), in, block->in_size);
+
+      deflateEnd (&zs);
+    }
+}
+
+/* Writes the image data as one zlib stream, split into IDAT chunks of
+ * one batch of blocks each, followed by IEND.  Replaces png_write_rows()
+ * and png_write_end() for non-interlaced images.
+ */
+static void
+save_rows_parallel (png_structp     pp,
+                    PngDeflateData *data)
+{
+  GByteArray *idat;
+  guchar     *window;
+  gsize       block_size;
+  gint        n_threads = gimp_get_num_processors ();
+  gint        batch     = 2 * n_threads;
+  gint        flevel;
+  guint       header;
+  guint8      zlib_header[2];
+  uLong       adler     = adler32 (0L, Z_NULL, 0);
+
+  data->block_rows = MAX (1, DEFLATE_BLOCK_SIZE / (data->rowbytes + 1));
+  data->n_blocks   = (data->height + data->block_rows - 1) / data->block_rows;
+
+  block_size     = data->block_rows * (data->rowbytes + 1);
+  data->filtered = g_malloc (batch * block_size);
+  data->blocks   = g_new0 (PngDeflateBlock, batch);
+  window         = g_malloc (DEFLATE_WINDOW_SIZE);
+  data->window   = window;
+  idat           = g_byte_array_new ();
+
+  /* zlib header: deflate with a 32K window, and the level hint zlib
+   * itself would write.
+   */
+  if (data->level < 2)
+    flevel = 0;
+  else if (data->level < 6)
+    flevel = 1;
+  else if (data->level == 6)
+    flevel = 2;
+  else
+    flevel = 3;
+
+  header  = (0x78 << 8) | (flevel << 6);
+  header += 31 - header % 31;
+
+  zlib_header[0] = header >> 8;
+  zlib_header[1] = header & 0xff;
+  g_byte_array_append (idat, zlib_header, 2);
+
+  for (data->first_block = 0;
+       data->first_block < data->n_blocks;
+       data->first_block += batch)
+    {
+      gint  n     = MIN (batch, data->n_blocks - data->first_block);
+      gsize total = 0;
+      gint  b;
+
+      gegl_parallel_distribute_range (
+        n, 1,
+        (GeglParallelDistributeRangeFunc) filter_blocks,
+        data);
+
+      gegl_parallel_distribute_range (
+        n, 1,
+        (GeglParallelDistributeRangeFunc) deflate_blocks,
+        data);
+
+      for (b = 0; b < n; b++)
+        {
+          PngDeflateBlock *block = &data->blocks[b];
+
+          g_byte_array_append (idat, block->data, block->size);
+          adler = adler32_combine (adler, block->adler, block->in_size);
+          total += block->in_size;
+
+          g_clear_pointer (&block->data, g_free);
+        }
+
+      if (data->first_block + n == data->n_blocks)
+        {
+          guint8 trailer[4] = { adler >> 24, (adler >> 16) & 0xff,
+                                (adler >> 8) & 0xff, adler & 0xff };
+
+          g_byte_array_append (idat, trailer, 4);
+        }
+
+      png_write_chunk (pp, (png_const_bytep) "IDAT", idat->data, idat->len);
+      g_byte_array_set_size (idat, 0);
+
+      /* Keep the tail of the batch to prime the next one */
+      data->window_size = MIN (DEFLATE_WINDOW_SIZE, total);
+      memcpy (window, data->filtered + total - data->window_size,
+              data->window_size);
+
+      gimp_progress_update ((gdouble) (data->first_block + n) /
+                            (gdouble) data->n_blocks);
+    }
+
+  png_write_chunk (pp, (png_const_bytep) "IEND", NULL, 0);
+
+  g_byte_array_free (idat, TRUE);
+  g_free (window);
+  g_free (data->blocks);
+  g_free (data->filtered);
+}
+
 static gboolean
 ia_has_transparent_pixels (GeglBuffer *buffer)
 {
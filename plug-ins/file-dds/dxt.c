@@ -32,7 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <glib.h>
+#include <gegl.h>
 
 #include "dds.h"
 #include "dxt.h"
@@ -1016,155 +1016,122 @@ encode_alpha_block_BC3 (unsigned char       *dst,
 #define BLOCK_COUNT(w, h)          ((((h) + 3) >> 2) * (((w) + 3) >> 2))
 #define BLOCK_OFFSET(x, y, w, bs)  (((y) >> 2) * ((bs) * (((w) + 3) >> 2)) + ((bs) * ((x) >> 2)))
 
-static void
-compress_BC1 (unsigned char       *dst,
-              const unsigned char *src,
-              int                  w,
-              int                  h,
-              int                  flags)
+/* minimum number of blocks compressed by a single thread */
+#define MIN_BLOCKS_PER_THREAD  256
+
+typedef void (*compressfunc_t) (unsigned char *dst,
+                                unsigned char *block,
+                                int            flags);
+
+typedef struct
 {
-  const unsigned int block_count = BLOCK_COUNT(w, h);
-  unsigned int i;
-  unsigned char block[64], *p;
-  int x, y;
+  unsigned char       *dst;
+  const unsigned char *src;
+  int                  w;
+  int                  h;
+  int                  block_size;
+  compressfunc_t       func;
+  int                  flags;
+} compress_data_t;
 
-#ifdef _OPENMP
-#pragma omp parallel for schedule(dynamic, 256) private(block, p, x, y)
-#endif
-  for (i = 0; i < block_count; ++i)
-    {
-      x = (i % ((w + 3) >> 2)) << 2;
-      y = (i / ((w + 3) >> 2)) << 2;
-      p = dst + BLOCK_OFFSET(x, y, w, 8);
-      extract_block(src, x, y, w, h, block);
-      encode_color_block(p, block, DXT_BC1 | flags);
-    }
+static void
+compress_BC1 (unsigned char *dst,
+              unsigned char *block,
+              int            flags)
+{
+  encode_color_block(dst, block, DXT_BC1 | flags);
 }
 
 static void
-compress_BC2 (unsigned char       *dst,
-              const unsigned char *src,
-              int                  w,
-              int                  h,
-              int                  flags)
+compress_BC2 (unsigned char *dst,
+              unsigned char *block,
+              int            flags)
 {
-  const unsigned int block_count = BLOCK_COUNT(w, h);
-  unsigned int i;
-  unsigned char block[64], *p;
-  int x, y;
-
-#ifdef _OPENMP
-#pragma omp parallel for schedule(dynamic, 256) private(block, p, x, y)
-#endif
-  for (i = 0; i < block_count; ++i)
-    {
-      x = (i % ((w + 3) >> 2)) << 2;
-      y = (i / ((w + 3) >> 2)) << 2;
-      p = dst + BLOCK_OFFSET(x, y, w, 16);
-      extract_block(src, x, y, w, h, block);
-      encode_alpha_block_BC2(p, block);
-      encode_color_block(p + 8, block, DXT_BC2 | flags);
-    }
+  encode_alpha_block_BC2(dst, block);
+  encode_color_block(dst + 8, block, DXT_BC2 | flags);
 }
 
 static void
-compress_BC3 (unsigned char       *dst,
-              const unsigned char *src,
-              int                  w,
-              int                  h,
-              int                  flags)
+compress_BC3 (unsigned char *dst,
+              unsigned char *block,
+              int            flags)
 {
-  const unsigned int block_count = BLOCK_COUNT(w, h);
-  unsigned int i;
-  unsigned char block[64], *p;
-  int x, y;
+  encode_alpha_block_BC3(dst, block, 0);
+  encode_color_block(dst + 8, block, DXT_BC3 | flags);
+}
 
-#ifdef _OPENMP
-#pragma omp parallel for schedule(dynamic, 256) private(block, p, x, y)
-#endif
-  for (i = 0; i < block_count; ++i)
-    {
-      x = (i % ((w + 3) >> 2)) << 2;
-      y = (i / ((w + 3) >> 2)) << 2;
-      p = dst + BLOCK_OFFSET(x, y, w, 16);
-      extract_block(src, x, y, w, h, block);
-      encode_alpha_block_BC3(p, block, 0);
-      encode_color_block(p + 8, block, DXT_BC3 | flags);
-    }
+static void
+compress_BC4 (unsigned char *dst,
+              unsigned char *block,
+              int            flags)
+{
+  encode_alpha_block_BC3(dst, block, -1);
 }
 
 static void
-compress_BC4 (unsigned char       *dst,
-              const unsigned char *src,
-              int                  w,
-              int                  h)
+compress_BC5 (unsigned char *dst,
+              unsigned char *block,
+              int            flags)
 {
-  const unsigned int block_count = BLOCK_COUNT(w, h);
-  unsigned int i;
-  unsigned char block[64], *p;
-  int x, y;
+  encode_alpha_block_BC3(dst, block, -2);
+  encode_alpha_block_BC3(dst + 8, block, -1);
+}
 
-#ifdef _OPENMP
-#pragma omp parallel for schedule(dynamic, 256) private(block, p, x, y)
-#endif
-  for (i = 0; i < block_count; ++i)
-    {
-      x = (i % ((w + 3) >> 2)) << 2;
-      y = (i / ((w + 3) >> 2)) << 2;
-      p = dst + BLOCK_OFFSET(x, y, w, 8);
-      extract_block(src, x, y, w, h, block);
-      encode_alpha_block_BC3(p, block, -1);
-    }
+static void
+compress_YCoCg (unsigned char *dst,
+                unsigned char *block,
+                int            flags)
+{
+  encode_alpha_block_BC3(dst, block, 0);
+  encode_YCoCg_block(dst + 8, block);
 }
 
 static void
-compress_BC5 (unsigned char       *dst,
-              const unsigned char *src,
-              int                  w,
-              int                  h)
+compress_block_range (gsize            offset,
+                      gsize            size,
+                      compress_data_t *data)
 {
-  const unsigned int block_count = BLOCK_COUNT(w, h);
+  const unsigned int bw = (data->w + 3) >> 2;
+  unsigned char block[64];
   unsigned int i;
-  unsigned char block[64], *p;
   int x, y;
 
-#ifdef _OPENMP
-#pragma omp parallel for schedule(dynamic, 256) private(block, p, x, y)
-#endif
-  for (i = 0; i < block_count; ++i)
+  for (i = offset; i < offset + size; ++i)
     {
-      x = (i % ((w + 3) >> 2)) << 2;
-      y = (i / ((w + 3) >> 2)) << 2;
-      p = dst + BLOCK_OFFSET(x, y, w, 16);
-      extract_block(src, x, y, w, h, block);
-      encode_alpha_block_BC3(p, block, -2);
-      encode_alpha_block_BC3(p + 8, block, -1);
+      x = (i % bw) << 2;
+      y = (i / bw) << 2;
+      extract_block(data->src, x, y, data->w, data->h, block);
+      data->func(data->dst + BLOCK_OFFSET(x, y, data->w, data->block_size),
+                 block, data->flags);
     }
 }
 
+/* Every block is encoded on its own from its own 16 pixels, so handing
+ * ranges of blocks to several threads yields exactly the same output as
+ * compressing them in order.
+ */
 static void
-compress_YCoCg (unsigned char       *dst,
-                const unsigned char *src,
-                int                  w,
-                int                  h)
+compress_blocks (unsigned char       *dst,
+                 const unsigned char *src,
+                 int                  w,
+                 int                  h,
+                 int                  block_size,
+                 compressfunc_t       func,
+                 int                  flags)
 {
-  const unsigned int block_count = BLOCK_COUNT(w, h);
-  unsigned int i;
-  unsigned char block[64], *p;
-  int x, y;
-
-#ifdef _OPENMP
-#pragma omp parallel for schedule(dynamic, 256) private(block, p, x, y)
-#endif
-  for (i = 0; i < block_count; ++i)
-    {
-      x = (i % ((w + 3) >> 2)) << 2;
-      y = (i / ((w + 3) >> 2)) << 2;
-      p = dst + BLOCK_OFFSET(x, y, w, 16);
-      extract_block(src, x, y, w, h, block);
-      encode_alpha_block_BC3(p, block, 0);
-      encode_YCoCg_block(p + 8, block);
-    }
+  compress_data_t data;
+
+  data.dst        = dst;
+  data.src        = src;
+  data.w          = w;
+  data.h          = h;
+  data.block_size = block_size;
+  data.func       = func;
+  data.flags      = flags;
+
+  gegl_parallel_distribute_range (BLOCK_COUNT(w, h), MIN_BLOCKS_PER_THREAD,
+                                  (GeglParallelDistributeRangeFunc) compress_block_range,
+                                  &data);
 }
 
 int
@@ -1246,29 +1213,29 @@ dxt_compress (unsigned char *dst,
       switch (format)
         {
         case DDS_COMPRESS_BC1:
-          compress_BC1(dst + offset, s, w, h, flags);
+          compress_blocks(dst + offset, s, w, h, 8, compress_BC1, flags);
           break;
         case DDS_COMPRESS_BC2:
-          compress_BC2(dst + offset, s, w, h, flags);
+          compress_blocks(dst + offset, s, w, h, 16, compress_BC2, flags);
           break;
         case DDS_COMPRESS_BC3:
         case DDS_COMPRESS_BC3N:
         case DDS_COMPRESS_RXGB:
         case DDS_COMPRESS_AEXP:
         case DDS_COMPRESS_YCOCG:
-          compress_BC3(dst + offset, s, w, h, flags);
+          compress_blocks(dst + offset, s, w, h, 16, compress_BC3, flags);
           break;
         case DDS_COMPRESS_BC4:
-          compress_BC4(dst + offset, s, w, h);
+          compress_blocks(dst + offset, s, w, h, 8, compress_BC4, 0);
           break;
         case DDS_COMPRESS_BC5:
-          compress_BC5(dst + offset, s, w, h);
+          compress_blocks(dst + offset, s, w, h, 16, compress_BC5, 0);
           break;
         case DDS_COMPRESS_YCOCGS:
-          compress_YCoCg(dst + offset, s, w, h);
+          compress_blocks(dst + offset, s, w, h, 16, compress_YCoCg, 0);
           break;
         default:
-          compress_BC3(dst + offset, s, w, h, flags);
+          compress_blocks(dst + offset, s, w, h, 16, compress_BC3, flags);
           break;
         }
       s += (w * h * bpp);
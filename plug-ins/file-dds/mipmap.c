@@ -26,6 +26,7 @@
 #include <float.h>
 
 #include <gtk/gtk.h>
+#include <gegl.h>
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -438,65 +439,61 @@ scale_image_nearest (unsigned char *dst,
     }
 }
 
+typedef struct
+{
+  unsigned char *dst;
+  int            dw;
+  unsigned char *src;
+  int            sw;
+  int            sh;
+  int            bpp;
+  filterfunc_t   filter;
+  wrapfunc_t     wrap;
+  int            gc;
+  float          gamma;
+  float          xfactor;
+  float          yfactor;
+  float          xscale;
+  float          yscale;
+  float          xsupport;
+  float          ysupport;
+} scale_data_t;
+
 static void
-scale_image (unsigned char *dst,
-             int            dw,
-             int            dh,
-             unsigned char *src,
-             int            sw,
-             int            sh,
-             int            bpp,
-             filterfunc_t   filter,
-             float          support,
-             wrapfunc_t     wrap,
-             int            gc,
-             float          gamma)
+scale_image_rows (gsize         offset,
+                  gsize         size,
+                  scale_data_t *data)
 {
-  const float blur = 1.0f;
-  const float xfactor = (float)dw / (float)sw;
-  const float yfactor = (float)dh / (float)sh;
+  unsigned char *dst = data->dst;
+  unsigned char *src = data->src;
+  const int dw = data->dw;
+  const int sw = data->sw;
+  const int sh = data->sh;
+  const int bpp = data->bpp;
+  filterfunc_t filter = data->filter;
+  wrapfunc_t wrap = data->wrap;
+  const int gc = data->gc;
+  const float gamma = data->gamma;
+  const float xfactor = data->xfactor;
+  const float yfactor = data->yfactor;
+  const float xscale = data->xscale;
+  const float yscale = data->yscale;
+  const float xsupport = data->xsupport;
+  const float ysupport = data->ysupport;
 
   int x, y, start, stop, nmax, n, i;
   int sstride = sw * bpp;
   float center, contrib, density, s, r, t;
 
   unsigned char *d, *row, *col;
-
-  float xscale = MIN(xfactor, 1.0f) / blur;
-  float yscale = MIN(yfactor, 1.0f) / blur;
-  float xsupport = support / xscale;
-  float ysupport = support / yscale;
   unsigned char *tmp;
 
-  if (xsupport <= 0.5f)
-    {
-      xsupport = 0.5f + 1e-10f;
-      xscale = 1.0f;
-    }
-
-  if (ysupport <= 0.5f)
-    {
-      ysupport = 0.5f + 1e-10f;
-      yscale = 1.0f;
-    }
-
-#ifdef _OPENMP
-  tmp = g_malloc(sw * bpp * omp_get_max_threads());
-#else
   tmp = g_malloc(sw * bpp);
-#endif
 
-#ifdef _OPENMP
-#pragma omp parallel for schedule(dynamic)                              \
-  private(x, y, d, row, col, center, start, stop, nmax, s, i, n, density, r, t, contrib)
-#endif
-  for (y = 0; y < dh; ++y)
+  for (y = offset; y < (int) (offset + size); ++y)
     {
       /* resample in Y direction to temp buffer */
       d = tmp;
-#ifdef _OPENMP
-      d += (sw * bpp * omp_get_thread_num());
-#endif
 
       center = ((float)y + 0.5f) / yfactor;
       start = (int)(center - ysupport + 0.5f);
@@ -580,6 +577,60 @@ scale_image (unsigned char *dst,
   g_free (tmp);
 }
 
+static void
+scale_image (unsigned char *dst,
+             int            dw,
+             int            dh,
+             unsigned char *src,
+             int            sw,
+             int            sh,
+             int            bpp,
+             filterfunc_t   filter,
+             float          support,
+             wrapfunc_t     wrap,
+             int            gc,
+             float          gamma)
+{
+  const float blur = 1.0f;
+  scale_data_t data;
+
+  data.dst      = dst;
+  data.dw       = dw;
+  data.src      = src;
+  data.sw       = sw;
+  data.sh       = sh;
+  data.bpp      = bpp;
+  data.filter   = filter;
+  data.wrap     = wrap;
+  data.gc       = gc;
+  data.gamma    = gamma;
+  data.xfactor  = (float)dw / (float)sw;
+  data.yfactor  = (float)dh / (float)sh;
+  data.xscale   = MIN(data.xfactor, 1.0f) / blur;
+  data.yscale   = MIN(data.yfactor, 1.0f) / blur;
+  data.xsupport = support / data.xscale;
+  data.ysupport = support / data.yscale;
+
+  if (data.xsupport <= 0.5f)
+    {
+      data.xsupport = 0.5f + 1e-10f;
+      data.xscale = 1.0f;
+    }
+
+  if (data.ysupport <= 0.5f)
+    {
+      data.ysupport = 0.5f + 1e-10f;
+      data.yscale = 1.0f;
+    }
+
+  /* every destination row only reads the source level, so rows can be
+   * resampled by any number of threads with the same result
+   */
+  gegl_parallel_distribute_range (dh, MAX(1, 4096 / MAX(1, dw)),
+                                  (GeglParallelDistributeRangeFunc) scale_image_rows,
+                                  &data);
+}
+
 /******************************************************************************
  * 3D image scaling                                                           *
  ******************************************************************************/
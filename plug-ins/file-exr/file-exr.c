@@ -25,6 +25,7 @@
 #include "openexr-wrapper.h"
 
 #define LOAD_PROC       "file-exr-load"
+#define SAVE_PROC       "file-exr-save"
 #define PLUG_IN_BINARY  "file-exr"
 #define PLUG_IN_VERSION "0.0.0"
 
@@ -58,9 +59,25 @@ static GimpValueArray * exr_load             (GimpProcedure        *procedure,
                                               const GimpValueArray *args,
                                               gpointer              run_data);
 
+static GimpValueArray * exr_save             (GimpProcedure        *procedure,
+                                              GimpRunMode           run_mode,
+                                              GimpImage            *image,
+                                              gint                  n_drawables,
+                                              GimpDrawable        **drawables,
+                                              GFile                *file,
+                                              const GimpValueArray *args,
+                                              gpointer              run_data);
+
 static GimpImage      * load_image           (GFile                *file,
                                               gboolean              interactive,
                                               GError              **error);
+static gboolean         save_image           (GFile                *file,
+                                              GimpDrawable         *drawable,
+                                              GObject              *config,
+                                              GError              **error);
+static gboolean         save_dialog          (GimpProcedure        *procedure,
+                                              GObject              *config);
+static gint             get_band_height      (gint                  chunk_height);
 static void             sanitize_comment     (gchar                *comment);
 
 
@@ -86,7 +103,12 @@ exr_init (Exr *exr)
 static GList *
 exr_query_procedures (GimpPlugIn *plug_in)
 {
-  return g_list_append (NULL, g_strdup (LOAD_PROC));
+  GList *list = NULL;
+
+  list = g_list_append (list, g_strdup (LOAD_PROC));
+  list = g_list_append (list, g_strdup (SAVE_PROC));
+
+  return list;
 }
 
 static GimpProcedure *
@@ -121,6 +143,49 @@ exr_create_procedure (GimpPlugIn  *plug_in,
       gimp_file_procedure_set_magics (GIMP_FILE_PROCEDURE (procedure),
                                       "0,long,0x762f3101");
     }
+  else if (! strcmp (name, SAVE_PROC))
+    {
+      procedure = gimp_save_procedure_new (plug_in, name,
+                                           GIMP_PDB_PROC_TYPE_PLUGIN,
+                                           exr_save, NULL, NULL);
+
+      gimp_procedure_set_image_types (procedure, "RGB*, GRAY*");
+
+      gimp_procedure_set_menu_label (procedure, N_("OpenEXR image"));
+
+      gimp_procedure_set_documentation (procedure,
+                                        "Exports files in the OpenEXR file format",
+                                        "This plug-in exports OpenEXR files, "
+                                        "as linear half or single precision "
+                                        "floating point data. Image metadata "
+                                        "is not exported.",
+                                        name);
+      gimp_procedure_set_attribution (procedure,
+                                      "The GIMP Team",
+                                      "The GIMP Team",
+                                      "2023");
+
+      gimp_file_procedure_set_format_name (GIMP_FILE_PROCEDURE (procedure),
+                                           _("OpenEXR"));
+      gimp_file_procedure_set_mime_types (GIMP_FILE_PROCEDURE (procedure),
+                                          "image/x-exr");
+      gimp_file_procedure_set_extensions (GIMP_FILE_PROCEDURE (procedure),
+                                          "exr");
+
+      GIMP_PROC_ARG_INT (procedure, "compression",
+                         "Compression",
+                         "Compression (0 = none, 1 = RLE, 2 = ZIPS, 3 = ZIP, "
+                         "4 = PIZ, 5 = PXR24, 6 = B44, 7 = B44A)",
+                         COMPRESSION_NONE, COMPRESSION_B44A, COMPRESSION_ZIP,
+                         G_PARAM_READWRITE);
+
+      GIMP_PROC_ARG_BOOLEAN (procedure, "half",
+                             "Save as _half float",
+                             "Write 16-bit half float instead of "
+                             "32-bit float data",
+                             TRUE,
+                             G_PARAM_READWRITE);
+    }
 
   return procedure;
 }
@@ -156,6 +221,83 @@ exr_load (GimpProcedure        *procedure,
   return return_vals;
 }
 
+static GimpValueArray *
+exr_save (GimpProcedure        *procedure,
+          GimpRunMode           run_mode,
+          GimpImage            *image,
+          gint                  n_drawables,
+          GimpDrawable        **drawables,
+          GFile                *file,
+          const GimpValueArray *args,
+          gpointer              run_data)
+{
+  GimpProcedureConfig *config;
+  GimpPDBStatusType    status = GIMP_PDB_SUCCESS;
+  GimpExportReturn     export = GIMP_EXPORT_CANCEL;
+  GError              *error  = NULL;
+
+  INIT_I18N ();
+  gegl_init (NULL, NULL);
+
+  config = gimp_procedure_create_config (procedure);
+  gimp_procedure_config_begin_run (config, image, run_mode, args);
+
+  switch (run_mode)
+    {
+    case GIMP_RUN_INTERACTIVE:
+    case GIMP_RUN_WITH_LAST_VALS:
+      gimp_ui_init (PLUG_IN_BINARY);
+
+      export = gimp_export_image (&image, &n_drawables, &drawables, "OpenEXR",
+                                  GIMP_EXPORT_CAN_HANDLE_RGB  |
+                                  GIMP_EXPORT_CAN_HANDLE_GRAY |
+                                  GIMP_EXPORT_CAN_HANDLE_ALPHA);
+
+      if (export == GIMP_EXPORT_CANCEL)
+        {
+          g_object_unref (config);
+
+          return gimp_procedure_new_return_values (procedure,
+                                                   GIMP_PDB_CANCEL,
+                                                   NULL);
+        }
+      break;
+
+    default:
+      break;
+    }
+
+  if (n_drawables != 1)
+    {
+      g_set_error (&error, G_FILE_ERROR, 0,
+                   _("OpenEXR format does not support multiple layers."));
+
+      status = GIMP_PDB_CALLING_ERROR;
+    }
+  else if (run_mode == GIMP_RUN_INTERACTIVE)
+    {
+      if (! save_dialog (procedure, G_OBJECT (config)))
+        status = GIMP_PDB_CANCEL;
+    }
+
+  if (status == GIMP_PDB_SUCCESS)
+    {
+      if (! save_image (file, drawables[0], G_OBJECT (config), &error))
+        status = GIMP_PDB_EXECUTION_ERROR;
+    }
+
+  gimp_procedure_config_end_run (config, status);
+  g_object_unref (config);
+
+  if (export == GIMP_EXPORT_EXPORT)
+    {
+      gimp_image_delete (image);
+      g_free (drawables);
+    }
+
+  return gimp_procedure_new_return_values (procedure, status, error);
+}
+
 static GimpImage *
 load_image (GFile        *file,
             gboolean      interactive,
@@ -174,7 +316,7 @@ load_image (GFile        *file,
   const Babl       *format;
   GeglBuffer       *buffer = NULL;
   gint              bpp;
-  gint              tile_height;
+  gint              band_height;
   gchar            *pixels = NULL;
   gint              begin;
   gint32            success = FALSE;
@@ -188,6 +330,8 @@ load_image (GFile        *file,
   gimp_progress_init_printf (_("Opening '%s'"),
                              gimp_file_get_utf8_name (file));
 
+  exr_set_thread_count (gimp_get_num_processors ());
+
   filename = g_file_get_path (file);
   loader = exr_loader_new (filename);
   g_free (filename);
@@ -281,38 +425,25 @@ load_image (GFile        *file,
   format = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
   bpp = babl_format_get_bytes_per_pixel (format);
 
-  tile_height = gimp_tile_height ();
-  pixels = g_new0 (gchar, tile_height * width * bpp);
+  band_height = get_band_height (exr_loader_get_chunk_height (loader));
+  pixels = g_new0 (gchar, (gsize) band_height * width * bpp);
 
-  for (begin = 0; begin < height; begin += tile_height)
+  for (begin = 0; begin < height; begin += band_height)
     {
-      gint end;
-      gint num;
-      gint i;
+      gint num = MIN (band_height, height - begin);
 
-      end = MIN (begin + tile_height, height);
-      num = end - begin;
-
-      for (i = 0; i < num; i++)
+      if (exr_loader_read_pixel_rows (loader, pixels, bpp, begin, num) < 0)
         {
-          gint retval;
-
-          retval = exr_loader_read_pixel_row (loader,
-                                              pixels + (i * width * bpp),
-                                              bpp, begin + i);
-          if (retval < 0)
-            {
-              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
-                           _("Error reading pixel data from '%s'"),
-                           gimp_file_get_utf8_name (file));
-              goto out;
-            }
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("Error reading pixel data from '%s'"),
+                       gimp_file_get_utf8_name (file));
+          goto out;
         }
 
       gegl_buffer_set (buffer, GEGL_RECTANGLE (0, begin, width, num),
                        0, NULL, pixels, GEGL_AUTO_ROWSTRIDE);
 
-      gimp_progress_update ((gdouble) begin / (gdouble) height);
+      gimp_progress_update ((gdouble) (begin + num) / (gdouble) height);
     }
 
   /* try to read the file comment */
@@ -399,3 +530,190 @@ sanitize_comment (gchar *comment)
         }
     }
 }
+
+static gboolean
+save_image (GFile         *file,
+            GimpDrawable  *drawable,
+            GObject       *config,
+            GError       **error)
+{
+  gchar          *filename;
+  EXRSaver       *saver;
+  GeglBuffer     *buffer;
+  const Babl     *format;
+  EXRImageType    image_type;
+  EXRCompression  compression;
+  gboolean        half;
+  gboolean        has_alpha;
+  gint            width;
+  gint            height;
+  gint            bpp;
+  gint            band_height;
+  gchar          *pixels;
+  gint            begin;
+  gboolean        success = FALSE;
+
+  g_object_get (config,
+                "compression", &compression,
+                "half",        &half,
+                NULL);
+
+  gimp_progress_init_printf (_("Exporting '%s'"),
+                             gimp_file_get_utf8_name (file));
+
+  exr_set_thread_count (gimp_get_num_processors ());
+
+  width     = gimp_drawable_width  (drawable);
+  height    = gimp_drawable_height (drawable);
+  has_alpha = gimp_drawable_has_alpha (drawable);
+
+  /* OpenEXR stores linear light */
+  if (gimp_drawable_is_gray (drawable))
+    {
+      image_type = IMAGE_TYPE_GRAY;
+
+      if (has_alpha)
+        format = babl_format (half ? "YA half" : "YA float");
+      else
+        format = babl_format (half ? "Y half" : "Y float");
+    }
+  else
+    {
+      image_type = IMAGE_TYPE_RGB;
+
+      if (has_alpha)
+        format = babl_format (half ? "RGBA half" : "RGBA float");
+      else
+        format = babl_format (half ? "RGB half" : "RGB float");
+    }
+
+  bpp = babl_format_get_bytes_per_pixel (format);
+
+  filename = g_file_get_path (file);
+  saver = exr_saver_new (filename, width, height, image_type,
+                         half ? PREC_HALF : PREC_FLOAT, has_alpha,
+                         compression);
+  g_free (filename);
+
+  if (! saver)
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   _("Could not open '%s' for writing"),
+                   gimp_file_get_utf8_name (file));
+      return FALSE;
+    }
+
+  buffer = gimp_drawable_get_buffer (drawable);
+
+  /* Rows are exported in bands, so that the whole image is never held
+   * in memory twice, while OpenEXR still gets enough rows at a time to
+   * compress them with all threads.
+   */
+  band_height = get_band_height (exr_saver_get_chunk_height (saver));
+  pixels = g_new (gchar, (gsize) band_height * width * bpp);
+
+  for (begin = 0; begin < height; begin += band_height)
+    {
+      gint num = MIN (band_height, height - begin);
+
+      gegl_buffer_get (buffer, GEGL_RECTANGLE (0, begin, width, num), 1.0,
+                       format, pixels,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      if (exr_saver_write_pixel_rows (saver, pixels, bpp, num) < 0)
+        {
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("Error writing pixel data to '%s'"),
+                       gimp_file_get_utf8_name (file));
+          goto out;
+        }
+
+      gimp_progress_update ((gdouble) (begin + num) / (gdouble) height);
+    }
+
+  success = TRUE;
+
+ out:
+  if (exr_saver_close (saver) < 0 && success)
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   _("Error writing pixel data to '%s'"),
+                   gimp_file_get_utf8_name (file));
+      success = FALSE;
+    }
+
+  g_free (pixels);
+  g_object_unref (buffer);
+
+  if (success)
+    gimp_progress_update (1.0);
+
+  return success;
+}
+
+static gboolean
+save_dialog (GimpProcedure *procedure,
+             GObject       *config)
+{
+  GtkWidget    *dialog;
+  GtkWidget    *grid;
+  GtkListStore *store;
+  GtkWidget    *combo;
+  GtkWidget    *toggle;
+  gboolean      run;
+
+  dialog = gimp_procedure_dialog_new (procedure,
+                                      GIMP_PROCEDURE_CONFIG (config),
+                                      _("Export Image as OpenEXR"));
+
+  grid = gtk_grid_new ();
+  gtk_container_set_border_width (GTK_CONTAINER (grid), 12);
+  gtk_grid_set_row_spacing (GTK_GRID (grid), 6);
+  gtk_grid_set_column_spacing (GTK_GRID (grid), 6);
+  gtk_box_pack_start (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (dialog))),
+                      grid, TRUE, TRUE, 0);
+  gtk_widget_show (grid);
+
+  store = gimp_int_store_new (_("None"),  COMPRESSION_NONE,
+                              "RLE",      COMPRESSION_RLE,
+                              "ZIPS",     COMPRESSION_ZIPS,
+                              "ZIP",      COMPRESSION_ZIP,
+                              "PIZ",      COMPRESSION_PIZ,
+                              "PXR24",    COMPRESSION_PXR24,
+                              "B44",      COMPRESSION_B44,
+                              "B44A",     COMPRESSION_B44A,
+                              NULL);
+  combo = gimp_prop_int_combo_box_new (config, "compression",
+                                       GIMP_INT_STORE (store));
+  g_object_unref (store);
+
+  gimp_grid_attach_aligned (GTK_GRID (grid), 0, 0,
+                            _("_Compression:"), 1.0, 0.5,
+                            combo, 1);
+
+  toggle = gimp_prop_check_button_new (config, "half",
+                                       _("Save as _half float"));
+  gtk_grid_attach (GTK_GRID (grid), toggle, 0, 1, 2, 1);
+
+  gtk_widget_show (dialog);
+
+  run = (gimp_dialog_run (GIMP_DIALOG (dialog)) == GTK_RESPONSE_OK);
+
+  gtk_widget_destroy (dialog);
+
+  return run;
+}
+
+/* Rows are read and written in bands a whole number of GIMP tiles high,
+ * holding a few compressed chunks for every thread of OpenEXR's pool.
+ */
+static gint
+get_band_height (gint chunk_height)
+{
+  gint tile_height = gimp_tile_height ();
+  gint height;
+
+  height = MAX (chunk_height, 1) * gimp_get_num_processors () * 2;
+
+  return (height + tile_height - 1) / tile_height * tile_height;
+}
@@ -52,10 +52,12 @@
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated"
 #include <ImfInputFile.h>
+#include <ImfOutputFile.h>
 #include <ImfChannelList.h>
 #include <ImfRgbaFile.h>
 #include <ImfRgbaYca.h>
 #include <ImfStandardAttributes.h>
+#include <ImfThreading.h>
 #pragma GCC diagnostic pop
 
 #include "exr-attribute-blob.h"
@@ -65,6 +67,27 @@ using namespace Imf;
 using namespace Imf::RgbaYca;
 using namespace Imath;
 
+// Number of scanlines compressed together, and so decoded or encoded
+// as one job by OpenEXR's thread pool.
+static int lines_per_chunk(Compression compression)
+{
+  switch (compression)
+    {
+    case NO_COMPRESSION:
+    case RLE_COMPRESSION:
+    case ZIPS_COMPRESSION:
+      return 1;
+    case ZIP_COMPRESSION:
+    case PXR24_COMPRESSION:
+      return 16;
+    case PIZ_COMPRESSION:
+    case B44_COMPRESSION:
+    case B44A_COMPRESSION:
+    default:
+      return 32;
+    }
+}
+
 static bool XYZ_equal(cmsCIEXYZ *a, cmsCIEXYZ *b)
 {
   static const double epsilon = 0.0001;
@@ -149,44 +172,55 @@ struct _EXRLoader
       }
   }
 
-  int readPixelRow(char* pixels,
-                   int bpp,
-                   int row)
+  int readPixelRows(char* pixels,
+                    int bpp,
+                    int row,
+                    int n_rows)
   {
     const int actual_row = data_window_.min.y + row;
+    const size_t stride = (size_t) getWidth() * bpp;
     FrameBuffer fb;
     // This is necessary because OpenEXR expects the buffer to begin at
     // (0, 0). Though it probably results in some unmapped address,
     // hopefully OpenEXR will not make use of it. :/
-    char* base = pixels - (data_window_.min.x * bpp);
+    char* base = pixels - (data_window_.min.x * bpp) - (actual_row * stride);
 
     switch (image_type_)
       {
       case IMAGE_TYPE_GRAY:
-        fb.insert("Y", Slice(pt_, base, bpp, 0, 1, 1, 0.5));
+        fb.insert("Y", Slice(pt_, base, bpp, stride, 1, 1, 0.5));
         if (hasAlpha())
           {
-            fb.insert("A", Slice(pt_, base + bpc_, bpp, 0, 1, 1, 1.0));
+            fb.insert("A", Slice(pt_, base + bpc_, bpp, stride, 1, 1, 1.0));
           }
         break;
 
       case IMAGE_TYPE_RGB:
       default:
-        fb.insert("R", Slice(pt_, base + (bpc_ * 0), bpp, 0, 1, 1, 0.0));
-        fb.insert("G", Slice(pt_, base + (bpc_ * 1), bpp, 0, 1, 1, 0.0));
-        fb.insert("B", Slice(pt_, base + (bpc_ * 2), bpp, 0, 1, 1, 0.0));
+        fb.insert("R", Slice(pt_, base + (bpc_ * 0), bpp, stride, 1, 1, 0.0));
+        fb.insert("G", Slice(pt_, base + (bpc_ * 1), bpp, stride, 1, 1, 0.0));
+        fb.insert("B", Slice(pt_, base + (bpc_ * 2), bpp, stride, 1, 1, 0.0));
         if (hasAlpha())
           {
-            fb.insert("A", Slice(pt_, base + (bpc_ * 3), bpp, 0, 1, 1, 1.0));
+            fb.insert("A", Slice(pt_, base + (bpc_ * 3), bpp, stride, 1, 1, 1.0));
           }
       }
 
+    // Reading all rows at once lets the thread pool decode their
+    // chunks in parallel.
     file_.setFrameBuffer(fb);
-    file_.readPixels(actual_row);
+    file_.readPixels(actual_row, actual_row + n_rows - 1);
 
     return 0;
   }
 
+  int getChunkHeight() const {
+    if (file_.isTiled())
+      return file_.header().tileDescription().ySize;
+
+    return lines_per_chunk(file_.header().compression());
+  }
+
   int getWidth() const {
     return data_window_.max.x - data_window_.min.x + 1;
   }
@@ -501,17 +535,236 @@ exr_loader_get_xmp (EXRLoader *loader,
   return loader->getXmp (size);
 }
 
+int
+exr_loader_get_chunk_height (EXRLoader *loader)
+{
+  // This does not throw.
+  return loader->getChunkHeight();
+}
+
 int
 exr_loader_read_pixel_row (EXRLoader *loader,
                            char *pixels,
                            int bpp,
                            int row)
+{
+  return exr_loader_read_pixel_rows (loader, pixels, bpp, row, 1);
+}
+
+int
+exr_loader_read_pixel_rows (EXRLoader *loader,
+                            char *pixels,
+                            int bpp,
+                            int row,
+                            int n_rows)
+{
+  int retval = -1;
+  // Don't let any exceptions propagate to the C layer.
+  try
+    {
+      retval = loader->readPixelRows(pixels, bpp, row, n_rows);
+    }
+  catch (...)
+    {
+      retval = -1;
+    }
+
+  return retval;
+}
+
+struct _EXRSaver
+{
+  _EXRSaver(const char* filename,
+            int width,
+            int height,
+            EXRImageType image_type,
+            EXRPrecision precision,
+            bool has_alpha,
+            EXRCompression compression) :
+    header_(width, height),
+    width_(width),
+    image_type_(image_type),
+    has_alpha_(has_alpha),
+    file_(NULL)
+  {
+    switch (precision)
+      {
+      case PREC_UINT:
+        pt_ = UINT;
+        bpc_ = 4;
+        break;
+      case PREC_HALF:
+        pt_ = HALF;
+        bpc_ = 2;
+        break;
+      case PREC_FLOAT:
+      default:
+        pt_ = FLOAT;
+        bpc_ = 4;
+      }
+
+    switch (compression)
+      {
+      case COMPRESSION_NONE:
+        header_.compression() = NO_COMPRESSION;
+        break;
+      case COMPRESSION_RLE:
+        header_.compression() = RLE_COMPRESSION;
+        break;
+      case COMPRESSION_ZIPS:
+        header_.compression() = ZIPS_COMPRESSION;
+        break;
+      case COMPRESSION_ZIP:
+        header_.compression() = ZIP_COMPRESSION;
+        break;
+      case COMPRESSION_PIZ:
+        header_.compression() = PIZ_COMPRESSION;
+        break;
+      case COMPRESSION_PXR24:
+        header_.compression() = PXR24_COMPRESSION;
+        break;
+      case COMPRESSION_B44:
+        header_.compression() = B44_COMPRESSION;
+        break;
+      case COMPRESSION_B44A:
+        header_.compression() = B44A_COMPRESSION;
+        break;
+      }
+
+    switch (image_type_)
+      {
+      case IMAGE_TYPE_GRAY:
+        header_.channels().insert("Y", Channel(pt_));
+        break;
+
+      case IMAGE_TYPE_RGB:
+      default:
+        header_.channels().insert("R", Channel(pt_));
+        header_.channels().insert("G", Channel(pt_));
+        header_.channels().insert("B", Channel(pt_));
+      }
+
+    if (has_alpha_)
+      header_.channels().insert("A", Channel(pt_));
+
+    file_ = new OutputFile(filename, header_, globalThreadCount());
+  }
+
+  ~_EXRSaver()
+  {
+    delete file_;
+  }
+
+  int writePixelRows(const char* pixels,
+                     int bpp,
+                     int n_rows)
+  {
+    const int row = file_->currentScanLine();
+    const size_t stride = (size_t) width_ * bpp;
+    FrameBuffer fb;
+    // The frame buffer is addressed with absolute coordinates, like
+    // when reading.
+    char* base = (char *) pixels - (row * stride);
+
+    switch (image_type_)
+      {
+      case IMAGE_TYPE_GRAY:
+        fb.insert("Y", Slice(pt_, base, bpp, stride));
+        if (has_alpha_)
+          fb.insert("A", Slice(pt_, base + bpc_, bpp, stride));
+        break;
+
+      case IMAGE_TYPE_RGB:
+      default:
+        fb.insert("R", Slice(pt_, base + (bpc_ * 0), bpp, stride));
+        fb.insert("G", Slice(pt_, base + (bpc_ * 1), bpp, stride));
+        fb.insert("B", Slice(pt_, base + (bpc_ * 2), bpp, stride));
+        if (has_alpha_)
+          fb.insert("A", Slice(pt_, base + (bpc_ * 3), bpp, stride));
+      }
+
+    // Writing all rows at once lets the thread pool compress their
+    // chunks in parallel.
+    file_->setFrameBuffer(fb);
+    file_->writePixels(n_rows);
+
+    return 0;
+  }
+
+  int getChunkHeight() const {
+    return lines_per_chunk(header_.compression());
+  }
+
+  Header header_;
+  int width_;
+  EXRImageType image_type_;
+  bool has_alpha_;
+  PixelType pt_;
+  int bpc_;
+  OutputFile *file_;
+};
+
+EXRSaver *
+exr_saver_new (const char     *filename,
+               int             width,
+               int             height,
+               EXRImageType    image_type,
+               EXRPrecision    precision,
+               int             has_alpha,
+               EXRCompression  compression)
+{
+  EXRSaver *saver;
+
+  // Don't let any exceptions propagate to the C layer.
+  try
+    {
+      saver = new EXRSaver(filename, width, height, image_type, precision,
+                           has_alpha ? true : false, compression);
+    }
+  catch (...)
+    {
+      saver = NULL;
+    }
+
+  return saver;
+}
+
+int
+exr_saver_close (EXRSaver *saver)
+{
+  int retval = 0;
+
+  // Don't let any exceptions propagate to the C layer.
+  try
+    {
+      delete saver;
+    }
+  catch (...)
+    {
+      retval = -1;
+    }
+
+  return retval;
+}
+
+int
+exr_saver_get_chunk_height (EXRSaver *saver)
+{
+  // This does not throw.
+  return saver->getChunkHeight();
+}
+
+int
+exr_saver_write_pixel_rows (EXRSaver   *saver,
+                            const char *pixels,
+                            int         bpp,
+                            int         n_rows)
 {
   int retval = -1;
   // Don't let any exceptions propagate to the C layer.
   try
     {
-      retval = loader->readPixelRow(pixels, bpp, row);
+      retval = saver->writePixelRows(pixels, bpp, n_rows);
     }
   catch (...)
     {
@@ -520,3 +773,16 @@ exr_loader_read_pixel_row (EXRLoader *loader,
 
   return retval;
 }
+
+void
+exr_set_thread_count (int n_threads)
+{
+  // Don't let any exceptions propagate to the C layer.
+  try
+    {
+      setGlobalThreadCount(n_threads);
+    }
+  catch (...)
+    {
+    }
+}
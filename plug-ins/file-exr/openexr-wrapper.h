@@ -24,6 +24,7 @@ G_BEGIN_DECLS
  * exposed to more than this.
  */
 typedef struct _EXRLoader EXRLoader;
+typedef struct _EXRSaver  EXRSaver;
 
 typedef enum
 {
@@ -38,6 +39,21 @@ typedef enum
   IMAGE_TYPE_GRAY
 } EXRImageType;
 
+typedef enum
+{
+  COMPRESSION_NONE,
+  COMPRESSION_RLE,
+  COMPRESSION_ZIPS,
+  COMPRESSION_ZIP,
+  COMPRESSION_PIZ,
+  COMPRESSION_PXR24,
+  COMPRESSION_B44,
+  COMPRESSION_B44A
+} EXRCompression;
+
+
+void               exr_set_thread_count      (int         n_threads);
+
 
 EXRLoader        * exr_loader_new            (const char *filename);
 
@@ -58,10 +74,34 @@ guchar           * exr_loader_get_exif       (EXRLoader  *loader,
 guchar           * exr_loader_get_xmp        (EXRLoader  *loader,
                                               guint      *size);
 
+int                exr_loader_get_chunk_height (EXRLoader *loader);
+
 int                exr_loader_read_pixel_row (EXRLoader *loader,
                                               char      *pixels,
                                               int        bpp,
                                               int        row);
+int                exr_loader_read_pixel_rows (EXRLoader *loader,
+                                               char      *pixels,
+                                               int        bpp,
+                                               int        row,
+                                               int        n_rows);
+
+
+EXRSaver         * exr_saver_new             (const char     *filename,
+                                              int             width,
+                                              int             height,
+                                              EXRImageType    image_type,
+                                              EXRPrecision    precision,
+                                              int             has_alpha,
+                                              EXRCompression  compression);
+int                exr_saver_close           (EXRSaver       *saver);
+
+int                exr_saver_get_chunk_height (EXRSaver      *saver);
+
+int                exr_saver_write_pixel_rows (EXRSaver      *saver,
+                                               const char    *pixels,
+                                               int            bpp,
+                                               int            n_rows);
 
 G_END_DECLS
 
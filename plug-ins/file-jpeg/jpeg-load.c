@@ -39,6 +39,7 @@
 #include "jpeg-icc.h"
 #include "jpeg-settings.h"
 #include "jpeg-load.h"
+#include "jpeg-restart.h"
 
 static gboolean  jpeg_load_resolution       (GimpImage *image,
                                              struct jpeg_decompress_struct
@@ -349,6 +350,30 @@ load_image (GFile        *file,
                                    "R'G'B' u8" : "Y' u8",
                                    gimp_drawable_get_format (GIMP_DRAWABLE (layer)));
 
+  /* Files with restart markers can be decoded strip by strip on all
+   * processors at once.
+   */
+  if (! preview)
+    {
+      guchar *pixels = jpeg_restart_decode (&cinfo, file);
+
+      if (pixels)
+        {
+          gegl_buffer_set (buffer,
+                           GEGL_RECTANGLE (0, 0,
+                                           cinfo.output_width,
+                                           cinfo.output_height),
+                           0,
+                           format,
+                           pixels,
+                           GEGL_AUTO_ROWSTRIDE);
+          g_free (pixels);
+
+          /* the decompressor itself has not read any scanlines */
+          goto finish;
+        }
+    }
+
   while (cinfo.output_scanline < cinfo.output_height)
     {
       gint     start, end;
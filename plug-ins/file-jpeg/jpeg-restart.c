@@ -0,0 +1,907 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <setjmp.h>
+
+#include <jpeglib.h>
+#include <jerror.h>
+
+#include <libgimp/gimp.h>
+
+#include "jpeg.h"
+#include "jpeg-restart.h"
+
+
+#define MARKER_SOF0  0xc0
+#define MARKER_SOF1  0xc1
+#define MARKER_RST0  0xd0
+#define MARKER_RST7  0xd7
+#define MARKER_SOI   0xd8
+#define MARKER_EOI   0xd9
+#define MARKER_SOS   0xda
+#define MARKER_APP1  0xe1
+#define MARKER_APP2  0xe2
+#define MARKER_COM   0xfe
+
+#define IS_RST(m)    ((m) >= MARKER_RST0 && (m) <= MARKER_RST7)
+
+/* size of the output buffer of the memory destination */
+#define DEST_BUFFER_SIZE   4096
+
+/* pixels fetched from the drawable for one round of strip encoders */
+#define ENCODE_BATCH_SIZE  (64 * 1024 * 1024)
+
+/* minimum number of pixel rows a strip is worth starting a thread for */
+#define MIN_STRIP_ROWS     64
+
+
+typedef struct
+{
+  struct jpeg_destination_mgr  pub;
+  GByteArray                  *data;
+  JOCTET                       buffer[DEST_BUFFER_SIZE];
+} JpegMemDest;
+
+typedef struct
+{
+  j_compress_ptr   cinfo;
+  guchar          *pixels;
+  gint             rowstride;
+  gint             n_rows;
+  gint             interval_rows;
+  GByteArray     **strips;
+  gint             failed;
+} EncodeData;
+
+typedef struct
+{
+  j_decompress_ptr   cinfo;
+  const guchar      *data;
+  const GByteArray  *header;
+  gsize              sof;
+  const gsize       *seg_start;
+  const gsize       *seg_end;
+  gint               n_segments;
+  gint               mcu_height;
+  gint               granule;
+  gint               overlap;
+  guchar            *pixels;
+  gint               failed;
+} DecodeData;
+
+
+static void
+mem_dest_init (j_compress_ptr cinfo)
+{
+  JpegMemDest *dest = (JpegMemDest *) cinfo->dest;
+
+  dest->pub.next_output_byte = dest->buffer;
+  dest->pub.free_in_buffer   = DEST_BUFFER_SIZE;
+}
+
+static boolean
+mem_dest_empty (j_compress_ptr cinfo)
+{
+  JpegMemDest *dest = (JpegMemDest *) cinfo->dest;
+
+  g_byte_array_append (dest->data, dest->buffer, DEST_BUFFER_SIZE);
+
+  dest->pub.next_output_byte = dest->buffer;
+  dest->pub.free_in_buffer   = DEST_BUFFER_SIZE;
+
+  return TRUE;
+}
+
+static void
+mem_dest_term (j_compress_ptr cinfo)
+{
+  JpegMemDest *dest = (JpegMemDest *) cinfo->dest;
+
+  g_byte_array_append (dest->data, dest->buffer,
+                       DEST_BUFFER_SIZE - dest->pub.free_in_buffer);
+
+  dest->pub.next_output_byte = dest->buffer;
+  dest->pub.free_in_buffer   = DEST_BUFFER_SIZE;
+}
+
+void
+jpeg_restart_mem_dest (j_compress_ptr  cinfo,
+                       GByteArray     *data)
+{
+  JpegMemDest *dest;
+
+  /* cinfo may already have a destination of another kind, so always
+   * allocate a new one
+   */
+  dest = (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+                                     sizeof (JpegMemDest));
+
+  dest->pub.init_destination    = mem_dest_init;
+  dest->pub.empty_output_buffer = mem_dest_empty;
+  dest->pub.term_destination    = mem_dest_term;
+  dest->data                    = data;
+
+  cinfo->dest = (struct jpeg_destination_mgr *) dest;
+}
+
+static void
+mem_src_init (j_decompress_ptr cinfo)
+{
+}
+
+static boolean
+mem_src_fill (j_decompress_ptr cinfo)
+{
+  static const JOCTET eoi[2] = { 0xff, MARKER_EOI };
+
+  /* the whole stream is in memory, so the data is truncated */
+  WARNMS (cinfo, JWRN_JPEG_EOF);
+
+  cinfo->src->next_input_byte = eoi;
+  cinfo->src->bytes_in_buffer = 2;
+
+  return TRUE;
+}
+
+static void
+mem_src_skip (j_decompress_ptr cinfo,
+              long             num_bytes)
+{
+  if (num_bytes <= 0)
+    return;
+
+  if ((size_t) num_bytes > cinfo->src->bytes_in_buffer)
+    {
+      mem_src_fill (cinfo);
+    }
+  else
+    {
+      cinfo->src->next_input_byte += num_bytes;
+      cinfo->src->bytes_in_buffer -= num_bytes;
+    }
+}
+
+static void
+mem_src_term (j_decompress_ptr cinfo)
+{
+}
+
+static void
+mem_src (j_decompress_ptr  cinfo,
+         const guchar     *data,
+         gsize             size)
+{
+  struct jpeg_source_mgr *src;
+
+  src = (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+                                    sizeof (struct jpeg_source_mgr));
+
+  src->init_source       = mem_src_init;
+  src->fill_input_buffer = mem_src_fill;
+  src->skip_input_data   = mem_src_skip;
+  src->resync_to_restart = jpeg_resync_to_restart;
+  src->term_source       = mem_src_term;
+  src->next_input_byte   = data;
+  src->bytes_in_buffer   = size;
+
+  cinfo->src = src;
+}
+
+/* Returns the offset of the entropy-coded data following the first SOS
+ * marker of the JPEG stream in data, or 0 if the stream is malformed.
+ * If sof is not NULL, the offset of the SOF marker before it is
+ * returned there.
+ */
+static gsize
+find_scan_data (const guchar *data,
+                gsize         size,
+                gsize        *sof)
+{
+  gsize pos = 2;
+
+  if (size < 4 || data[0] != 0xff || data[1] != MARKER_SOI)
+    return 0;
+
+  while (pos + 4 <= size)
+    {
+      guint marker;
+      guint length;
+
+      if (data[pos] != 0xff)
+        return 0;
+
+      marker = data[pos + 1];
+
+      /* fill byte */
+      if (marker == 0xff)
+        {
+          pos++;
+          continue;
+        }
+
+      length = (data[pos + 2] << 8) | data[pos + 3];
+
+      if (length < 2)
+        return 0;
+
+      if (sof && (marker == MARKER_SOF0 || marker == MARKER_SOF1))
+        *sof = pos;
+
+      if (marker == MARKER_SOS)
+        return (pos + 2 + length <= size) ? pos + 2 + length : 0;
+
+      pos += 2 + length;
+    }
+
+  return 0;
+}
+
+static gboolean
+write_restart_marker (FILE  *outfile,
+                      guint *next_rst)
+{
+  guchar marker[2];
+
+  marker[0] = 0xff;
+  marker[1] = MARKER_RST0 + (*next_rst)++ % 8;
+
+  return fwrite (marker, 1, 2, outfile) == 2;
+}
+
+/* Writes entropy-coded data to outfile, renumbering the restart markers
+ * in it to follow on from those written before.
+ */
+static gboolean
+write_scan_data (FILE         *outfile,
+                 const guchar *data,
+                 gsize         size,
+                 guint        *next_rst)
+{
+  gsize start = 0;
+  gsize i;
+
+  for (i = 0; i + 1 < size; i++)
+    {
+      if (data[i] == 0xff && IS_RST (data[i + 1]))
+        {
+          if (fwrite (data + start, 1, i - start, outfile) != i - start ||
+              ! write_restart_marker (outfile, next_rst))
+            return FALSE;
+
+          start = ++i + 1;
+        }
+    }
+
+  return fwrite (data + start, 1, size - start, outfile) == size - start;
+}
+
+static gint
+gcd (gint a,
+     gint b)
+{
+  while (b)
+    {
+      gint t = a % b;
+
+      a = b;
+      b = t;
+    }
+
+  return a;
+}
+
+static gint
+get_mcu_height (gint comps_in_scan,
+                gint max_v_samp_factor)
+{
+  /*  a non-interleaved scan has an MCU of a single block  */
+  return comps_in_scan > 1 ? max_v_samp_factor * DCTSIZE : DCTSIZE;
+}
+
+gboolean
+jpeg_restart_can_encode (j_compress_ptr cinfo)
+{
+  gint max_h_samp_factor = 1;
+  gint max_v_samp_factor = 1;
+  gint mcus_per_row;
+  gint i;
+
+  if (cinfo->restart_in_rows <= 0     ||
+      cinfo->scan_info                ||
+      cinfo->optimize_coding          ||
+      cinfo->arith_code               ||
+      cinfo->smoothing_factor != 0    ||
+      gimp_get_num_processors () < 2)
+    return FALSE;
+
+  for (i = 0; i < cinfo->num_components; i++)
+    {
+      max_h_samp_factor = MAX (max_h_samp_factor,
+                               cinfo->comp_info[i].h_samp_factor);
+      max_v_samp_factor = MAX (max_v_samp_factor,
+                               cinfo->comp_info[i].v_samp_factor);
+    }
+
+  if (cinfo->num_components == 1)
+    max_h_samp_factor = max_v_samp_factor = 1;
+
+  mcus_per_row = (cinfo->image_width + max_h_samp_factor * DCTSIZE - 1) /
+                 (max_h_samp_factor * DCTSIZE);
+
+  /*  the library clamps the restart interval, then it no longer
+   *  ends on a row of MCUs
+   */
+  if (cinfo->restart_in_rows * mcus_per_row > 65535)
+    return FALSE;
+
+  /*  worth it only for more than one strip  */
+  return cinfo->image_height >
+         cinfo->restart_in_rows *
+         get_mcu_height (cinfo->num_components, max_v_samp_factor);
+}
+
+static void
+copy_compress_parameters (j_compress_ptr src,
+                          j_compress_ptr dest,
+                          gint           height)
+{
+  gint i;
+
+  dest->image_width      = src->image_width;
+  dest->image_height     = height;
+  dest->input_components = src->input_components;
+  dest->in_color_space   = src->in_color_space;
+
+  jpeg_set_defaults (dest);
+  jpeg_set_colorspace (dest, src->jpeg_color_space);
+
+  for (i = 0; i < NUM_QUANT_TBLS; i++)
+    {
+      if (! src->quant_tbl_ptrs[i])
+        continue;
+
+      if (! dest->quant_tbl_ptrs[i])
+        dest->quant_tbl_ptrs[i] = jpeg_alloc_quant_table ((j_common_ptr) dest);
+
+      memcpy (dest->quant_tbl_ptrs[i]->quantval,
+              src->quant_tbl_ptrs[i]->quantval,
+              sizeof (src->quant_tbl_ptrs[i]->quantval));
+    }
+
+  for (i = 0; i < src->num_components; i++)
+    {
+      dest->comp_info[i].h_samp_factor = src->comp_info[i].h_samp_factor;
+      dest->comp_info[i].v_samp_factor = src->comp_info[i].v_samp_factor;
+      dest->comp_info[i].quant_tbl_no  = src->comp_info[i].quant_tbl_no;
+      dest->comp_info[i].dc_tbl_no     = src->comp_info[i].dc_tbl_no;
+      dest->comp_info[i].ac_tbl_no     = src->comp_info[i].ac_tbl_no;
+    }
+
+  dest->dct_method         = src->dct_method;
+  dest->smoothing_factor   = src->smoothing_factor;
+  dest->restart_in_rows    = src->restart_in_rows;
+  dest->optimize_coding    = FALSE;
+
+  /*  only the entropy-coded data of a strip is used  */
+  dest->write_JFIF_header  = FALSE;
+  dest->write_Adobe_marker = FALSE;
+}
+
+static GByteArray *
+encode_strip (j_compress_ptr  parent,
+              guchar         *pixels,
+              gint            rowstride,
+              gint            height)
+{
+  struct jpeg_compress_struct  cinfo;
+  struct my_error_mgr          jerr;
+  GByteArray                  *data;
+
+  data = g_byte_array_new ();
+
+  /*  errors are printed to stderr, as this runs in a worker thread  */
+  cinfo.err = jpeg_std_error (&jerr.pub);
+  jerr.pub.error_exit = my_error_exit;
+
+  if (setjmp (jerr.setjmp_buffer))
+    {
+      jpeg_destroy_compress (&cinfo);
+      g_byte_array_free (data, TRUE);
+
+      return NULL;
+    }
+
+  jpeg_create_compress (&cinfo);
+
+  jpeg_restart_mem_dest (&cinfo, data);
+  copy_compress_parameters (parent, &cinfo, height);
+
+  jpeg_start_compress (&cinfo, TRUE);
+
+  while (cinfo.next_scanline < cinfo.image_height)
+    {
+      JSAMPROW row = pixels + cinfo.next_scanline * rowstride;
+
+      jpeg_write_scanlines (&cinfo, &row, 1);
+    }
+
+  jpeg_finish_compress (&cinfo);
+  jpeg_destroy_compress (&cinfo);
+
+  return data;
+}
+
+static void
+encode_strips (gsize       offset,
+               gsize       size,
+               EncodeData *data)
+{
+  gint y      = offset * data->interval_rows;
+  gint height = MIN ((gint) size * data->interval_rows, data->n_rows - y);
+
+  data->strips[offset] = encode_strip (data->cinfo,
+                                       data->pixels + y * data->rowstride,
+                                       data->rowstride, height);
+
+  if (! data->strips[offset])
+    g_atomic_int_set (&data->failed, TRUE);
+}
+
+/*  Every restart interval starts with fresh DC predictions at a byte
+ *  boundary, so encoding the intervals of a strip on their own gives
+ *  the very same entropy-coded data as encoding the whole image.  The
+ *  strips only need their restart markers renumbered, and one more
+ *  marker in between.
+ */
+gboolean
+jpeg_restart_encode (j_compress_ptr  cinfo,
+                     FILE           *outfile,
+                     GeglBuffer     *buffer,
+                     const Babl     *format)
+{
+  static const guchar  eoi[2] = { 0xff, MARKER_EOI };
+  JpegMemDest         *dest   = (JpegMemDest *) cinfo->dest;
+  EncodeData           data;
+  gint                 width  = cinfo->image_width;
+  gint                 height = cinfo->image_height;
+  gint                 interval_rows;
+  gint                 batch_intervals;
+  gint                 batch_rows;
+  gint                 y;
+  guint                next_rst = 0;
+  gboolean             first    = TRUE;
+  gboolean             success  = TRUE;
+
+  g_return_val_if_fail (cinfo->restart_interval ==
+                        cinfo->restart_in_rows * cinfo->MCUs_per_row, FALSE);
+
+  /*  have the library write the frame and scan headers, and take them
+   *  with all the markers written before
+   */
+  jpeg_write_scanlines (cinfo, NULL, 0);
+  (*dest->pub.term_destination) (cinfo);
+
+  if (fwrite (dest->data->data, 1, dest->data->len, outfile) !=
+      dest->data->len)
+    return FALSE;
+
+  interval_rows = cinfo->restart_in_rows *
+                  get_mcu_height (cinfo->comps_in_scan,
+                                  cinfo->max_v_samp_factor);
+
+  data.cinfo         = cinfo;
+  data.rowstride     = cinfo->input_components * width;
+  data.interval_rows = interval_rows;
+  data.failed        = FALSE;
+
+  batch_intervals = ENCODE_BATCH_SIZE / ((gsize) data.rowstride * interval_rows);
+  batch_intervals = MAX (batch_intervals, gimp_get_num_processors ());
+  batch_rows      = MIN (batch_intervals * interval_rows, height);
+
+  data.pixels = g_new (guchar, (gsize) data.rowstride * batch_rows);
+  data.strips = g_new0 (GByteArray *, batch_intervals);
+
+  for (y = 0; y < height && success; y += batch_rows)
+    {
+      gint n_intervals;
+      gint i;
+
+      data.n_rows = MIN (batch_rows, height - y);
+      n_intervals = (data.n_rows + interval_rows - 1) / interval_rows;
+
+      gegl_buffer_get (buffer,
+                       GEGL_RECTANGLE (0, y, width, data.n_rows), 1.0,
+                       format, data.pixels,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      gegl_parallel_distribute_range (
+        n_intervals,
+        MAX (1, MIN_STRIP_ROWS / interval_rows),
+        (GeglParallelDistributeRangeFunc) encode_strips,
+        &data);
+
+      if (data.failed)
+        success = FALSE;
+
+      for (i = 0; i < n_intervals; i++)
+        {
+          GByteArray *strip = data.strips[i];
+          gsize       start;
+
+          if (! strip)
+            continue;
+
+          start = find_scan_data (strip->data, strip->len, NULL);
+
+          if (success && (! start || strip->len < start + 2))
+            success = FALSE;
+
+          if (success && ! first)
+            success = write_restart_marker (outfile, &next_rst);
+
+          if (success)
+            success = write_scan_data (outfile,
+                                       strip->data + start,
+                                       strip->len - start - 2,
+                                       &next_rst);
+
+          first = FALSE;
+
+          g_byte_array_free (strip, TRUE);
+          data.strips[i] = NULL;
+        }
+
+      gimp_progress_update ((gdouble) (y + data.n_rows) / (gdouble) height);
+    }
+
+  if (success)
+    success = (fwrite (eoi, 1, 2, outfile) == 2);
+
+  g_free (data.strips);
+  g_free (data.pixels);
+
+  return success;
+}
+
+/*  The headers for decoding a strip on its own are those of the file,
+ *  without the metadata the main decompressor has already read.
+ */
+static GByteArray *
+get_strip_header (const guchar *data,
+                  gsize         scan_start,
+                  gsize        *sof)
+{
+  GByteArray *header = g_byte_array_sized_new (scan_start);
+  gsize       pos    = 2;
+
+  g_byte_array_append (header, data, 2);
+
+  while (pos < scan_start)
+    {
+      guint marker;
+      gsize length;
+
+      if (data[pos + 1] == 0xff)
+        {
+          pos++;
+          continue;
+        }
+
+      marker = data[pos + 1];
+      length = 2 + ((data[pos + 2] << 8) | data[pos + 3]);
+
+      if (marker == MARKER_SOF0 || marker == MARKER_SOF1)
+        *sof = header->len;
+
+      if (marker != MARKER_APP1 &&
+          marker != MARKER_APP2 &&
+          marker != MARKER_COM)
+        g_byte_array_append (header, data + pos, length);
+
+      pos += length;
+    }
+
+  return header;
+}
+
+static gboolean
+decode_strip (DecodeData *data,
+              gint        top,
+              gint        bottom,
+              gint        first_row,
+              gint        last_row,
+              gint        first_segment,
+              gint        last_segment)
+{
+  j_decompress_ptr               parent    = data->cinfo;
+  gint                           rowstride = parent->output_width *
+                                             parent->output_components;
+  struct jpeg_decompress_struct  cinfo;
+  struct my_error_mgr            jerr;
+  GByteArray                    *stream;
+  guchar                        *scratch;
+  gint                           height;
+  gint                           i;
+
+  height = MIN (bottom * data->mcu_height, (gint) parent->output_height) -
+           top * data->mcu_height;
+
+  stream = g_byte_array_new ();
+  g_byte_array_append (stream, data->header->data, data->header->len);
+
+  stream->data[data->sof + 5] = height >> 8;
+  stream->data[data->sof + 6] = height & 0xff;
+
+  for (i = first_segment; i < last_segment; i++)
+    {
+      if (i > first_segment)
+        {
+          guchar marker[2];
+
+          marker[0] = 0xff;
+          marker[1] = MARKER_RST0 + (i - first_segment - 1) % 8;
+
+          g_byte_array_append (stream, marker, 2);
+        }
+
+      g_byte_array_append (stream, data->data + data->seg_start[i],
+                           data->seg_end[i] - data->seg_start[i]);
+    }
+
+  {
+    guchar eoi[2] = { 0xff, MARKER_EOI };
+
+    g_byte_array_append (stream, eoi, 2);
+  }
+
+  scratch = g_new (guchar, rowstride);
+
+  /*  errors are printed to stderr, as this runs in a worker thread  */
+  cinfo.err = jpeg_std_error (&jerr.pub);
+  jerr.pub.error_exit = my_error_exit;
+
+  if (setjmp (jerr.setjmp_buffer))
+    {
+      jpeg_destroy_decompress (&cinfo);
+      g_byte_array_free (stream, TRUE);
+      g_free (scratch);
+
+      return FALSE;
+    }
+
+  jpeg_create_decompress (&cinfo);
+
+  mem_src (&cinfo, stream->data, stream->len);
+
+  jpeg_read_header (&cinfo, TRUE);
+
+  cinfo.out_color_space     = parent->out_color_space;
+  cinfo.dct_method          = parent->dct_method;
+  cinfo.do_fancy_upsampling = parent->do_fancy_upsampling;
+
+  jpeg_start_decompress (&cinfo);
+
+  if (cinfo.output_width      != parent->output_width      ||
+      cinfo.output_components != parent->output_components ||
+      cinfo.output_height     != (JDIMENSION) height)
+    ERREXIT (&cinfo, JERR_IMAGE_TOO_BIG);
+
+  while (cinfo.output_scanline < cinfo.output_height)
+    {
+      gint     y   = top * data->mcu_height + cinfo.output_scanline;
+      JSAMPROW row = scratch;
+
+      /*  rows of the overlap are only decoded for their context  */
+      if (y >= first_row && y < last_row)
+        row = data->pixels + (gsize) y * rowstride;
+
+      jpeg_read_scanlines (&cinfo, &row, 1);
+    }
+
+  jpeg_finish_decompress (&cinfo);
+  jpeg_destroy_decompress (&cinfo);
+
+  g_byte_array_free (stream, TRUE);
+  g_free (scratch);
+
+  return TRUE;
+}
+
+static void
+decode_strips (gsize       offset,
+               gsize       size,
+               DecodeData *data)
+{
+  j_decompress_ptr cinfo        = data->cinfo;
+  gint             mcu_rows     = cinfo->MCU_rows_in_scan;
+  gint             mcus_per_row = cinfo->MCUs_per_row;
+  gint             first        = offset * data->granule;
+  gint             last         = MIN ((gint) (offset + size) * data->granule,
+                                       mcu_rows);
+  gint             top;
+  gint             bottom;
+  gint             first_segment;
+  gint             last_segment;
+
+  /*  fancy upsampling looks at the chroma rows around each row, so
+   *  decode some more rows at inner edges of the strip
+   */
+  top    = MAX (first - data->overlap, 0);
+  bottom = MIN (last + data->overlap, mcu_rows);
+
+  first_segment = (gsize) top * mcus_per_row / cinfo->restart_interval;
+  last_segment  = (bottom == mcu_rows) ?
+                  data->n_segments :
+                  (gsize) bottom * mcus_per_row / cinfo->restart_interval;
+
+  if (! decode_strip (data, top, bottom,
+                      first * data->mcu_height,
+                      MIN (last * data->mcu_height,
+                           (gint) cinfo->output_height),
+                      first_segment, last_segment))
+    g_atomic_int_set (&data->failed, TRUE);
+}
+
+/*  Restart intervals may end anywhere within a row of MCUs.  The image
+ *  is cut only where both an interval and a row of MCUs end.
+ */
+guchar *
+jpeg_restart_decode (j_decompress_ptr  cinfo,
+                     GFile            *file)
+{
+  DecodeData  data;
+  gchar      *contents;
+  gsize       length;
+  gsize       scan_start;
+  gsize       sof = 0;
+  gsize      *seg_start;
+  gsize      *seg_end;
+  gsize       pos;
+  gint        n_segments;
+  gint        n_granules;
+  gint        mcus_per_row;
+  gint        k;
+  guchar     *pixels = NULL;
+
+  if (cinfo->progressive_mode                            ||
+      cinfo->restart_interval == 0                        ||
+      cinfo->comps_in_scan != cinfo->num_components       ||
+      cinfo->quantize_colors                              ||
+      cinfo->output_width  != cinfo->image_width          ||
+      cinfo->output_height != cinfo->image_height         ||
+      (cinfo->out_color_space != JCS_RGB &&
+       cinfo->out_color_space != JCS_GRAYSCALE)           ||
+      gimp_get_num_processors () < 2)
+    return NULL;
+
+  mcus_per_row = cinfo->MCUs_per_row;
+
+  data.cinfo      = cinfo;
+  data.mcu_height = get_mcu_height (cinfo->comps_in_scan,
+                                    cinfo->max_v_samp_factor);
+  data.granule    = cinfo->restart_interval /
+                    gcd (cinfo->restart_interval, mcus_per_row);
+  data.overlap    = (cinfo->do_fancy_upsampling &&
+                     cinfo->max_v_samp_factor > 1) ? data.granule : 0;
+  data.failed     = FALSE;
+
+  n_granules = (cinfo->MCU_rows_in_scan + data.granule - 1) / data.granule;
+
+  if (n_granules < 2)
+    return NULL;
+
+  if (! g_file_load_contents (file, NULL, &contents, &length, NULL, NULL))
+    return NULL;
+
+  data.data  = (const guchar *) contents;
+  scan_start = find_scan_data (data.data, length, &sof);
+
+  if (! scan_start || ! sof)
+    {
+      g_free (contents);
+      return NULL;
+    }
+
+  n_segments = ((gsize) mcus_per_row * cinfo->MCU_rows_in_scan +
+                cinfo->restart_interval - 1) / cinfo->restart_interval;
+
+  seg_start = g_new (gsize, n_segments);
+  seg_end   = g_new (gsize, n_segments);
+
+  /*  find the restart markers in the entropy-coded data  */
+  k   = 0;
+  pos = scan_start;
+  seg_start[0] = pos;
+
+  while (pos + 1 < length)
+    {
+      const guchar *ff = memchr (data.data + pos, 0xff, length - pos - 1);
+      guint         marker;
+
+      if (! ff)
+        {
+          pos = length;
+          break;
+        }
+
+      pos    = ff - data.data;
+      marker = data.data[pos + 1];
+
+      if (marker == 0x00)
+        {
+          /*  stuffed zero byte  */
+          pos += 2;
+        }
+      else if (marker == 0xff)
+        {
+          pos++;
+        }
+      else if (IS_RST (marker) && k + 1 < n_segments)
+        {
+          seg_end[k++] = pos;
+          seg_start[k] = pos + 2;
+          pos += 2;
+        }
+      else
+        {
+          /*  any other marker ends the scan  */
+          break;
+        }
+    }
+
+  seg_end[k++] = pos;
+
+  /*  on anything unexpected, leave it to the library  */
+  if (k == n_segments)
+    {
+      GByteArray *header = get_strip_header (data.data, scan_start, &sof);
+
+      pixels = g_try_malloc ((gsize) cinfo->output_width *
+                             cinfo->output_height *
+                             cinfo->output_components);
+
+      data.header     = header;
+      data.sof        = sof;
+      data.seg_start  = seg_start;
+      data.seg_end    = seg_end;
+      data.n_segments = n_segments;
+      data.pixels     = pixels;
+
+      if (pixels)
+        {
+          gegl_parallel_distribute_range (
+            n_granules,
+            MAX (1, MIN_STRIP_ROWS / (data.granule * data.mcu_height)),
+            (GeglParallelDistributeRangeFunc) decode_strips,
+            &data);
+
+          if (data.failed)
+            g_clear_pointer (&pixels, g_free);
+        }
+
+      g_byte_array_free (header, TRUE);
+    }
+
+  g_free (seg_start);
+  g_free (seg_end);
+  g_free (contents);
+
+  return pixels;
+}
@@ -0,0 +1,62 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __JPEG_RESTART_H__
+#define __JPEG_RESTART_H__
+
+/*
+ * Restart markers split the entropy-coded data of a JPEG file into
+ * segments which can be coded without knowing anything about the
+ * segments before them.  When the segments line up with rows of MCUs,
+ * horizontal strips of the image can be encoded or decoded on their
+ * own, each by its own libjpeg object, and stitched together again.
+ */
+
+/*
+ * Checks whether the compressor set up in cinfo, with all parameters
+ * set but not started yet, can be run strip by strip.  This requires
+ * restart markers every few MCU rows, sequential mode and the default
+ * Huffman tables, and no smoothing.
+ */
+gboolean   jpeg_restart_can_encode (j_compress_ptr    cinfo);
+
+/*
+ * Makes cinfo write its output to the end of data.
+ */
+void       jpeg_restart_mem_dest   (j_compress_ptr    cinfo,
+                                    GByteArray       *data);
+
+/*
+ * Encodes buffer to outfile, strip by strip on all processors.  cinfo
+ * must have been set up with jpeg_restart_mem_dest() and started, and
+ * all markers written; it is left for the caller to destroy.
+ */
+gboolean   jpeg_restart_encode     (j_compress_ptr    cinfo,
+                                    FILE             *outfile,
+                                    GeglBuffer       *buffer,
+                                    const Babl       *format);
+
+/*
+ * Decodes a started sequential decompressor with restart markers strip
+ * by strip on all processors, returning the pixels of the whole image
+ * in cinfo's output format, or NULL if the file does not qualify or any
+ * strip fails, in which case cinfo can still be read the normal way.
+ */
+guchar   * jpeg_restart_decode     (j_decompress_ptr  cinfo,
+                                    GFile            *file);
+
+#endif /* __JPEG_RESTART_H__ */
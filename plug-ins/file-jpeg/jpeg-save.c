@@ -41,6 +41,7 @@
 #include "jpeg.h"
 #include "jpeg-icc.h"
 #include "jpeg-load.h"
+#include "jpeg-restart.h"
 #include "jpeg-save.h"
 #include "jpeg-settings.h"
 
@@ -236,6 +237,8 @@ save_image (GFile                *file,
   gboolean         use_arithmetic_coding = FALSE;
   gboolean         use_restart           = FALSE;
   gchar           *comment;
+  gboolean         parallel;
+  GByteArray      *headers = NULL;
 
   g_object_get (config,
                 "quality",                   &dquality,
@@ -582,6 +585,18 @@ save_image (GFile                *file,
       }
   }
 
+  /* With restart markers and the default Huffman tables, strips of the
+   * image can be encoded on all processors at once.  The markers and
+   * headers are then collected in memory, see jpeg-restart.c.
+   */
+  parallel = ! preview && jpeg_restart_can_encode (&cinfo);
+
+  if (parallel)
+    {
+      headers = g_byte_array_new ();
+      jpeg_restart_mem_dest (&cinfo, headers);
+    }
+
   /* Step 4: Start compressor */
 
   /* TRUE ensures that we will write a complete interchange-JPEG file.
@@ -612,6 +627,32 @@ save_image (GFile                *file,
       g_object_unref (profile);
     }
 
+  if (parallel)
+    {
+      gboolean success;
+
+      success = jpeg_restart_encode (&cinfo, outfile, buffer, format);
+
+      jpeg_destroy_compress (&cinfo);
+      g_byte_array_free (headers, TRUE);
+      g_object_unref (buffer);
+
+      if (fclose (outfile) != 0)
+        success = FALSE;
+
+      if (! success)
+        {
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("Error writing '%s'"),
+                       gimp_file_get_utf8_name (file));
+          return FALSE;
+        }
+
+      gimp_progress_update (1.0);
+
+      return TRUE;
+    }
+
   /* Step 5: while (scan lines remain to be written) */
   /*           jpeg_write_scanlines(...); */
 
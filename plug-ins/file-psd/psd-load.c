@@ -38,6 +38,48 @@
 
 #define COMP_MODE_SIZE sizeof(guint16)
 
+/* Layers are read in batches of about this many bytes of decoded data */
+#define LOAD_BATCH_SIZE (256 * 1024 * 1024)
+
+
+/* Compressed data of a layer channel, read ahead of decoding it */
+typedef struct
+{
+  PSDchannel   *channel;                /* Channel to decode into */
+  guint16       comp_mode;              /* Compression mode */
+  gchar        *src;                    /* Compressed data */
+  guint32       src_len;                /* Compressed data length */
+  guint16      *rle_pack_len;           /* Packbits row lengths */
+  gboolean      failed;                 /* Decoding failed */
+  GError       *error;                  /* Decoding error */
+} PSDpackedChannel;
+
+/* Layer being loaded */
+typedef struct
+{
+  PSDlayer         *lyr;                /* Layer record */
+  PSDchannel      **chn;                /* Channel records */
+  PSDpackedChannel *packed;             /* Channel data to decode */
+  gboolean          empty;              /* Layer has no pixels */
+  gboolean          empty_mask;         /* Layer mask has no pixels */
+  gboolean          alpha;              /* Layer has an alpha channel */
+  gboolean          user_mask;          /* Layer has a user mask */
+  guint16           user_mask_chn;      /* Index of the user mask channel */
+  guint16           layer_channels;     /* Number of channels drawn */
+  guint16           channel_idx[MAX_CHANNELS]; /* Channels drawn, in order */
+  const Babl       *format;             /* Layer pixel format */
+  guchar           *pixels;             /* Interleaved layer pixels */
+  gsize             size;               /* Decoded size of the layer */
+} PSDlayerData;
+
+/* Batch of layers decoded in parallel */
+typedef struct
+{
+  PSDimage         *img_a;
+  PSDlayerData     *layers;
+  GPtrArray        *packed;
+} PSDloadBatch;
+
 
 /*  Local function prototypes  */
 static gint             read_header_block          (PSDimage     *img_a,
@@ -92,6 +134,19 @@ static void             psd_to_gimp_color_map      (guchar       *map256);
 static GimpImageType    get_gimp_image_type        (GimpImageBaseType image_base_type,
                                                     gboolean          alpha);
 
+static gint             read_layer_channels        (PSDimage      *img_a,
+                                                    PSDlayerData  *ld,
+                                                    GPtrArray     *packed,
+                                                    FILE          *f,
+                                                    GError       **error);
+static void             decode_layer_channels      (gsize          offset,
+                                                    gsize          size,
+                                                    PSDloadBatch  *batch);
+static void             interleave_layer_channels  (gsize          offset,
+                                                    gsize          size,
+                                                    PSDloadBatch  *batch);
+static void             free_layer_data            (PSDlayerData  *ld);
+
 static gint             read_channel_data          (PSDchannel     *channel,
                                                     guint16         bps,
                                                     guint16         compression,
@@ -99,6 +154,22 @@ static gint             read_channel_data          (PSDchannel     *channel,
                                                     FILE           *f,
                                                     guint32         comp_len,
                                                     GError        **error);
+static gint             read_channel_source        (PSDchannel     *channel,
+                                                    guint16         bps,
+                                                    guint16         compression,
+                                                    const guint16  *rle_pack_len,
+                                                    FILE           *f,
+                                                    guint32         comp_len,
+                                                    gchar         **src,
+                                                    guint32        *src_len,
+                                                    GError        **error);
+static gint             decode_channel_data        (PSDchannel     *channel,
+                                                    guint16         bps,
+                                                    guint16         compression,
+                                                    const guint16  *rle_pack_len,
+                                                    const gchar    *src,
+                                                    guint32         src_len,
+                                                    GError        **error);
 
 static void             convert_1_bit              (const gchar *src,
                                                     gchar       *dst,
@@ -1139,6 +1210,30 @@ add_image_resources (GimpImage *image,
   return 0;
 }
 
+static void
+psd_init_cmyk_transforms (PSDimage *img_a)
+{
+  GimpColorProfile *srgb;
+
+  if (! img_a->cmyk_profile ||
+      (img_a->cmyk_transform && img_a->cmyk_transform_alpha))
+    return;
+
+  srgb = gimp_color_profile_new_rgb_srgb ();
+
+  if (! img_a->cmyk_transform_alpha)
+    img_a->cmyk_transform_alpha = gimp_color_transform_new (img_a->cmyk_profile, babl_format ("cmykA u8"),
+                                                            srgb, babl_format ("R'G'B'A float"),
+                                                            0, 0);
+
+  if (! img_a->cmyk_transform)
+    img_a->cmyk_transform = gimp_color_transform_new (img_a->cmyk_profile, babl_format ("cmyk u8"),
+                                                      srgb, babl_format ("R'G'B' float"),
+                                                      0, 0);
+
+  g_object_unref (srgb);
+}
+
 static guchar *
 psd_convert_cmyk_to_srgb (PSDimage *img_a,
                           guchar   *dst,
@@ -1149,40 +1244,19 @@ psd_convert_cmyk_to_srgb (PSDimage *img_a,
 {
   if (img_a->cmyk_profile)
     {
+      psd_init_cmyk_transforms (img_a);
+
       if (alpha)
         {
-          if (! img_a->cmyk_transform_alpha)
-            {
-              GimpColorProfile *srgb = gimp_color_profile_new_rgb_srgb ();
-
-              img_a->cmyk_transform_alpha = gimp_color_transform_new (img_a->cmyk_profile, babl_format ("cmykA u8"),
-                                                                      srgb, babl_format ("R'G'B'A float"),
-                                                                      0, 0);
-
-              g_object_unref (srgb);
-            }
-
-        gimp_color_transform_process_pixels (img_a->cmyk_transform_alpha,
-                                             babl_format ("cmykA u8"),
-                                             src,
-                                             babl_format ("R'G'B'A float"),
-                                             dst,
-                                             width * height);
+          gimp_color_transform_process_pixels (img_a->cmyk_transform_alpha,
+                                               babl_format ("cmykA u8"),
+                                               src,
+                                               babl_format ("R'G'B'A float"),
+                                               dst,
+                                               width * height);
         }
       else
         {
-          if (! img_a->cmyk_transform)
-            {
-              GimpColorProfile *srgb = gimp_color_profile_new_rgb_srgb ();
-
-              img_a->cmyk_transform = gimp_color_transform_new (img_a->cmyk_profile, babl_format ("cmyk u8"),
-                                                                      srgb, babl_format ("R'G'B' float"),
-                                                                      0, 0);
-
-
-              g_object_unref (srgb);
-            }
-
           gimp_color_transform_process_pixels (img_a->cmyk_transform_alpha,
                                                babl_format ("cmyk u8"),
                                                src,
@@ -1207,6 +1281,349 @@ psd_convert_cmyk_to_srgb (PSDimage *img_a,
 }
 
 
+static gint
+read_layer_channels (PSDimage      *img_a,
+                     PSDlayerData  *ld,
+                     GPtrArray     *packed,
+                     FILE          *f,
+                     GError       **error)
+{
+  PSDlayer *lyr = ld->lyr;
+  guint16   alpha_chn = -1;
+  gint      bps;
+  gint      cidx;                  /* Channel index */
+  gint      rowi;                  /* Row index */
+
+  if (lyr->drop)
+    {
+      IFDBG(2) g_debug ("Drop layer");
+
+      /* Step past layer data */
+      for (cidx = 0; cidx < lyr->num_channels; ++cidx)
+        {
+          if (fseek (f, lyr->chn_info[cidx].data_len, SEEK_CUR) < 0)
+            {
+              psd_set_error (feof (f), errno, error);
+              return -1;
+            }
+        }
+
+      return 0;
+    }
+
+  bps = img_a->bps / 8;
+  if (bps == 0)
+    bps++;
+
+  /* Empty layer */
+  if (lyr->bottom - lyr->top == 0
+      || lyr->right - lyr->left == 0)
+      ld->empty = TRUE;
+  else
+      ld->empty = FALSE;
+
+  /* Empty mask */
+  if (lyr->layer_mask.bottom - lyr->layer_mask.top == 0
+      || lyr->layer_mask.right - lyr->layer_mask.left == 0)
+      ld->empty_mask = TRUE;
+  else
+      ld->empty_mask = FALSE;
+
+  IFDBG(3) g_debug ("Empty mask %d, size %d %d", ld->empty_mask,
+                    lyr->layer_mask.bottom - lyr->layer_mask.top,
+                    lyr->layer_mask.right - lyr->layer_mask.left);
+
+  /* Load layer channel data */
+  IFDBG(2) g_debug ("Number of channels: %d", lyr->num_channels);
+  /* Create pointer array for the channel records */
+  ld->chn    = g_new0 (PSDchannel *, lyr->num_channels);
+  ld->packed = g_new0 (PSDpackedChannel, lyr->num_channels);
+  for (cidx = 0; cidx < lyr->num_channels; ++cidx)
+    {
+      PSDchannel       *chn;
+      PSDpackedChannel *pc        = &ld->packed[cidx];
+      guint16           comp_mode = PSD_COMP_RAW;
+      guint16          *rle_pack_len;
+      guint32           comp_len  = 0;
+
+      /* Allocate channel record */
+      chn = ld->chn[cidx] = g_new0 (PSDchannel, 1);
+
+      chn->id = lyr->chn_info[cidx].channel_id;
+      chn->rows = lyr->bottom - lyr->top;
+      chn->columns = lyr->right - lyr->left;
+      chn->data = NULL;
+
+      if (chn->id == PSD_CHANNEL_EXTRA_MASK)
+        {
+          if (fseek (f, lyr->chn_info[cidx].data_len, SEEK_CUR) != 0)
+            {
+              psd_set_error (feof (f), errno, error);
+              return -1;
+            }
+
+          continue;
+        }
+      else if (chn->id == PSD_CHANNEL_MASK)
+        {
+          /* Works around a bug in panotools psd files where the layer mask
+             size is given as 0 but data exists. Set mask size to layer size.
+          */
+          if (ld->empty_mask && lyr->chn_info[cidx].data_len - 2 > 0)
+            {
+              ld->empty_mask = FALSE;
+              if (lyr->layer_mask.top == lyr->layer_mask.bottom)
+                {
+                  lyr->layer_mask.top = lyr->top;
+                  lyr->layer_mask.bottom = lyr->bottom;
+                }
+              if (lyr->layer_mask.right == lyr->layer_mask.left)
+                {
+                  lyr->layer_mask.right = lyr->right;
+                  lyr->layer_mask.left = lyr->left;
+                }
+            }
+          chn->rows = (lyr->layer_mask.bottom -
+                       lyr->layer_mask.top);
+          chn->columns = (lyr->layer_mask.right -
+                          lyr->layer_mask.left);
+        }
+
+      IFDBG(3) g_debug ("Channel id %d, %dx%d",
+                        chn->id,
+                        chn->columns,
+                        chn->rows);
+
+      /* Only read channel data if there is any channel
+       * data. Note that the channel data can contain a
+       * compression method but no actual data.
+       */
+      if (lyr->chn_info[cidx].data_len >= COMP_MODE_SIZE)
+        {
+          if (fread (&comp_mode, COMP_MODE_SIZE, 1, f) < 1)
+            {
+              psd_set_error (feof (f), errno, error);
+              return -1;
+            }
+          comp_mode = GUINT16_FROM_BE (comp_mode);
+          IFDBG(3) g_debug ("Compression mode: %d", comp_mode);
+        }
+      if (lyr->chn_info[cidx].data_len > COMP_MODE_SIZE)
+        {
+          switch (comp_mode)
+            {
+              case PSD_COMP_RAW:        /* Planar raw data */
+                IFDBG(3) g_debug ("Raw data length: %d",
+                                  lyr->chn_info[cidx].data_len - 2);
+                break;
+
+              case PSD_COMP_RLE:        /* Packbits */
+                IFDBG(3) g_debug ("RLE channel length %d, RLE length data: %d, "
+                                  "RLE data block: %d",
+                                  lyr->chn_info[cidx].data_len - 2,
+                                  chn->rows * 2,
+                                  (lyr->chn_info[cidx].data_len - 2 -
+                                   chn->rows * 2));
+                rle_pack_len = pc->rle_pack_len = g_malloc (chn->rows * 2);
+                for (rowi = 0; rowi < chn->rows; ++rowi)
+                  {
+                    if (fread (&rle_pack_len[rowi], 2, 1, f) < 1)
+                      {
+                        psd_set_error (feof (f), errno, error);
+                        return -1;
+                      }
+                    rle_pack_len[rowi] = GUINT16_FROM_BE (rle_pack_len[rowi]);
+                  }
+                break;
+
+              case PSD_COMP_ZIP:                 /* ? */
+              case PSD_COMP_ZIP_PRED:
+                comp_len = lyr->chn_info[cidx].data_len - 2;
+                break;
+
+              default:
+                g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                            _("Unsupported compression mode: %d"), comp_mode);
+                return -1;
+                break;
+            }
+
+          pc->channel   = chn;
+          pc->comp_mode = comp_mode;
+
+          if (read_channel_source (chn, img_a->bps, comp_mode,
+                                   pc->rle_pack_len, f, comp_len,
+                                   &pc->src, &pc->src_len, error) < 1)
+            return -1;
+
+          g_ptr_array_add (packed, pc);
+
+          ld->size += (gsize) chn->rows * chn->columns * bps;
+        }
+    }
+
+  IFDBG(3) g_debug ("Re-hash channel indices");
+  ld->alpha          = FALSE;
+  ld->user_mask      = FALSE;
+  ld->user_mask_chn  = -1;
+  ld->layer_channels = 0;
+  for (cidx = 0; cidx < lyr->num_channels; ++cidx)
+    {
+      if (ld->chn[cidx]->id == PSD_CHANNEL_MASK)
+        {
+          ld->user_mask = TRUE;
+          ld->user_mask_chn = cidx;
+        }
+      else if (ld->chn[cidx]->id == PSD_CHANNEL_ALPHA)
+        {
+          ld->alpha = TRUE;
+          alpha_chn = cidx;
+        }
+      else if (ld->packed[cidx].channel)
+        {
+          ld->channel_idx[ld->layer_channels] = cidx;   /* Assumes in sane order */
+          ld->layer_channels++;                         /* RGB, Lab, CMYK etc.   */
+        }
+    }
+
+  if (ld->alpha)
+    {
+      ld->channel_idx[ld->layer_channels] = alpha_chn;
+      ld->layer_channels++;
+    }
+
+  /* Only normal layers with pixels are drawn from the channel data */
+  if (lyr->group_type == 0 && ! ld->empty)
+    {
+      ld->format = get_layer_format (img_a, ld->alpha);
+
+      ld->size += (gsize) (lyr->right - lyr->left) * (lyr->bottom - lyr->top) *
+                  babl_format_get_bytes_per_pixel (ld->format);
+    }
+
+  return 0;
+}
+
+static void
+decode_layer_channels (gsize         offset,
+                       gsize         size,
+                       PSDloadBatch *batch)
+{
+  gsize i;
+
+  for (i = offset; i < offset + size; i++)
+    {
+      PSDpackedChannel *pc = g_ptr_array_index (batch->packed, i);
+
+      pc->failed = decode_channel_data (pc->channel, batch->img_a->bps,
+                                        pc->comp_mode, pc->rle_pack_len,
+                                        pc->src, pc->src_len,
+                                        &pc->error) < 1;
+
+      g_clear_pointer (&pc->src, g_free);
+      g_clear_pointer (&pc->rle_pack_len, g_free);
+    }
+}
+
+static void
+interleave_layer_channels (gsize         offset,
+                           gsize         size,
+                           PSDloadBatch *batch)
+{
+  PSDimage *img_a = batch->img_a;
+  gint      bps;
+  gsize     i;
+
+  bps = img_a->bps / 8;
+  if (bps == 0)
+    bps++;
+
+  for (i = offset; i < offset + size; i++)
+    {
+      PSDlayerData *ld       = &batch->layers[i];
+      gint          l_w      = ld->lyr->right - ld->lyr->left;
+      gint          l_h      = ld->lyr->bottom - ld->lyr->top;
+      gsize         n_pixels = (gsize) l_w * l_h;
+      gint          dst_step = bps * ld->layer_channels;
+      guint8       *dst0;
+      gint          cidx;
+
+      if (! ld->format)
+        continue;
+
+      ld->pixels = g_malloc0 (n_pixels *
+                              MAX (babl_format_get_bytes_per_pixel (ld->format),
+                                   dst_step));
+
+      if (img_a->color_mode == PSD_CMYK)
+        dst0 = g_malloc (ld->layer_channels * n_pixels);
+      else
+        dst0 = ld->pixels;
+
+      for (cidx = 0; cidx < ld->layer_channels; ++cidx)
+        {
+          gint b;
+
+          IFDBG(3) g_debug ("Start channel %d", ld->channel_idx[cidx]);
+
+          for (b = 0; b < bps; ++b)
+            {
+              const guint8 *src;
+              guint8       *dst;
+              gsize         x;
+
+              src = (const guint8 *) &ld->chn[ld->channel_idx[cidx]]->data[b];
+              dst = &dst0[cidx * bps + b];
+
+              for (x = 0; x < n_pixels; ++x)
+                {
+                  *dst = *src;
+
+                  src += bps;
+                  dst += dst_step;
+                }
+            }
+        }
+
+      if (img_a->color_mode == PSD_CMYK)
+        {
+          psd_convert_cmyk_to_srgb (img_a,
+                                    ld->pixels, dst0,
+                                    l_w, l_h,
+                                    ld->alpha);
+
+          g_free (dst0);
+        }
+
+      for (cidx = 0; cidx < ld->layer_channels; ++cidx)
+        g_clear_pointer (&ld->chn[ld->channel_idx[cidx]]->data, g_free);
+    }
+}
+
+static void
+free_layer_data (PSDlayerData *ld)
+{
+  gint cidx;
+
+  if (ld->chn)
+    {
+      for (cidx = 0; cidx < ld->lyr->num_channels; ++cidx)
+        {
+          if (ld->chn[cidx])
+            g_free (ld->chn[cidx]->data);
+          g_free (ld->chn[cidx]);
+
+          g_free (ld->packed[cidx].src);
+          g_free (ld->packed[cidx].rle_pack_len);
+          g_clear_error (&ld->packed[cidx].error);
+        }
+    }
+
+  g_clear_pointer (&ld->chn, g_free);
+  g_clear_pointer (&ld->packed, g_free);
+  g_clear_pointer (&ld->pixels, g_free);
+}
+
 static gint
 add_layers (GimpImage *image,
             PSDimage  *img_a,
@@ -1214,14 +1631,11 @@ add_layers (GimpImage *image,
             FILE      *f,
             GError   **error)
 {
+  PSDlayerData         *layers;
   PSDchannel          **lyr_chn;
   GArray               *parent_group_stack;
   GimpLayer            *parent_group = NULL;
-  guint16               alpha_chn;
   guint16               user_mask_chn;
-  guint16               layer_channels;
-  guint16               channel_idx[MAX_CHANNELS];
-  guint16              *rle_pack_len;
   guint16               bps;
   gint32                l_x;                   /* Layer x */
   gint32                l_y;                   /* Layer y */
@@ -1235,9 +1649,8 @@ add_layers (GimpImage *image,
   GimpLayerMask        *mask         = NULL;
   GimpLayer            *active_layer = NULL;
   gint                  lidx;                  /* Layer index */
-  gint                  cidx;                  /* Channel index */
-  gint                  rowi;                  /* Row index */
-  gboolean              alpha;
+  gint                  first;                 /* First layer of the batch */
+  gint                  last;                  /* Layer past the batch */
   gboolean              user_mask;
   gboolean              empty;
   gboolean              empty_mask;
@@ -1261,532 +1674,357 @@ add_layers (GimpImage *image,
       return -1;
     }
 
+  /* Color transforms are shared by the threads drawing CMYK layers */
+  if (img_a->color_mode == PSD_CMYK)
+    psd_init_cmyk_transforms (img_a);
+
   /* set the root of the group hierarchy */
   parent_group_stack = g_array_new (FALSE, FALSE, sizeof (GimpLayer *));
   g_array_append_val (parent_group_stack, parent_group);
 
-  for (lidx = 0; lidx < img_a->num_layers; ++lidx)
-    {
-      IFDBG(2) g_debug ("Process Layer No %d.", lidx);
+  layers = g_new0 (PSDlayerData, img_a->num_layers);
 
-      if (lyr_a[lidx]->drop)
+  for (first = 0; first < img_a->num_layers; first = last)
+    {
+      PSDloadBatch batch;
+      gsize        batch_size = 0;
+      guint        i;
+
+      /* Read the channel data of layers in file order, until the batch
+       * would take more than LOAD_BATCH_SIZE bytes once decoded.  The
+       * channels of the batch are then decompressed, and the layers
+       * drawn, by all threads, before the layers are added to the image
+       * one by one, in order.
+       */
+      batch.img_a  = img_a;
+      batch.layers = &layers[first];
+      batch.packed = g_ptr_array_new ();
+
+      for (last = first;
+           last < img_a->num_layers &&
+           (last == first || batch_size < LOAD_BATCH_SIZE);
+           last++)
         {
-          IFDBG(2) g_debug ("Drop layer %d", lidx);
+          IFDBG(2) g_debug ("Read Layer No %d.", last);
 
-          /* Step past layer data */
-          for (cidx = 0; cidx < lyr_a[lidx]->num_channels; ++cidx)
+          layers[last].lyr = lyr_a[last];
+
+          if (read_layer_channels (img_a, &layers[last], batch.packed,
+                                   f, error) < 0)
             {
-              if (fseek (f, lyr_a[lidx]->chn_info[cidx].data_len, SEEK_CUR) < 0)
-                {
-                  psd_set_error (feof (f), errno, error);
-                  return -1;
-                }
+              for (lidx = first; lidx <= last; lidx++)
+                free_layer_data (&layers[lidx]);
+              g_ptr_array_free (batch.packed, TRUE);
+              g_free (layers);
+              return -1;
             }
+
+          batch_size += layers[last].size;
         }
-      else
-        {
-          /* Empty layer */
-          if (lyr_a[lidx]->bottom - lyr_a[lidx]->top == 0
-              || lyr_a[lidx]->right - lyr_a[lidx]->left == 0)
-              empty = TRUE;
-          else
-              empty = FALSE;
 
-          /* Empty mask */
-          if (lyr_a[lidx]->layer_mask.bottom - lyr_a[lidx]->layer_mask.top == 0
-              || lyr_a[lidx]->layer_mask.right - lyr_a[lidx]->layer_mask.left == 0)
-              empty_mask = TRUE;
-          else
-              empty_mask = FALSE;
+      gegl_parallel_distribute_range (
+        batch.packed->len, 1,
+        (GeglParallelDistributeRangeFunc) decode_layer_channels,
+        &batch);
 
-          IFDBG(3) g_debug ("Empty mask %d, size %d %d", empty_mask,
-                            lyr_a[lidx]->layer_mask.bottom - lyr_a[lidx]->layer_mask.top,
-                            lyr_a[lidx]->layer_mask.right - lyr_a[lidx]->layer_mask.left);
+      for (i = 0; i < batch.packed->len; i++)
+        {
+          PSDpackedChannel *pc = g_ptr_array_index (batch.packed, i);
 
-          /* Load layer channel data */
-          IFDBG(2) g_debug ("Number of channels: %d", lyr_a[lidx]->num_channels);
-          /* Create pointer array for the channel records */
-          lyr_chn = g_new (PSDchannel *, lyr_a[lidx]->num_channels);
-          for (cidx = 0; cidx < lyr_a[lidx]->num_channels; ++cidx)
+          if (pc->failed)
             {
-              guint16 comp_mode = PSD_COMP_RAW;
+              if (pc->error)
+                g_propagate_error (error, g_steal_pointer (&pc->error));
 
-              /* Allocate channel record */
-              lyr_chn[cidx] = g_malloc (sizeof (PSDchannel) );
+              for (lidx = first; lidx < last; lidx++)
+                free_layer_data (&layers[lidx]);
+              g_ptr_array_free (batch.packed, TRUE);
+              g_free (layers);
+              return -1;
+            }
+        }
 
-              lyr_chn[cidx]->id = lyr_a[lidx]->chn_info[cidx].channel_id;
-              lyr_chn[cidx]->rows = lyr_a[lidx]->bottom - lyr_a[lidx]->top;
-              lyr_chn[cidx]->columns = lyr_a[lidx]->right - lyr_a[lidx]->left;
-              lyr_chn[cidx]->data = NULL;
+      g_ptr_array_free (batch.packed, TRUE);
+
+      gegl_parallel_distribute_range (
+        last - first, 1,
+        (GeglParallelDistributeRangeFunc) interleave_layer_channels,
+        &batch);
+
+      for (lidx = first; lidx < last; ++lidx)
+        {
+          PSDlayerData *ld = &layers[lidx];
 
-              if (lyr_chn[cidx]->id == PSD_CHANNEL_EXTRA_MASK)
+          IFDBG(2) g_debug ("Process Layer No %d.", lidx);
+
+          if (lyr_a[lidx]->drop)
+            {
+              IFDBG(2) g_debug ("Drop layer %d", lidx);
+            }
+          else
+            {
+              empty         = ld->empty;
+              empty_mask    = ld->empty_mask;
+              user_mask     = ld->user_mask;
+              user_mask_chn = ld->user_mask_chn;
+              lyr_chn       = ld->chn;
+
+              /* Draw layer */
+
+              l_x = 0;
+              l_y = 0;
+              l_w = img_a->columns;
+              l_h = img_a->rows;
+              if (parent_group_stack->len > 0)
+                parent_group = g_array_index (parent_group_stack, GimpLayer *,
+                                              parent_group_stack->len - 1);
+              else
+                parent_group = NULL; /* root */
+
+              /* Create the layer */
+              if (lyr_a[lidx]->group_type != 0)
                 {
-                  if (fseek (f, lyr_a[lidx]->chn_info[cidx].data_len, SEEK_CUR) != 0)
+                  if (lyr_a[lidx]->group_type == 3)
                     {
-                      psd_set_error (feof (f), errno, error);
-                      return -1;
+                      /* the </Layer group> marker layers are used to
+                       * assemble the layer structure in a single pass
+                       */
+                      IFDBG(2) g_debug ("Create placeholder group layer");
+                      layer = gimp_layer_group_new (image);
+                      /* add this group layer as the new parent */
+                      g_array_append_val (parent_group_stack, layer);
                     }
-
-                  continue;
-                }
-              else if (lyr_chn[cidx]->id == PSD_CHANNEL_MASK)
-                {
-                  /* Works around a bug in panotools psd files where the layer mask
-                     size is given as 0 but data exists. Set mask size to layer size.
-                  */
-                  if (empty_mask && lyr_a[lidx]->chn_info[cidx].data_len - 2 > 0)
+                  else /* group-type == 1 || group_type == 2 */
                     {
-                      empty_mask = FALSE;
-                      if (lyr_a[lidx]->layer_mask.top == lyr_a[lidx]->layer_mask.bottom)
+                      if (parent_group_stack->len)
                         {
-                          lyr_a[lidx]->layer_mask.top = lyr_a[lidx]->top;
-                          lyr_a[lidx]->layer_mask.bottom = lyr_a[lidx]->bottom;
+                          layer = g_array_index (parent_group_stack, GimpLayer *,
+                                                 parent_group_stack->len - 1);
+                          IFDBG(2) g_debug ("End group layer id %d.", gimp_item_get_id (GIMP_ITEM (layer)));
+                          /* since the layers are stored in reverse, the group
+                           * layer start marker actually means we're done with
+                           * that layer group
+                           */
+                          g_array_remove_index (parent_group_stack,
+                                                parent_group_stack->len - 1);
+
+                          gimp_drawable_offsets (GIMP_DRAWABLE (layer), &l_x, &l_y);
+
+                          l_w = gimp_drawable_width  (GIMP_DRAWABLE (layer));
+                          l_h = gimp_drawable_height (GIMP_DRAWABLE (layer));
                         }
-                      if (lyr_a[lidx]->layer_mask.right == lyr_a[lidx]->layer_mask.left)
+                      else
                         {
-                          lyr_a[lidx]->layer_mask.right = lyr_a[lidx]->right;
-                          lyr_a[lidx]->layer_mask.left = lyr_a[lidx]->left;
+                          IFDBG(1) g_debug ("WARNING: Unmatched group layer start marker.");
+                          layer = NULL;
                         }
                     }
-                  lyr_chn[cidx]->rows = (lyr_a[lidx]->layer_mask.bottom -
-                                        lyr_a[lidx]->layer_mask.top);
-                  lyr_chn[cidx]->columns = (lyr_a[lidx]->layer_mask.right -
-                                           lyr_a[lidx]->layer_mask.left);
                 }
-
-              IFDBG(3) g_debug ("Channel id %d, %dx%d",
-                                lyr_chn[cidx]->id,
-                                lyr_chn[cidx]->columns,
-                                lyr_chn[cidx]->rows);
-
-              /* Only read channel data if there is any channel
-               * data. Note that the channel data can contain a
-               * compression method but no actual data.
-               */
-              if (lyr_a[lidx]->chn_info[cidx].data_len >= COMP_MODE_SIZE)
+              else
                 {
-                  if (fread (&comp_mode, COMP_MODE_SIZE, 1, f) < 1)
+                  if (empty)
                     {
-                      psd_set_error (feof (f), errno, error);
-                      return -1;
+                      IFDBG(2) g_debug ("Create blank layer");
                     }
-                  comp_mode = GUINT16_FROM_BE (comp_mode);
-                  IFDBG(3) g_debug ("Compression mode: %d", comp_mode);
-                }
-              if (lyr_a[lidx]->chn_info[cidx].data_len > COMP_MODE_SIZE)
-                {
-                  switch (comp_mode)
+                  else
                     {
-                      case PSD_COMP_RAW:        /* Planar raw data */
-                        IFDBG(3) g_debug ("Raw data length: %d",
-                                          lyr_a[lidx]->chn_info[cidx].data_len - 2);
-                        if (read_channel_data (lyr_chn[cidx], img_a->bps,
-                                               PSD_COMP_RAW, NULL, f, 0,
-                                               error) < 1)
-                          return -1;
-                        break;
-
-                      case PSD_COMP_RLE:        /* Packbits */
-                        IFDBG(3) g_debug ("RLE channel length %d, RLE length data: %d, "
-                                          "RLE data block: %d",
-                                          lyr_a[lidx]->chn_info[cidx].data_len - 2,
-                                          lyr_chn[cidx]->rows * 2,
-                                          (lyr_a[lidx]->chn_info[cidx].data_len - 2 -
-                                           lyr_chn[cidx]->rows * 2));
-                        rle_pack_len = g_malloc (lyr_chn[cidx]->rows * 2);
-                        for (rowi = 0; rowi < lyr_chn[cidx]->rows; ++rowi)
-                          {
-                            if (fread (&rle_pack_len[rowi], 2, 1, f) < 1)
-                              {
-                                psd_set_error (feof (f), errno, error);
-                                g_free (rle_pack_len);
-                                return -1;
-                              }
-                            rle_pack_len[rowi] = GUINT16_FROM_BE (rle_pack_len[rowi]);
-                          }
-
-                        IFDBG(3) g_debug ("RLE decode - data");
-                        if (read_channel_data (lyr_chn[cidx], img_a->bps,
-                                               PSD_COMP_RLE, rle_pack_len, f, 0,
-                                               error) < 1)
-                          return -1;
-
-                        g_free (rle_pack_len);
-                        break;
-
-                      case PSD_COMP_ZIP:                 /* ? */
-                      case PSD_COMP_ZIP_PRED:
-                        if (read_channel_data (lyr_chn[cidx], img_a->bps,
-                                               comp_mode, NULL, f,
-                                               lyr_a[lidx]->chn_info[cidx].data_len - 2,
-                                               error) < 1)
-                          return -1;
-                        break;
-
-                      default:
-                        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
-                                    _("Unsupported compression mode: %d"), comp_mode);
-                        return -1;
-                        break;
+                      IFDBG(2) g_debug ("Create normal layer");
+                      l_x = lyr_a[lidx]->left;
+                      l_y = lyr_a[lidx]->top;
+                      l_w = lyr_a[lidx]->right - lyr_a[lidx]->left;
+                      l_h = lyr_a[lidx]->bottom - lyr_a[lidx]->top;
                     }
-                }
-            }
 
-          /* Draw layer */
-
-          alpha = FALSE;
-          alpha_chn = -1;
-          user_mask = FALSE;
-          user_mask_chn = -1;
-          layer_channels = 0;
-          l_x = 0;
-          l_y = 0;
-          l_w = img_a->columns;
-          l_h = img_a->rows;
-          if (parent_group_stack->len > 0)
-            parent_group = g_array_index (parent_group_stack, GimpLayer *,
-                                          parent_group_stack->len - 1);
-          else
-            parent_group = NULL; /* root */
+                  image_type = get_gimp_image_type (img_a->base_type, TRUE);
+                  IFDBG(3) g_debug ("Layer type %d", image_type);
 
-          IFDBG(3) g_debug ("Re-hash channel indices");
-          for (cidx = 0; cidx < lyr_a[lidx]->num_channels; ++cidx)
-            {
-              if (lyr_chn[cidx]->id == PSD_CHANNEL_MASK)
-                {
-                  user_mask = TRUE;
-                  user_mask_chn = cidx;
-                }
-              else if (lyr_chn[cidx]->id == PSD_CHANNEL_ALPHA)
-                {
-                  alpha = TRUE;
-                  alpha_chn = cidx;
-                }
-              else if (lyr_chn[cidx]->data)
-                {
-                  channel_idx[layer_channels] = cidx;   /* Assumes in sane order */
-                  layer_channels++;                     /* RGB, Lab, CMYK etc.   */
+                  layer = gimp_layer_new (image, lyr_a[lidx]->name,
+                                          l_w, l_h, image_type,
+                                          100, GIMP_LAYER_MODE_NORMAL);
                 }
-            }
-
-          if (alpha)
-            {
-              channel_idx[layer_channels] = alpha_chn;
-              layer_channels++;
-            }
 
-          /* Create the layer */
-          if (lyr_a[lidx]->group_type != 0)
-            {
-              if (lyr_a[lidx]->group_type == 3)
+              if (layer != NULL)
                 {
-                  /* the </Layer group> marker layers are used to
-                   * assemble the layer structure in a single pass
+                  /* Set the layer name.  Note that we do this even for group-end
+                   * markers, to avoid having the default group name collide with
+                   * subsequent layers; the real group name is set by the group
+                   * start marker.
                    */
-                  IFDBG(2) g_debug ("Create placeholder group layer");
-                  layer = gimp_layer_group_new (image);
-                  /* add this group layer as the new parent */
-                  g_array_append_val (parent_group_stack, layer);
-                }
-              else /* group-type == 1 || group_type == 2 */
-                {
-                  if (parent_group_stack->len)
-                    {
-                      layer = g_array_index (parent_group_stack, GimpLayer *,
-                                             parent_group_stack->len - 1);
-                      IFDBG(2) g_debug ("End group layer id %d.", gimp_item_get_id (GIMP_ITEM (layer)));
-                      /* since the layers are stored in reverse, the group
-                       * layer start marker actually means we're done with
-                       * that layer group
-                       */
-                      g_array_remove_index (parent_group_stack,
-                                            parent_group_stack->len - 1);
-
-                      gimp_drawable_offsets (GIMP_DRAWABLE (layer), &l_x, &l_y);
+                  gimp_item_set_name (GIMP_ITEM (layer), lyr_a[lidx]->name);
 
-                      l_w = gimp_drawable_width  (GIMP_DRAWABLE (layer));
-                      l_h = gimp_drawable_height (GIMP_DRAWABLE (layer));
-                    }
-                  else
-                    {
-                      IFDBG(1) g_debug ("WARNING: Unmatched group layer start marker.");
-                      layer = NULL;
-                    }
-                }
-            }
-          else
-            {
-              if (empty)
-                {
-                  IFDBG(2) g_debug ("Create blank layer");
-                }
-              else
-                {
-                  IFDBG(2) g_debug ("Create normal layer");
-                  l_x = lyr_a[lidx]->left;
-                  l_y = lyr_a[lidx]->top;
-                  l_w = lyr_a[lidx]->right - lyr_a[lidx]->left;
-                  l_h = lyr_a[lidx]->bottom - lyr_a[lidx]->top;
-                }
-
-              image_type = get_gimp_image_type (img_a->base_type, TRUE);
-              IFDBG(3) g_debug ("Layer type %d", image_type);
-
-              layer = gimp_layer_new (image, lyr_a[lidx]->name,
-                                      l_w, l_h, image_type,
-                                      100, GIMP_LAYER_MODE_NORMAL);
-            }
-
-          if (layer != NULL)
-            {
-              /* Set the layer name.  Note that we do this even for group-end
-               * markers, to avoid having the default group name collide with
-               * subsequent layers; the real group name is set by the group
-               * start marker.
-               */
-              gimp_item_set_name (GIMP_ITEM (layer), lyr_a[lidx]->name);
-
-              /* Set the layer properties (skip this for layer group end
-               * markers; we set their properties when processing the start
-               * marker.)
-               */
-              if (lyr_a[lidx]->group_type != 3)
-                {
-                  /* Mode */
-                  psd_to_gimp_blend_mode (lyr_a[lidx]->blend_mode, &mode_info);
-                  gimp_layer_set_mode (layer, mode_info.mode);
-                  gimp_layer_set_blend_space (layer, mode_info.blend_space);
-                  gimp_layer_set_composite_space (layer, mode_info.composite_space);
-                  gimp_layer_set_composite_mode (layer, mode_info.composite_mode);
-
-                  /* Opacity */
-                  gimp_layer_set_opacity (layer,
-                                          lyr_a[lidx]->opacity * 100.0 / 255.0);
-
-                  /* Flags */
-                  gimp_layer_set_lock_alpha  (layer, lyr_a[lidx]->layer_flags.trans_prot);
-                  gimp_item_set_visible (GIMP_ITEM (layer), lyr_a[lidx]->layer_flags.visible);
-#if 0
-                  /* according to the spec, the 'irrelevant' flag indicates
-                   * that the layer's "pixel data is irrelevant to the
-                   * appearance of the document".  what this seems to mean is
-                   * not that the layer doesn't contribute to the image, but
-                   * rather that its appearance can be entirely derived from
-                   * sources other than the pixel data, such as vector data.
-                   * in particular, this doesn't mean that the layer is
-                   * invisible. since we only support raster layers atm, we can
-                   * just ignore this flag.
+                  /* Set the layer properties (skip this for layer group end
+                   * markers; we set their properties when processing the start
+                   * marker.)
                    */
-                  if (lyr_a[lidx]->layer_flags.irrelevant &&
-                      lyr_a[lidx]->group_type == 0)
+                  if (lyr_a[lidx]->group_type != 3)
                     {
-                      gimp_item_set_visible (GIMP_ITEM (layer), FALSE);
-                    }
+                      /* Mode */
+                      psd_to_gimp_blend_mode (lyr_a[lidx]->blend_mode, &mode_info);
+                      gimp_layer_set_mode (layer, mode_info.mode);
+                      gimp_layer_set_blend_space (layer, mode_info.blend_space);
+                      gimp_layer_set_composite_space (layer, mode_info.composite_space);
+                      gimp_layer_set_composite_mode (layer, mode_info.composite_mode);
+
+                      /* Opacity */
+                      gimp_layer_set_opacity (layer,
+                                              lyr_a[lidx]->opacity * 100.0 / 255.0);
+
+                      /* Flags */
+                      gimp_layer_set_lock_alpha  (layer, lyr_a[lidx]->layer_flags.trans_prot);
+                      gimp_item_set_visible (GIMP_ITEM (layer), lyr_a[lidx]->layer_flags.visible);
+#if 0
+                      /* according to the spec, the 'irrelevant' flag indicates
+                       * that the layer's "pixel data is irrelevant to the
+                       * appearance of the document".  what this seems to mean is
+                       * not that the layer doesn't contribute to the image, but
+                       * rather that its appearance can be entirely derived from
+                       * sources other than the pixel data, such as vector data.
+                       * in particular, this doesn't mean that the layer is
+                       * invisible. since we only support raster layers atm, we can
+                       * just ignore this flag.
+                       */
+                      if (lyr_a[lidx]->layer_flags.irrelevant &&
+                          lyr_a[lidx]->group_type == 0)
+                        {
+                          gimp_item_set_visible (GIMP_ITEM (layer), FALSE);
+                        }
 #endif
 
-                  /* Position */
-                  if (l_x != 0 || l_y != 0)
-                    gimp_layer_set_offsets (layer, l_x, l_y);
+                      /* Position */
+                      if (l_x != 0 || l_y != 0)
+                        gimp_layer_set_offsets (layer, l_x, l_y);
 
-                  /* Color tag */
-                  gimp_item_set_color_tag (GIMP_ITEM (layer),
-                                           psd_to_gimp_layer_color_tag (lyr_a[lidx]->color_tag[0]));
+                      /* Color tag */
+                      gimp_item_set_color_tag (GIMP_ITEM (layer),
+                                               psd_to_gimp_layer_color_tag (lyr_a[lidx]->color_tag[0]));
 
-                  /* Tattoo */
-                  if (lyr_a[lidx]->id)
-                    gimp_item_set_tattoo (GIMP_ITEM (layer), lyr_a[lidx]->id);
+                      /* Tattoo */
+                      if (lyr_a[lidx]->id)
+                        gimp_item_set_tattoo (GIMP_ITEM (layer), lyr_a[lidx]->id);
 
-                  /* For layer groups, expand or collapse the group */
-                  if (lyr_a[lidx]->group_type != 0)
-                    {
-                      gimp_item_set_expanded (GIMP_ITEM (layer),
-                                              lyr_a[lidx]->group_type == 1);
+                      /* For layer groups, expand or collapse the group */
+                      if (lyr_a[lidx]->group_type != 0)
+                        {
+                          gimp_item_set_expanded (GIMP_ITEM (layer),
+                                                  lyr_a[lidx]->group_type == 1);
+                        }
                     }
-                }
-
-              /* Remember the active layer ID */
-              if (lidx == img_a->layer_state)
-                {
-                  active_layer = layer;
-                }
-
-              /* Set the layer data */
-              if (lyr_a[lidx]->group_type == 0)
-                {
-                  IFDBG(3) g_debug ("Draw layer");
 
-                  if (empty)
+                  /* Remember the active layer ID */
+                  if (lidx == img_a->layer_state)
                     {
-                      gimp_drawable_fill (GIMP_DRAWABLE (layer), GIMP_FILL_TRANSPARENT);
+                      active_layer = layer;
                     }
-                  else
-                    {
-                      GeglBufferIterator *iter;
-
-                      bps = img_a->bps / 8;
-                      if (bps == 0)
-                        bps++;
-
-                      buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
 
-                      iter = gegl_buffer_iterator_new (
-                        buffer, NULL, 0, get_layer_format (img_a, alpha),
-                        GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE, 1);
+                  /* Set the layer data */
+                  if (lyr_a[lidx]->group_type == 0)
+                    {
+                      IFDBG(3) g_debug ("Draw layer");
 
-                      while (gegl_buffer_iterator_next (iter))
+                      if (empty)
                         {
-                          const GeglRectangle *roi      = &iter->items[0].roi;
-                          guint8              *dst0     = iter->items[0].data;
-                          gint                 src_step = bps;
-                          gint                 dst_step = bps * layer_channels;
-
-                          if (img_a->color_mode == PSD_CMYK)
-                            {
-                              dst0 = gegl_scratch_alloc (layer_channels *
-                                                         iter->length);
-                            }
-
-                          for (cidx = 0; cidx < layer_channels; ++cidx)
-                            {
-                              gint b;
-
-                              if (roi->x == 0 && roi->y == 0)
-                                IFDBG(3) g_debug ("Start channel %d", channel_idx[cidx]);
-
-                              for (b = 0; b < bps; ++b)
-                                {
-                                  guint8 *dst;
-                                  gint    y;
-
-                                  dst = &dst0[cidx * bps + b];
-
-                                  for (y = 0; y < roi->height; y++)
-                                    {
-                                      const guint8 *src;
-                                      gint          x;
-
-                                      src = (const guint8 *)
-                                        &lyr_chn[channel_idx[cidx]]->data[
-                                          ((roi->y + y) * l_w +
-                                           roi->x)      * bps +
-                                          b];
-
-                                      for (x = 0; x < roi->width; ++x)
-                                        {
-                                          *dst = *src;
-
-                                          src += src_step;
-                                          dst += dst_step;
-                                        }
-                                    }
-                                }
-                            }
-
-                          if (img_a->color_mode == PSD_CMYK)
-                            {
-                              psd_convert_cmyk_to_srgb (
-                                img_a,
-                                iter->items[0].data, dst0,
-                                roi->width, roi->height,
-                                alpha);
-
-                              gegl_scratch_free (dst0);
-                            }
+                          gimp_drawable_fill (GIMP_DRAWABLE (layer), GIMP_FILL_TRANSPARENT);
                         }
+                      else
+                        {
+                          buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+                          gegl_buffer_set (buffer,
+                                           GEGL_RECTANGLE (0, 0, l_w, l_h),
+                                           0, ld->format,
+                                           ld->pixels,
+                                           GEGL_AUTO_ROWSTRIDE);
+                          g_object_unref (buffer);
 
-                      for (cidx = 0; cidx < layer_channels; ++cidx)
-                        g_free (lyr_chn[channel_idx[cidx]]->data);
-
-                      g_object_unref (buffer);
+                          g_clear_pointer (&ld->pixels, g_free);
+                        }
                     }
-                }
 
-              /* Layer mask */
-              if (user_mask && lyr_a[lidx]->group_type != 3)
-                {
-                  if (empty_mask)
+                  /* Layer mask */
+                  if (user_mask && lyr_a[lidx]->group_type != 3)
                     {
-                      IFDBG(3) g_debug ("Create empty mask");
-                      if (lyr_a[lidx]->layer_mask.def_color == 255)
-                        mask = gimp_layer_create_mask (layer,
-                                                       GIMP_ADD_MASK_WHITE);
-                      else
-                        mask = gimp_layer_create_mask (layer,
-                                                       GIMP_ADD_MASK_BLACK);
-                      gimp_layer_add_mask (layer, mask);
-                      gimp_layer_set_apply_mask (layer,
-                                                 ! lyr_a[lidx]->layer_mask.mask_flags.disabled);
-                    }
-                  else
-                    {
-                      GeglRectangle mask_rect;
-
-                      /* Load layer mask data */
-                      lm_x = lyr_a[lidx]->layer_mask.left - l_x;
-                      lm_y = lyr_a[lidx]->layer_mask.top - l_y;
-                      lm_w = lyr_a[lidx]->layer_mask.right - lyr_a[lidx]->layer_mask.left;
-                      lm_h = lyr_a[lidx]->layer_mask.bottom - lyr_a[lidx]->layer_mask.top;
-                      IFDBG(3) g_debug ("Mask channel index %d", user_mask_chn);
-                      IFDBG(3) g_debug ("Original Mask %d %d %d %d", lm_x, lm_y, lm_w, lm_h);
-                      /* Crop mask at layer boundary, and draw layer mask data,
-                       * if any
-                       */
-                      if (gegl_rectangle_intersect (
-                            &mask_rect,
-                            GEGL_RECTANGLE (0, 0, l_w, l_h),
-                            GEGL_RECTANGLE (lm_x, lm_y, lm_w, lm_h)))
+                      if (empty_mask)
                         {
-                          IFDBG(3) g_debug ("Layer %d %d %d %d", l_x, l_y, l_w, l_h);
-                          IFDBG(3) g_debug ("Mask %d %d %d %d",
-                                            mask_rect.x,     mask_rect.y,
-                                            mask_rect.width, mask_rect.height);
-
+                          IFDBG(3) g_debug ("Create empty mask");
                           if (lyr_a[lidx]->layer_mask.def_color == 255)
                             mask = gimp_layer_create_mask (layer,
                                                            GIMP_ADD_MASK_WHITE);
                           else
                             mask = gimp_layer_create_mask (layer,
                                                            GIMP_ADD_MASK_BLACK);
-
-                          bps = img_a->bps / 8;
-                          if (bps == 0)
-                            bps++;
-
-                          IFDBG(3) g_debug ("New layer mask %d", gimp_item_get_id (GIMP_ITEM (mask)));
                           gimp_layer_add_mask (layer, mask);
-                          buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
-                          gegl_buffer_set (buffer,
-                                           &mask_rect,
-                                           0, get_mask_format (img_a),
-                                           lyr_chn[user_mask_chn]->data + (
-                                             (mask_rect.y - lm_y)  * lm_w +
-                                             (mask_rect.x - lm_x)) * bps,
-                                           lm_w * bps);
-                          g_object_unref (buffer);
                           gimp_layer_set_apply_mask (layer,
                                                      ! lyr_a[lidx]->layer_mask.mask_flags.disabled);
                         }
-                      g_free (lyr_chn[user_mask_chn]->data);
+                      else
+                        {
+                          GeglRectangle mask_rect;
+
+                          /* Load layer mask data */
+                          lm_x = lyr_a[lidx]->layer_mask.left - l_x;
+                          lm_y = lyr_a[lidx]->layer_mask.top - l_y;
+                          lm_w = lyr_a[lidx]->layer_mask.right - lyr_a[lidx]->layer_mask.left;
+                          lm_h = lyr_a[lidx]->layer_mask.bottom - lyr_a[lidx]->layer_mask.top;
+                          IFDBG(3) g_debug ("Mask channel index %d", user_mask_chn);
+                          IFDBG(3) g_debug ("Original Mask %d %d %d %d", lm_x, lm_y, lm_w, lm_h);
+                          /* Crop mask at layer boundary, and draw layer mask data,
+                           * if any
+                           */
+                          if (gegl_rectangle_intersect (
+                                &mask_rect,
+                                GEGL_RECTANGLE (0, 0, l_w, l_h),
+                                GEGL_RECTANGLE (lm_x, lm_y, lm_w, lm_h)))
+                            {
+                              IFDBG(3) g_debug ("Layer %d %d %d %d", l_x, l_y, l_w, l_h);
+                              IFDBG(3) g_debug ("Mask %d %d %d %d",
+                                                mask_rect.x,     mask_rect.y,
+                                                mask_rect.width, mask_rect.height);
+
+                              if (lyr_a[lidx]->layer_mask.def_color == 255)
+                                mask = gimp_layer_create_mask (layer,
+                                                               GIMP_ADD_MASK_WHITE);
+                              else
+                                mask = gimp_layer_create_mask (layer,
+                                                               GIMP_ADD_MASK_BLACK);
+
+                              bps = img_a->bps / 8;
+                              if (bps == 0)
+                                bps++;
+
+                              IFDBG(3) g_debug ("New layer mask %d", gimp_item_get_id (GIMP_ITEM (mask)));
+                              gimp_layer_add_mask (layer, mask);
+                              buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
+                              gegl_buffer_set (buffer,
+                                               &mask_rect,
+                                               0, get_mask_format (img_a),
+                                               lyr_chn[user_mask_chn]->data + (
+                                                 (mask_rect.y - lm_y)  * lm_w +
+                                                 (mask_rect.x - lm_x)) * bps,
+                                               lm_w * bps);
+                              g_object_unref (buffer);
+                              gimp_layer_set_apply_mask (layer,
+                                                         ! lyr_a[lidx]->layer_mask.mask_flags.disabled);
+                            }
+                          g_clear_pointer (&lyr_chn[user_mask_chn]->data, g_free);
+                        }
                     }
-                }
 
-                /* Insert the layer */
-                if (lyr_a[lidx]->group_type == 0 || /* normal layer */
-                    lyr_a[lidx]->group_type == 3    /* group layer end marker */)
-                  {
-                    gimp_image_insert_layer (image, layer, parent_group, 0);
-                  }
+                    /* Insert the layer */
+                    if (lyr_a[lidx]->group_type == 0 || /* normal layer */
+                        lyr_a[lidx]->group_type == 3    /* group layer end marker */)
+                      {
+                        gimp_image_insert_layer (image, layer, parent_group, 0);
+                      }
+                }
             }
 
-          for (cidx = 0; cidx < lyr_a[lidx]->num_channels; ++cidx)
-            if (lyr_chn[cidx])
-              g_free (lyr_chn[cidx]);
-          g_free (lyr_chn);
+          free_layer_data (ld);
+
+          g_free (lyr_a[lidx]->chn_info);
+          g_free (lyr_a[lidx]->name);
+          g_free (lyr_a[lidx]);
         }
-      g_free (lyr_a[lidx]->chn_info);
-      g_free (lyr_a[lidx]->name);
-      g_free (lyr_a[lidx]);
     }
+  g_free (layers);
   g_free (lyr_a);
   g_array_free (parent_group_stack, FALSE);
 
@@ -2233,19 +2471,42 @@ read_channel_data (PSDchannel     *channel,
                    guint32         comp_len,
                    GError        **error)
 {
-  gchar    *raw_data;
-  gchar    *src;
+  gchar   *src;
+  guint32  src_len;
+  gint     ret;
+
+  if (read_channel_source (channel, bps, compression, rle_pack_len,
+                           f, comp_len, &src, &src_len, error) < 1)
+    return -1;
+
+  ret = decode_channel_data (channel, bps, compression, rle_pack_len,
+                             src, src_len, error);
+
+  g_free (src);
+
+  return ret;
+}
+
+/* Reads the channel data as stored in the file, without decoding it */
+static gint
+read_channel_source (PSDchannel     *channel,
+                     guint16         bps,
+                     guint16         compression,
+                     const guint16  *rle_pack_len,
+                     FILE           *f,
+                     guint32         comp_len,
+                     gchar         **src,
+                     guint32        *src_len,
+                     GError        **error)
+{
   guint32   readline_len;
-  gint      i, j;
+  gint      i;
 
   if (bps == 1)
     readline_len = ((channel->columns + 7) / 8);
   else
     readline_len = (channel->columns * bps / 8);
 
-  IFDBG(3) g_debug ("raw data size %d x %d = %d", readline_len,
-                    channel->rows, readline_len * channel->rows);
-
   /* sanity check, int overflow check (avoid divisions by zero) */
   if ((channel->rows == 0) || (channel->columns == 0) ||
       (channel->rows > G_MAXINT32 / channel->columns / MAX (bps / 8, 1)))
@@ -2255,21 +2516,27 @@ read_channel_data (PSDchannel     *channel,
       return -1;
     }
 
-  raw_data = g_malloc (readline_len * channel->rows);
   switch (compression)
     {
       case PSD_COMP_RAW:
-        if (fread (raw_data, readline_len, channel->rows, f) < 1)
+        *src_len = readline_len * channel->rows;
+        *src = g_malloc (*src_len);
+        if (fread (*src, readline_len, channel->rows, f) < 1)
           {
             psd_set_error (feof (f), errno, error);
+            g_clear_pointer (src, g_free);
             return -1;
           }
         break;
 
       case PSD_COMP_RLE:
+        *src_len = 0;
         for (i = 0; i < channel->rows; ++i)
+          *src_len += rle_pack_len[i];
+
+        *src = g_malloc (*src_len);
+        for (i = 0, *src_len = 0; i < channel->rows; ++i)
           {
-            src = gegl_scratch_alloc (rle_pack_len[i]);
 /*      FIXME check for over-run
             if (ftell (f) + rle_pack_len[i] > block_end)
               {
@@ -2277,16 +2544,76 @@ read_channel_data (PSDchannel     *channel,
                 return -1;
               }
 */
-            if (fread (src, rle_pack_len[i], 1, f) < 1)
+            if (fread (*src + *src_len, rle_pack_len[i], 1, f) < 1)
               {
                 psd_set_error (feof (f), errno, error);
-                gegl_scratch_free (src);
+                g_clear_pointer (src, g_free);
                 return -1;
               }
+            *src_len += rle_pack_len[i];
+          }
+        break;
+
+      case PSD_COMP_ZIP:
+      case PSD_COMP_ZIP_PRED:
+        *src_len = comp_len;
+        *src = g_malloc (comp_len);
+        if (fread (*src, comp_len, 1, f) < 1)
+          {
+            psd_set_error (feof (f), errno, error);
+            g_clear_pointer (src, g_free);
+            return -1;
+          }
+        break;
+
+      default:
+        *src_len = 0;
+        *src = NULL;
+        break;
+    }
+
+  return 1;
+}
+
+/* Decodes channel data read by read_channel_source().  This only touches
+ * the channel record, so channels can be decoded by several threads at
+ * once.
+ */
+static gint
+decode_channel_data (PSDchannel     *channel,
+                     guint16         bps,
+                     guint16         compression,
+                     const guint16  *rle_pack_len,
+                     const gchar    *src,
+                     guint32         src_len,
+                     GError        **error)
+{
+  gchar    *raw_data;
+  guint32   readline_len;
+  gint      i, j;
+
+  if (bps == 1)
+    readline_len = ((channel->columns + 7) / 8);
+  else
+    readline_len = (channel->columns * bps / 8);
+
+  IFDBG(3) g_debug ("raw data size %d x %d = %d", readline_len,
+                    channel->rows, readline_len * channel->rows);
+
+  raw_data = g_malloc (readline_len * channel->rows);
+  switch (compression)
+    {
+      case PSD_COMP_RAW:
+        memcpy (raw_data, src, readline_len * channel->rows);
+        break;
+
+      case PSD_COMP_RLE:
+        for (i = 0; i < channel->rows; ++i)
+          {
             /* FIXME check for errors returned from decode packbits */
             decode_packbits (src, raw_data + i * readline_len,
                              rle_pack_len[i], readline_len);
-            gegl_scratch_free (src);
+            src += rle_pack_len[i];
           }
         break;
       case PSD_COMP_ZIP:
@@ -2294,16 +2621,8 @@ read_channel_data (PSDchannel     *channel,
         {
           z_stream zs;
 
-          src = g_malloc (comp_len);
-          if (fread (src, comp_len, 1, f) < 1)
-            {
-              psd_set_error (feof (f), errno, error);
-              g_free (src);
-              return -1;
-            }
-
           zs.next_in = (guchar*) src;
-          zs.avail_in = comp_len;
+          zs.avail_in = src_len;
           zs.next_out = (guchar*) raw_data;
           zs.avail_out = readline_len * channel->rows;
           zs.zalloc = zzalloc;
@@ -2318,11 +2637,10 @@ read_channel_data (PSDchannel     *channel,
             {
               g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
                            _("Failed to decompress data"));
-              g_free (src);
+              g_free (raw_data);
               return -1;
             }
 
-          g_free (src);
           break;
         }
     }
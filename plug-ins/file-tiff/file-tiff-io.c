@@ -46,7 +46,14 @@ typedef struct
   gsize          position;
 } TiffIO;
 
+typedef struct
+{
+  GByteArray    *data;
+  gsize          position;
+} TiffMemoryIO;
+
 static TIFFExtendProc parent_extender;
+static GThread       *main_thread = NULL;
 
 static void      tiff_io_warning       (const gchar *module,
                                         const gchar *fmt,
@@ -54,6 +61,9 @@ static void      tiff_io_warning       (const gchar *module,
 static void      tiff_io_error         (const gchar *module,
                                         const gchar *fmt,
                                         va_list      ap) G_GNUC_PRINTF (2, 0);
+static gboolean  tiff_io_from_thread   (const gchar *module,
+                                        const gchar *fmt,
+                                        va_list      ap) G_GNUC_PRINTF (2, 0);
 static tsize_t   tiff_io_read          (thandle_t    handle,
                                         tdata_t      buffer,
                                         tsize_t      size);
@@ -67,6 +77,22 @@ static gint      tiff_io_close         (thandle_t    handle);
 static toff_t    tiff_io_get_file_size (thandle_t    handle);
 static void      register_geotags      (TIFF        *tif);
 
+static TIFF    * tiff_io_open          (GFile       *file,
+                                        const gchar *mode,
+                                        GError     **error);
+
+static tsize_t   tiff_memory_read      (thandle_t    handle,
+                                        tdata_t      buffer,
+                                        tsize_t      size);
+static tsize_t   tiff_memory_write     (thandle_t    handle,
+                                        tdata_t      buffer,
+                                        tsize_t      size);
+static toff_t    tiff_memory_seek      (thandle_t    handle,
+                                        toff_t       offset,
+                                        gint         whence);
+static gint      tiff_memory_close     (thandle_t    handle);
+static toff_t    tiff_memory_get_size  (thandle_t    handle);
+
 static void
 register_geotags (TIFF *tif)
 {
@@ -84,9 +110,6 @@ register_geotags (TIFF *tif)
 }
 
 
-static TiffIO tiff_io = { 0, };
-
-
 TIFF *
 tiff_open (GFile        *file,
            const gchar  *mode,
@@ -97,37 +120,100 @@ tiff_open (GFile        *file,
 
   parent_extender = TIFFSetTagExtender (register_geotags);
 
-  tiff_io.file = file;
+  main_thread = g_thread_self ();
+
+  return tiff_io_open (file, mode, error);
+}
+
+/* Opens another read handle on the file @tif was opened from, set to
+ * the same directory.  Every handle has its own stream and decoder
+ * state, so separate handles can be used from separate threads.
+ */
+TIFF *
+tiff_reopen (TIFF    *tif,
+             GError **error)
+{
+  TiffIO *io = (TiffIO *) TIFFClientdata (tif);
+  TIFF   *new_tif;
+
+  new_tif = tiff_io_open (io->file, "r", error);
+
+  if (new_tif && ! TIFFSetDirectory (new_tif, TIFFCurrentDirectory (tif)))
+    {
+      g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                           "TIFFSetDirectory() failed");
+
+      TIFFClose (new_tif);
+      new_tif = NULL;
+    }
+
+  return new_tif;
+}
+
+/* Opens a TIFF handle reading from, or writing to, @data in memory. */
+TIFF *
+tiff_open_memory (GByteArray  *data,
+                  const gchar *mode)
+{
+  TiffMemoryIO *io = g_slice_new0 (TiffMemoryIO);
+  TIFF         *tif;
+
+  io->data = g_byte_array_ref (data);
+
+  tif = TIFFClientOpen ("file-tiff", mode,
+                        (thandle_t) io,
+                        tiff_memory_read,
+                        tiff_memory_write,
+                        tiff_memory_seek,
+                        tiff_memory_close,
+                        tiff_memory_get_size,
+                        NULL, NULL);
+
+  if (! tif)
+    tiff_memory_close ((thandle_t) io);
+
+  return tif;
+}
+
+static TIFF *
+tiff_io_open (GFile        *file,
+              const gchar  *mode,
+              GError      **error)
+{
+  TiffIO *io = g_slice_new0 (TiffIO);
+  TIFF   *tif;
+
+  io->file = file;
 
   if (! strcmp (mode, "r"))
     {
-      tiff_io.input = G_INPUT_STREAM (g_file_read (file, NULL, error));
-      if (! tiff_io.input)
-        return NULL;
+      io->input = G_INPUT_STREAM (g_file_read (file, NULL, error));
+      if (! io->input)
+        goto fail;
 
-      tiff_io.stream = G_OBJECT (tiff_io.input);
+      io->stream = G_OBJECT (io->input);
     }
   else if(! strcmp (mode, "w"))
     {
-      tiff_io.output = G_OUTPUT_STREAM (g_file_replace (file,
-                                                        NULL, FALSE,
-                                                        G_FILE_CREATE_NONE,
-                                                        NULL, error));
-      if (! tiff_io.output)
-        return NULL;
-
-      tiff_io.stream = G_OBJECT (tiff_io.output);
+      io->output = G_OUTPUT_STREAM (g_file_replace (file,
+                                                    NULL, FALSE,
+                                                    G_FILE_CREATE_NONE,
+                                                    NULL, error));
+      if (! io->output)
+        goto fail;
+
+      io->stream = G_OBJECT (io->output);
     }
   else if(! strcmp (mode, "a"))
     {
       GIOStream *iostream = G_IO_STREAM (g_file_open_readwrite (file, NULL,
                                                                 error));
       if (! iostream)
-        return NULL;
+        goto fail;
 
-      tiff_io.input  = g_io_stream_get_input_stream (iostream);
-      tiff_io.output = g_io_stream_get_output_stream (iostream);
-      tiff_io.stream = G_OBJECT (iostream);
+      io->input  = g_io_stream_get_input_stream (iostream);
+      io->output = g_io_stream_get_output_stream (iostream);
+      io->stream = G_OBJECT (iostream);
     }
   else
     {
@@ -136,18 +222,51 @@ tiff_open (GFile        *file,
 
 #if 0
 #warning FIXME !can_seek code is broken
-  tiff_io.can_seek = g_seekable_can_seek (G_SEEKABLE (tiff_io.stream));
+  io->can_seek = g_seekable_can_seek (G_SEEKABLE (io->stream));
 #endif
-  tiff_io.can_seek = TRUE;
-
-  return TIFFClientOpen ("file-tiff", mode,
-                         (thandle_t) &tiff_io,
-                         tiff_io_read,
-                         tiff_io_write,
-                         tiff_io_seek,
-                         tiff_io_close,
-                         tiff_io_get_file_size,
-                         NULL, NULL);
+  io->can_seek = TRUE;
+
+  tif = TIFFClientOpen ("file-tiff", mode,
+                        (thandle_t) io,
+                        tiff_io_read,
+                        tiff_io_write,
+                        tiff_io_seek,
+                        tiff_io_close,
+                        tiff_io_get_file_size,
+                        NULL, NULL);
+
+  /* TIFFClientOpen() doesn't close the handle when it fails */
+  if (! tif)
+    tiff_io_close ((thandle_t) io);
+
+  return tif;
+
+fail:
+  g_slice_free (TiffIO, io);
+
+  return NULL;
+}
+
+/* Messages can only be passed on to the core from the main thread,
+ * the ones libtiff reports while decoding in other threads are only
+ * printed to stderr.
+ */
+static gboolean
+tiff_io_from_thread (const gchar *module,
+                     const gchar *fmt,
+                     va_list      ap)
+{
+  gchar *msg;
+
+  if (g_thread_self () == main_thread)
+    return FALSE;
+
+  msg = g_strdup_vprintf (fmt, ap);
+
+  g_printerr ("%s: [%s] %s\n", G_STRFUNC, module, msg);
+  g_free (msg);
+
+  return TRUE;
 }
 
 static void
@@ -213,6 +332,9 @@ tiff_io_warning (const gchar *module,
       return;
     }
 
+  if (tiff_io_from_thread (module, fmt, ap))
+    return;
+
   g_logv (G_LOG_DOMAIN, G_LOG_LEVEL_MESSAGE, fmt, ap);
 }
 
@@ -227,6 +349,9 @@ tiff_io_error (const gchar *module,
   if (! strcmp (fmt, "Compression algorithm does not support random access"))
     return;
 
+  if (tiff_io_from_thread (module, fmt, ap))
+    return;
+
   g_logv (G_LOG_DOMAIN, G_LOG_LEVEL_MESSAGE, fmt, ap);
 }
 
@@ -467,16 +592,10 @@ tiff_io_close (thandle_t handle)
     }
 
   g_object_unref (io->stream);
-  io->stream = NULL;
-  io->input  = NULL;
-  io->output = NULL;
 
   g_free (io->buffer);
-  io->buffer = NULL;
 
-  io->allocated = 0;
-  io->used      = 0;
-  io->position  = 0;
+  g_slice_free (TiffIO, io);
 
   return closed ? 0 : -1;
 }
@@ -506,3 +625,83 @@ tiff_io_get_file_size (thandle_t handle)
 
   return (toff_t) size;
 }
+
+static tsize_t
+tiff_memory_read (thandle_t handle,
+                  tdata_t   buffer,
+                  tsize_t   size)
+{
+  TiffMemoryIO *io = (TiffMemoryIO *) handle;
+
+  if (io->position >= io->data->len)
+    return 0;
+
+  size = MIN (size, io->data->len - io->position);
+
+  memcpy (buffer, io->data->data + io->position, size);
+  io->position += size;
+
+  return size;
+}
+
+static tsize_t
+tiff_memory_write (thandle_t handle,
+                   tdata_t   buffer,
+                   tsize_t   size)
+{
+  TiffMemoryIO *io = (TiffMemoryIO *) handle;
+
+  if (io->position + size > io->data->len)
+    g_byte_array_set_size (io->data, io->position + size);
+
+  memcpy (io->data->data + io->position, buffer, size);
+  io->position += size;
+
+  return size;
+}
+
+static toff_t
+tiff_memory_seek (thandle_t handle,
+                  toff_t    offset,
+                  gint      whence)
+{
+  TiffMemoryIO *io = (TiffMemoryIO *) handle;
+
+  switch (whence)
+    {
+    default:
+    case SEEK_SET:
+      io->position = offset;
+      break;
+
+    case SEEK_CUR:
+      io->position += offset;
+      break;
+
+    case SEEK_END:
+      io->position = io->data->len + offset;
+      break;
+    }
+
+  return (toff_t) io->position;
+}
+
+static gint
+tiff_memory_close (thandle_t handle)
+{
+  TiffMemoryIO *io = (TiffMemoryIO *) handle;
+
+  g_byte_array_unref (io->data);
+
+  g_slice_free (TiffMemoryIO, io);
+
+  return 0;
+}
+
+static toff_t
+tiff_memory_get_size (thandle_t handle)
+{
+  TiffMemoryIO *io = (TiffMemoryIO *) handle;
+
+  return (toff_t) io->data->len;
+}
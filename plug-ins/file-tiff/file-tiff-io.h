@@ -41,9 +41,13 @@ static const TIFFFieldInfo geotifftags_fieldinfo[] = {
   { GEOTIFF_ASCIIPARAMS,          -1, -1, TIFF_ASCII,  FIELD_CUSTOM, TRUE, FALSE, "GeoAsciiParams" }
 };
 
-TIFF * tiff_open (GFile        *file,
-                  const gchar  *mode,
-                  GError      **error);
+TIFF * tiff_open        (GFile        *file,
+                         const gchar  *mode,
+                         GError      **error);
+TIFF * tiff_reopen      (TIFF         *tif,
+                         GError      **error);
+TIFF * tiff_open_memory (GByteArray   *data,
+                         const gchar  *mode);
 
 
 #endif /* __FILE_TIFF_IO_H__ */
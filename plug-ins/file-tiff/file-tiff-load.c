@@ -61,6 +61,9 @@
 
 #define PLUG_IN_ROLE "gimp-file-tiff-load"
 
+/* Largest strip or tile that is decoded in a separate thread */
+#define MAX_PARALLEL_CHUNK_SIZE (64 * 1024 * 1024)
+
 
 typedef struct
 {
@@ -71,6 +74,37 @@ typedef struct
   guchar       *pixel;
 } ChannelData;
 
+/* Everything needed to copy a decoded strip or tile of a contiguous
+ * image to the channel buffers.
+ */
+typedef struct
+{
+  ChannelData *channel;
+  const Babl  *src_format;
+  gushort      bps;
+  gushort      spp;
+  gboolean     is_bw;
+  gboolean     is_signed;
+  gint         extra;
+  gint         bytes_per_pixel;
+  gboolean     tiled;
+  guint32      image_width;
+  guint32      image_height;
+  guint32      tile_width;
+  guint32      tile_height;
+  guint32      chunks_across;
+  tmsize_t     chunk_size;
+} LoadContiguousData;
+
+typedef struct
+{
+  const LoadContiguousData *data;
+  TIFF                     *tif;
+  GAsyncQueue              *handles;
+  guint32                   first_chunk;
+  gboolean                 *failed;
+} LoadParallelData;
+
 typedef enum
 {
   GIMP_TIFF_LOAD_ASSOCALPHA,
@@ -1716,6 +1750,246 @@ load_paths (TIFF      *tif,
 }
 
 
+/* Copies one decoded strip or tile, whose top left corner is at (x, y),
+ * to the channel buffers.  Also used from the decoding threads, for
+ * different chunks at the same time.
+ */
+static void
+load_contiguous_chunk (const LoadContiguousData *data,
+                       guchar                   *buffer,
+                       guchar                   *bw_buffer,
+                       guint32                   x,
+                       guint32                   y)
+{
+  GeglBuffer *src_buf;
+  guint32     rows;
+  guint32     cols;
+  gint        offset;
+  gint        i;
+
+  cols = MIN (data->image_width  - x, data->tile_width);
+  rows = MIN (data->image_height - y, data->tile_height);
+
+  if (data->is_bw)
+    {
+      if (data->bps == 1)
+        convert_bit2byte (buffer, bw_buffer, cols, rows);
+      else if (data->bps == 2)
+        convert_2bit2byte (buffer, bw_buffer, cols, rows);
+      else if (data->bps == 4)
+        convert_4bit2byte (buffer, bw_buffer, cols, rows);
+    }
+  else if (data->is_signed)
+    {
+      convert_int2uint (buffer, data->bps, data->spp, cols, rows,
+                        data->tile_width * data->bytes_per_pixel);
+    }
+
+  src_buf = gegl_buffer_linear_new_from_data (data->is_bw ? bw_buffer : buffer,
+                                              data->src_format,
+                                              GEGL_RECTANGLE (0, 0, cols, rows),
+                                              data->tile_width *
+                                              data->bytes_per_pixel,
+                                              NULL, NULL);
+
+  offset = 0;
+
+  for (i = 0; i <= data->extra; i++)
+    {
+      GeglBufferIterator *iter;
+      gint                src_bpp;
+      gint                dest_bpp;
+
+      src_bpp  = babl_format_get_bytes_per_pixel (data->src_format);
+      dest_bpp = babl_format_get_bytes_per_pixel (data->channel[i].format);
+
+      iter = gegl_buffer_iterator_new (src_buf,
+                                       GEGL_RECTANGLE (0, 0, cols, rows),
+                                       0, NULL,
+                                       GEGL_ACCESS_READ,
+                                       GEGL_ABYSS_NONE, 2);
+      gegl_buffer_iterator_add (iter, data->channel[i].buffer,
+                                GEGL_RECTANGLE (x, y, cols, rows),
+                                0, data->channel[i].format,
+                                GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          guchar *s      = iter->items[0].data;
+          guchar *d      = iter->items[1].data;
+          gint    length = iter->length;
+
+          s += offset;
+
+          while (length--)
+            {
+              memcpy (d, s, dest_bpp);
+              d += dest_bpp;
+              s += src_bpp;
+            }
+        }
+
+      offset += dest_bpp;
+    }
+
+  g_object_unref (src_buf);
+}
+
+/* Whether the strips or tiles of the current directory are worth
+ * decoding in separate threads, each reading through its own handle.
+ */
+static gboolean
+load_contiguous_can_decode_in_parallel (TIFF *tif)
+{
+  guint32  n_chunks;
+  tmsize_t chunk_size;
+
+  if (gimp_get_num_processors () < 2)
+    return FALSE;
+
+  if (TIFFIsTiled (tif))
+    {
+      n_chunks   = TIFFNumberOfTiles (tif);
+      chunk_size = TIFFTileSize (tif);
+    }
+  else
+    {
+      n_chunks   = TIFFNumberOfStrips (tif);
+      chunk_size = TIFFStripSize (tif);
+    }
+
+  /* Every thread holds a whole decoded chunk in memory */
+  return n_chunks > 1 && chunk_size > 0 && chunk_size <= MAX_PARALLEL_CHUNK_SIZE;
+}
+
+static void
+load_contiguous_decode_range (gsize             offset,
+                              gsize             size,
+                              LoadParallelData *pdata)
+{
+  const LoadContiguousData *data = pdata->data;
+  TIFF                     *tif;
+  guchar                   *buffer;
+  guchar                   *bw_buffer = NULL;
+  gsize                     i;
+
+  tif = g_async_queue_try_pop (pdata->handles);
+
+  if (! tif)
+    tif = tiff_reopen (pdata->tif, NULL);
+
+  if (! tif)
+    {
+      for (i = offset; i < offset + size; i++)
+        pdata->failed[i] = TRUE;
+
+      return;
+    }
+
+  buffer = g_malloc (data->chunk_size);
+
+  if (data->is_bw)
+    bw_buffer = g_malloc (data->tile_width * data->tile_height);
+
+  for (i = offset; i < offset + size; i++)
+    {
+      guint32  chunk = pdata->first_chunk + i;
+      guint32  x, y;
+      tmsize_t result;
+
+      if (data->tiled)
+        {
+          x = (chunk % data->chunks_across) * data->tile_width;
+          y = (chunk / data->chunks_across) * data->tile_height;
+
+          result = TIFFReadEncodedTile (tif, chunk, buffer, data->chunk_size);
+        }
+      else
+        {
+          x = 0;
+          y = chunk * data->tile_height;
+
+          result = TIFFReadEncodedStrip (tif, chunk, buffer, data->chunk_size);
+        }
+
+      pdata->failed[i] = (result < 0);
+
+      if (! pdata->failed[i])
+        load_contiguous_chunk (data, buffer, bw_buffer, x, y);
+    }
+
+  g_free (buffer);
+  g_free (bw_buffer);
+
+  g_async_queue_push (pdata->handles, tif);
+}
+
+static void
+load_contiguous_parallel (TIFF               *tif,
+                          LoadContiguousData *data)
+{
+  LoadParallelData  pdata;
+  guint32           n_chunks;
+  guint32           batch_size;
+  guint32           chunk;
+  TIFF             *handle;
+
+  if (data->tiled)
+    n_chunks = TIFFNumberOfTiles (tif);
+  else
+    n_chunks = TIFFNumberOfStrips (tif);
+
+  /* Decode whole rows of chunks, enough of them to keep all threads
+   * busy, and report progress in between.
+   */
+  batch_size = MAX (data->chunks_across, 4 * gimp_get_num_processors ());
+  batch_size = (batch_size + data->chunks_across - 1) /
+               data->chunks_across * data->chunks_across;
+
+  pdata.data    = data;
+  pdata.tif     = tif;
+  pdata.handles = g_async_queue_new ();
+  pdata.failed  = g_new0 (gboolean, batch_size);
+
+  for (chunk = 0; chunk < n_chunks; chunk += batch_size)
+    {
+      guint32 n = MIN (batch_size, n_chunks - chunk);
+      guint32 i;
+
+      pdata.first_chunk = chunk;
+
+      gegl_parallel_distribute_range (
+        n, 1,
+        (GeglParallelDistributeRangeFunc) load_contiguous_decode_range,
+        &pdata);
+
+      /* Like for scanlines, a broken strip ends loading, while broken
+       * tiles are left empty.
+       */
+      if (! data->tiled)
+        {
+          for (i = 0; i < n; i++)
+            {
+              if (pdata.failed[i])
+                {
+                  g_message (_("Reading scanline failed. Image may be corrupt at line %d."),
+                             (chunk + i) * data->tile_height);
+                  goto out;
+                }
+            }
+        }
+
+      gimp_progress_update ((gdouble) (chunk + n) / (gdouble) n_chunks);
+    }
+
+out:
+  while ((handle = g_async_queue_try_pop (pdata.handles)))
+    TIFFClose (handle);
+
+  g_async_queue_unref (pdata.handles);
+  g_free (pdata.failed);
+}
+
 static void
 load_contiguous (TIFF        *tif,
                  ChannelData *channel,
@@ -1726,72 +2000,95 @@ load_contiguous (TIFF        *tif,
                  gboolean     is_signed,
                  gint         extra)
 {
-  guint32     image_width;
-  guint32     image_height;
-  guint32     tile_width;
-  guint32     tile_height;
-  gint        bytes_per_pixel;
-  const Babl *src_format;
-  guchar     *buffer;
-  guchar     *bw_buffer = NULL;
-  gdouble     progress  = 0.0;
-  gdouble     one_row;
-  guint32     y;
-  gint        i;
+  LoadContiguousData data;
+  guchar            *buffer;
+  guchar            *bw_buffer = NULL;
+  gdouble            progress  = 0.0;
+  gdouble            one_row;
+  guint32            y;
+  gint               i;
 
   g_printerr ("%s\n", __func__);
 
-  TIFFGetField (tif, TIFFTAG_IMAGEWIDTH,  &image_width);
-  TIFFGetField (tif, TIFFTAG_IMAGELENGTH, &image_height);
+  data.channel   = channel;
+  data.bps       = bps;
+  data.spp       = spp;
+  data.is_bw     = is_bw;
+  data.is_signed = is_signed;
+  data.extra     = extra;
+  data.tiled     = TIFFIsTiled (tif);
 
-  tile_width = image_width;
+  TIFFGetField (tif, TIFFTAG_IMAGEWIDTH,  &data.image_width);
+  TIFFGetField (tif, TIFFTAG_IMAGELENGTH, &data.image_height);
 
-  if (TIFFIsTiled (tif))
+  data.src_format = babl_format_n (type, spp);
+
+  /* consistency check */
+  data.bytes_per_pixel = 0;
+  for (i = 0; i <= extra; i++)
+    data.bytes_per_pixel += babl_format_get_bytes_per_pixel (channel[i].format);
+
+  g_printerr ("bytes_per_pixel: %d, format: %d\n",
+              data.bytes_per_pixel,
+              babl_format_get_bytes_per_pixel (data.src_format));
+
+  if (load_contiguous_can_decode_in_parallel (tif))
     {
-      TIFFGetField (tif, TIFFTAG_TILEWIDTH,  &tile_width);
-      TIFFGetField (tif, TIFFTAG_TILELENGTH, &tile_height);
+      if (data.tiled)
+        {
+          TIFFGetField (tif, TIFFTAG_TILEWIDTH,  &data.tile_width);
+          TIFFGetField (tif, TIFFTAG_TILELENGTH, &data.tile_height);
+
+          data.chunk_size = TIFFTileSize (tif);
+        }
+      else
+        {
+          data.tile_width = data.image_width;
+
+          TIFFGetFieldDefaulted (tif, TIFFTAG_ROWSPERSTRIP, &data.tile_height);
+          data.tile_height = MIN (data.tile_height, data.image_height);
+
+          data.chunk_size = TIFFStripSize (tif);
+        }
+
+      data.chunks_across = (data.image_width + data.tile_width - 1) /
+                           data.tile_width;
+
+      load_contiguous_parallel (tif, &data);
+
+      return;
+    }
+
+  if (data.tiled)
+    {
+      TIFFGetField (tif, TIFFTAG_TILEWIDTH,  &data.tile_width);
+      TIFFGetField (tif, TIFFTAG_TILELENGTH, &data.tile_height);
 
       buffer = g_malloc (TIFFTileSize (tif));
     }
   else
     {
-      tile_width  = image_width;
-      tile_height = 1;
+      data.tile_width  = data.image_width;
+      data.tile_height = 1;
 
       buffer = g_malloc (TIFFScanlineSize (tif));
     }
 
   if (is_bw)
-    bw_buffer = g_malloc (tile_width * tile_height);
+    bw_buffer = g_malloc (data.tile_width * data.tile_height);
 
-  one_row = (gdouble) tile_height / (gdouble) image_height;
-
-  src_format = babl_format_n (type, spp);
-
-  /* consistency check */
-  bytes_per_pixel = 0;
-  for (i = 0; i <= extra; i++)
-    bytes_per_pixel += babl_format_get_bytes_per_pixel (channel[i].format);
-
-  g_printerr ("bytes_per_pixel: %d, format: %d\n",
-              bytes_per_pixel,
-              babl_format_get_bytes_per_pixel (src_format));
+  one_row = (gdouble) data.tile_height / (gdouble) data.image_height;
 
-  for (y = 0; y < image_height; y += tile_height)
+  for (y = 0; y < data.image_height; y += data.tile_height)
     {
       guint32 x;
 
-      for (x = 0; x < image_width; x += tile_width)
+      for (x = 0; x < data.image_width; x += data.tile_width)
         {
-          GeglBuffer *src_buf;
-          guint32     rows;
-          guint32     cols;
-          gint        offset;
-
           gimp_progress_update (progress + one_row *
-                                ((gdouble) x / (gdouble) image_width));
+                                ((gdouble) x / (gdouble) data.image_width));
 
-          if (TIFFIsTiled (tif))
+          if (data.tiled)
             TIFFReadTile (tif, buffer, x, y, 0, 0);
           else if (TIFFReadScanline (tif, buffer, y, 0) == -1)
             {
@@ -1802,71 +2099,7 @@ load_contiguous (TIFF        *tif,
               return;
             }
 
-          cols = MIN (image_width  - x, tile_width);
-          rows = MIN (image_height - y, tile_height);
-
-          if (is_bw)
-            {
-              if (bps == 1)
-                convert_bit2byte (buffer, bw_buffer, cols, rows);
-              else if (bps == 2)
-                convert_2bit2byte (buffer, bw_buffer, cols, rows);
-              else if (bps == 4)
-                convert_4bit2byte (buffer, bw_buffer, cols, rows);
-            }
-          else if (is_signed)
-            {
-              convert_int2uint (buffer, bps, spp, cols, rows,
-                                tile_width * bytes_per_pixel);
-            }
-
-          src_buf = gegl_buffer_linear_new_from_data (is_bw ? bw_buffer : buffer,
-                                                      src_format,
-                                                      GEGL_RECTANGLE (0, 0, cols, rows),
-                                                      tile_width * bytes_per_pixel,
-                                                      NULL, NULL);
-
-          offset = 0;
-
-          for (i = 0; i <= extra; i++)
-            {
-              GeglBufferIterator *iter;
-              gint                src_bpp;
-              gint                dest_bpp;
-
-              src_bpp  = babl_format_get_bytes_per_pixel (src_format);
-              dest_bpp = babl_format_get_bytes_per_pixel (channel[i].format);
-
-              iter = gegl_buffer_iterator_new (src_buf,
-                                               GEGL_RECTANGLE (0, 0, cols, rows),
-                                               0, NULL,
-                                               GEGL_ACCESS_READ,
-                                               GEGL_ABYSS_NONE, 2);
-              gegl_buffer_iterator_add (iter, channel[i].buffer,
-                                        GEGL_RECTANGLE (x, y, cols, rows),
-                                        0, channel[i].format,
-                                        GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
-
-              while (gegl_buffer_iterator_next (iter))
-                {
-                  guchar *s      = iter->items[0].data;
-                  guchar *d      = iter->items[1].data;
-                  gint    length = iter->length;
-
-                  s += offset;
-
-                  while (length--)
-                    {
-                      memcpy (d, s, dest_bpp);
-                      d += dest_bpp;
-                      s += src_bpp;
-                    }
-                }
-
-              offset += dest_bpp;
-            }
-
-          g_object_unref (src_buf);
+          load_contiguous_chunk (&data, buffer, bw_buffer, x, y);
         }
 
       progress += one_row;
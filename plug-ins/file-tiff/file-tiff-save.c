@@ -63,6 +63,28 @@
 #define PLUG_IN_ROLE "gimp-file-tiff-save"
 
 
+/* Everything needed to fetch and encode one strip of a layer */
+typedef struct
+{
+  GeglBuffer   *buffer;
+  const Babl   *format;
+  gint          cols;
+  gint          rows;
+  gint          rowsperstrip;
+  gint          bytesperrow;
+  gboolean      is_bw;
+  gboolean      invert;
+  gushort       compression;
+  gshort        predictor;
+  gshort        photometric;
+  gshort        samplesperpixel;
+  gshort        bitspersample;
+  gshort        sampleformat;
+  gint          first_strip;
+  GByteArray  **strips;
+} SaveStripData;
+
+
 static gboolean  save_paths             (TIFF          *tif,
                                          GimpImage     *image,
                                          gdouble        width,
@@ -78,6 +100,15 @@ static void      byte2bit               (const guchar  *byteline,
 static void      save_thumbnail         (GimpImage     *image,
                                          TIFF          *tif);
 
+static gboolean  can_encode_strips      (gushort        compression);
+static void      encode_strips          (gsize          offset,
+                                         gsize          size,
+                                         SaveStripData *data);
+static gboolean  save_strips            (TIFF          *tif,
+                                         SaveStripData *data,
+                                         gdouble        progress_base,
+                                         gdouble        progress_fraction);
+
 
 static void
 double_to_psd_fixed (gdouble  value,
@@ -715,62 +746,93 @@ save_layer (TIFF        *tif,
   if (page == 0)
     save_paths (tif, orig_image, cols, rows, offset_x, offset_y);
 
-  /* array to rearrange data */
-  src  = g_new (guchar, bytesperrow * tile_height);
-  data = g_new (guchar, bytesperrow);
-
-  /* Now write the TIFF data. */
-  for (y = 0; y < rows; y = yend)
+  if (can_encode_strips (compression))
     {
-      yend = y + tile_height;
-      yend = MIN (yend, rows);
-
-      gegl_buffer_get (buffer,
-                       GEGL_RECTANGLE (0, y, cols, yend - y), 1.0,
-                       format, src,
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      SaveStripData strip_data;
+
+      strip_data.buffer          = buffer;
+      strip_data.format          = format;
+      strip_data.cols            = cols;
+      strip_data.rows            = rows;
+      strip_data.rowsperstrip    = rowsperstrip;
+      strip_data.bytesperrow     = bytesperrow;
+      strip_data.is_bw           = is_bw;
+      strip_data.invert          = invert;
+      strip_data.compression     = compression;
+      strip_data.predictor       = predictor;
+      strip_data.photometric     = photometric;
+      strip_data.samplesperpixel = samplesperpixel;
+      strip_data.bitspersample   = bitspersample;
+      strip_data.sampleformat    = sampleformat;
+
+      /* On failure, first_strip is the strip that could not be written */
+      if (! save_strips (tif, &strip_data,
+                         progress_base, progress_fraction))
+        {
+          g_message (_("Failed a scanline write on row %d"),
+                     strip_data.first_strip * (gint) rowsperstrip);
+          goto out;
+        }
+    }
+  else
+    {
+      /* array to rearrange data */
+      src  = g_new (guchar, bytesperrow * tile_height);
+      data = g_new (guchar, bytesperrow);
 
-      for (row = y; row < yend; row++)
+      /* Now write the TIFF data. */
+      for (y = 0; y < rows; y = yend)
         {
-          guchar *t = src + bytesperrow * (row - y);
+          yend = y + tile_height;
+          yend = MIN (yend, rows);
+
+          gegl_buffer_get (buffer,
+                           GEGL_RECTANGLE (0, y, cols, yend - y), 1.0,
+                           format, src,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-          switch (drawable_type)
+          for (row = y; row < yend; row++)
             {
-            case GIMP_INDEXED_IMAGE:
-            case GIMP_INDEXEDA_IMAGE:
-              if (is_bw)
-                {
-                  byte2bit (t, bytesperrow, data, invert);
-                  success = (TIFFWriteScanline (tif, data, row, 0) >= 0);
-                }
-              else
+              guchar *t = src + bytesperrow * (row - y);
+
+              switch (drawable_type)
                 {
+                case GIMP_INDEXED_IMAGE:
+                case GIMP_INDEXEDA_IMAGE:
+                  if (is_bw)
+                    {
+                      byte2bit (t, bytesperrow, data, invert);
+                      success = (TIFFWriteScanline (tif, data, row, 0) >= 0);
+                    }
+                  else
+                    {
+                      success = (TIFFWriteScanline (tif, t, row, 0) >= 0);
+                    }
+                  break;
+
+                case GIMP_GRAY_IMAGE:
+                case GIMP_GRAYA_IMAGE:
+                case GIMP_RGB_IMAGE:
+                case GIMP_RGBA_IMAGE:
                   success = (TIFFWriteScanline (tif, t, row, 0) >= 0);
-                }
-              break;
+                  break;
 
-            case GIMP_GRAY_IMAGE:
-            case GIMP_GRAYA_IMAGE:
-            case GIMP_RGB_IMAGE:
-            case GIMP_RGBA_IMAGE:
-              success = (TIFFWriteScanline (tif, t, row, 0) >= 0);
-              break;
+                default:
+                  success = FALSE;
+                  break;
+                }
 
-            default:
-              success = FALSE;
-              break;
+              if (!success)
+                {
+                  g_message (_("Failed a scanline write on row %d"), row);
+                  goto out;
+                }
             }
 
-          if (!success)
-            {
-              g_message (_("Failed a scanline write on row %d"), row);
-              goto out;
-            }
+          if ((row % 32) == 0)
+            gimp_progress_update (progress_base + progress_fraction
+                                  * (gdouble) row / (gdouble) rows);
         }
-
-      if ((row % 32) == 0)
-        gimp_progress_update (progress_base + progress_fraction
-                              * (gdouble) row / (gdouble) rows);
     }
 
   /* Save GeoTIFF tags to file, if available */
@@ -1404,3 +1466,181 @@ byte2bit (const guchar *byteline,
       *bitline = invert ? ~bitval & (0xff << (8 - width)) : bitval;
     }
 }
+
+/* Strips are compressed independently of each other, so for the
+ * codecs that keep no state across strips they can be encoded in
+ * separate threads and written as raw data afterwards.  JPEG shares
+ * its tables between strips, and fax compression is cheap enough
+ * that it's not worth it, so those are still written by scanline.
+ */
+static gboolean
+can_encode_strips (gushort compression)
+{
+  if (gimp_get_num_processors () < 2)
+    return FALSE;
+
+  switch (compression)
+    {
+    case COMPRESSION_LZW:
+    case COMPRESSION_PACKBITS:
+    case COMPRESSION_DEFLATE:
+    case COMPRESSION_ADOBE_DEFLATE:
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+/* Fetches and encodes the strips [offset, offset + size) of the current
+ * batch, each into a TIFF of its own in memory, and keeps the encoded
+ * data of each strip.  Called concurrently for different strips.
+ */
+static void
+encode_strips (gsize          offset,
+               gsize          size,
+               SaveStripData *data)
+{
+  guchar *src;
+  guchar *bits = NULL;
+  gint    bitsperrow;
+  gsize   i;
+
+  src = g_new (guchar, data->bytesperrow * data->rowsperstrip);
+
+  bitsperrow = (data->bytesperrow + 7) / 8;
+
+  if (data->is_bw)
+    bits = g_new (guchar, bitsperrow * data->rowsperstrip);
+
+  for (i = offset; i < offset + size; i++)
+    {
+      gint        strip  = data->first_strip + i;
+      gint        y      = strip * data->rowsperstrip;
+      gint        n_rows = MIN (data->rowsperstrip, data->rows - y);
+      guchar     *pixels = src;
+      gsize       pixels_size;
+      GByteArray *bytes;
+      TIFF       *mem;
+      toff_t     *offsets;
+      toff_t     *counts;
+
+      gegl_buffer_get (data->buffer,
+                       GEGL_RECTANGLE (0, y, data->cols, n_rows), 1.0,
+                       data->format, src,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      pixels_size = (gsize) data->bytesperrow * n_rows;
+
+      if (data->is_bw)
+        {
+          gint row;
+
+          for (row = 0; row < n_rows; row++)
+            byte2bit (src + data->bytesperrow * row, data->bytesperrow,
+                      bits + bitsperrow * row, data->invert);
+
+          pixels      = bits;
+          pixels_size = (gsize) bitsperrow * n_rows;
+        }
+
+      bytes = g_byte_array_new ();
+      mem   = tiff_open_memory (bytes, "w");
+
+      data->strips[i] = NULL;
+
+      if (mem)
+        {
+          TIFFSetField (mem, TIFFTAG_IMAGEWIDTH,      data->cols);
+          TIFFSetField (mem, TIFFTAG_IMAGELENGTH,     n_rows);
+          TIFFSetField (mem, TIFFTAG_BITSPERSAMPLE,   data->bitspersample);
+          TIFFSetField (mem, TIFFTAG_SAMPLESPERPIXEL, data->samplesperpixel);
+          TIFFSetField (mem, TIFFTAG_SAMPLEFORMAT,    data->sampleformat);
+          TIFFSetField (mem, TIFFTAG_PHOTOMETRIC,     data->photometric);
+          TIFFSetField (mem, TIFFTAG_PLANARCONFIG,    PLANARCONFIG_CONTIG);
+          TIFFSetField (mem, TIFFTAG_ROWSPERSTRIP,    n_rows);
+          TIFFSetField (mem, TIFFTAG_COMPRESSION,     data->compression);
+
+          /* Same condition as for the file itself, see save_layer() */
+          if ((data->compression == COMPRESSION_LZW ||
+               data->compression == COMPRESSION_ADOBE_DEFLATE) &&
+              (data->predictor != 0))
+            {
+              TIFFSetField (mem, TIFFTAG_PREDICTOR, data->predictor);
+            }
+
+          if (TIFFWriteEncodedStrip (mem, 0, pixels, pixels_size) >= 0 &&
+              TIFFGetField (mem, TIFFTAG_STRIPOFFSETS,    &offsets)     &&
+              TIFFGetField (mem, TIFFTAG_STRIPBYTECOUNTS, &counts))
+            {
+              data->strips[i] = g_byte_array_sized_new (counts[0]);
+
+              g_byte_array_append (data->strips[i],
+                                   bytes->data + offsets[0], counts[0]);
+            }
+
+          TIFFClose (mem);
+        }
+
+      g_byte_array_unref (bytes);
+    }
+
+  g_free (src);
+  g_free (bits);
+}
+
+static gboolean
+save_strips (TIFF          *tif,
+             SaveStripData *data,
+             gdouble        progress_base,
+             gdouble        progress_fraction)
+{
+  gint     n_strips;
+  gint     batch_size;
+  gint     strip;
+  gboolean success = TRUE;
+
+  n_strips   = (data->rows + data->rowsperstrip - 1) / data->rowsperstrip;
+  batch_size = 4 * gimp_get_num_processors ();
+
+  data->strips = g_new0 (GByteArray *, batch_size);
+
+  for (strip = 0; success && strip < n_strips; strip += batch_size)
+    {
+      gint n = MIN (batch_size, n_strips - strip);
+      gint i;
+
+      data->first_strip = strip;
+
+      gegl_parallel_distribute_range (
+        n, 1,
+        (GeglParallelDistributeRangeFunc) encode_strips,
+        data);
+
+      /* The encoded strips are written in order, from this thread */
+      for (i = 0; i < n; i++)
+        {
+          if (success)
+            {
+              success = (data->strips[i] &&
+                         TIFFWriteRawStrip (tif, strip + i,
+                                            data->strips[i]->data,
+                                            data->strips[i]->len) >= 0);
+
+              if (! success)
+                data->first_strip = strip + i;
+            }
+
+          if (data->strips[i])
+            g_byte_array_unref (data->strips[i]);
+        }
+
+      gimp_progress_update (progress_base + progress_fraction *
+                            (gdouble) (strip + n) / (gdouble) n_strips);
+    }
+
+  g_free (data->strips);
+  data->strips = NULL;
+
+  return success;
+}
@@ -16,6 +16,52 @@
 #include "libgimp/stdplugins-intl.h"
 
 
+/* Number of rows rendered, and written back, at once */
+#define BAND_HEIGHT 64
+
+
+typedef struct
+{
+  get_ray_func  ray_func;
+  guchar       *row;
+  gint          y;
+  gboolean      has_alpha;
+} RenderRowData;
+
+
+/* Shade the pixels [x, x + n) of a single row.  Called concurrently */
+/* for disjoint ranges of the row; only reads the shared state.      */
+
+static void
+compute_row_range (gsize          x,
+                   gsize          n,
+                   RenderRowData *data)
+{
+  guchar *row  = data->row;
+  gint    obpp = data->has_alpha ? 4 : 3;
+  gsize   index;
+  gsize   xcount;
+
+  index = x * obpp;
+
+  for (xcount = x; xcount < x + n; xcount++)
+    {
+      GimpVector3 p;
+      GimpRGB     color;
+
+      p = int_to_pos (xcount, data->y);
+      color = (* data->ray_func) (&p);
+
+      row[index++] = (guchar) (color.r * 255.0);
+      row[index++] = (guchar) (color.g * 255.0);
+      row[index++] = (guchar) (color.b * 255.0);
+
+      if (data->has_alpha)
+        row[index++] = (guchar) (color.a * 255.0);
+    }
+}
+
+
 /*************/
 /* Main loop */
 /*************/
@@ -23,17 +69,16 @@
 void
 compute_image (void)
 {
-  gint         xcount, ycount;
-  GimpRGB      color;
-  glong        progress_counter = 0;
-  GimpVector3  p;
-  GimpImage   *new_image = NULL;
-  GimpLayer   *new_layer = NULL;
-  gint32       index;
-  guchar      *row = NULL;
-  guchar       obpp;
-  gboolean     has_alpha;
-  get_ray_func ray_func;
+  gint          ycount;
+  gint          band_y;
+  glong         progress_counter = 0;
+  GimpImage    *new_image = NULL;
+  GimpLayer    *new_layer = NULL;
+  guchar       *band = NULL;
+  guchar        obpp;
+  gboolean      has_alpha;
+  get_ray_func  ray_func;
+  RenderRowData data;
 
   if (mapvals.create_new_image == TRUE ||
       (mapvals.transparent_background == TRUE &&
@@ -96,7 +141,10 @@ compute_image (void)
   /* FIXME */
   obpp = has_alpha ? 4 : 3; //gimp_drawable_bpp (output_drawable);
 
-  row = g_new (guchar, obpp * width);
+  band = g_new (guchar, (gsize) obpp * width * BAND_HEIGHT);
+
+  data.ray_func  = ray_func;
+  data.has_alpha = has_alpha;
 
   gimp_progress_init (_("Lighting Effects"));
 
@@ -104,41 +152,47 @@ compute_image (void)
   if (mapvals.bump_mapped == TRUE && mapvals.bumpmap_id != -1 && height >= 2)
     interpol_row (0, width, 0);
 
-  for (ycount = 0; ycount < height; ycount++)
+  for (band_y = 0; band_y < height; band_y += BAND_HEIGHT)
     {
-      if (mapvals.bump_mapped == TRUE && mapvals.bumpmap_id != -1)
-	precompute_normals (0, width, ycount);
-
-      index = 0;
+      gint band_height = MIN (BAND_HEIGHT, height - band_y);
 
-      for (xcount = 0; xcount < width; xcount++)
-	{
-	  p = int_to_pos (xcount, ycount);
-	  color = (* ray_func) (&p);
+      /* The bilinear lookup may touch the rows just outside the band */
+      image_cache_rows (band_y - 1, band_y + band_height + 1);
 
-	  row[index++] = (guchar) (color.r * 255.0);
-	  row[index++] = (guchar) (color.g * 255.0);
-	  row[index++] = (guchar) (color.b * 255.0);
+      for (ycount = band_y; ycount < band_y + band_height; ycount++)
+        {
+          /* The bump map normals are rolled forward row by row, so */
+          /* rows are shaded in order, each split across threads.   */
+          if (mapvals.bump_mapped == TRUE && mapvals.bumpmap_id != -1)
+            precompute_normals (0, width, ycount);
+
+          data.row = band + (gsize) obpp * width * (ycount - band_y);
+          data.y   = ycount;
+
+          gegl_parallel_distribute_range (
+            width, 64,
+            (GeglParallelDistributeRangeFunc) compute_row_range,
+            &data);
+        }
 
-	  if (has_alpha)
-	    row[index++] = (guchar) (color.a * 255.0);
+      gegl_buffer_set (dest_buffer,
+                       GEGL_RECTANGLE (0, band_y, width, band_height), 0,
+                       has_alpha ?
+                       babl_format ("R'G'B'A u8") : babl_format ("R'G'B' u8"),
+                       band,
+                       GEGL_AUTO_ROWSTRIDE);
 
-	  progress_counter++;
-	}
+      progress_counter += (glong) width * band_height;
 
       gimp_progress_update ((gdouble) progress_counter /
                             (gdouble) maxcounter);
-
-      gegl_buffer_set (dest_buffer, GEGL_RECTANGLE (0, ycount, width, 1), 0,
-                       has_alpha ?
-                       babl_format ("R'G'B'A u8") : babl_format ("R'G'B' u8"),
-                       row,
-                       GEGL_AUTO_ROWSTRIDE);
     }
 
+  image_cache_free ();
+
   gimp_progress_update (1.0);
 
-  g_free (row);
+  g_free (band);
 
   g_object_unref (dest_buffer);
 
@@ -39,6 +39,10 @@ gint border_x1, border_y1, border_x2, border_y2;
 
 guchar sinemap[256], spheremap[256], logmap[256];
 
+static GimpRGB *image_cache    = NULL;
+static gint     image_cache_y1 = 0;
+static gint     image_cache_y2 = 0;
+
 /******************/
 /* Implementation */
 /******************/
@@ -73,6 +77,13 @@ peek (gint x,
 {
   GimpRGB color;
 
+  if (image_cache                                  &&
+      x >= 0              && x < width             &&
+      y >= image_cache_y1 && y < image_cache_y2)
+    {
+      return image_cache[(y - image_cache_y1) * width + x];
+    }
+
   gegl_buffer_sample (source_buffer, x, y, NULL,
                       &color, babl_format ("R'G'B'A double"),
                       GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
@@ -83,6 +94,41 @@ peek (gint x,
   return color;
 }
 
+/*****************************************************/
+/* Keep the source rows [y1, y2) in memory, so that  */
+/* peek() can be called concurrently while rendering */
+/*****************************************************/
+
+void
+image_cache_rows (gint y1,
+                  gint y2)
+{
+  y1 = CLAMP (y1, 0, height);
+  y2 = CLAMP (y2, y1, height);
+
+  image_cache_free ();
+
+  if (y2 == y1)
+    return;
+
+  image_cache    = g_new (GimpRGB, (gsize) width * (y2 - y1));
+  image_cache_y1 = y1;
+  image_cache_y2 = y2;
+
+  gegl_buffer_get (source_buffer, GEGL_RECTANGLE (0, y1, width, y2 - y1), 1.0,
+                   babl_format ("R'G'B'A double"), image_cache,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+}
+
+void
+image_cache_free (void)
+{
+  g_clear_pointer (&image_cache, g_free);
+
+  image_cache_y1 = 0;
+  image_cache_y2 = 0;
+}
+
 GimpRGB
 peek_env_map (gint x,
 	      gint y)
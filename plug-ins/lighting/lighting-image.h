@@ -36,6 +36,9 @@ guchar         peek_map        (GeglBuffer   *buffer,
 				gint          y);
 GimpRGB        peek            (gint          x,
 				gint          y);
+void           image_cache_rows (gint         y1,
+                                 gint         y2);
+void           image_cache_free (void);
 GimpRGB        peek_env_map    (gint          x,
 				gint          y);
 void           poke            (gint          x,
@@ -31,7 +31,8 @@ phong_shade (GimpVector3 *position,
              GimpVector3 *lightposition,
              GimpRGB      *diff_col,
              GimpRGB      *light_col,
-             LightType    light_type)
+             LightType    light_type,
+             gdouble      diffuse_int)
 {
   GimpRGB       diffuse_color, specular_color;
   gdouble      nl, rv, dist;
@@ -82,7 +83,7 @@ phong_shade (GimpVector3 *position,
       /* =================================================== */
 
       diffuse_color = *light_col;
-      gimp_rgb_multiply (&diffuse_color, mapvals.material.diffuse_int);
+      gimp_rgb_multiply (&diffuse_color, diffuse_int);
       diffuse_color.r *= diff_col->r;
       diffuse_color.g *= diff_col->g;
       diffuse_color.b *= diff_col->b;
@@ -483,10 +484,10 @@ sphere_to_image (GimpVector3 *normal,
                  gdouble     *u,
                  gdouble     *v)
 {
-  static gdouble     alpha, fac;
-  static GimpVector3 cross_prod;
-  static GimpVector3 firstaxis  = { 1.0, 0.0, 0.0 };
-  static GimpVector3 secondaxis = { 0.0, 1.0, 0.0 };
+  static const GimpVector3 firstaxis  = { 1.0, 0.0, 0.0 };
+  static const GimpVector3 secondaxis = { 0.0, 1.0, 0.0 };
+  gdouble                  alpha, fac;
+  GimpVector3              cross_prod;
 
   alpha = acos (-gimp_vector3_inner_product (&secondaxis, normal));
 
@@ -570,7 +571,8 @@ get_ray_color (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[k].type);
+                                         mapvals.lightsource[k].type,
+                                         mapvals.material.diffuse_int);
             }
           else
             {
@@ -582,7 +584,8 @@ get_ray_color (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[k].type);
+                                         mapvals.lightsource[k].type,
+                                         mapvals.material.diffuse_int);
             }
 
           gimp_rgb_add (&color_sum, &light_color);
@@ -605,7 +608,6 @@ get_ray_color_ref (GimpVector3 *position)
   gdouble      xf, yf;
   GimpVector3  normal, *p, v, r;
   gint         k;
-  gdouble      tmpval;
 
   pos_to_float (position->x, position->y, &xf, &yf);
 
@@ -652,7 +654,8 @@ get_ray_color_ref (GimpVector3 *position)
                                      p,
                                      &color,
                                      &color_int,
-                                     mapvals.lightsource[0].type);
+                                     mapvals.lightsource[0].type,
+                                     mapvals.material.diffuse_int);
         }
 
       gimp_vector3_sub (&v, &mapvals.viewpoint, position);
@@ -667,18 +670,14 @@ get_ray_color_ref (GimpVector3 *position)
       env_color = peek_env_map (RINT (env_width * xf),
                                 RINT (env_height * yf));
 
-      tmpval = mapvals.material.diffuse_int;
-      mapvals.material.diffuse_int = 0.;
-
       light_color = phong_shade (position,
                                  &mapvals.viewpoint,
                                  &normal,
                                  &r,
                                  &color,
                                  &env_color,
-                                 DIRECTIONAL_LIGHT);
-
-      mapvals.material.diffuse_int = tmpval;
+                                 DIRECTIONAL_LIGHT,
+                                 0.0);
 
       gimp_rgb_add (&color_sum, &light_color);
     }
@@ -737,7 +736,8 @@ get_ray_color_no_bilinear (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[k].type);
+                                         mapvals.lightsource[k].type,
+                                         mapvals.material.diffuse_int);
             }
           else
             {
@@ -749,7 +749,8 @@ get_ray_color_no_bilinear (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[k].type);
+                                         mapvals.lightsource[k].type,
+                                         mapvals.material.diffuse_int);
             }
 
           gimp_rgb_add (&color_sum, &light_color);
@@ -772,7 +773,6 @@ get_ray_color_no_bilinear_ref (GimpVector3 *position)
   gdouble      xf, yf;
   GimpVector3  normal, *p, v, r;
   gint         k;
-  gdouble      tmpval;
 
   pos_to_float (position->x, position->y, &xf, &yf);
 
@@ -819,7 +819,8 @@ get_ray_color_no_bilinear_ref (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[0].type);
+                                         mapvals.lightsource[0].type,
+                                         mapvals.material.diffuse_int);
         }
 
       gimp_vector3_sub (&v, &mapvals.viewpoint, position);
@@ -834,18 +835,14 @@ get_ray_color_no_bilinear_ref (GimpVector3 *position)
       env_color = peek_env_map (RINT (env_width * xf),
                                 RINT (env_height * yf));
 
-      tmpval = mapvals.material.diffuse_int;
-      mapvals.material.diffuse_int = 0.;
-
       light_color = phong_shade (position,
                                  &mapvals.viewpoint,
                                  &normal,
                                  &r,
                                  &color,
                                  &env_color,
-                                 DIRECTIONAL_LIGHT);
-
-      mapvals.material.diffuse_int = tmpval;
+                                 DIRECTIONAL_LIGHT,
+                                 0.0);
 
       gimp_rgb_add (&color_sum, &light_color);
     }
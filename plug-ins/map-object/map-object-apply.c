@@ -19,6 +19,10 @@
 #include "libgimp/stdplugins-intl.h"
 
 
+/* Size of the output tiles rendered by the worker threads */
+#define TILE_SIZE 64
+
+
 /*************/
 /* Main loop */
 /*************/
@@ -195,13 +199,97 @@ render (gdouble   x,
   *col = get_ray_color (&pos);
 }
 
+typedef struct
+{
+  GeglRectangle  area;
+  GimpRGB       *pixels;
+} RenderTile;
+
+static void
+put_tile_pixel (gint      x,
+                gint      y,
+                GimpRGB  *color,
+                gpointer  data)
+{
+  RenderTile *tile = data;
+
+  tile->pixels[(y - tile->area.y) * tile->area.width +
+               (x - tile->area.x)] = *color;
+}
+
+/*******************************************************/
+/* Renders one tile of the output image, and writes it */
+/* back in one go. Called concurrently for different   */
+/* tiles, so only the shared read-only state is used.  */
+/*******************************************************/
+
+static void
+render_tile (const GeglRectangle *area)
+{
+  RenderTile tile;
+
+  tile.area   = *area;
+  tile.pixels = g_new (GimpRGB, area->width * area->height);
+
+  if (! mapvals.antialiasing)
+    {
+      GimpRGB *pixel = tile.pixels;
+      gint     xcount, ycount;
+
+      for (ycount = area->y; ycount < area->y + area->height; ycount++)
+        {
+          for (xcount = area->x; xcount < area->x + area->width; xcount++)
+            {
+              GimpVector3 p = int_to_pos (xcount, ycount);
+
+              *pixel++ = (* get_ray_color) (&p);
+            }
+        }
+    }
+  else
+    {
+      /* Pixels only look at their own corners, so supersampling */
+      /* each tile separately gives the same result as doing the */
+      /* whole image at once.                                    */
+      gimp_adaptive_supersample_area (area->x,
+                                      area->y,
+                                      area->x + area->width  - 1,
+                                      area->y + area->height - 1,
+                                      max_depth,
+                                      mapvals.pixelthreshold,
+                                      render,
+                                      NULL,
+                                      put_tile_pixel,
+                                      &tile,
+                                      NULL,
+                                      NULL);
+    }
+
+  gegl_buffer_set (dest_buffer, area, 0,
+                   babl_format ("R'G'B'A double"), tile.pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_free (tile.pixels);
+}
+
 static void
-show_progress (gint     min,
-               gint     max,
-               gint     curr,
-               gpointer data)
+render_row_of_tiles (gsize                offset,
+                     gsize                size,
+                     const GeglRectangle *row)
 {
-  gimp_progress_update ((gdouble) curr / (gdouble) max);
+  gsize i;
+
+  for (i = offset; i < offset + size; i++)
+    {
+      GeglRectangle area;
+
+      area.x      = row->x + i * TILE_SIZE;
+      area.y      = row->y;
+      area.width  = MIN (TILE_SIZE, row->x + row->width - area.x);
+      area.height = row->height;
+
+      render_tile (&area);
+    }
 }
 
 /**************************************************/
@@ -212,10 +300,8 @@ show_progress (gint     min,
 void
 compute_image (void)
 {
-  gint         xcount, ycount;
-  GimpRGB      color;
-  glong        progress_counter = 0;
-  GimpVector3  p;
+  gint         ycount;
+  gint         n_tiles_x;
   GimpImage   *new_image    = NULL;
   GimpLayer   *new_layer    = NULL;
   gboolean     insert_layer = FALSE;
@@ -276,37 +362,32 @@ compute_image (void)
       break;
     }
 
-  if (! mapvals.antialiasing)
-    {
-      for (ycount = 0; ycount < height; ycount++)
-        {
-          for (xcount = 0; xcount < width; xcount++)
-            {
-              p = int_to_pos (xcount, ycount);
-              color = (* get_ray_color) (&p);
-              poke (xcount, ycount, &color, NULL);
+  image_cache_textures ();
 
-              progress_counter++;
-            }
+  n_tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
 
-          gimp_progress_update ((gdouble) progress_counter /
-                                (gdouble) maxcounter);
-        }
-    }
-  else
+  /* Render one row of tiles at a time, so that progress can be */
+  /* reported from this thread in between.                      */
+
+  for (ycount = 0; ycount < height; ycount += TILE_SIZE)
     {
-      gimp_adaptive_supersample_area (0, 0,
-                                      width - 1, height - 1,
-                                      max_depth,
-                                      mapvals.pixelthreshold,
-                                      render,
-                                      NULL,
-                                      poke,
-                                      NULL,
-                                      show_progress,
-                                      NULL);
+      GeglRectangle row;
+
+      gegl_rectangle_set (&row,
+                          0, ycount,
+                          width, MIN (TILE_SIZE, height - ycount));
+
+      gegl_parallel_distribute_range (
+        n_tiles_x, 1,
+        (GeglParallelDistributeRangeFunc) render_row_of_tiles,
+        &row);
+
+      gimp_progress_update ((gdouble) (ycount + row.height) /
+                            (gdouble) height);
     }
 
+  image_free_textures ();
+
   gimp_progress_update (1.0);
 
   g_object_unref (source_buffer);
@@ -46,6 +46,132 @@ GimpRGB  background;
 
 gint border_x, border_y, border_w, border_h;
 
+
+/* Source images are read into memory a tile at a time, the first time */
+/* a tile is looked up, so that the renderer threads don't have to go  */
+/* through the plug-in tile backend for every single texel.            */
+
+#define TEXTURE_TILE_SIZE 64
+
+typedef struct
+{
+  GeglBuffer  *buffer;
+  gint         width;
+  gint         height;
+  gint         n_tiles_x;
+  gint         n_tiles_y;
+  gboolean     has_alpha;
+  GimpRGB    **tiles;
+} TextureCache;
+
+static TextureCache *source_cache       = NULL;
+static TextureCache *box_caches[6]      = { NULL, };
+static TextureCache *cylinder_caches[2] = { NULL, };
+
+
+static TextureCache *
+texture_cache_new (GeglBuffer *buffer)
+{
+  TextureCache *cache;
+
+  if (! buffer)
+    return NULL;
+
+  cache = g_slice_new0 (TextureCache);
+
+  cache->buffer    = g_object_ref (buffer);
+  cache->width     = gegl_buffer_get_width  (buffer);
+  cache->height    = gegl_buffer_get_height (buffer);
+  cache->n_tiles_x = (cache->width  + TEXTURE_TILE_SIZE - 1) /
+                     TEXTURE_TILE_SIZE;
+  cache->n_tiles_y = (cache->height + TEXTURE_TILE_SIZE - 1) /
+                     TEXTURE_TILE_SIZE;
+  cache->has_alpha = babl_format_has_alpha (gegl_buffer_get_format (buffer));
+  cache->tiles     = g_new0 (GimpRGB *, cache->n_tiles_x * cache->n_tiles_y);
+
+  return cache;
+}
+
+static void
+texture_cache_free (TextureCache *cache)
+{
+  gint i;
+
+  if (! cache)
+    return;
+
+  for (i = 0; i < cache->n_tiles_x * cache->n_tiles_y; i++)
+    g_free (cache->tiles[i]);
+
+  g_free (cache->tiles);
+  g_object_unref (cache->buffer);
+
+  g_slice_free (TextureCache, cache);
+}
+
+static GimpRGB
+texture_cache_peek (TextureCache *cache,
+                    gint          x,
+                    gint          y)
+{
+  GimpRGB *tile;
+  gint     tile_x, tile_y;
+  gint     tile_width;
+  gint     index;
+
+  if (x < 0 || y < 0 || x >= cache->width || y >= cache->height)
+    {
+      GimpRGB color = { 0.0, 0.0, 0.0, cache->has_alpha ? 0.0 : 1.0 };
+
+      return color;
+    }
+
+  tile_x = x / TEXTURE_TILE_SIZE;
+  tile_y = y / TEXTURE_TILE_SIZE;
+  index  = tile_y * cache->n_tiles_x + tile_x;
+
+  tile_width = MIN (TEXTURE_TILE_SIZE,
+                    cache->width - tile_x * TEXTURE_TILE_SIZE);
+
+  tile = g_atomic_pointer_get (&cache->tiles[index]);
+
+  if (! tile)
+    {
+      GeglRectangle rect;
+      gint          i;
+
+      gegl_rectangle_set (&rect,
+                          tile_x * TEXTURE_TILE_SIZE,
+                          tile_y * TEXTURE_TILE_SIZE,
+                          tile_width,
+                          MIN (TEXTURE_TILE_SIZE,
+                               cache->height - tile_y * TEXTURE_TILE_SIZE));
+
+      tile = g_new (GimpRGB, rect.width * rect.height);
+
+      gegl_buffer_get (cache->buffer, &rect, 1.0,
+                       babl_format ("R'G'B'A double"), tile,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      if (! cache->has_alpha)
+        {
+          for (i = 0; i < rect.width * rect.height; i++)
+            tile[i].a = 1.0;
+        }
+
+      /* Another thread may have read the same tile in the meantime */
+      if (! g_atomic_pointer_compare_and_exchange (&cache->tiles[index],
+                                                   NULL, tile))
+        {
+          g_free (tile);
+
+          tile = g_atomic_pointer_get (&cache->tiles[index]);
+        }
+    }
+
+  return tile[(y % TEXTURE_TILE_SIZE) * tile_width + (x % TEXTURE_TILE_SIZE)];
+}
+
 /******************/
 /* Implementation */
 /******************/
@@ -56,6 +182,9 @@ peek (gint x,
 {
   GimpRGB color;
 
+  if (source_cache)
+    return texture_cache_peek (source_cache, x, y);
+
   gegl_buffer_sample (source_buffer, x, y, NULL,
                       &color, babl_format ("R'G'B'A double"),
                       GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
@@ -73,6 +202,9 @@ peek_box_image (gint image,
 {
   GimpRGB color;
 
+  if (box_caches[image])
+    return texture_cache_peek (box_caches[image], x, y);
+
   gegl_buffer_sample (box_buffers[image], x, y, NULL,
                       &color, babl_format ("R'G'B'A double"),
                       GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
@@ -90,6 +222,9 @@ peek_cylinder_image (gint image,
 {
   GimpRGB color;
 
+  if (cylinder_caches[image])
+    return texture_cache_peek (cylinder_caches[image], x, y);
+
   gegl_buffer_sample (cylinder_buffers[image], x, y, NULL,
                       &color, babl_format ("R'G'B'A double"),
                       GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
@@ -352,3 +487,43 @@ image_setup (GimpDrawable *drawable,
 
   return TRUE;
 }
+
+/****************************************************/
+/* Set up, and tear down, the in-memory copies of   */
+/* the source images used while rendering the image */
+/****************************************************/
+
+void
+image_cache_textures (void)
+{
+  gint i;
+
+  image_free_textures ();
+
+  source_cache = texture_cache_new (source_buffer);
+
+  if (mapvals.maptype == MAP_BOX)
+    {
+      for (i = 0; i < 6; i++)
+        box_caches[i] = texture_cache_new (box_buffers[i]);
+    }
+  else if (mapvals.maptype == MAP_CYLINDER)
+    {
+      for (i = 0; i < 2; i++)
+        cylinder_caches[i] = texture_cache_new (cylinder_buffers[i]);
+    }
+}
+
+void
+image_free_textures (void)
+{
+  gint i;
+
+  g_clear_pointer (&source_cache, texture_cache_free);
+
+  for (i = 0; i < 6; i++)
+    g_clear_pointer (&box_caches[i], texture_cache_free);
+
+  for (i = 0; i < 2; i++)
+    g_clear_pointer (&cylinder_caches[i], texture_cache_free);
+}
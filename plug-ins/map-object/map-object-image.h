@@ -61,4 +61,7 @@ extern GimpRGB     get_cylinder_image_color (gint         image,
                                              gdouble      u,
                                              gdouble      v);
 
+extern void        image_cache_textures     (void);
+extern void        image_free_textures      (void);
+
 #endif  /* __MAPOBJECT_IMAGE_H__ */
@@ -0,0 +1,250 @@
+#!/usr/bin/env python3
+
+#   Export Benchmarks
+#
+"""
+  Measures how long a file format's export procedure takes on a
+  synthetic image, once for each of the format's main settings, and
+  reports the median time, the throughput and the resulting file size.
+
+  The image is filled with plasma from a fixed seed, so runs are
+  comparable across builds and machines.
+"""
+#   This program is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation; either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import os, sys, tempfile, time
+
+import gi
+gi.require_version('Gimp', '3.0')
+from gi.repository import Gimp
+from gi.repository import GObject
+from gi.repository import GLib
+from gi.repository import Gio
+
+
+def png_header (args):
+    return ", serial deflate" if 'GIMP_PNG_SERIAL_DEFLATE' in os.environ else ""
+
+def png_args (level, args):
+    return [
+        # interlaced, compression
+        GObject.Value(GObject.TYPE_BOOLEAN, False),
+        GObject.Value(GObject.TYPE_INT, level),
+        # leave out every optional chunk: bkgd, gama, offs, phys, time
+        GObject.Value(GObject.TYPE_BOOLEAN, False),
+        GObject.Value(GObject.TYPE_BOOLEAN, False),
+        GObject.Value(GObject.TYPE_BOOLEAN, False),
+        GObject.Value(GObject.TYPE_BOOLEAN, False),
+        GObject.Value(GObject.TYPE_BOOLEAN, False),
+        # save-transparent
+        GObject.Value(GObject.TYPE_BOOLEAN, False),
+    ]
+
+def dds_header (args):
+    return ", with mipmaps" + (", perceptual metric" if args.index(4) else "")
+
+def dds_args (compression, args):
+    return [
+        GObject.Value(GObject.TYPE_INT, compression),
+        # generate mipmaps for the selected layer
+        GObject.Value(GObject.TYPE_INT, 1),
+        GObject.Value(GObject.TYPE_INT, 0),
+        GObject.Value(GObject.TYPE_INT, 0),
+        GObject.Value(GObject.TYPE_BOOLEAN, False),
+        GObject.Value(GObject.TYPE_INT, 0),
+        # default filter and wrap, no gamma correction
+        GObject.Value(GObject.TYPE_INT, 0),
+        GObject.Value(GObject.TYPE_INT, 0),
+        GObject.Value(GObject.TYPE_BOOLEAN, False),
+        GObject.Value(GObject.TYPE_BOOLEAN, False),
+        GObject.Value(GObject.TYPE_DOUBLE, 0.0),
+        GObject.Value(GObject.TYPE_BOOLEAN, args.index(4)),
+        GObject.Value(GObject.TYPE_BOOLEAN, False),
+        GObject.Value(GObject.TYPE_DOUBLE, 0.5),
+    ]
+
+FORMATS = {
+    "python-fu-benchmark-png-export": {
+        "label":     "PNG Export",
+        "help":      "Exports the image at every compression level. "
+                     "Non-interlaced images are deflated by all processors "
+                     "at once; set GIMP_PNG_SERIAL_DEFLATE in the environment "
+                     "before starting GIMP to have libpng compress them on a "
+                     "single thread instead, and compare.",
+        "procedure": "file-png-save",
+        "extension": "png",
+        "type":      Gimp.ImageType.RGB_IMAGE,
+        "variants":  [("%d" % level, level) for level in range(10)],
+        "column":    "level",
+        # megabytes of uncompressed pixel data
+        "unit":      "MB/s",
+        "size":      lambda width, height: width * height * 3 / (1024.0 * 1024.0),
+        "header":    png_header,
+        "args":      png_args,
+        "options":   [],
+    },
+    "python-fu-benchmark-dds-export": {
+        "label":     "DDS Export",
+        "help":      "Exports the image with a full mipmap chain in each of "
+                     "the BC1 to BC5 formats. Mipmap generation and block "
+                     "compression are spread over all processors; set the "
+                     "number of threads in Preferences to compare.",
+        "procedure": "file-dds-save",
+        "extension": "dds",
+        "type":      Gimp.ImageType.RGBA_IMAGE,
+        "variants":  [("BC1", 1), ("BC2", 2), ("BC3", 3), ("BC4", 5), ("BC5", 6)],
+        "column":    "format",
+        # megapixels of the base level
+        "unit":      "MP/s",
+        "size":      lambda width, height: width * height / 1000000.0,
+        "header":    dds_header,
+        "args":      dds_args,
+        "options":   ["perceptual"],
+    },
+}
+
+def benchmark (procedure, args, data):
+    fmt = FORMATS[procedure.get_name()]
+
+    if args.length() != 4 + len(fmt["options"]):
+        error = 'Wrong parameters given'
+        return procedure.new_return_values(Gimp.PDBStatusType.CALLING_ERROR,
+                                           GLib.Error(error))
+    run_mode = args.index(0)
+    width = args.index(1)
+    height = args.index(2)
+    runs = args.index(3)
+
+    image = Gimp.Image.new(width, height, Gimp.ImageBaseType.RGB)
+    layer = Gimp.Layer.new(image, "Plasma", width, height,
+                           fmt["type"], 100,
+                           Gimp.LayerMode.NORMAL)
+    image.insert_layer(layer, None, 0)
+
+    Gimp.get_pdb().run_procedure('plug-in-plasma', [
+        GObject.Value(Gimp.RunMode, Gimp.RunMode.NONINTERACTIVE),
+        GObject.Value(Gimp.Image, image),
+        GObject.Value(Gimp.Drawable, layer),
+        GObject.Value(GObject.TYPE_INT, 0),
+        GObject.Value(GObject.TYPE_DOUBLE, 1.0),
+    ])
+
+    size = fmt["size"](width, height)
+    tempdir = tempfile.mkdtemp('gimp-benchmark-' + fmt["extension"] + '-export')
+    filename = os.path.join(tempdir, 'benchmark.' + fmt["extension"])
+
+    sys.stderr.write("%dx%d, %d processors%s\n" %
+                     (width, height, Gimp.get_num_processors(),
+                      fmt["header"](args)))
+    sys.stderr.write("%-6s   time (s)   %s   size (bytes)\n" %
+                     (fmt["column"], fmt["unit"]))
+
+    for name, variant in fmt["variants"]:
+        times = []
+
+        for run in range(runs):
+            start = time.time()
+            Gimp.get_pdb().run_procedure(fmt["procedure"], [
+                GObject.Value(Gimp.RunMode, Gimp.RunMode.NONINTERACTIVE),
+                GObject.Value(Gimp.Image, image),
+                GObject.Value(GObject.TYPE_INT, 1),
+                GObject.Value(Gimp.ObjectArray, Gimp.ObjectArray.new(Gimp.Drawable, [layer], 1)),
+                GObject.Value(Gio.File, Gio.File.new_for_path(filename)),
+            ] + fmt["args"](variant, args))
+            end = time.time()
+
+            times.append(end - start)
+
+        times.sort()
+        median = times[len(times) // 2]
+
+        sys.stderr.write("%-6s %10.3f %6.1f %14d\n" %
+                         (name, median, size / median,
+                          os.path.getsize(filename)))
+
+        os.remove(filename)
+
+    os.rmdir(tempdir)
+    image.delete()
+
+    return procedure.new_return_values(Gimp.PDBStatusType.SUCCESS, GLib.Error())
+
+
+class BenchmarkExport(Gimp.PlugIn):
+
+    ## Parameters ##
+    __gproperties__ = {
+        "run-mode": (Gimp.RunMode,
+                     "Run mode",
+                     "The run mode",
+                     Gimp.RunMode.NONINTERACTIVE,
+                     GObject.ParamFlags.READWRITE),
+        "width": (int,
+                  "Width",
+                  "Width of the synthetic image",
+                  1, 65536, 4096,
+                  GObject.ParamFlags.READWRITE),
+        "height": (int,
+                   "Height",
+                   "Height of the synthetic image",
+                   1, 65536, 4096,
+                   GObject.ParamFlags.READWRITE),
+        "runs": (int,
+                 "Runs",
+                 "Number of exports per setting; the median time is reported",
+                 1, 100, 3,
+                 GObject.ParamFlags.READWRITE),
+        "perceptual": (bool,
+                       "Perceptual metric",
+                       "Use the perceptual error metric",
+                       False,
+                       GObject.ParamFlags.READWRITE)
+    }
+
+    ## GimpPlugIn virtual methods ##
+    def do_query_procedures(self):
+        self.set_translation_domain("gimp30-python",
+                                    Gio.file_new_for_path(Gimp.locale_directory()))
+        return list(FORMATS.keys())
+
+    def do_create_procedure(self, name):
+        procedure = None
+        if name in FORMATS:
+            fmt = FORMATS[name]
+
+            procedure = Gimp.Procedure.new(self, name,
+                                           Gimp.PDBProcType.PLUGIN,
+                                           benchmark, None)
+            procedure.set_documentation(
+                "Benchmark for " + fmt["extension"].upper() + " export",
+                globals()["__doc__"] + "\n  " + fmt["help"],
+                name)
+            procedure.set_menu_label(fmt["label"])
+            procedure.set_attribution("The GIMP Team",
+                                      "The GIMP Team",
+                                      "2023")
+            procedure.add_menu_path("<Image>/Filters/Extensions/Benchmark")
+
+            procedure.add_argument_from_property(self, "run-mode")
+            procedure.add_argument_from_property(self, "width")
+            procedure.add_argument_from_property(self, "height")
+            procedure.add_argument_from_property(self, "runs")
+
+            for option in fmt["options"]:
+                procedure.add_argument_from_property(self, option)
+
+        return procedure
+
+
+Gimp.main(BenchmarkExport.__gtype__, sys.argv)